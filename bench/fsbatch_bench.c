@@ -0,0 +1,137 @@
+/**
+ * @file fsbatch_bench.c
+ * @brief Бенчмарк встроенных файловых команд на 100000 аргументах
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Выполняет строки "touch f0000000 f0000001 ...", "ls .", "rm ...",
+ * "mkdir ..." и "rmdir ..." во встроенном контексте во временном каталоге,
+ * один раз через io_uring и один раз синхронно (CUSTOM_SHELL_IO_URING=0).
+ * Строки проходят через разбор, как введённые в оболочке, поэтому замер
+ * включает разбор и проверяет, что argv не обрезается.
+ *
+ * Использование: fsbatch_bench [количество] [каталог]
+ */
+
+#define _GNU_SOURCE
+
+#include "customshell.h"
+#include "fsbatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @def BENCH_DEFAULT_COUNT
+ * @brief Количество аргументов по умолчанию
+ */
+#define BENCH_DEFAULT_COUNT 100000
+
+/**
+ * @brief Текущее монотонное время в секундах
+ * @return Время
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Замер выполнения одной строки
+ * @param ctx Контекст
+ * @param label Подпись
+ * @param line Строка команды
+ * @param ops Количество файловых операций в строке
+ * @param output Дескриптор вывода команды
+ * @return Время выполнения в секундах
+ */
+static double bench_run(shell_context_t *ctx, const char *label, const char *line,
+                        int ops, int output) {
+    shell_context_set_output(ctx, output);
+
+    double start = bench_now();
+    int result = shell_context_eval_string(ctx, line);
+    double elapsed = bench_now() - start;
+
+    printf("  %-8s %8.3f с  (%8.0f оп/с)%s\n", label, elapsed,
+           (double)ops / elapsed, result == 0 ? "" : "  ОШИБКА");
+    fflush(stdout);
+    return elapsed;
+}
+
+/**
+ * @brief Замена имени команды в начале строки
+ * @param line Строка с именем команды в первых 5 символах
+ * @param name Имя (не длиннее 5 символов)
+ */
+static void bench_set_command(char *line, const char *name) {
+    memset(line, ' ', 5);
+    memcpy(line, name, strlen(name));
+}
+
+/**
+ * @brief Точка входа бенчмарка
+ * @param argc Количество аргументов
+ * @param argv Аргументы
+ * @return Код выхода
+ */
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_COUNT;
+    const char *base = argc > 2 ? argv[2] : "/tmp";
+    if (count <= 0) {
+        fprintf(stderr, "fsbatch_bench: неверное количество '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/fsbatch_bench.XXXXXX", base);
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        fprintf(stderr, "fsbatch_bench: не удалось создать каталог: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // Строка вида "touch f0000000 ... f0099999": имя команды занимает пять
+    // символов, остальное - имена файлов
+    char *line = malloc(5 + (size_t)count * 9 + 1);
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    shell_context_t *ctx = shell_context_create();
+    if (!line || null_fd == -1 || !ctx) {
+        fprintf(stderr, "fsbatch_bench: не удалось подготовить контекст\n");
+        return EXIT_FAILURE;
+    }
+    char *end = line + 5;
+    for (int i = 0; i < count; i++) {
+        end += sprintf(end, " f%07d", i);
+    }
+
+    const char *modes[] = {"1", "0"};
+    for (int m = 0; m < 2; m++) {
+        setenv("CUSTOM_SHELL_IO_URING", modes[m], 1);
+        printf("%d аргументов, механизм: %s\n", count, fsbatch_backend(count));
+
+        bench_set_command(line, "touch");
+        bench_run(ctx, "touch", line, count, STDOUT_FILENO);
+        bench_run(ctx, "ls", "ls .", count, null_fd);
+        bench_set_command(line, "rm");
+        bench_run(ctx, "rm", line, count, STDOUT_FILENO);
+        bench_set_command(line, "mkdir");
+        bench_run(ctx, "mkdir", line, count, STDOUT_FILENO);
+        bench_set_command(line, "rmdir");
+        bench_run(ctx, "rmdir", line, count, STDOUT_FILENO);
+    }
+
+    if (chdir("/") == 0) {
+        rmdir(dir);
+    }
+    shell_context_destroy(ctx);
+    close(null_fd);
+    free(line);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file alias.h
+ * @brief Заголовочный файл псевдонимов команд (alias, unalias)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Тело псевдонима разбивается на слова тем же разбором, что и аргументы
+ * команды (parse_arguments), один раз при alias. При разборе команды слово
+ * в позиции команды (после префиксных присваиваний) заменяется готовыми
+ * словами тела без повторного разбора текста. Первое слово подстановки
+ * снова проверяется, поэтому псевдонимы раскрываются рекурсивно; каждый
+ * псевдоним раскрывается в команде не больше одного раза (псевдоним
+ * отмечается номером раскрытия), что исключает циклы вроде alias ls=ls или
+ * a=b, b=a. Если тело оканчивается пробелом, проверяется и следующее за
+ * подстановкой слово, как в bash.
+ *
+ * Псевдонимы принадлежат состоянию оболочки (shell_state_t::aliases):
+ * у каждого встроенного контекста и сеанса сервера свои. Они хранятся в
+ * хеш-таблице по имени без ограничения количества. Разобранные строки
+ * общие для всех сеансов (parse_cache_acquire), поэтому строка кэшируется
+ * вместе с ключом набора псевдонимов (shell_state_t::alias_key): любое
+ * изменение набора даёт новый ключ, а состояния без псевдонимов делят ключ
+ * 0. Тела ловушек и хуков разбираются при установке и видят псевдонимы на
+ * тот момент. Перенаправления, конвейеры и ';' в теле не поддерживаются:
+ * их разбирает parse_command до разбиения на слова.
+ */
+
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include "shell.h"
+
+/**
+ * @brief Псевдонимы состояния оболочки
+ */
+typedef struct alias_table alias_table_t;
+
+/**
+ * @brief Раскрытие псевдонимов в словах команды
+ * @param state Состояние оболочки
+ * @param args Указатель на массив слов (завершён NULL, может быть заменён)
+ * @param argc Указатель на количество слов
+ * @param position Индекс слова в позиции команды
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int alias_expand(shell_state_t *state, char ***args, int *argc, int position);
+
+/**
+ * @brief Определение псевдонима
+ * @param state Состояние оболочки
+ * @param name Имя
+ * @param value Тело
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int alias_define(shell_state_t *state, const char *name, const char *value);
+
+/**
+ * @brief Функция обхода псевдонимов
+ * @param name Имя
+ * @param text Тело
+ * @param arg Аргумент, переданный в alias_foreach
+ * @return 0 для продолжения обхода, иначе обход прекращается
+ */
+typedef int (*alias_visit_fn)(const char *name, const char *text, void *arg);
+
+/**
+ * @brief Обход псевдонимов в порядке имён (для вывода и образа сессии)
+ * @param state Состояние оболочки
+ * @param visit Функция обхода
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit (0 если обход завершён), -1 при нехватке памяти
+ */
+int alias_foreach(shell_state_t *state, alias_visit_fn visit, void *arg);
+
+/**
+ * @brief Удаление всех псевдонимов (unalias -a и при уничтожении состояния)
+ * @param state Состояние оболочки
+ */
+void alias_clear_all(shell_state_t *state);
+
+#endif /* ALIAS_H */
@@ -0,0 +1,109 @@
+/**
+ * @file audit.h
+ * @brief Заголовочный файл журнала аудита выполненных команд
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Если задана переменная CUSTOM_SHELL_AUDIT_LOG (файл) или
+ * CUSTOM_SHELL_AUDIT_SOCKET (Unix-сокет датаграмм), каждая выполненная
+ * команда записывается одной строкой JSON:
+ * @code
+ * {"start":1718000000.123456,"end":1718000000.125001,"pid":4242,"uid":1000,
+ *  "cwd":"/home/user","argv":[["ls","-la"],["wc","-l"]],"status":0,
+ *  "user":0.001200,"sys":0.000800}
+ * @endcode
+ * argv содержит слова каждого звена конвейера; user и sys - процессорное
+ * время звеньев и встроенных команд (с).
+ *
+ * Выполняющий команду поток только кладёт запись в свою очередь с одним
+ * писателем и одним читателем (без блокировок); фоновый поток забирает
+ * записи из очередей всех потоков и пишет их пачками: в файл одним write,
+ * в сокет одним sendmmsg. Очередь ограничена AUDIT_QUEUE_SIZE записями:
+ * если приёмник не успевает, новые записи отбрасываются, а их число
+ * попадает в журнал записью {"dropped":N}.
+ */
+
+#ifndef AUDIT_H
+#define AUDIT_H
+
+#include "shell.h"
+#include <sys/resource.h>
+
+/**
+ * @def AUDIT_LOG_ENV
+ * @brief Переменная окружения с путём файла журнала
+ */
+#define AUDIT_LOG_ENV "CUSTOM_SHELL_AUDIT_LOG"
+
+/**
+ * @def AUDIT_SOCKET_ENV
+ * @brief Переменная окружения с путём Unix-сокета датаграмм
+ */
+#define AUDIT_SOCKET_ENV "CUSTOM_SHELL_AUDIT_SOCKET"
+
+/**
+ * @def AUDIT_QUEUE_SIZE
+ * @brief Ёмкость очереди одного потока (степень двойки)
+ */
+#define AUDIT_QUEUE_SIZE 64
+
+/**
+ * @def AUDIT_ARGV_MAX
+ * @brief Место под слова команды в одной записи (байт)
+ */
+#define AUDIT_ARGV_MAX MAX_INPUT_SIZE
+
+/**
+ * @def AUDIT_SEND_TIMEOUT_MS
+ * @brief Наибольшее ожидание отправки в сокет, чтобы выход не зависел от приёмника
+ */
+#define AUDIT_SEND_TIMEOUT_MS 1000
+
+/**
+ * @struct audit_mark_t
+ * @brief Состояние перед выполнением команды
+ */
+typedef struct {
+    struct timespec started;        /**< Время запуска */
+    struct rusage self;             /**< Время потока до запуска */
+    struct rusage children;         /**< Время дочерних процессов до запуска */
+    char cwd[MAX_PATH];             /**< Каталог, в котором запущена команда */
+} audit_mark_t;
+
+/**
+ * @brief Журнал включён
+ *
+ * @details Меняется только при запуске и остановке журнала.
+ */
+extern int audit_enabled;
+
+/**
+ * @brief Запуск журнала, если задан CUSTOM_SHELL_AUDIT_LOG или CUSTOM_SHELL_AUDIT_SOCKET
+ * @return 0 в случае успеха или если журнал не задан, -1 в случае ошибки
+ */
+int audit_start(void);
+
+/**
+ * @brief Запись оставшихся записей и остановка журнала
+ */
+void audit_stop(void);
+
+/**
+ * @brief Замер перед выполнением команды
+ * @param mark Куда записать состояние
+ * @return 1 если журнал включён, 0 иначе
+ */
+int audit_begin(audit_mark_t *mark);
+
+/**
+ * @brief Постановка записи о выполненной команде в очередь
+ * @param mark Состояние перед выполнением
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ * @param status Код выхода
+ */
+void audit_end(const audit_mark_t *mark, const command_t *commands, int count, int status);
+
+#endif /* AUDIT_H */
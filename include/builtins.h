@@ -115,6 +115,198 @@ int builtin_rmdir(char **args, int argc);
  */
 int builtin_ls(char **args, int argc);
 
+/**
+ * @brief Встроенная команда env (запуск с изменённым окружением)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода запущенной команды, -1 в случае ошибки
+ */
+int builtin_env(char **args, int argc);
+
+/**
+ * @brief Встроенная команда exec (замена оболочки или перенаправление дескрипторов)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 если команда не указана, -1 если замена не удалась
+ */
+int builtin_exec(char **args, int argc);
+
+/**
+ * @brief Встроенная команда trap (установка ловушек на сигналы)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_trap(char **args, int argc);
+
+/**
+ * @brief Встроенная команда checksum (контрольные суммы файлов)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_checksum(char **args, int argc);
+
+/**
+ * @brief Встроенная команда head (начало файла)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_head(char **args, int argc);
+
+/**
+ * @brief Встроенная команда tail (конец файла, слежение за файлом)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_tail(char **args, int argc);
+
+/**
+ * @brief Встроенная команда cut (выбор полей и байт из строк)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_cut(char **args, int argc);
+
+/**
+ * @brief Встроенная команда jobs (список фоновых заданий)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха
+ */
+int builtin_jobs(char **args, int argc);
+
+/**
+ * @brief Встроенная команда fg (ожидание задания на переднем плане)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код завершения задания или -1 в случае ошибки
+ */
+int builtin_fg(char **args, int argc);
+
+/**
+ * @brief Встроенная команда wait (ожидание фоновых заданий)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код завершения последнего ожидаемого задания или -1 в случае ошибки
+ */
+int builtin_wait(char **args, int argc);
+
+/**
+ * @brief Встроенная команда kill (отправка сигнала процессу или прерывание задачи)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_kill(char **args, int argc);
+
+/**
+ * @brief Встроенная команда cache (кеширование результата команды)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода команды (сохранённый или новый), -1 в случае ошибки
+ */
+int builtin_cache(char **args, int argc);
+
+/**
+ * @brief Встроенная команда run-graph (параллельное выполнение графа задач)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если задачи завершились с ошибкой, -1 в случае ошибки
+ */
+int builtin_run_graph(char **args, int argc);
+
+/**
+ * @brief Встроенная команда watch (перезапуск команды при изменении файлов)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 после прерывания, -1 в случае ошибки
+ */
+int builtin_watch(char **args, int argc);
+
+/**
+ * @brief Встроенная команда pmap (параллельная обработка ввода процессами команды)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если процесс команды завершился с ошибкой, -1 в случае ошибки
+ */
+int builtin_pmap(char **args, int argc);
+
+/**
+ * @brief Встроенная команда pv (передача потока с показом скорости)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки или прерывания
+ */
+int builtin_pv(char **args, int argc);
+
+/**
+ * @brief Встроенная команда pipestats (статистика звеньев последнего конвейера)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если конвейеров ещё не было, -1 в случае ошибки
+ */
+int builtin_pipestats(char **args, int argc);
+
+/**
+ * @brief Встроенная команда shellstats (собственные расходы оболочки)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_shellstats(char **args, int argc);
+
+/**
+ * @brief Встроенная команда set (параметры оболочки)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_set(char **args, int argc);
+
+/**
+ * @brief Встроенная команда source (выполнение файла в текущей оболочке)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода последней команды файла, -1 в случае ошибки
+ */
+int builtin_source(char **args, int argc);
+
+/**
+ * @brief Встроенная команда hook (хуки preexec и precmd)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_hook(char **args, int argc);
+
+/**
+ * @brief Встроенная команда enable (загрузка команд из библиотек)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если часть команд не обработана, -1 в случае ошибки
+ */
+int builtin_enable(char **args, int argc);
+
+/**
+ * @brief Встроенная команда alias (определение и вывод псевдонимов)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если часть аргументов не обработана, -1 в случае ошибки
+ */
+int builtin_alias(char **args, int argc);
+
+/**
+ * @brief Встроенная команда unalias (удаление псевдонимов)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если часть имён не найдена, -1 в случае ошибки
+ */
+int builtin_unalias(char **args, int argc);
+
 #ifdef __cplusplus
 }
 #endif
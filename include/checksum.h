@@ -0,0 +1,131 @@
+/**
+ * @file checksum.h
+ * @brief Заголовочный файл для вычисления контрольных сумм
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Поддерживаются CRC32C, XXH3 (64 и 128 бит) и SHA-256. Реализация
+ * выбирается во время выполнения: SSE4.2 для CRC32C, AVX2 для XXH3 и
+ * SHA-NI для SHA-256, с переносимым кодом на случай их отсутствия.
+ * Результаты совпадают с эталонными утилитами (xxhsum, sha256sum).
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def CHECKSUM_HEX_MAX
+ * @brief Максимальная длина шестнадцатеричной записи суммы (с завершающим нулём)
+ */
+#define CHECKSUM_HEX_MAX 65
+
+/**
+ * @enum checksum_algo_t
+ * @brief Алгоритм контрольной суммы
+ */
+typedef enum {
+    CHECKSUM_CRC32C = 0,  /**< CRC32C (Castagnoli) */
+    CHECKSUM_XXH3_64,     /**< XXH3, 64 бита */
+    CHECKSUM_XXH3_128,    /**< XXH3, 128 бит */
+    CHECKSUM_SHA256       /**< SHA-256 */
+} checksum_algo_t;
+
+/**
+ * @struct checksum_ctx_t
+ * @brief Состояние потокового вычисления контрольной суммы
+ */
+typedef struct {
+    checksum_algo_t algo;             /**< Алгоритм */
+    uint64_t total_len;               /**< Обработано байт */
+    union {
+        uint32_t crc;                 /**< Состояние CRC32C */
+        struct {
+            uint32_t h[8];            /**< Состояние SHA-256 */
+            uint8_t block[64];        /**< Неполный блок */
+            size_t block_len;         /**< Заполненность блока */
+        } sha;
+        struct {
+            uint64_t acc[8];          /**< Аккумуляторы XXH3 */
+            uint8_t buffer[256];      /**< Ещё не обработанные данные */
+            size_t buffered;          /**< Заполненность буфера */
+            uint8_t tail[64];         /**< Последние 64 обработанных байта */
+            size_t stripes_in_block;  /**< Номер полосы внутри блока */
+        } xxh;
+    } u;
+} checksum_ctx_t;
+
+/**
+ * @brief Разбор имени алгоритма
+ * @param name Имя (crc32c, xxh3, xxh128, sha256)
+ * @param algo Куда записать алгоритм
+ * @return 0 в случае успеха, -1 если имя неизвестно
+ */
+int checksum_parse_algo(const char *name, checksum_algo_t *algo);
+
+/**
+ * @brief Описание выбранных реализаций (для диагностики)
+ * @return Строка вида "crc32c=sse4.2 xxh3=avx2 sha256=sha-ni"
+ */
+const char *checksum_backend_info(void);
+
+/**
+ * @brief Начало вычисления
+ * @param ctx Состояние
+ * @param algo Алгоритм
+ */
+void checksum_init(checksum_ctx_t *ctx, checksum_algo_t algo);
+
+/**
+ * @brief Добавление данных
+ * @param ctx Состояние
+ * @param data Данные
+ * @param len Длина данных
+ */
+void checksum_update(checksum_ctx_t *ctx, const void *data, size_t len);
+
+/**
+ * @brief Завершение вычисления
+ * @param ctx Состояние
+ * @param hex Буфер размером не менее CHECKSUM_HEX_MAX для шестнадцатеричной записи
+ */
+void checksum_final(checksum_ctx_t *ctx, char *hex);
+
+/**
+ * @brief Вычисление суммы файла
+ * @param path Путь к файлу ("-" - стандартный ввод)
+ * @param algo Алгоритм
+ * @param hex Буфер размером не менее CHECKSUM_HEX_MAX
+ * @return 0 в случае успеха, иначе значение errno
+ *
+ * @details Обычные файлы отображаются в память целиком, каналы и
+ * устройства читаются блоками по 1 МиБ.
+ */
+int checksum_file(const char *path, checksum_algo_t algo, char *hex);
+
+/**
+ * @brief Вычисление суммы файла относительно каталога
+ * @param dir_fd Каталог для относительного пути или AT_FDCWD
+ * @param path Путь к файлу ("-" - стандартный ввод)
+ * @param algo Алгоритм
+ * @param hex Буфер размером не менее CHECKSUM_HEX_MAX
+ * @return 0 в случае успеха, иначе значение errno
+ *
+ * @details Рабочие потоки пула не знают текущего каталога сеанса, поэтому
+ * каталог передаётся явно.
+ */
+int checksum_file_at(int dir_fd, const char *path, checksum_algo_t algo, char *hex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHECKSUM_H */
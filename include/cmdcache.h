@@ -0,0 +1,46 @@
+/**
+ * @file cmdcache.h
+ * @brief Заголовочный файл кеша результатов команд (встроенная команда cache)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * cache [--ttl T] [--dep ФАЙЛ]... [--env ИМЯ]... команда [аргументы]
+ * выполняет команду один раз и запоминает её вывод, поток ошибок и код
+ * выхода. Повторный вызов с тем же ключом выводит сохранённый результат
+ * через sendfile, не запуская команду.
+ *
+ * Ключ - SHA-256 от аргументов команды, текущего каталога, значений PATH и
+ * переменных --env и содержимого файлов --dep. Вывод хранится на диске
+ * по адресу содержимого (SHA-256), одинаковый вывод разных команд
+ * хранится один раз. Хранилище общее для всех оболочек пользователя;
+ * при превышении предела объёма вытесняются давно не использованные
+ * записи.
+ *
+ * При промахе вывод команды появляется после её завершения, а вывод и
+ * ошибки воспроизводятся по очереди, без исходного чередования.
+ */
+
+#ifndef CMDCACHE_H
+#define CMDCACHE_H
+
+/**
+ * @def CMDCACHE_DEFAULT_LIMIT
+ * @brief Предел объёма хранилища по умолчанию (байт)
+ */
+#define CMDCACHE_DEFAULT_LIMIT (256ULL * 1024 * 1024)
+
+/**
+ * @def CMDCACHE_MAX_DEPS
+ * @brief Максимальное количество параметров --dep и --env
+ */
+#define CMDCACHE_MAX_DEPS 32
+
+/**
+ * @def CMDCACHE_FORMAT
+ * @brief Первая строка файла записи (версия формата хранилища)
+ */
+#define CMDCACHE_FORMAT "custom_shell-cache 1"
+
+#endif /* CMDCACHE_H */
@@ -0,0 +1,74 @@
+/**
+ * @file cmdhash.h
+ * @brief Заголовочный файл общей таблицы путей команд
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Путь внешней команды ищется по PATH один раз и запоминается в таблице,
+ * общей для всех контекстов процесса (аналог hash в bash). Ключ - имя
+ * команды вместе со значением PATH, поэтому контексты с разным PATH не
+ * мешают друг другу. Найденный путь перед использованием проверяется
+ * одним вызовом access(): удалённая программа ищется заново.
+ */
+
+#ifndef CMDHASH_H
+#define CMDHASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def CMDHASH_MAX_ENTRIES
+ * @brief Максимальное количество запомненных путей (при переполнении таблица очищается)
+ */
+#define CMDHASH_MAX_ENTRIES 4096
+
+/**
+ * @brief Поиск полного пути команды
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @return Путь (освобождается free()) или NULL, если путь нужно искать
+ *         обычным execvp: имя содержит '/', PATH не задан или содержит
+ *         относительные каталоги, программа не найдена
+ */
+char *cmdhash_lookup(const char *name, const char *path_env);
+
+/**
+ * @brief Функция обхода таблицы
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @param resolved Найденный путь
+ * @param arg Аргумент, переданный в cmdhash_foreach
+ * @return 0 для продолжения обхода, иначе обход прекращается
+ */
+typedef int (*cmdhash_visit_fn)(const char *name, const char *path_env,
+                                const char *resolved, void *arg);
+
+/**
+ * @brief Обход всех запомненных путей (для образа сессии)
+ * @param visit Функция обхода, вызывается под блокировкой чтения
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit (0 если обход завершён)
+ */
+int cmdhash_foreach(cmdhash_visit_fn visit, void *arg);
+
+/**
+ * @brief Добавление готового пути без поиска по PATH
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @param resolved Путь
+ * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Путь проверяется при первом использовании, как и любой
+ * запомненный путь.
+ */
+int cmdhash_insert(const char *name, const char *path_env, const char *resolved);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMDHASH_H */
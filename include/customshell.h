@@ -0,0 +1,106 @@
+/**
+ * @file customshell.h
+ * @brief Публичный интерфейс библиотеки libcustomshell
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Интерпретатор оболочки, встраиваемый в другую программу. Каждый контекст
+ * хранит собственные код выхода, переменные и перенаправления, поэтому
+ * скрипты выполняются без запуска процесса оболочки, а разные контексты
+ * не видят состояния друг друга. Один контекст в каждый момент времени
+ * используется одним потоком; разные контексты могут работать параллельно.
+ *
+ * У контекста свой текущий каталог: cd меняет только его, а пути
+ * разрешаются вызовами *at относительно дескриптора каталога. Вывод команд
+ * по умолчанию идёт в стандартные дескрипторы процесса, его можно направить
+ * в отдельный дескриптор (shell_context_set_output). Ловушки (trap),
+ * хуки (hook), загрузка команд (enable -f, -d), фоновое выполнение (&) и
+ * замена процесса (exec) во встроенном контексте недоступны.
+ *
+ * Пример:
+ * @code
+ * shell_context_t *ctx = shell_context_create();
+ * shell_context_eval_string(ctx, "NAME=world; echo hello");
+ * const char *name = shell_context_get_var(ctx, "NAME");
+ * shell_context_destroy(ctx);
+ * @endcode
+ */
+
+#ifndef CUSTOMSHELL_H
+#define CUSTOMSHELL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Контекст интерпретатора
+ */
+typedef struct shell_state shell_context_t;
+
+/**
+ * @brief Создание контекста интерпретатора
+ * @return Контекст или NULL в случае ошибки
+ *
+ * @details Контекст не загружает историю и ничего не выводит.
+ */
+shell_context_t *shell_context_create(void);
+
+/**
+ * @brief Назначение дескриптора вывода контекста
+ * @param ctx Контекст
+ * @param fd Дескриптор для вывода и ошибок команд или -1 (стандартные)
+ * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Внешние команды получают fd как 1 и 2, а /dev/null как ввод.
+ * Встроенные команды пишут в fd через поток контекста и выполняются
+ * параллельно с командами других контекстов: дескрипторы процесса не
+ * меняются.
+ * Дескриптор остаётся во владении вызывающей программы.
+ */
+int shell_context_set_output(shell_context_t *ctx, int fd);
+
+/**
+ * @brief Выполнение скрипта из строки
+ * @param ctx Контекст
+ * @param script Текст скрипта: строки, разделённые '\n'
+ * @return Код выхода последней команды или -1 в случае ошибки
+ *
+ * @details Пустые строки и строки-комментарии ('#') пропускаются. Команда
+ * exit завершает выполнение скрипта, но не контекст.
+ */
+int shell_context_eval_string(shell_context_t *ctx, const char *script);
+
+/**
+ * @brief Выполнение скрипта из файла
+ * @param ctx Контекст
+ * @param path Путь к файлу скрипта
+ * @return Код выхода последней команды или -1 в случае ошибки
+ */
+int shell_context_eval_file(shell_context_t *ctx, const char *path);
+
+/**
+ * @brief Получение значения переменной
+ * @param ctx Контекст
+ * @param name Имя переменной; "?" - код выхода последней команды,
+ * "PIPESTATUS" - коды всех звеньев последнего конвейера через пробел
+ * @return Значение или NULL, если переменная не задана
+ *
+ * @details Указатель действителен до следующего вызова функций контекста.
+ * Переменные контекста перекрывают окружение процесса.
+ */
+const char *shell_context_get_var(shell_context_t *ctx, const char *name);
+
+/**
+ * @brief Уничтожение контекста
+ * @param ctx Контекст (может быть NULL)
+ */
+void shell_context_destroy(shell_context_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOMSHELL_H */
@@ -15,6 +15,7 @@
 
 #include "shell.h"
 #include "parser.h"
+#include "shellio.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,6 +28,26 @@ extern "C" {
  */
 int execute_command(command_t *cmd);
 
+/**
+ * @brief Длина конвейера, начинающегося с данной команды
+ * @param commands Команды, начиная с первого звена
+ * @param count Количество доступных команд
+ * @return Количество звеньев конвейера (не меньше 1)
+ */
+int pipeline_length(const command_t *commands, int count);
+
+/**
+ * @brief Выполнение конвейера
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ * @return Код выхода последнего звена
+ *
+ * @details Все звенья, кроме последнего, запускаются в дочерних процессах.
+ * Встроенная команда в последнем звене выполняется в самой оболочке с
+ * вводом из канала, без создания процесса.
+ */
+int execute_pipeline(command_t *commands, int count);
+
 /**
  * @brief Выполнение внешней программы
  * @param cmd Команда для выполнения
@@ -34,6 +55,56 @@ int execute_command(command_t *cmd);
  */
 int execute_external(command_t *cmd);
 
+/**
+ * @brief Выполнение команды с заданным окружением
+ * @param cmd Команда для выполнения
+ * @param envp Окружение только для этого запуска
+ * @return Код выхода команды
+ *
+ * @details Внешняя программа получает envp напрямую через execve,
+ * встроенная команда видит его на время вызова без создания процесса.
+ */
+int execute_with_env(command_t *cmd, char **envp);
+
+/**
+ * @brief Выполнение команды с выводом в заданные дескрипторы
+ * @param cmd Команда (внешняя или встроенная, без перенаправлений)
+ * @param out_fd Дескриптор для стандартного вывода
+ * @param err_fd Дескриптор для потока ошибок
+ * @return Код выхода команды
+ *
+ * @details Встроенная команда выполняется в оболочке с временно
+ * подменёнными дескрипторами 1 и 2, внешняя - в дочернем процессе.
+ */
+int execute_captured(command_t *cmd, int out_fd, int err_fd);
+
+/**
+ * @brief Запуск строки команд в дочернем процессе без ожидания
+ * @param line Строка команд (конвейеры, ';')
+ * @param own_group Создать для процесса отдельную группу (kill(-pid) завершит весь конвейер)
+ * @return Идентификатор процесса или -1 в случае ошибки
+ *
+ * @details Строка разбирается в оболочке до fork; дочерний процесс
+ * выполняет её теми же конвейерами, что и основной цикл, и завершается
+ * с кодом последней команды. Процесс нужно дождаться waitpid().
+ * Процесс в отдельной группе не получает Ctrl+C от терминала.
+ */
+pid_t execute_spawn(const char *line, int own_group);
+
+/**
+ * @brief Запуск внешней команды с заданными вводом и выводом без ожидания
+ * @param cmd Команда (внешняя, без перенаправлений)
+ * @param in_fd Дескриптор для стандартного ввода
+ * @param out_fd Дескриптор для стандартного вывода
+ * @return Идентификатор процесса или -1 в случае ошибки
+ *
+ * @details Дочерний процесс наследует только дескрипторы 0-2 и те, что
+ * без O_CLOEXEC: концы каналов к другим процессам вызывающий должен
+ * создавать с O_CLOEXEC, иначе они не получат конец ввода. Процесс нужно
+ * дождаться waitpid().
+ */
+pid_t execute_start(command_t *cmd, int in_fd, int out_fd);
+
 /**
  * @brief Выполнение встроенной команды
  * @param cmd Команда для выполнения
@@ -44,14 +115,28 @@ int execute_builtin(command_t *cmd);
 /**
  * @brief Настройка перенаправления ввода/вывода
  * @param cmd Команда с настройками перенаправления
+ * @param io Звено для перенаправлений команды (shellio.h)
  * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Дескрипторы процесса не меняются: файлы видны встроенной
+ * команде текущего потока и дочерним процессам, созданным внутри неё.
+ * Звено снимается restore_stdio() и в случае ошибки.
  */
-int setup_redirections(command_t *cmd);
+int setup_redirections(command_t *cmd, shell_io_t *io);
 
 /**
  * @brief Восстановление стандартного ввода/вывода
+ * @param io Звено из setup_redirections()
+ */
+void restore_stdio(shell_io_t *io);
+
+/**
+ * @brief Сохранение текущих перенаправлений после выполнения команды
+ *
+ * @details Используется командой exec без аргументов: перенаправления
+ * вида "exec 3>file" остаются в силе для самой оболочки.
  */
-void restore_stdio(void);
+void executor_keep_redirections(void);
 
 /**
  * @brief Ожидание завершения фоновых процессов
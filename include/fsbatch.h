@@ -0,0 +1,69 @@
+/**
+ * @file fsbatch.h
+ * @brief Заголовочный файл для пакетных файловых операций
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Встроенные команды rm, mkdir, touch и ls выполняют одну и ту же
+ * операцию над множеством путей. При достаточном количестве путей
+ * операции отправляются в кольцо io_uring с ограниченной глубиной
+ * очереди и завершаются асинхронно. Если io_uring недоступен (старое
+ * ядро, запрет seccomp, сборка без поддержки) или отключён переменной
+ * CUSTOM_SHELL_IO_URING=0, используются обычные синхронные вызовы.
+ */
+
+#ifndef FSBATCH_H
+#define FSBATCH_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct statx;
+
+/**
+ * @enum fsbatch_op_t
+ * @brief Пакетная операция
+ */
+typedef enum {
+    FSBATCH_UNLINK = 0,  /**< unlinkat(dirfd, путь, 0) */
+    FSBATCH_MKDIR,       /**< mkdirat(dirfd, путь, mode) */
+    FSBATCH_CREATE,      /**< openat(O_WRONLY | O_CREAT | O_APPEND, mode) и close */
+    FSBATCH_STATX        /**< statx(dirfd, путь, 0, STATX_BASIC_STATS) */
+} fsbatch_op_t;
+
+/**
+ * @brief Выполнение операции над набором путей
+ * @param op Операция
+ * @param dirfd Каталог для относительных путей (AT_FDCWD - текущий)
+ * @param paths Пути
+ * @param count Количество путей
+ * @param mode Права для FSBATCH_MKDIR и FSBATCH_CREATE
+ * @param errors Массив из count элементов: 0 или значение errno для каждого пути
+ * @param stx Массив из count элементов для FSBATCH_STATX, иначе NULL
+ * @return Количество успешно обработанных путей
+ *
+ * @details Порядок выполнения не гарантируется, кроме mkdir путей со
+ * слешем: такая операция начинается после завершения всех предыдущих,
+ * поэтому "mkdir a a/b" работает как при последовательном вызове.
+ */
+int fsbatch_run(fsbatch_op_t op, int dirfd, char *const *paths, int count,
+                mode_t mode, int *errors, struct statx *stx);
+
+/**
+ * @brief Название механизма, которым будет выполнен пакет из count путей
+ * @param count Количество путей
+ * @return "io_uring" или "sync"
+ */
+const char *fsbatch_backend(int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FSBATCH_H */
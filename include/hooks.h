@@ -0,0 +1,105 @@
+/**
+ * @file hooks.h
+ * @brief Заголовочный файл хуков preexec и precmd
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * hook preexec тело - команды, выполняемые после чтения строки ввода перед
+ * её выполнением (строка доступна командам хука в переменной HOOK_COMMAND,
+ * после хука переменная возвращается к прежнему значению); hook precmd тело - команды, выполняемые перед выводом
+ * приглашения. На каждую точку можно установить до HOOK_MAX тел, они
+ * выполняются в порядке установки.
+ *
+ * Как и тела ловушек (signals.h), тело разбирается один раз при установке.
+ * Хуки принадлежат состоянию оболочки (shell_state_t::hooks); пока их нет,
+ * основной цикл проверяет только битовую маску состояния. Команды
+ * хука сами хуки не вызывают, а код выхода ($?) после хука
+ * восстанавливается.
+ */
+
+#ifndef HOOKS_H
+#define HOOKS_H
+
+#include "shell.h"
+
+/**
+ * @enum hook_point_t
+ * @brief Точки вызова хуков
+ */
+typedef enum {
+    HOOK_PREEXEC,   /**< Перед выполнением строки ввода */
+    HOOK_PRECMD,    /**< Перед выводом приглашения */
+    HOOK_POINTS     /**< Количество точек */
+} hook_point_t;
+
+/**
+ * @def HOOK_MAX
+ * @brief Наибольшее количество тел на одну точку
+ */
+#define HOOK_MAX 16
+
+/**
+ * @def HOOK_COMMAND_VAR
+ * @brief Переменная со строкой ввода для preexec
+ */
+#define HOOK_COMMAND_VAR "HOOK_COMMAND"
+
+/**
+ * @brief Хуки состояния оболочки
+ */
+typedef struct hook_table hook_table_t;
+
+/**
+ * @brief Проверка наличия хуков в точке
+ * @param state Состояние оболочки
+ * @param point Точка
+ * @return Ненулевое значение, если хуки установлены
+ */
+static inline int hook_installed(const shell_state_t *state, hook_point_t point) {
+    return state->hook_mask & (1u << point);
+}
+
+/**
+ * @brief Добавление тела хука
+ * @param state Состояние оболочки
+ * @param point Точка
+ * @param body Тело
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int hook_add(shell_state_t *state, hook_point_t point, const char *body);
+
+/**
+ * @brief Выполнение хуков точки
+ * @param state Состояние оболочки
+ * @param point Точка
+ * @param line Строка ввода (для preexec) или NULL
+ */
+void hook_run(shell_state_t *state, hook_point_t point, const char *line);
+
+/**
+ * @brief Функция обхода хуков
+ * @param point Точка
+ * @param body Тело
+ * @param arg Аргумент, переданный в hook_foreach
+ * @return 0 для продолжения обхода, иначе обход прекращается
+ */
+typedef int (*hook_visit_fn)(hook_point_t point, const char *body, void *arg);
+
+/**
+ * @brief Обход установленных хуков в порядке установки (для вывода и образа сессии)
+ * @param state Состояние оболочки
+ * @param visit Функция обхода
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit (0 если обход завершён)
+ */
+int hook_foreach(shell_state_t *state, hook_visit_fn visit, void *arg);
+
+/**
+ * @brief Удаление всех хуков (при выходе)
+ * @param state Состояние оболочки
+ */
+void hook_clear_all(shell_state_t *state);
+
+#endif /* HOOKS_H */
@@ -0,0 +1,82 @@
+/**
+ * @file image.h
+ * @brief Заголовочный файл образа сессии для быстрого запуска
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * custom_shell --dump-image ФАЙЛ выполняет ~/.custom_shellrc и сохраняет
+ * полученное состояние: переменные, заданные и удалённые файлом настроек,
+ * хуки (hooks.h), псевдонимы (alias.h), ловушки (signals.h) и таблицу путей
+ * команд (cmdhash.h).
+ * При следующем запуске образ загружается одним mmap вместо выполнения
+ * файла настроек.
+ *
+ * Образ не содержит указателей: записи ссылаются на строки смещениями,
+ * поэтому он не зависит от адреса загрузки. Образ действителен, пока
+ * совпадают build ID исполняемого файла и размер и время изменения каждого
+ * выполненного при создании файла (отсутствующий файл должен отсутствовать
+ * и дальше). Иначе образ пропускается и файл настроек выполняется как обычно.
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+/**
+ * @def IMAGE_FILE_NAME
+ * @brief Имя файла образа в домашнем каталоге по умолчанию
+ */
+#define IMAGE_FILE_NAME "/.custom_shell.img"
+
+/**
+ * @def IMAGE_VERSION
+ * @brief Версия формата образа
+ */
+#define IMAGE_VERSION 4
+
+/**
+ * @def IMAGE_BUILD_ID_MAX
+ * @brief Размер поля build ID в заголовке образа (шестнадцатеричная строка)
+ */
+#define IMAGE_BUILD_ID_MAX 72
+
+/**
+ * @brief Путь к образу сессии
+ * @return CUSTOM_SHELL_IMAGE, если задана, иначе ~/.custom_shell.img
+ *         (освобождается free()), или NULL
+ */
+char *image_default_path(void);
+
+/**
+ * @brief Начало записи состояния для образа
+ *
+ * @details Запоминает окружение до выполнения файла настроек: в образ
+ * попадают только переменные, которые файл добавил или изменил, и имена
+ * удалённых им переменных.
+ */
+void image_begin(void);
+
+/**
+ * @brief Регистрация выполненного файла
+ * @param path Путь к файлу (может не существовать)
+ */
+void image_track_file(const char *path);
+
+/**
+ * @brief Сохранение образа сессии
+ * @param path Путь к файлу образа (заменяется атомарно)
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int image_dump(const char *path);
+
+/**
+ * @brief Загрузка образа сессии
+ * @param path Путь к файлу образа
+ * @return 0 если образ применён, -1 если его нет, он устарел или повреждён
+ *
+ * @details Состояние применяется только после проверки всего образа.
+ */
+int image_load(const char *path);
+
+#endif /* IMAGE_H */
@@ -0,0 +1,95 @@
+/**
+ * @file jobs.h
+ * @brief Заголовочный файл таблицы фоновых заданий
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Фоновое задание - это либо дочерний процесс (внешняя команда, конвейер,
+ * встроенная команда с перенаправлениями), либо задача: встроенная
+ * команда, выполняемая отдельным потоком внутри оболочки без копирования
+ * её адресного пространства. Задачи прерываются кооперативно: команда
+ * периодически проверяет task_cancelled().
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "shell.h"
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def MAX_JOBS
+ * @brief Максимальное количество одновременных фоновых заданий
+ */
+#define MAX_JOBS 64
+
+/**
+ * @brief Проверка, может ли встроенная команда выполняться потоком
+ * @param cmd Команда
+ * @return Ненулевое значение если команду можно запустить как задачу
+ *
+ * @details Команды, меняющие состояние оболочки (cd, exit, trap...), и
+ * команды с перенаправлениями или присваиваниями так не запускаются:
+ * дескрипторы и окружение общие для всех потоков процесса.
+ */
+int jobs_task_safe(const command_t *cmd);
+
+/**
+ * @brief Запуск встроенной команды как фоновой задачи
+ * @param cmd Команда (копируется)
+ * @return Номер задания или -1 в случае ошибки
+ */
+int jobs_start_task(const command_t *cmd);
+
+/**
+ * @brief Регистрация фонового процесса
+ * @param pid Идентификатор процесса
+ * @param command Имя команды
+ * @return Номер задания или -1, если таблица заполнена
+ */
+int jobs_add_process(pid_t pid, const char *command);
+
+/**
+ * @brief Учёт завершения процесса, полученного waitpid
+ * @param pid Идентификатор процесса
+ * @param status Статус waitpid
+ * @return 0 если процесс принадлежит заданию, -1 иначе
+ */
+int jobs_process_finished(pid_t pid, int status);
+
+/**
+ * @brief Вывод сообщений о завершившихся заданиях и освобождение их ячеек
+ */
+void jobs_notify(void);
+
+/**
+ * @brief Прерывание задач и ожидание их завершения при выходе из оболочки
+ */
+void jobs_shutdown(void);
+
+/**
+ * @brief Флаг прерывания текущей задачи
+ * @return Указатель на флаг или NULL, если поток не является задачей
+ *
+ * @details Нужен командам, которые сами раздают работу своим потокам.
+ */
+const atomic_int *task_cancel_flag(void);
+
+/**
+ * @brief Проверка, запрошено ли прерывание текущей задачи
+ * @return Ненулевое значение если задачу нужно завершить
+ */
+int task_cancelled(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JOBS_H */
@@ -0,0 +1,133 @@
+/**
+ * @file metrics.h
+ * @brief Заголовочный файл метрик оболочки (формат Prometheus на Unix-сокете)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Если задана переменная CUSTOM_SHELL_METRICS_SOCKET, оболочка (и сервер
+ * сессий) открывает на этом пути Unix-сокет и на каждое подключение
+ * отвечает HTTP-ответом с метриками в текстовом формате Prometheus:
+ * @code
+ * curl --unix-socket /run/user/1000/shell.metrics http://localhost/metrics
+ * @endcode
+ *
+ * Задержки собираются в гистограммы с логарифмически-линейными
+ * корзинами, как в HDR Histogram: четыре корзины на каждую степень двойки
+ * от 1 мкс до ~137 с, погрешность границы не больше 25%. Счётчики
+ * хранятся отдельно для каждого потока и изменяются без блокировок и
+ * атомарных операций чтения-записи; поток сервера метрик складывает их
+ * при запросе. Без переменной запись метрик сводится к проверке флага.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @def METRICS_SOCKET_ENV
+ * @brief Переменная окружения с путём сокета метрик
+ */
+#define METRICS_SOCKET_ENV "CUSTOM_SHELL_METRICS_SOCKET"
+
+/**
+ * @def METRICS_MIN_SHIFT
+ * @brief Нижняя граница гистограмм: 2^10 нс (около 1 мкс)
+ */
+#define METRICS_MIN_SHIFT 10
+
+/**
+ * @def METRICS_OCTAVES
+ * @brief Количество степеней двойки в гистограмме (до 2^37 нс, около 137 с)
+ */
+#define METRICS_OCTAVES 27
+
+/**
+ * @def METRICS_SUB_BUCKETS
+ * @brief Корзин на одну степень двойки
+ */
+#define METRICS_SUB_BUCKETS 4
+
+/**
+ * @def METRICS_BUCKETS
+ * @brief Всего корзин: меньше нижней границы, основные и переполнение
+ */
+#define METRICS_BUCKETS (METRICS_OCTAVES * METRICS_SUB_BUCKETS + 2)
+
+/**
+ * @def METRICS_MAX_BUILTINS
+ * @brief Размер таблицы счётчиков встроенных команд одного потока
+ */
+#define METRICS_MAX_BUILTINS 64
+
+/**
+ * @enum metric_id_t
+ * @brief Измеряемые задержки
+ */
+typedef enum {
+    METRIC_PROMPT,      /**< Построение приглашения */
+    METRIC_PARSE,       /**< Разбор строки (с учётом кэша разбора) */
+    METRIC_SPAWN,       /**< fork в родительском процессе */
+    METRIC_CHILD,       /**< Время выполнения дочернего процесса */
+    METRIC_HISTORY,     /**< Добавление в историю */
+    METRIC_BUILTIN,     /**< Выполнение встроенной команды */
+    METRIC_COUNT        /**< Количество метрик */
+} metric_id_t;
+
+/**
+ * @brief Метрики включены (сокет открыт)
+ *
+ * @details Меняется только при запуске и остановке сервера метрик, до и
+ * после работы остальных потоков.
+ */
+extern int metrics_enabled;
+
+/**
+ * @brief Начало замера
+ * @return Текущее время (нс) или 0, если метрики выключены
+ */
+static inline uint64_t metrics_clock(void) {
+    if (!metrics_enabled) {
+        return 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Запись задержки
+ * @param id Метрика
+ * @param started Результат metrics_clock() в начале замера (0 - не записывать)
+ */
+void metrics_record(metric_id_t id, uint64_t started);
+
+/**
+ * @brief Запись уже измеренной задержки
+ * @param id Метрика
+ * @param ns Задержка (нс)
+ */
+void metrics_record_value(metric_id_t id, uint64_t ns);
+
+/**
+ * @brief Учёт вызова встроенной команды
+ * @param name Имя команды
+ * @param started Результат metrics_clock() перед вызовом (0 - не записывать)
+ */
+void metrics_record_builtin(const char *name, uint64_t started);
+
+/**
+ * @brief Запуск сервера метрик, если задан CUSTOM_SHELL_METRICS_SOCKET
+ * @return 0 в случае успеха или если метрики не заданы, -1 в случае ошибки
+ */
+int metrics_start(void);
+
+/**
+ * @brief Остановка сервера метрик и удаление сокета
+ */
+void metrics_stop(void);
+
+#endif /* METRICS_H */
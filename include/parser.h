@@ -39,11 +39,10 @@ int parse_command(const char *cmd_str, command_t *cmd);
 /**
  * @brief Разбор аргументов команды
  * @param args_str Строка с аргументами
- * @param args Массив для аргументов
- * @param max_args Максимальное количество аргументов
+ * @param args Массив для аргументов (размер по числу слов, завершён NULL)
  * @return Количество аргументов
  */
-int parse_arguments(const char *args_str, char ***args, int max_args);
+int parse_arguments(const char *args_str, char ***args);
 
 /**
  * @brief Очистка структуры команды
@@ -58,6 +57,50 @@ void free_command(command_t *cmd);
  */
 void free_commands(command_t *commands, int count);
 
+/**
+ * @def PARSE_CACHE_MAX_ENTRIES
+ * @brief Максимальное количество строк в общем кэше разбора
+ */
+#define PARSE_CACHE_MAX_ENTRIES 512
+
+/**
+ * @struct parsed_line_t
+ * @brief Разобранная строка ввода из общего кэша
+ *
+ * @details Команды записи используются несколькими потоками одновременно
+ * и не должны изменяться при выполнении.
+ */
+typedef struct parsed_line {
+    command_t *commands;         /**< Команды строки */
+    int count;                   /**< Количество команд */
+    struct parsed_line *next;    /**< Следующая запись цепочки (внутреннее) */
+    char *text;                  /**< Исходная строка (внутреннее) */
+    unsigned long hash;          /**< Хеш строки (внутреннее) */
+    unsigned long alias_key;     /**< Набор псевдонимов, с которым разобрана строка (внутреннее) */
+    unsigned long last_used;     /**< Момент последнего использования (внутреннее) */
+    int refs;                    /**< Счётчик ссылок (внутреннее) */
+    int cached;                  /**< Запись находится в кэше (внутреннее) */
+} parsed_line_t;
+
+/**
+ * @brief Разбор строки через общий кэш
+ * @param input Входная строка
+ * @return Разобранная строка (освобождается parse_cache_release) или
+ *         NULL, если строка не содержит команд
+ *
+ * @details Из состояния контекста разбор зависит только от псевдонимов,
+ * поэтому строка кэшируется вместе с ключом их набора (alias.h): одна и
+ * та же строка из сеансов без псевдонимов или с одним набором
+ * разбирается один раз.
+ */
+parsed_line_t *parse_cache_acquire(const char *input);
+
+/**
+ * @brief Возврат разобранной строки в кэш
+ * @param line Разобранная строка
+ */
+void parse_cache_release(parsed_line_t *line);
+
 /**
  * @brief Обработка расширения истории команд
  * @param input Входная строка
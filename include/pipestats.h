@@ -0,0 +1,109 @@
+/**
+ * @file pipestats.h
+ * @brief Заголовочный файл статистики звеньев конвейера (PIPESTATUS, pipestats)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Исполнитель записывает для каждого звена последнего конвейера время
+ * выполнения, процессорное время и код выхода. Если замер включён
+ * (pipestats -s on), пока звенья работают, каждые PIPESTATS_SAMPLE_MS мс
+ * через FIONREAD читается заполнение каналов между ними: канал, который
+ * почти всё время полон, указывает на звено после него как на узкое место,
+ * из-за которого стоят звенья до него.
+ *
+ * Коды всех звеньев последней команды переднего плана хранятся в
+ * PIPESTATUS (через пробел, завершение сигналом - 128 + номер).
+ */
+
+#ifndef PIPESTATS_H
+#define PIPESTATS_H
+
+#include "shell.h"
+
+/**
+ * @def PIPESTATS_SAMPLE_MS
+ * @brief Период замера заполнения каналов (мс)
+ */
+#define PIPESTATS_SAMPLE_MS 10
+
+/**
+ * @def PIPESTATS_NAME_MAX
+ * @brief Максимальная длина имени звена в статистике
+ */
+#define PIPESTATS_NAME_MAX 64
+
+/**
+ * @struct pipeline_stage_stats_t
+ * @brief Статистика одного звена
+ */
+typedef struct {
+    char name[PIPESTATS_NAME_MAX];  /**< Имя команды */
+    int status;                     /**< Код выхода (128 + сигнал), -1 - не запущено */
+    double started;                 /**< Момент запуска (монотонные часы, с) */
+    double wall;                    /**< Время выполнения (с) */
+    double user;                    /**< Процессорное время пользователя (с) */
+    double sys;                     /**< Процессорное время ядра (с) */
+    int samples;                    /**< Замеров входного канала */
+    int full_samples;               /**< Из них канал был заполнен */
+    long long pipe_total;           /**< Сумма заполнений (байт) для среднего */
+    long long pipe_max;             /**< Наибольшее заполнение (байт) */
+} pipeline_stage_stats_t;
+
+/**
+ * @struct pipeline_stats_t
+ * @brief Статистика конвейера
+ */
+typedef struct pipeline_stats {
+    pipeline_stage_stats_t *stages; /**< Звенья */
+    int count;                      /**< Количество звеньев */
+    double started;                 /**< Момент запуска первого звена */
+    double wall;                    /**< Время выполнения всего конвейера (с) */
+} pipeline_stats_t;
+
+/**
+ * @brief Текущее время по монотонным часам
+ * @return Секунды
+ */
+double pipestats_now(void);
+
+/**
+ * @brief Создание пустой статистики конвейера
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ * @return Статистика или NULL при нехватке памяти
+ */
+pipeline_stats_t *pipestats_create(const command_t *commands, int count);
+
+/**
+ * @brief Замер заполнения входного канала звена
+ * @param stage Звено
+ * @param fd Копия читающего конца канала
+ */
+void pipestats_sample(pipeline_stage_stats_t *stage, int fd);
+
+/**
+ * @brief Сохранение завершённого конвейера в текущем состоянии
+ * @param stats Статистика (переходит во владение состояния)
+ *
+ * @details Заменяет статистику прошлого конвейера и обновляет PIPESTATUS.
+ */
+void pipestats_commit(pipeline_stats_t *stats);
+
+/**
+ * @brief Обновление PIPESTATUS после одиночной команды
+ * @param exit_code Код выхода команды
+ *
+ * @details Статистика прошлого конвейера не меняется: pipestats
+ * показывает последний конвейер, а не себя.
+ */
+void pipestats_set_single(int exit_code);
+
+/**
+ * @brief Освобождение статистики состояния
+ * @param state Состояние оболочки
+ */
+void pipestats_free(shell_state_t *state);
+
+#endif /* PIPESTATS_H */
@@ -0,0 +1,54 @@
+/**
+ * @file pmap.h
+ * @brief Заголовочный файл параллельной обработки потока (встроенная команда pmap)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * pmap [-j N] [-s размер] [-L] -- команда [аргументы]
+ * делит стандартный ввод на фрагменты по границам строк и обрабатывает их
+ * N процессами команды одновременно; вывод собирается в порядке ввода.
+ *
+ * По умолчанию каждый фрагмент обрабатывается отдельным процессом, и
+ * команда может выводить что угодно (gzip, sort, wc). С -L запускаются N
+ * долгоживущих процессов, фрагменты раздаются им по кругу; так экономится
+ * запуск процесса на фрагмент, но команда должна выводить ровно одну
+ * строку на каждую входную (sed, tr, построчный awk), иначе вывод нельзя
+ * разделить по фрагментам.
+ *
+ * Одновременно в обработке не больше PMAP_WINDOW_PER_JOB * N фрагментов:
+ * вывод фрагментов, опередивших первый незавершённый, держится в памяти,
+ * и окно ограничивает их число. Объём вывода каждого из них ограничен
+ * PMAP_MAX_BUFFERED: дальше вывод процесса не читается, пока фрагмент не
+ * станет первым, и процесс останавливается на записи в канал.
+ */
+
+#ifndef PMAP_H
+#define PMAP_H
+
+/**
+ * @def PMAP_DEFAULT_CHUNK
+ * @brief Размер фрагмента ввода по умолчанию (байт)
+ */
+#define PMAP_DEFAULT_CHUNK (1024 * 1024)
+
+/**
+ * @def PMAP_MAX_JOBS
+ * @brief Верхняя граница числа процессов
+ */
+#define PMAP_MAX_JOBS 256
+
+/**
+ * @def PMAP_WINDOW_PER_JOB
+ * @brief Фрагментов в обработке на один процесс
+ */
+#define PMAP_WINDOW_PER_JOB 2
+
+/**
+ * @def PMAP_MAX_BUFFERED
+ * @brief Предел вывода фрагмента, ожидающего очереди, в памяти (байт)
+ */
+#define PMAP_MAX_BUFFERED (4 * 1024 * 1024)
+
+#endif /* PMAP_H */
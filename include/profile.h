@@ -0,0 +1,105 @@
+/**
+ * @file profile.h
+ * @brief Заголовочный файл профилировщика строк скриптов (set -o profile)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * После set -o profile каждая выполненная строка скрипта (файла,
+ * выполненного через source, или ввода, если оболочка читает скрипт со
+ * stdin) получает время выполнения по монотонным часам, процессорное
+ * время (своё и дочерних процессов), число fork и число вызовов. Время
+ * строки с source включает время строк вложенного файла.
+ *
+ * set +o profile или выход из оболочки выводит в поток ошибок таблицу
+ * строк по убыванию времени. Если задана переменная CUSTOM_SHELL_PROFILE,
+ * в этот файл дополнительно записываются стеки строк в свёрнутом формате
+ * flamegraph.pl (собственное время строки в микросекундах):
+ * @code
+ * deploy.sh:12;lib.sh:40 182000
+ * @endcode
+ *
+ * Замер строки - два clock_gettime и четыре getrusage, поэтому профиль
+ * можно не выключать на тестовых стендах.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "shell.h"
+#include <stdint.h>
+
+/**
+ * @def PROFILE_OUT_VAR
+ * @brief Переменная с путём файла свёрнутых стеков
+ */
+#define PROFILE_OUT_VAR "CUSTOM_SHELL_PROFILE"
+
+/**
+ * @def PROFILE_BUCKETS
+ * @brief Размер хеш-таблиц строк и стеков
+ */
+#define PROFILE_BUCKETS 256
+
+/**
+ * @def PROFILE_MAX_DEPTH
+ * @brief Наибольшая глубина стека в свёрнутом формате
+ */
+#define PROFILE_MAX_DEPTH 32
+
+/**
+ * @struct profile_frame_t
+ * @brief Выполняемая строка (живёт на стеке вызывающего)
+ */
+typedef struct profile_frame {
+    struct profile_frame *parent;   /**< Строка, выполнившая source */
+    unsigned long session;          /**< Номер сеанса профилирования */
+    const char *file;               /**< Файл */
+    int line;                       /**< Номер строки */
+    const char *text;               /**< Текст строки */
+    uint64_t started_ns;            /**< Начало (монотонные часы) */
+    uint64_t cpu_started_ns;        /**< Процессорное время в начале */
+    unsigned long long forks_started;  /**< Счётчик fork в начале */
+    uint64_t child_ns;              /**< Время вложенных строк */
+} profile_frame_t;
+
+/**
+ * @brief Включение профилирования (set -o profile)
+ * @param state Состояние оболочки
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int profile_start(shell_state_t *state);
+
+/**
+ * @brief Выключение профилирования с выводом отчёта (set +o profile, выход)
+ * @param state Состояние оболочки
+ */
+void profile_stop(shell_state_t *state);
+
+/**
+ * @brief Освобождение профиля без отчёта
+ * @param state Состояние оболочки
+ */
+void profile_free(shell_state_t *state);
+
+/**
+ * @brief Начало строки скрипта
+ * @param state Состояние оболочки
+ * @param frame Запись строки
+ * @param file Файл (строка должна жить до profile_leave)
+ * @param line Номер строки
+ * @param text Текст строки
+ * @return 1 если профилирование включено, 0 иначе
+ */
+int profile_enter(shell_state_t *state, profile_frame_t *frame,
+                  const char *file, int line, const char *text);
+
+/**
+ * @brief Конец строки скрипта
+ * @param state Состояние оболочки
+ * @param frame Запись строки из profile_enter
+ */
+void profile_leave(shell_state_t *state, profile_frame_t *frame);
+
+#endif /* PROFILE_H */
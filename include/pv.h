@@ -0,0 +1,33 @@
+/**
+ * @file pv.h
+ * @brief Заголовочный файл измерителя потока (встроенная команда pv)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * pv [-q] [-i секунды] [-L скорость] [-s размер] [файл]
+ * передаёт ввод (или файл) в вывод без изменений и показывает в потоке
+ * ошибок объём, время, скорость и, если размер известен, процент и
+ * оставшееся время. Данные переносятся через splice без копирования в
+ * память процесса; если ни ввод, ни вывод не канал, splice идёт через
+ * промежуточный канал, а если splice не поддерживается (терминал), -
+ * обычными read и write.
+ */
+
+#ifndef PV_H
+#define PV_H
+
+/**
+ * @def PV_CHUNK
+ * @brief Наибольший объём одного splice (байт)
+ */
+#define PV_CHUNK (1024 * 1024)
+
+/**
+ * @def PV_DEFAULT_INTERVAL_MS
+ * @brief Период обновления строки состояния по умолчанию (мс)
+ */
+#define PV_DEFAULT_INTERVAL_MS 1000
+
+#endif /* PV_H */
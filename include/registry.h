@@ -0,0 +1,67 @@
+/**
+ * @file registry.h
+ * @brief Заголовочный файл таблицы встроенных команд
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Одна таблица имён и обработчиков отвечает и на вопрос парсера
+ * (is_builtin), и на вызов исполнителя. Кроме собственных команд оболочки
+ * в таблицу добавляются команды из разделяемых библиотек (enable -f, ABI в
+ * shellplugin.h), до REGISTRY_MAX_PLUGINS одновременно.
+ *
+ * Таблицу читают без блокировок, в том числе встроенные контексты в других
+ * потоках. Поэтому библиотека после enable -d остаётся загруженной: её
+ * обработчик может ещё выполняться.
+ */
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdio.h>
+
+/**
+ * @def REGISTRY_MAX_PLUGINS
+ * @brief Наибольшее количество загруженных команд
+ */
+#define REGISTRY_MAX_PLUGINS 32
+
+/**
+ * @brief Поиск встроенной команды
+ * @param name Имя команды
+ * @return 1 если команда встроенная или загруженная, 0 иначе
+ */
+int builtin_exists(const char *name);
+
+/**
+ * @brief Вызов встроенной команды по имени
+ * @param name Имя команды
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода команды или -1, если команды нет
+ */
+int builtin_dispatch(const char *name, char **args, int argc);
+
+/**
+ * @brief Загрузка команды из разделяемой библиотеки
+ * @param path Путь к библиотеке
+ * @param name Имя команды
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_load(const char *path, const char *name);
+
+/**
+ * @brief Удаление загруженной команды
+ * @param name Имя команды
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_unload(const char *name);
+
+/**
+ * @brief Вывод списка команд в формате enable
+ * @param out Поток вывода
+ */
+void builtin_list(FILE *out);
+
+#endif /* REGISTRY_H */
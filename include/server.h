@@ -0,0 +1,49 @@
+/**
+ * @file server.h
+ * @brief Заголовочный файл многосессионного сервера оболочки
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Сервер принимает соединения на Unix-сокете; каждое соединение - отдельная
+ * сессия со своим контекстом интерпретатора (customshell.h): переменными,
+ * кодом выхода и текущим каталогом. Клиент пишет команды построчно, вывод
+ * и ошибки команд возвращаются в тот же сокет.
+ *
+ * Сессии обслуживает фиксированный набор потоков: готовые к чтению сокеты
+ * выдаются потокам через epoll, поэтому число сессий не ограничено числом
+ * потоков. Таблица путей команд (cmdhash.h) и кеш разобранных строк
+ * (parser.h) общие для всех сессий.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+/**
+ * @def SERVER_DEFAULT_WORKERS
+ * @brief Количество рабочих потоков по умолчанию
+ */
+#define SERVER_DEFAULT_WORKERS 16
+
+/**
+ * @def SERVER_MAX_WORKERS
+ * @brief Верхняя граница количества рабочих потоков
+ */
+#define SERVER_MAX_WORKERS 256
+
+/**
+ * @def SERVER_MAX_LINE
+ * @brief Максимальная длина строки команды от клиента
+ */
+#define SERVER_MAX_LINE (64 * 1024)
+
+/**
+ * @brief Запуск сервера
+ * @param socket_path Путь к Unix-сокету (существующий файл заменяется)
+ * @param workers Количество рабочих потоков
+ * @return 0 после остановки по SIGINT/SIGTERM/SIGHUP, 1 в случае ошибки
+ */
+int server_run(const char *socket_path, int workers);
+
+#endif /* SERVER_H */
@@ -35,7 +35,8 @@ extern "C" {
 
 /**
  * @def MAX_ARGS
- * @brief Максимальное количество аргументов команды
+ * @brief Максимальное количество команд в одной строке ввода
+ * (количество аргументов команды не ограничено)
  */
 #define MAX_ARGS 64
 
@@ -63,12 +64,24 @@ extern "C" {
  */
 #define HISTORY_FILE_NAME "/.custom_shell_history"
 
+/**
+ * @def RC_FILE_NAME
+ * @brief Имя файла настроек, выполняемого при запуске
+ */
+#define RC_FILE_NAME "/.custom_shellrc"
+
 /**
  * @def MAX_HISTORY_FILE_SIZE
  * @brief Максимальный размер файла истории в байтах
  */
 #define MAX_HISTORY_FILE_SIZE (1024 * 1024) // 1MB
 
+/**
+ * @def PIPE_STATUS_SIZE
+ * @brief Размер текста PIPESTATUS (коды звеньев через пробел)
+ */
+#define PIPE_STATUS_SIZE 256
+
 /**
  * @def COLOR_RESET
  * @brief ANSI escape-код для сброса цвета
@@ -121,7 +134,12 @@ typedef struct {
     int argc;             /**< Количество аргументов */
     char *input_file;     /**< Файл для перенаправления ввода */
     char *output_file;    /**< Файл для перенаправления вывода */
+    int input_fd;         /**< Дескриптор, перенаправляемый на ввод (по умолчанию 0) */
+    int output_fd;        /**< Дескриптор, перенаправляемый на вывод (по умолчанию 1) */
     int background;       /**< Флаг фонового выполнения */
+    int pipe_next;        /**< Вывод передаётся по каналу следующей команде */
+    char **assigns;       /**< Префиксные присваивания вида NAME=value */
+    int assign_count;     /**< Количество префиксных присваиваний */
 } command_t;
 
 /**
@@ -135,21 +153,109 @@ typedef struct {
 } history_entry_t;
 
 /**
- * @struct shell_state_t
+ * @struct shell_state
  * @brief Структура для хранения состояния оболочки
+ *
+ * @details Всё изменяемое состояние интерпретатора хранится здесь, а не в
+ * глобальных переменных. Состояние, с которым работает поток, выбирается
+ * shell_make_current(); встраиваемый контекст (custom_shell.h) - это
+ * тот же shell_state_t с флагом embedded.
  */
-typedef struct {
+typedef struct shell_state {
     char *prompt;         /**< Строка приглашения */
     char *current_dir;    /**< Текущая директория */
     int exit_code;        /**< Код выхода последней команды */
     int should_exit;      /**< Флаг для выхода из оболочки */
+    int embedded;         /**< Контекст встроен в другую программу */
+    int sourcing;         /**< Выполняется файл настроек (команды не попадают в историю) */
     history_entry_t history[MAX_HISTORY_SIZE];  /**< История команд */
     int history_count;    /**< Количество команд в истории */
     int history_index;    /**< Индекс текущей позиции в истории */
+    int cwd_fd;           /**< Текущий каталог контекста (-1 - каталог процесса) */
+    int io_fd;            /**< Вывод и ошибки команд контекста (-1 - общие 1 и 2) */
+    FILE *io_out;         /**< Поток встроенных команд поверх io_fd (shellio.h) */
+    char **vars;          /**< Переменные контекста вида NAME=value */
+    int var_count;        /**< Количество переменных контекста */
+    int var_capacity;     /**< Ёмкость массива vars */
+    int vars_hidden;      /**< Переменные контекста уже включены в environ */
+    char status_text[16]; /**< Текстовое значение $? для shell_context_get_var */
+    char pipe_status[PIPE_STATUS_SIZE];  /**< PIPESTATUS: коды звеньев последней команды */
+    struct pipeline_stats *pipeline;     /**< Статистика последнего конвейера (pipestats) */
+    int pipe_sampling;    /**< Замер заполнения каналов конвейера (pipestats -s on) */
+    struct profile *profile;  /**< Профиль строк скриптов (set -o profile), NULL - выключен */
+    struct xtrace *xtrace;    /**< Трассировка команд (set -x), NULL - выключена */
+    struct hook_table *hooks; /**< Хуки preexec и precmd (hooks.h), NULL - не установлены */
+    unsigned int hook_mask;   /**< Биты точек, для которых установлены хуки */
+    struct alias_table *aliases;  /**< Псевдонимы (alias.h), NULL - не определены */
+    unsigned long alias_key;      /**< Ключ набора псевдонимов в кэше разбора, 0 - псевдонимов нет */
+    int source_depth;     /**< Глубина вложенности source */
 } shell_state_t;
 
-// Глобальная переменная для выхода из оболочки
-extern int g_should_exit;
+/**
+ * @brief Состояние оболочки, с которым работает текущий поток
+ * @return Указатель на состояние или NULL
+ */
+shell_state_t *shell_current(void);
+
+/**
+ * @brief Назначение состояния оболочки текущему потоку
+ * @param state Новое состояние (может быть NULL)
+ * @return Предыдущее состояние потока
+ */
+shell_state_t *shell_make_current(shell_state_t *state);
+
+/**
+ * @brief Дескриптор текущего каталога для вызовов *at
+ * @return Каталог контекста текущего потока или AT_FDCWD
+ */
+int shell_cwd_fd(void);
+
+/**
+ * @brief Смена текущего каталога
+ * @param path Новый каталог
+ * @return 0 в случае успеха, -1 в случае ошибки (errno установлен)
+ *
+ * @details Контекст со своим каталогом меняет только cwd_fd, процесс
+ * остаётся в прежнем каталоге.
+ */
+int shell_chdir(const char *path);
+
+/**
+ * @brief Путь текущего каталога
+ * @param buffer Буфер
+ * @param size Размер буфера
+ * @return buffer или NULL в случае ошибки
+ */
+char *shell_getcwd(char *buffer, size_t size);
+
+/**
+ * @brief Выполнение одной строки ввода
+ * @param state Указатель на состояние оболочки
+ * @param line Строка с командами
+ * @return Код выхода последней команды
+ *
+ * @details Состояние должно быть текущим для потока. Ловушки DEBUG и ERR
+ * и запись в историю работают только в интерактивной оболочке.
+ */
+int shell_execute_line(shell_state_t *state, const char *line);
+
+/**
+ * @brief Выполнение файла команд в текущей оболочке
+ * @param state Указатель на состояние оболочки
+ * @param path Путь к файлу
+ * @return Код выхода последней команды или -1, если файл не открыт
+ *
+ * @details Файл запоминается для проверки образа сессии (image.h), даже
+ * если его нет. Пустые строки и строки-комментарии пропускаются.
+ */
+int shell_source_file(shell_state_t *state, const char *path);
+
+/**
+ * @brief Выполнение файла настроек ~/.custom_shellrc
+ * @param state Указатель на состояние оболочки
+ * @return 0 если файл выполнен или отсутствует, -1 если HOME не задан
+ */
+int shell_source_rc(shell_state_t *state);
 
 /**
  * @brief Инициализация оболочки
@@ -0,0 +1,125 @@
+/**
+ * @file shellio.h
+ * @brief Заголовочный файл ввода-вывода встроенных команд
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Дескрипторы 0-2 общие для всего процесса, а встроенные команды разных
+ * контекстов выполняются параллельно. Поэтому встроенная команда не
+ * пишет в stdout и stderr напрямую: shell_stdout(), shell_stderr() и
+ * shell_fd() возвращают вывод и ввод текущего потока.
+ *
+ * Перенаправления встроенных команд и ввод встроенной команды в конце
+ * конвейера - звенья shell_io_t в стеке потока: верхнее звено, в котором
+ * задан дескриптор, определяет его. Ниже звеньев - вывод контекста
+ * (io_fd, ввод - /dev/null), ещё ниже - дескрипторы процесса. Дочерний
+ * процесс переносит звенья в свои дескрипторы (shell_io_child).
+ */
+
+#ifndef SHELLIO_H
+#define SHELLIO_H
+
+#include "shell.h"
+#include <stdio.h>
+
+/**
+ * @def SHELL_IO_SLOTS
+ * @brief Наибольшее количество дескрипторов в одном звене
+ */
+#define SHELL_IO_SLOTS 3
+
+/**
+ * @struct shell_io
+ * @brief Звено перенаправлений потока
+ */
+typedef struct shell_io {
+    int targets[SHELL_IO_SLOTS];  /**< Номера дескрипторов в команде */
+    int fds[SHELL_IO_SLOTS];      /**< Дескрипторы, на которые они указывают */
+    unsigned int owned;           /**< Биты слотов, закрываемых при снятии звена */
+    int count;                    /**< Количество занятых слотов */
+    FILE *out;                    /**< Поток для дескриптора 1 (создаётся по требованию) */
+    FILE *err;                    /**< Поток для дескриптора 2 (создаётся по требованию) */
+    struct shell_io *prev;        /**< Нижнее звено */
+} shell_io_t;
+
+/**
+ * @brief Добавление пустого звена на вершину стека потока
+ * @param io Звено (обычно локальная переменная вызывающей функции)
+ */
+void shell_io_push(shell_io_t *io);
+
+/**
+ * @brief Назначение дескриптора в звене
+ * @param io Звено
+ * @param target Номер дескриптора в команде
+ * @param fd Дескриптор
+ * @param owned Закрыть fd при снятии звена
+ * @return 0 в случае успеха, -1 если слоты звена заняты
+ */
+int shell_io_set(shell_io_t *io, int target, int fd, int owned);
+
+/**
+ * @brief Снятие звена с вершины стека
+ * @param io Звено
+ *
+ * @details Потоки звена записываются и закрываются, дескрипторы с
+ * owned закрываются.
+ */
+void shell_io_pop(shell_io_t *io);
+
+/**
+ * @brief Дескриптор текущего потока
+ * @param fd Номер дескриптора в команде
+ * @return Дескриптор, на который указывает fd
+ */
+int shell_fd(int fd);
+
+/**
+ * @brief Стандартный вывод текущего потока
+ * @return Поток вывода
+ */
+FILE *shell_stdout(void);
+
+/**
+ * @brief Поток ошибок текущего потока
+ * @return Поток ошибок
+ */
+FILE *shell_stderr(void);
+
+/**
+ * @brief perror() в поток ошибок текущего потока
+ * @param message Префикс сообщения
+ */
+void shell_perror(const char *message);
+
+/**
+ * @brief Запись буферов всех потоков вывода перед fork и после команды
+ */
+void shell_io_flush(void);
+
+/**
+ * @brief Перенос звеньев в дескрипторы процесса
+ * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Используется перед exec и в дочернем процессе.
+ */
+int shell_io_apply(void);
+
+/**
+ * @brief Подготовка ввода-вывода дочернего процесса сразу после fork
+ *
+ * @details Звенья и вывод контекста переносятся в дескрипторы 0-2, после
+ * чего стек потока очищается: дочерний процесс владеет своими
+ * дескрипторами.
+ */
+void shell_io_child(void);
+
+/**
+ * @brief Освобождение потока вывода контекста
+ * @param state Состояние оболочки
+ */
+void shell_io_release(shell_state_t *state);
+
+#endif /* SHELLIO_H */
@@ -0,0 +1,110 @@
+/**
+ * @file shellplugin.h
+ * @brief Публичный интерфейс загружаемых встроенных команд (enable -f)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Загружаемая команда - разделяемая библиотека, которая экспортирует
+ * описание shell_builtin_def_t под именем "<имя>_builtin" (дефис в имени
+ * заменяется на '_'). Команда выполняется в процессе оболочки без fork и
+ * exec и получает только аргументы и приёмники вывода, поэтому не зависит
+ * от внутренних структур оболочки:
+ * @code
+ * #include <shellplugin.h>
+ * #include <string.h>
+ *
+ * static int hello_run(const shell_builtin_call_t *call) {
+ *     const char *who = call->argc > 1 ? call->argv[1] : "world";
+ *     call->out.write(call->out.handle, who, strlen(who));
+ *     return call->out.write(call->out.handle, "\n", 1) == 0 ? 0 : 1;
+ * }
+ *
+ * const shell_builtin_def_t hello_builtin = {
+ *     SHELL_BUILTIN_ABI_VERSION, "hello", "hello [имя]", hello_run
+ * };
+ * @endcode
+ * Сборка и загрузка:
+ * @code
+ * cc -shared -fPIC -o hello.so hello.c
+ * enable -f ./hello.so hello
+ * @endcode
+ *
+ * Версия ABI меняется при любом несовместимом изменении структур ниже;
+ * библиотека с другой версией не загружается.
+ */
+
+#ifndef SHELLPLUGIN_H
+#define SHELLPLUGIN_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def SHELL_BUILTIN_ABI_VERSION
+ * @brief Версия ABI загружаемых команд
+ */
+#define SHELL_BUILTIN_ABI_VERSION 1
+
+/**
+ * @def SHELL_BUILTIN_SYMBOL_SUFFIX
+ * @brief Суффикс имени экспортируемого описания команды
+ */
+#define SHELL_BUILTIN_SYMBOL_SUFFIX "_builtin"
+
+/**
+ * @struct shell_builtin_sink_t
+ * @brief Приёмник вывода команды
+ *
+ * @details write записывает size байт и возвращает 0 или -1 в случае
+ * ошибки. Вывод учитывает перенаправления команды и порядок относительно
+ * вывода встроенных команд оболочки.
+ */
+typedef struct {
+    void *handle;                                                   /**< Аргумент write */
+    int (*write)(void *handle, const char *data, size_t size);      /**< Запись */
+} shell_builtin_sink_t;
+
+/**
+ * @struct shell_builtin_call_t
+ * @brief Вызов команды: аргументы, приёмники и доступ к переменным
+ *
+ * @details Структура и аргументы действительны только на время вызова.
+ */
+typedef struct {
+    unsigned int abi_version;               /**< SHELL_BUILTIN_ABI_VERSION оболочки */
+    int argc;                               /**< Количество аргументов (с именем команды) */
+    const char *const *argv;                /**< Аргументы, argv[argc] == NULL */
+    shell_builtin_sink_t out;               /**< Стандартный вывод */
+    shell_builtin_sink_t err;               /**< Поток ошибок */
+    const char *(*get_var)(const char *name);                   /**< Значение переменной или NULL */
+    int (*set_var)(const char *name, const char *value);        /**< Установка переменной (0 или -1) */
+} shell_builtin_call_t;
+
+/**
+ * @brief Обработчик команды
+ * @param call Вызов
+ * @return Код выхода команды
+ */
+typedef int (*shell_builtin_fn_t)(const shell_builtin_call_t *call);
+
+/**
+ * @struct shell_builtin_def_t
+ * @brief Описание команды, экспортируемое библиотекой
+ */
+typedef struct {
+    unsigned int abi_version;       /**< SHELL_BUILTIN_ABI_VERSION библиотеки */
+    const char *name;               /**< Имя команды */
+    const char *usage;              /**< Строка справки или NULL */
+    shell_builtin_fn_t run;         /**< Обработчик */
+} shell_builtin_def_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHELLPLUGIN_H */
@@ -0,0 +1,77 @@
+/**
+ * @file shellstats.h
+ * @brief Заголовочный файл счётчиков накладных расходов оболочки (shellstats)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Оболочка считает собственные расходы: вызовы malloc и free и их объём
+ * (если исполняемый файл собран с перехватом аллокатора, ENABLE_ALLOC_STATS),
+ * системные вызовы на горячем пути (fork, dup2, open, getcwd, gethostname),
+ * попадания в кеши (пути команд, приглашение, текущий каталог) и пиковый
+ * RSS. shellstats выводит счётчики, shellstats --reset обнуляет их, чтобы
+ * измерить одну команду:
+ * @code
+ * shellstats --reset; ls -la; shellstats
+ * @endcode
+ *
+ * Счётчики общие для всех потоков и увеличиваются атомарно без упорядочивания.
+ */
+
+#ifndef SHELLSTATS_H
+#define SHELLSTATS_H
+
+/**
+ * @enum shellstat_id_t
+ * @brief Счётчики системных вызовов и кешей
+ */
+typedef enum {
+    SHELLSTAT_FORK,             /**< fork */
+    SHELLSTAT_DUP2,             /**< dup2 */
+    SHELLSTAT_OPEN,             /**< open и openat */
+    SHELLSTAT_GETCWD,           /**< getcwd */
+    SHELLSTAT_GETHOSTNAME,      /**< gethostname */
+    SHELLSTAT_CMDHASH_HIT,      /**< Путь команды найден в таблице */
+    SHELLSTAT_CMDHASH_MISS,     /**< Путь команды искался по PATH */
+    SHELLSTAT_PROMPT_HIT,       /**< Приглашение не изменилось */
+    SHELLSTAT_PROMPT_MISS,      /**< Приглашение построено заново */
+    SHELLSTAT_DIR_HIT,          /**< Текущий каталог взят из кеша */
+    SHELLSTAT_DIR_MISS,         /**< Текущий каталог запрошен у ядра */
+    SHELLSTAT_COUNT             /**< Количество счётчиков */
+} shellstat_id_t;
+
+/**
+ * @struct shellstats_alloc_t
+ * @brief Счётчики аллокатора
+ *
+ * @details Объём считается по malloc_usable_size, то есть вместе с
+ * округлением аллокатора.
+ */
+typedef struct {
+    int hooked;                         /**< Перехват аллокатора подключён */
+    unsigned long long mallocs;         /**< Выделений (malloc, calloc, realloc) */
+    unsigned long long frees;           /**< Освобождений */
+    unsigned long long bytes_allocated; /**< Выделено байт */
+    unsigned long long bytes_freed;     /**< Освобождено байт */
+} shellstats_alloc_t;
+
+/**
+ * @brief Счётчики системных вызовов и кешей
+ */
+extern unsigned long long shellstats_counters[SHELLSTAT_COUNT];
+
+/**
+ * @brief Счётчики аллокатора (заполняет перехватчик из allocstats.c)
+ */
+extern shellstats_alloc_t shellstats_alloc;
+
+/**
+ * @brief Увеличение счётчика
+ * @param id Счётчик
+ */
+static inline void shellstats_count(shellstat_id_t id) {
+    __atomic_fetch_add(&shellstats_counters[id], 1, __ATOMIC_RELAXED);
+}
+
+#endif /* SHELLSTATS_H */
@@ -0,0 +1,137 @@
+/**
+ * @file signals.h
+ * @brief Заголовочный файл для обработки сигналов и ловушек (trap)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Сигналы, для которых установлена ловушка, блокируются и принимаются
+ * через signalfd. Тела ловушек разбираются один раз при установке и
+ * выполняются из основного цикла оболочки, а не из обработчика сигнала.
+ * Пока ни одна ловушка не установлена, signalfd не создаётся.
+ */
+
+#ifndef SIGNALS_H
+#define SIGNALS_H
+
+#include "shell.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def TRAP_EXIT
+ * @brief Псевдосигнал EXIT (выход из оболочки)
+ */
+#define TRAP_EXIT 0
+
+/**
+ * @def TRAP_ERR
+ * @brief Псевдосигнал ERR (команда завершилась с ненулевым кодом)
+ */
+#define TRAP_ERR (NSIG)
+
+/**
+ * @def TRAP_DEBUG
+ * @brief Псевдосигнал DEBUG (перед выполнением каждой команды)
+ */
+#define TRAP_DEBUG (NSIG + 1)
+
+/**
+ * @def TRAP_SLOTS
+ * @brief Количество ячеек таблицы ловушек
+ */
+#define TRAP_SLOTS (NSIG + 2)
+
+/**
+ * @brief Дескриптор signalfd для перехватываемых сигналов
+ * @details -1, если ни одна ловушка на сигнал не установлена
+ */
+extern int g_trap_signal_fd;
+
+/**
+ * @brief Битовая маска установленных псевдосигналов EXIT/ERR/DEBUG
+ */
+extern unsigned int g_trap_pseudo_mask;
+
+/**
+ * @brief Разбор обозначения сигнала (INT, SIGINT, 2, EXIT, ERR, DEBUG)
+ * @param spec Обозначение сигнала
+ * @return Номер ячейки ловушки или -1 если обозначение неизвестно
+ */
+int trap_parse_spec(const char *spec);
+
+/**
+ * @brief Установка ловушки
+ * @param slot Номер ячейки (сигнал или TRAP_EXIT/TRAP_ERR/TRAP_DEBUG)
+ * @param body Тело ловушки; NULL - сброс, пустая строка - игнорирование
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int trap_set(int slot, const char *body);
+
+/**
+ * @brief Вывод установленных ловушек в формате, пригодном для повторного ввода
+ */
+void trap_print(void);
+
+/**
+ * @brief Функция обхода ловушек
+ * @param slot Номер ячейки
+ * @param body Тело ловушки; пустая строка - сигнал игнорируется
+ * @param arg Аргумент, переданный в trap_foreach
+ * @return 0 для продолжения обхода, иначе обход прекращается
+ */
+typedef int (*trap_visit_fn)(int slot, const char *body, void *arg);
+
+/**
+ * @brief Обход установленных ловушек по номерам ячеек (для образа сессии)
+ * @param visit Функция обхода
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit (0 если обход завершён)
+ */
+int trap_foreach(trap_visit_fn visit, void *arg);
+
+/**
+ * @brief Выполнение ловушек для сигналов, накопившихся в signalfd
+ */
+void trap_dispatch_signals(void);
+
+/**
+ * @brief Выполнение ловушки псевдосигнала
+ * @param slot TRAP_EXIT, TRAP_ERR или TRAP_DEBUG
+ */
+void trap_run_pseudo(int slot);
+
+/**
+ * @brief Ожидание готовности ввода с одновременным выполнением ловушек
+ * @param fd Дескриптор ввода
+ * @return 0 когда ввод готов, -1 в случае ошибки
+ */
+int trap_wait_input(int fd);
+
+/**
+ * @brief Восстановление маски сигналов в дочернем процессе перед exec
+ */
+void signals_reset_child(void);
+
+/**
+ * @brief Вывод списка имён сигналов (trap -l)
+ */
+void trap_list_signals(void);
+
+/**
+ * @brief Проверка, установлена ли ловушка псевдосигнала
+ * @param slot TRAP_EXIT, TRAP_ERR или TRAP_DEBUG
+ * @return Ненулевое значение если установлена
+ */
+static inline int trap_pseudo_installed(int slot) {
+    return g_trap_pseudo_mask & (1u << (slot == TRAP_EXIT ? 0 : slot - NSIG + 1));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIGNALS_H */
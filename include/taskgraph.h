@@ -0,0 +1,41 @@
+/**
+ * @file taskgraph.h
+ * @brief Заголовочный файл запуска графа задач (встроенная команда run-graph)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Файл задач состоит из разделов:
+ * @code
+ * # комментарий
+ * [link]
+ * deps = compile
+ * inputs = main.o util.o
+ * outputs = app
+ * command = cc -o app main.o util.o
+ * @endcode
+ * Списки разделяются пробелами, несколько строк command выполняются
+ * по очереди. Задача запускается, когда завершены все её зависимости;
+ * одновременно выполняется не больше N задач. Задача пропускается, если
+ * все её выходы существуют и не старше самого нового входа. В конце
+ * выводится время каждой задачи и критический путь - цепочка зависимостей
+ * с наибольшим суммарным временем.
+ */
+
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+/**
+ * @def TASKGRAPH_MAX_LINE
+ * @brief Максимальная длина строки файла задач
+ */
+#define TASKGRAPH_MAX_LINE 4096
+
+/**
+ * @def TASKGRAPH_MAX_JOBS
+ * @brief Верхняя граница числа одновременно выполняемых задач
+ */
+#define TASKGRAPH_MAX_JOBS 256
+
+#endif /* TASKGRAPH_H */
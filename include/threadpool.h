@@ -0,0 +1,103 @@
+/**
+ * @file threadpool.h
+ * @brief Заголовочный файл общего пула потоков с перехватом работы
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Один пул на всю оболочку для параллельных встроенных команд. У каждого
+ * рабочего потока своя очередь: владелец берёт задания с конца, свободные
+ * потоки забирают их с начала чужих очередей. Потоки создаются по мере
+ * появления работы, их число ограничено переменной CUSTOM_SHELL_THREADS,
+ * а по умолчанию - квотой процессора cgroup (cpu.max), а не числом ядер.
+ *
+ * Задания объединяются в группы. Группа, созданная командой переднего
+ * плана, отменяется по Ctrl+C; группа внутри фоновой задачи - вместе с
+ * этой задачей (kill %N).
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def THREADPOOL_MAX_THREADS
+ * @brief Верхняя граница размера пула
+ */
+#define THREADPOOL_MAX_THREADS 64
+
+/**
+ * @brief Функция задания
+ * @param arg Аргумент, переданный при отправке
+ */
+typedef void (*threadpool_fn)(void *arg);
+
+/**
+ * @brief Группа заданий с общими ожиданием и отменой
+ */
+typedef struct threadpool_group threadpool_group_t;
+
+/**
+ * @brief Текущий размер пула
+ * @return CUSTOM_SHELL_THREADS, если задана, иначе квота CPU cgroup
+ */
+int threadpool_size(void);
+
+/**
+ * @brief Создание группы заданий
+ * @return Группа или NULL в случае ошибки
+ */
+threadpool_group_t *threadpool_group_create(void);
+
+/**
+ * @brief Отправка задания в пул
+ * @param group Группа
+ * @param fn Функция задания
+ * @param arg Аргумент
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int threadpool_submit(threadpool_group_t *group, threadpool_fn fn, void *arg);
+
+/**
+ * @brief Ожидание всех заданий группы
+ * @param group Группа
+ * @return 0 если группа выполнена полностью, -1 если она была отменена
+ *
+ * @details Ожидающий поток сам выполняет задания из очередей пула.
+ */
+int threadpool_group_wait(threadpool_group_t *group);
+
+/**
+ * @brief Отмена группы: ещё не начатые задания пропускаются
+ * @param group Группа
+ */
+void threadpool_group_cancel(threadpool_group_t *group);
+
+/**
+ * @brief Освобождение группы (после threadpool_group_wait)
+ * @param group Группа
+ */
+void threadpool_group_destroy(threadpool_group_t *group);
+
+/**
+ * @brief Проверка отмены из выполняемого задания
+ * @return Ненулевое значение если работу текущего задания нужно прекратить
+ *
+ * @details Вне заданий пула учитывается только отмена фоновой задачи.
+ */
+int threadpool_cancelled(void);
+
+/**
+ * @brief Отмена групп переднего плана (вызывается из обработчика SIGINT)
+ */
+void threadpool_interrupt(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THREADPOOL_H */
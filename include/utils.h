@@ -42,10 +42,40 @@ void free_string_array(char **strings, int count);
  */
 char *trim_string(char *str);
 
+/**
+ * @brief Граница слова в кавычках, разбитого парсером по пробелам
+ * @param args Слова команды
+ * @param argc Количество слов
+ * @param start Индекс первого слова
+ * @param offset Смещение возможной открывающей кавычки в первом слове
+ * @return Индекс слова после закрывающей кавычки; start + 1, если кавычки
+ *         нет; argc, если кавычка не закрыта
+ */
+int quoted_span(char *const *args, int argc, int start, size_t offset);
+
+/**
+ * @brief Сборка тела из слов, разбитых парсером по пробелам
+ * @param args Слова команды
+ * @param start Индекс первого слова
+ * @param end Индекс слова после последнего
+ * @param offset Количество пропускаемых байт первого слова (например, "имя=")
+ * @param buffer Буфер для тела
+ * @param size Размер буфера
+ * @return buffer
+ *
+ * @details Слова соединяются одним пробелом. Если тело целиком в кавычках,
+ * они снимаются, а внутри одинарных '\'' заменяется на ' - так тело,
+ * выведенное trap, alias или hook, можно ввести повторно.
+ */
+char *join_words(char *const *args, int start, int end, size_t offset,
+                 char *buffer, size_t size);
+
 /**
  * @brief Получение переменной окружения
  * @param name Имя переменной
  * @return Значение переменной или NULL если не найдена
+ *
+ * @details Переменные встроенного контекста перекрывают окружение процесса.
  */
 char *get_env_var(const char *name);
 
@@ -54,9 +84,47 @@ char *get_env_var(const char *name);
  * @param name Имя переменной
  * @param value Значение переменной
  * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Интерактивная оболочка меняет окружение процесса (setenv),
+ * встроенный контекст - только собственные переменные.
  */
 int set_env_var(const char *name, const char *value);
 
+/**
+ * @brief Количество переменных контекста текущего потока
+ * @return Количество переменных, которые нужно добавить в окружение процессов
+ */
+int context_var_count(void);
+
+/**
+ * @brief Освобождение переменных контекста
+ * @param state Состояние оболочки
+ */
+void free_context_vars(shell_state_t *state);
+
+/**
+ * @brief Построение окружения для одного запуска дочернего процесса
+ * @param assigns Присваивания NAME=value, переопределяющие хранилище
+ * @param assign_count Количество присваиваний
+ * @param clear 1 — начать с пустого окружения (env -i)
+ * @param unsets Имена исключаемых переменных (env -u)
+ * @param unset_count Количество исключаемых переменных
+ * @return Массив указателей для execve (освобождается free())
+ *
+ * @details Строки не копируются, поэтому массив действителен только до
+ * следующего изменения хранилища переменных.
+ */
+char **build_child_env(char *const *assigns, int assign_count, int clear,
+                       char *const *unsets, int unset_count);
+
+/**
+ * @brief Применение присваиваний NAME=value к хранилищу переменных
+ * @param assigns Массив присваиваний
+ * @param assign_count Количество присваиваний
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int apply_assignments(char *const *assigns, int assign_count);
+
 /**
  * @brief Расширение переменных в строке
  * @param str Строка с переменными
@@ -0,0 +1,40 @@
+/**
+ * @file watch.h
+ * @brief Заголовочный файл слежения за файлами (встроенная команда watch)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * watch [-d мс] [-x имя]... путь... -- команда [аргументы]
+ * выполняет команду сразу и затем после каждого изменения в указанных
+ * файлах и каталогах. Каталоги отслеживаются рекурсивно через inotify,
+ * новые подкаталоги добавляются по мере появления. Файл отслеживается
+ * через свой каталог по имени, поэтому сохранение через rename поверх
+ * файла не теряет слежение. Серия событий
+ * сводится в один перезапуск после паузы -d; если команда ещё выполняется,
+ * когда приходят новые изменения, она прерывается. Ctrl+C завершает watch.
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+/**
+ * @def WATCH_DEFAULT_DEBOUNCE_MS
+ * @brief Пауза после последнего события перед перезапуском (мс)
+ */
+#define WATCH_DEFAULT_DEBOUNCE_MS 200
+
+/**
+ * @def WATCH_KILL_GRACE_MS
+ * @brief Время на завершение по SIGTERM до SIGKILL (мс)
+ */
+#define WATCH_KILL_GRACE_MS 1000
+
+/**
+ * @def WATCH_MAX_EXCLUDES
+ * @brief Максимальное количество параметров -x
+ */
+#define WATCH_MAX_EXCLUDES 16
+
+#endif /* WATCH_H */
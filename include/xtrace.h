@@ -0,0 +1,78 @@
+/**
+ * @file xtrace.h
+ * @brief Заголовочный файл трассировки команд (set -x)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * После set -x каждая команда перед выполнением выводится с префиксом
+ * PS4 (по умолчанию "+ "). Первый символ PS4 повторяется по глубине
+ * вложенности source, \t в PS4 заменяется временем (секунды Unix с
+ * микросекундами):
+ * @code
+ * PS4=+\t:
+ * @endcode
+ *
+ * Вывод идёт в дескриптор из переменной XTRACEFD (как BASH_XTRACEFD), по
+ * умолчанию в поток ошибок. Если дескриптор отдельный (не 1 и не 2),
+ * строки копятся в буфере и пишутся одним write, когда буфер заполнен,
+ * прошло XTRACE_FLUSH_MS мс, выполнен set +x или оболочка завершается.
+ * В поток ошибок каждая строка пишется сразу, чтобы не перемешиваться с
+ * ошибками команд.
+ *
+ * PS4 и XTRACEFD читаются при set -x.
+ */
+
+#ifndef XTRACE_H
+#define XTRACE_H
+
+#include "shell.h"
+#include <stdint.h>
+
+/**
+ * @def XTRACE_BUFFER_SIZE
+ * @brief Размер буфера трассировки (байт)
+ */
+#define XTRACE_BUFFER_SIZE 8192
+
+/**
+ * @def XTRACE_FLUSH_MS
+ * @brief Наибольшая задержка строки в буфере (мс)
+ */
+#define XTRACE_FLUSH_MS 1000
+
+/**
+ * @def XTRACE_PS4_MAX
+ * @brief Наибольшая длина PS4
+ */
+#define XTRACE_PS4_MAX 64
+
+/**
+ * @brief Включение трассировки (set -x)
+ * @param state Состояние оболочки
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int xtrace_start(shell_state_t *state);
+
+/**
+ * @brief Выключение трассировки с записью буфера (set +x, выход)
+ * @param state Состояние оболочки
+ */
+void xtrace_stop(shell_state_t *state);
+
+/**
+ * @brief Вывод команды перед выполнением
+ * @param state Состояние оболочки
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ */
+void xtrace_command(shell_state_t *state, const command_t *commands, int count);
+
+/**
+ * @brief Запись буфера трассировки
+ * @param state Состояние оболочки (может быть NULL)
+ */
+void xtrace_flush(shell_state_t *state);
+
+#endif /* XTRACE_H */
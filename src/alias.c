@@ -0,0 +1,486 @@
+/**
+ * @file alias.c
+ * @brief Реализация псевдонимов команд (alias, unalias)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "alias.h"
+#include "builtins.h"
+#include "parser.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @def ALIAS_INITIAL_BUCKETS
+ * @brief Начальное количество цепочек таблицы (степень двойки)
+ */
+#define ALIAS_INITIAL_BUCKETS 16
+
+/**
+ * @struct alias_t
+ * @brief Псевдоним в разобранном виде
+ */
+typedef struct alias {
+    char *name;             /**< Имя */
+    char *text;             /**< Исходное тело (для вывода alias) */
+    char **words;           /**< Слова тела */
+    int count;              /**< Количество слов */
+    int trailing_blank;     /**< Тело оканчивается пробелом */
+    unsigned long hash;     /**< Хеш имени */
+    unsigned long visited;  /**< Номер раскрытия, в котором псевдоним уже подставлен */
+    struct alias *next;     /**< Следующий псевдоним цепочки */
+} alias_t;
+
+/**
+ * @struct alias_table
+ * @brief Псевдонимы состояния оболочки
+ */
+struct alias_table {
+    alias_t **buckets;          /**< Цепочки */
+    size_t bucket_count;        /**< Количество цепочек (степень двойки) */
+    size_t count;               /**< Количество псевдонимов */
+    unsigned long expansions;   /**< Счётчик раскрытий для отметки visited */
+};
+
+// Источник ключей наборов псевдонимов: ключ не повторяется в процессе
+static unsigned long alias_keys = 0;
+
+/**
+ * @brief Хеш имени (FNV-1a)
+ * @param name Имя
+ * @return Хеш
+ */
+static unsigned long alias_hash(const char *name) {
+    unsigned long hash = 2166136261UL;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash = (hash ^ *p) * 16777619UL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Поиск псевдонима
+ * @param table Псевдонимы (может быть NULL)
+ * @param name Имя
+ * @return Указатель на ссылку на псевдоним в цепочке или NULL
+ */
+static alias_t **alias_find(const alias_table_t *table, const char *name) {
+    if (!table) {
+        return NULL;
+    }
+    unsigned long hash = alias_hash(name);
+    for (alias_t **link = &table->buckets[hash & (table->bucket_count - 1)]; *link;
+         link = &(*link)->next) {
+        if ((*link)->hash == hash && strcmp((*link)->name, name) == 0) {
+            return link;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Освобождение псевдонима
+ * @param alias Псевдоним
+ */
+static void alias_free(alias_t *alias) {
+    for (int i = 0; i < alias->count; i++) {
+        free(alias->words[i]);
+    }
+    free(alias->words);
+    free(alias->name);
+    free(alias->text);
+    free(alias);
+}
+
+/**
+ * @brief Новый ключ набора псевдонимов после изменения
+ * @param state Состояние оболочки
+ *
+ * @details Строки в кэше разбора, разобранные со старым набором, больше не
+ * находятся и вытесняются как давно не используемые.
+ */
+static void alias_changed(shell_state_t *state) {
+    if (state->aliases && state->aliases->count > 0) {
+        state->alias_key = __atomic_add_fetch(&alias_keys, 1, __ATOMIC_RELAXED);
+    } else {
+        state->alias_key = 0;
+    }
+}
+
+/**
+ * @brief Удвоение количества цепочек
+ * @param table Псевдонимы
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int alias_grow(alias_table_t *table) {
+    size_t bucket_count = table->bucket_count * 2;
+    alias_t **buckets = calloc(bucket_count, sizeof(*buckets));
+    if (!buckets) {
+        return -1;
+    }
+    for (size_t i = 0; i < table->bucket_count; i++) {
+        alias_t *alias = table->buckets[i];
+        while (alias) {
+            alias_t *next = alias->next;
+            alias_t **bucket = &buckets[alias->hash & (bucket_count - 1)];
+            alias->next = *bucket;
+            *bucket = alias;
+            alias = next;
+        }
+    }
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucket_count = bucket_count;
+    return 0;
+}
+
+/**
+ * @brief Замена слова словами тела псевдонима
+ * @param args Указатель на массив слов
+ * @param argc Указатель на количество слов
+ * @param position Индекс заменяемого слова
+ * @param alias Псевдоним
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int alias_splice(char ***args, int *argc, int position, const alias_t *alias) {
+    int total = *argc - 1 + alias->count;
+    char **words = malloc((size_t)(total + 1) * sizeof(char *));
+    if (!words) {
+        return -1;
+    }
+    for (int i = 0; i < alias->count; i++) {
+        words[position + i] = strdup(alias->words[i]);
+        if (!words[position + i]) {
+            while (i-- > 0) {
+                free(words[position + i]);
+            }
+            free(words);
+            return -1;
+        }
+    }
+    memcpy(words, *args, (size_t)position * sizeof(char *));
+    memcpy(words + position + alias->count, *args + position + 1,
+           (size_t)(*argc - position) * sizeof(char *));
+
+    free((*args)[position]);
+    free(*args);
+    *args = words;
+    *argc = total;
+    return 0;
+}
+
+/**
+ * @brief Раскрытие псевдонимов в словах команды
+ * @param state Состояние оболочки
+ * @param args Указатель на массив слов (завершён NULL, может быть заменён)
+ * @param argc Указатель на количество слов
+ * @param position Индекс слова в позиции команды
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int alias_expand(shell_state_t *state, char ***args, int *argc, int position) {
+    alias_table_t *table = state->aliases;
+    if (!table || table->count == 0) {
+        return 0;
+    }
+
+    // Псевдонимы, уже раскрытые в этой команде, отмечены номером раскрытия
+    unsigned long expansion = ++table->expansions;
+    // Слово после тела, оканчивающегося пробелом, или -1
+    int next = -1;
+
+    while (position < *argc) {
+        alias_t **link = alias_find(table, (*args)[position]);
+        if (!link || (*link)->visited == expansion) {
+            if (next == -1) {
+                break;
+            }
+            position = next;
+            next = -1;
+            continue;
+        }
+
+        alias_t *alias = *link;
+        alias->visited = expansion;
+        if (alias_splice(args, argc, position, alias) != 0) {
+            return -1;
+        }
+        if (next > position) {
+            next += alias->count - 1;
+        }
+        if (alias->trailing_blank) {
+            next = position + alias->count;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Определение псевдонима
+ * @param state Состояние оболочки
+ * @param name Имя
+ * @param value Тело
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int alias_define(shell_state_t *state, const char *name, const char *value) {
+    if (*name == '\0' || strpbrk(name, "/$'\"\\") || strpbrk(name, "|;&<>")) {
+        fprintf(shell_stderr(), "alias: %s: недопустимое имя псевдонима\n", name);
+        return -1;
+    }
+    if (strpbrk(value, "|;&<>")) {
+        fprintf(shell_stderr(), "alias: %s: перенаправления и конвейеры в теле не поддерживаются\n", name);
+        return -1;
+    }
+
+    if (!state->aliases) {
+        alias_table_t *table = calloc(1, sizeof(*table));
+        if (table) {
+            table->buckets = calloc(ALIAS_INITIAL_BUCKETS, sizeof(*table->buckets));
+            table->bucket_count = ALIAS_INITIAL_BUCKETS;
+        }
+        if (!table || !table->buckets) {
+            free(table);
+            fprintf(shell_stderr(), "alias: недостаточно памяти\n");
+            return -1;
+        }
+        state->aliases = table;
+    }
+    alias_table_t *table = state->aliases;
+
+    // Тело разбирается один раз тем же разбором, что и аргументы команды
+    alias_t *alias = calloc(1, sizeof(*alias));
+    if (!alias) {
+        fprintf(shell_stderr(), "alias: недостаточно памяти\n");
+        return -1;
+    }
+    alias->count = parse_arguments(value, &alias->words);
+    alias->name = strdup(name);
+    alias->text = strdup(value);
+    alias->hash = alias_hash(name);
+    size_t len = strlen(value);
+    alias->trailing_blank = len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t');
+    if (!alias->name || !alias->text || (!alias->words && alias->count > 0)) {
+        alias_free(alias);
+        fprintf(shell_stderr(), "alias: недостаточно памяти\n");
+        return -1;
+    }
+
+    alias_t **link = alias_find(table, name);
+    if (link) {
+        // Новое тело занимает место прежнего в цепочке
+        alias_t *old = *link;
+        alias->next = old->next;
+        *link = alias;
+        alias_free(old);
+    } else {
+        // Без памяти на новые цепочки таблица работает с прежними, более длинными
+        if (table->count >= table->bucket_count) {
+            alias_grow(table);
+        }
+        alias_t **bucket = &table->buckets[alias->hash & (table->bucket_count - 1)];
+        alias->next = *bucket;
+        *bucket = alias;
+        table->count++;
+    }
+
+    alias_changed(state);
+    return 0;
+}
+
+/**
+ * @brief Удаление псевдонима
+ * @param state Состояние оболочки
+ * @param name Имя
+ * @return 0 в случае успеха, -1 если псевдоним не найден
+ */
+static int alias_remove(shell_state_t *state, const char *name) {
+    alias_t **link = alias_find(state->aliases, name);
+    if (!link) {
+        return -1;
+    }
+    alias_t *alias = *link;
+    *link = alias->next;
+    alias_free(alias);
+    state->aliases->count--;
+    alias_changed(state);
+    return 0;
+}
+
+/**
+ * @brief Удаление всех псевдонимов
+ * @param state Состояние оболочки
+ */
+void alias_clear_all(shell_state_t *state) {
+    alias_table_t *table = state->aliases;
+    if (!table) {
+        return;
+    }
+    for (size_t i = 0; i < table->bucket_count; i++) {
+        alias_t *alias = table->buckets[i];
+        while (alias) {
+            alias_t *next = alias->next;
+            alias_free(alias);
+            alias = next;
+        }
+    }
+    free(table->buckets);
+    free(table);
+    state->aliases = NULL;
+    state->alias_key = 0;
+}
+
+/**
+ * @brief Сравнение псевдонимов по имени (для qsort)
+ * @param a Указатель на первый псевдоним
+ * @param b Указатель на второй псевдоним
+ * @return Результат strcmp имён
+ */
+static int alias_compare(const void *a, const void *b) {
+    return strcmp((*(const alias_t *const *)a)->name, (*(const alias_t *const *)b)->name);
+}
+
+/**
+ * @brief Обход псевдонимов в порядке имён (для вывода и образа сессии)
+ * @param state Состояние оболочки
+ * @param visit Функция обхода
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit (0 если обход завершён), -1 при нехватке памяти
+ */
+int alias_foreach(shell_state_t *state, alias_visit_fn visit, void *arg) {
+    alias_table_t *table = state->aliases;
+    if (!table || table->count == 0) {
+        return 0;
+    }
+
+    const alias_t **sorted = malloc(table->count * sizeof(*sorted));
+    if (!sorted) {
+        return -1;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < table->bucket_count; i++) {
+        for (const alias_t *alias = table->buckets[i]; alias; alias = alias->next) {
+            sorted[count++] = alias;
+        }
+    }
+    qsort(sorted, count, sizeof(*sorted), alias_compare);
+
+    int result = 0;
+    for (size_t i = 0; i < count && result == 0; i++) {
+        result = visit(sorted[i]->name, sorted[i]->text, arg);
+    }
+    free(sorted);
+    return result;
+}
+
+/**
+ * @brief Вывод псевдонима в формате alias (функция обхода)
+ * @param name Имя
+ * @param text Тело
+ * @param arg Не используется
+ * @return 0
+ */
+static int alias_print(const char *name, const char *text, void *arg) {
+    (void)arg;
+    fprintf(shell_stdout(), "alias %s='", name);
+    // Одинарная кавычка тела записывается как '\'', чтобы вывод читался обратно
+    for (const char *p = text; *p; p++) {
+        if (*p == '\'') {
+            fputs("'\\''", shell_stdout());
+        } else {
+            fputc(*p, shell_stdout());
+        }
+    }
+    fputs("'\n", shell_stdout());
+    return 0;
+}
+
+/**
+ * @brief Встроенная команда alias
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если часть аргументов не обработана, -1 в случае ошибки
+ */
+int builtin_alias(char **args, int argc) {
+    shell_state_t *state = shell_current();
+    if (!state) {
+        return -1;
+    }
+    if (argc == 1) {
+        return alias_foreach(state, alias_print, NULL) == 0 ? 0 : -1;
+    }
+
+    int failed = 0;
+    int total = 0;
+    for (int i = 1; i < argc; i++) {
+        total++;
+        char *eq = strchr(args[i], '=');
+        if (!eq || eq == args[i]) {
+            alias_t **link = alias_find(state->aliases, args[i]);
+            if (link) {
+                alias_print((*link)->name, (*link)->text, NULL);
+            } else {
+                fprintf(shell_stderr(), "alias: %s: не найден\n", args[i]);
+                failed++;
+            }
+            continue;
+        }
+
+        char name[256];
+        snprintf(name, sizeof(name), "%.*s", (int)(eq - args[i]), args[i]);
+
+        // Парсер разбивает тело в кавычках по пробелам, поэтому собираем его обратно
+        char value[MAX_INPUT_SIZE];
+        size_t offset = (size_t)(eq - args[i]) + 1;
+        int end = quoted_span(args, argc, i, offset);
+        join_words(args, i, end, offset, value, sizeof(value));
+        i = end - 1;
+
+        if (alias_define(state, name, value) != 0) {
+            failed++;
+        }
+    }
+
+    if (failed == 0) {
+        return 0;
+    }
+    return failed < total ? 1 : -1;
+}
+
+/**
+ * @brief Встроенная команда unalias
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если часть имён не найдена, -1 в случае ошибки
+ */
+int builtin_unalias(char **args, int argc) {
+    shell_state_t *state = shell_current();
+    if (!state) {
+        return -1;
+    }
+    if (argc < 2) {
+        fprintf(shell_stderr(), "Использование: unalias [-a] имя...\n");
+        return -1;
+    }
+
+    if (strcmp(args[1], "-a") == 0) {
+        alias_clear_all(state);
+        return 0;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        if (alias_remove(state, args[i]) != 0) {
+            fprintf(shell_stderr(), "unalias: %s: не найден\n", args[i]);
+            failed++;
+        }
+    }
+
+    if (failed == 0) {
+        return 0;
+    }
+    return failed < argc - 1 ? 1 : -1;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file allocstats.c
+ * @brief Перехват malloc и free для счётчиков shellstats
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details Файл входит только в исполняемый файл custom_shell (опция
+ * ENABLE_ALLOC_STATS), а не в библиотеку: программа, встраивающая
+ * интерпретатор, сохраняет свой аллокатор. Функции замещают malloc glibc
+ * для всего процесса, включая вызовы из самой libc, и передают работу
+ * __libc_malloc и остальным внутренним точкам входа glibc.
+ */
+
+#define _GNU_SOURCE
+
+#include "shellstats.h"
+#include <errno.h>
+#include <malloc.h>
+#include <stddef.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/**
+ * @brief Отметка о подключённом перехвате
+ */
+__attribute__((constructor))
+static void allocstats_init(void) {
+    shellstats_alloc.hooked = 1;
+}
+
+/**
+ * @brief Учёт выделенного блока
+ * @param ptr Блок или NULL
+ * @return ptr
+ */
+static inline void *allocstats_allocated(void *ptr) {
+    if (ptr) {
+        __atomic_fetch_add(&shellstats_alloc.mallocs, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&shellstats_alloc.bytes_allocated, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Учёт освобождаемого блока
+ * @param ptr Блок или NULL
+ */
+static inline void allocstats_freed(void *ptr) {
+    if (ptr) {
+        __atomic_fetch_add(&shellstats_alloc.frees, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&shellstats_alloc.bytes_freed, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief malloc с учётом
+ * @param size Размер
+ * @return Блок или NULL
+ */
+void *malloc(size_t size) {
+    return allocstats_allocated(__libc_malloc(size));
+}
+
+/**
+ * @brief calloc с учётом
+ * @param count Количество элементов
+ * @param size Размер элемента
+ * @return Блок или NULL
+ */
+void *calloc(size_t count, size_t size) {
+    return allocstats_allocated(__libc_calloc(count, size));
+}
+
+/**
+ * @brief realloc с учётом: старый блок считается освобождённым, новый - выделенным
+ * @param ptr Старый блок
+ * @param size Новый размер
+ * @return Блок или NULL (старый блок тогда не изменён)
+ */
+void *realloc(void *ptr, size_t size) {
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *result = __libc_realloc(ptr, size);
+    if (!result && size != 0) {
+        return NULL;
+    }
+    if (ptr) {
+        __atomic_fetch_add(&shellstats_alloc.frees, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&shellstats_alloc.bytes_freed, old_size, __ATOMIC_RELAXED);
+    }
+    return allocstats_allocated(result);
+}
+
+/**
+ * @brief free с учётом
+ * @param ptr Блок
+ */
+void free(void *ptr) {
+    allocstats_freed(ptr);
+    __libc_free(ptr);
+}
+
+/**
+ * @brief posix_memalign с учётом
+ * @param result Куда записать блок
+ * @param alignment Выравнивание
+ * @param size Размер
+ * @return 0 или код ошибки
+ */
+int posix_memalign(void **result, size_t alignment, size_t size) {
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void *ptr = __libc_memalign(alignment, size);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *result = allocstats_allocated(ptr);
+    return 0;
+}
+
+/**
+ * @brief aligned_alloc с учётом
+ * @param alignment Выравнивание
+ * @param size Размер
+ * @return Блок или NULL
+ */
+void *aligned_alloc(size_t alignment, size_t size) {
+    return allocstats_allocated(__libc_memalign(alignment, size));
+}
+
+/**
+ * @brief memalign с учётом
+ * @param alignment Выравнивание
+ * @param size Размер
+ * @return Блок или NULL
+ */
+void *memalign(size_t alignment, size_t size) {
+    return allocstats_allocated(__libc_memalign(alignment, size));
+}
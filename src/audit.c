@@ -0,0 +1,508 @@
+/**
+ * @file audit.c
+ * @brief Реализация журнала аудита выполненных команд
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "audit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @struct audit_record_t
+ * @brief Запись о выполненной команде
+ */
+typedef struct {
+    struct timespec started;        /**< Время запуска */
+    struct timespec finished;       /**< Время завершения */
+    int status;                     /**< Код выхода */
+    double user;                    /**< Процессорное время пользователя (с) */
+    double sys;                     /**< Процессорное время ядра (с) */
+    char cwd[MAX_PATH];             /**< Каталог запуска */
+    char argv[AUDIT_ARGV_MAX];      /**< Слова через '\0', пустое слово - граница звеньев */
+    size_t argv_len;                /**< Занято байт в argv */
+} audit_record_t;
+
+/**
+ * @struct audit_queue_t
+ * @brief Очередь записей одного потока (один писатель, один читатель)
+ *
+ * @details head меняет только поток-писатель, tail - только фоновый поток;
+ * они лежат в разных строках кеша. Очереди не освобождаются.
+ */
+typedef struct audit_queue {
+    audit_record_t records[AUDIT_QUEUE_SIZE];   /**< Кольцевой буфер */
+    _Alignas(64) unsigned long head;            /**< Записано (писатель) */
+    _Alignas(64) unsigned long tail;            /**< Прочитано (читатель) */
+    unsigned long dropped;                      /**< Отброшено при полной очереди */
+    struct audit_queue *next;                   /**< Следующая очередь */
+} audit_queue_t;
+
+int audit_enabled = 0;
+
+static pthread_mutex_t audit_lock = PTHREAD_MUTEX_INITIALIZER;
+static audit_queue_t *audit_queues = NULL;
+static __thread audit_queue_t *audit_self = NULL;
+
+static int audit_sink_fd = -1;
+static int audit_is_socket = 0;
+static char *audit_socket_path = NULL;
+static int audit_event_fd = -1;
+static int audit_stopping = 0;
+static unsigned long audit_reported_drops = 0;
+static pthread_t audit_thread;
+
+/**
+ * @brief Очередь текущего потока
+ * @return Очередь или NULL при нехватке памяти
+ */
+static audit_queue_t *audit_local(void) {
+    if (audit_self) {
+        return audit_self;
+    }
+
+    audit_queue_t *queue = aligned_alloc(_Alignof(audit_queue_t), sizeof(*queue));
+    if (!queue) {
+        return NULL;
+    }
+    memset(queue, 0, sizeof(*queue));
+
+    pthread_mutex_lock(&audit_lock);
+    queue->next = audit_queues;
+    __atomic_store_n(&audit_queues, queue, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&audit_lock);
+
+    audit_self = queue;
+    return queue;
+}
+
+/**
+ * @brief Время из rusage в секундах
+ * @param tv Время
+ * @return Секунды
+ */
+static double audit_seconds(struct timeval tv) {
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+/**
+ * @brief Замер перед выполнением команды
+ * @param mark Куда записать состояние
+ * @return 1 если журнал включён, 0 иначе
+ */
+int audit_begin(audit_mark_t *mark) {
+    if (!audit_enabled) {
+        return 0;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &mark->started);
+    getrusage(RUSAGE_THREAD, &mark->self);
+    getrusage(RUSAGE_CHILDREN, &mark->children);
+    if (!shell_getcwd(mark->cwd, sizeof(mark->cwd))) {
+        strcpy(mark->cwd, "?");
+    }
+    return 1;
+}
+
+/**
+ * @brief Постановка записи о выполненной команде в очередь
+ * @param mark Состояние перед выполнением
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ * @param status Код выхода
+ *
+ * @details Время дочерних процессов берётся для всего процесса: в сервере
+ * сессий в него попадают и процессы, завершившиеся в других сессиях.
+ */
+void audit_end(const audit_mark_t *mark, const command_t *commands, int count, int status) {
+    if (!audit_enabled) {
+        return;
+    }
+    audit_queue_t *queue = audit_local();
+    if (!queue) {
+        return;
+    }
+
+    unsigned long head = queue->head;
+    if (head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == AUDIT_QUEUE_SIZE) {
+        __atomic_fetch_add(&queue->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    audit_record_t *record = &queue->records[head & (AUDIT_QUEUE_SIZE - 1)];
+    struct rusage self, children;
+    clock_gettime(CLOCK_REALTIME, &record->finished);
+    getrusage(RUSAGE_THREAD, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    record->started = mark->started;
+    record->status = status;
+    record->user = audit_seconds(self.ru_utime) - audit_seconds(mark->self.ru_utime) +
+                   audit_seconds(children.ru_utime) - audit_seconds(mark->children.ru_utime);
+    record->sys = audit_seconds(self.ru_stime) - audit_seconds(mark->self.ru_stime) +
+                  audit_seconds(children.ru_stime) - audit_seconds(mark->children.ru_stime);
+    memcpy(record->cwd, mark->cwd, sizeof(record->cwd));
+
+    // Слова, не поместившиеся в запись, отбрасываются целиком
+    size_t used = 0;
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && used < sizeof(record->argv)) {
+            record->argv[used++] = '\0';
+        }
+        for (int j = 0; j < commands[i].argc; j++) {
+            size_t len = strlen(commands[i].args[j]) + 1;
+            if (len == 1 || used + len > sizeof(record->argv)) {
+                continue;
+            }
+            memcpy(record->argv + used, commands[i].args[j], len);
+            used += len;
+        }
+    }
+    record->argv_len = used;
+
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+
+    uint64_t one = 1;
+    if (write(audit_event_fd, &one, sizeof(one)) != sizeof(one)) {
+        // Счётчик eventfd переполнен: фоновый поток и так проснётся
+    }
+}
+
+/**
+ * @brief Вывод строки JSON с экранированием
+ * @param out Поток вывода
+ * @param text Строка
+ * @param len Длина
+ */
+static void audit_json_string(FILE *out, const char *text, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief Вывод записи строкой JSON
+ * @param out Поток вывода
+ * @param record Запись
+ */
+static void audit_format(FILE *out, const audit_record_t *record) {
+    fprintf(out, "{\"start\":%lld.%06ld,\"end\":%lld.%06ld,\"pid\":%d,\"uid\":%u,\"cwd\":",
+            (long long)record->started.tv_sec, record->started.tv_nsec / 1000,
+            (long long)record->finished.tv_sec, record->finished.tv_nsec / 1000,
+            (int)getpid(), (unsigned)getuid());
+    audit_json_string(out, record->cwd, strlen(record->cwd));
+
+    fputs(",\"argv\":[[", out);
+    const char *word = record->argv;
+    const char *end = record->argv + record->argv_len;
+    int first = 1;
+    while (word < end) {
+        size_t len = strlen(word);
+        if (len == 0) {
+            fputs("],[", out);
+            first = 1;
+        } else {
+            if (!first) {
+                fputc(',', out);
+            }
+            audit_json_string(out, word, len);
+            first = 0;
+        }
+        word += len + 1;
+    }
+    fprintf(out, "]],\"status\":%d,\"user\":%.6f,\"sys\":%.6f}\n",
+            record->status, record->user, record->sys);
+}
+
+/**
+ * @brief Подключение к сокету приёмника
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int audit_connect(void) {
+    if (audit_sink_fd != -1) {
+        close(audit_sink_fd);
+    }
+    audit_sink_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (audit_sink_fd == -1) {
+        return -1;
+    }
+
+    struct timeval timeout = {
+        .tv_sec = AUDIT_SEND_TIMEOUT_MS / 1000,
+        .tv_usec = (AUDIT_SEND_TIMEOUT_MS % 1000) * 1000,
+    };
+    setsockopt(audit_sink_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", audit_socket_path);
+    return connect(audit_sink_fd, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+/**
+ * @brief Отправка пачки записей
+ * @param buffer Записи подряд
+ * @param offsets Начала записей и конец последней (count + 1 элементов)
+ * @param count Количество записей
+ * @return Количество потерянных записей
+ */
+static unsigned long audit_flush(const char *buffer, const size_t *offsets, size_t count) {
+    if (!audit_is_socket) {
+        size_t done = offsets[0];
+        while (done < offsets[count]) {
+            ssize_t n = write(audit_sink_fd, buffer + done, offsets[count] - done);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                // Записи, не дописанные целиком, потеряны
+                size_t lost = 0;
+                while (lost < count && offsets[count - lost - 1] >= done) {
+                    lost++;
+                }
+                return lost;
+            }
+            done += (size_t)n;
+        }
+        return 0;
+    }
+
+    struct mmsghdr *messages = calloc(count, sizeof(*messages));
+    struct iovec *iov = calloc(count, sizeof(*iov));
+    if (!messages || !iov) {
+        free(messages);
+        free(iov);
+        return count;
+    }
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = (char *)buffer + offsets[i];
+        iov[i].iov_len = offsets[i + 1] - offsets[i];
+        messages[i].msg_hdr.msg_iov = &iov[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    int reconnected = 0;
+    while (sent < count) {
+        int n = sendmmsg(audit_sink_fd, messages + sent, (unsigned)(count - sent), 0);
+        if (n > 0) {
+            sent += (size_t)n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (!reconnected && (errno == ECONNREFUSED || errno == ENOTCONN ||
+                                    errno == EBADF || errno == EDESTADDRREQ)) {
+            // Приёмник перезапущен: один раз подключаемся заново
+            reconnected = 1;
+            audit_connect();
+        } else {
+            break;
+        }
+    }
+
+    free(messages);
+    free(iov);
+    return count - sent;
+}
+
+/**
+ * @brief Перенос всех записей из очередей в приёмник
+ */
+static void audit_drain(void) {
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&buffer, &size);
+    if (!out) {
+        return;
+    }
+
+    size_t capacity = AUDIT_QUEUE_SIZE + 1;
+    size_t count = 0;
+    size_t *offsets = malloc((capacity + 1) * sizeof(*offsets));
+    unsigned long drops = 0;
+
+    audit_queue_t *queues = __atomic_load_n(&audit_queues, __ATOMIC_ACQUIRE);
+    for (audit_queue_t *queue = queues; queue && offsets; queue = queue->next) {
+        drops += __atomic_load_n(&queue->dropped, __ATOMIC_RELAXED);
+
+        unsigned long tail = queue->tail;
+        unsigned long head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        for (; tail != head; tail++) {
+            if (count == capacity) {
+                size_t *grown = realloc(offsets, (capacity * 2 + 1) * sizeof(*offsets));
+                if (!grown) {
+                    break;
+                }
+                offsets = grown;
+                capacity *= 2;
+            }
+            offsets[count++] = (size_t)ftello(out);
+            audit_format(out, &queue->records[tail & (AUDIT_QUEUE_SIZE - 1)]);
+        }
+        // Запись скопирована в буфер: слот можно занимать снова
+        __atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    if (offsets && drops != audit_reported_drops && count < capacity) {
+        offsets[count++] = (size_t)ftello(out);
+        fprintf(out, "{\"dropped\":%lu}\n", drops - audit_reported_drops);
+        audit_reported_drops = drops;
+    }
+    fclose(out);
+
+    if (offsets && count > 0) {
+        offsets[count] = size;
+        unsigned long lost = audit_flush(buffer, offsets, count);
+        // Потерянные при записи учитываются в следующей записи dropped
+        audit_reported_drops -= lost;
+    }
+    free(offsets);
+    free(buffer);
+}
+
+/**
+ * @brief Фоновый поток журнала
+ * @param arg Не используется
+ * @return NULL
+ */
+static void *audit_loop(void *arg) {
+    (void)arg;
+    for (;;) {
+        struct pollfd pfd = { .fd = audit_event_fd, .events = POLLIN };
+        if (poll(&pfd, 1, -1) == -1 && errno != EINTR) {
+            break;
+        }
+        uint64_t pending;
+        if (read(audit_event_fd, &pending, sizeof(pending)) == -1 && errno != EAGAIN) {
+            break;
+        }
+
+        audit_drain();
+        if (__atomic_load_n(&audit_stopping, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Выключение журнала в дочернем процессе после fork
+ *
+ * @details Фоновый поток не переживает fork, а блокировка списка очередей
+ * могла остаться захваченной.
+ */
+static void audit_atfork_child(void) {
+    audit_enabled = 0;
+}
+
+/**
+ * @brief Запуск журнала, если задан CUSTOM_SHELL_AUDIT_LOG или CUSTOM_SHELL_AUDIT_SOCKET
+ * @return 0 в случае успеха или если журнал не задан, -1 в случае ошибки
+ */
+int audit_start(void) {
+    const char *log_path = getenv(AUDIT_LOG_ENV);
+    const char *socket_path = getenv(AUDIT_SOCKET_ENV);
+    if ((!log_path || !*log_path) && (!socket_path || !*socket_path)) {
+        return 0;
+    }
+
+    if (socket_path && *socket_path) {
+        audit_is_socket = 1;
+        audit_socket_path = strdup(socket_path);
+        if (!audit_socket_path || audit_connect() != 0) {
+            fprintf(stderr, "audit: %s: %s\n", socket_path, strerror(errno));
+            free(audit_socket_path);
+            audit_socket_path = NULL;
+            if (audit_sink_fd != -1) {
+                close(audit_sink_fd);
+                audit_sink_fd = -1;
+            }
+            return -1;
+        }
+    } else {
+        audit_sink_fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (audit_sink_fd == -1) {
+            fprintf(stderr, "audit: %s: %s\n", log_path, strerror(errno));
+            return -1;
+        }
+    }
+
+    audit_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (audit_event_fd == -1) {
+        perror("audit: eventfd");
+        close(audit_sink_fd);
+        audit_sink_fd = -1;
+        return -1;
+    }
+
+    static int atfork_registered = 0;
+    if (!atfork_registered) {
+        pthread_atfork(NULL, NULL, audit_atfork_child);
+        atfork_registered = 1;
+    }
+
+    // Сигналы обрабатывают основной поток и потоки сессий
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    audit_stopping = 0;
+    int error = pthread_create(&audit_thread, NULL, audit_loop, NULL);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    if (error != 0) {
+        fprintf(stderr, "audit: %s\n", strerror(error));
+        close(audit_event_fd);
+        close(audit_sink_fd);
+        audit_event_fd = -1;
+        audit_sink_fd = -1;
+        return -1;
+    }
+
+    audit_enabled = 1;
+    return 0;
+}
+
+/**
+ * @brief Запись оставшихся записей и остановка журнала
+ */
+void audit_stop(void) {
+    if (!audit_enabled) {
+        return;
+    }
+    audit_enabled = 0;
+
+    __atomic_store_n(&audit_stopping, 1, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (write(audit_event_fd, &one, sizeof(one)) != sizeof(one)) {
+        // Счётчик не пуст: поток и так проснётся
+    }
+    pthread_join(audit_thread, NULL);
+
+    close(audit_event_fd);
+    close(audit_sink_fd);
+    audit_event_fd = -1;
+    audit_sink_fd = -1;
+    free(audit_socket_path);
+    audit_socket_path = NULL;
+}
@@ -6,7 +6,16 @@
  * @date 2024
  */
 
+#define _GNU_SOURCE
+
 #include "builtins.h"
+#include "executor.h"
+#include "utils.h"
+#include "signals.h"
+#include "fsbatch.h"
+#include "profile.h"
+#include "xtrace.h"
+#include "shellio.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,12 +23,10 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <time.h>
 
-// Глобальная переменная для выхода из оболочки
-extern int g_should_exit;
-
 /**
  * @brief Встроенная команда cd (смена директории)
  * @param args Аргументы команды
@@ -31,20 +38,20 @@ int builtin_cd(char **args, int argc) {
     
     if (argc == 1) {
         // cd без аргументов - переход в домашнюю директорию
-        target_dir = getenv("HOME");
+        target_dir = get_env_var("HOME");
         if (!target_dir) {
-            fprintf(stderr, "\033[31mcd: переменная HOME не установлена\033[0m\n");
+            fprintf(shell_stderr(), "\033[31mcd: переменная HOME не установлена\033[0m\n");
             return -1;
         }
     } else if (argc == 2) {
         target_dir = args[1];
     } else {
-        fprintf(stderr, "\033[31mcd: слишком много аргументов\033[0m\n");
+        fprintf(shell_stderr(), "\033[31mcd: слишком много аргументов\033[0m\n");
         return -1;
     }
     
-    if (chdir(target_dir) != 0) {
-        fprintf(stderr, "\033[31mcd: %s\033[0m\n", strerror(errno));
+    if (shell_chdir(target_dir) != 0) {
+        fprintf(shell_stderr(), "\033[31mcd: %s\033[0m\n", strerror(errno));
         return -1;
     }
     
@@ -62,11 +69,11 @@ int builtin_pwd(char **args, int argc) {
     (void)argc; // Неиспользуемый параметр
     
     char cwd[1024];
-    if (getcwd(cwd, sizeof(cwd)) != NULL) {
-        printf("%s\n", cwd);
+    if (shell_getcwd(cwd, sizeof(cwd)) != NULL) {
+        fprintf(shell_stdout(), "%s\n", cwd);
         return 0;
     } else {
-        perror("pwd");
+        shell_perror("pwd");
         return -1;
     }
 }
@@ -79,12 +86,12 @@ int builtin_pwd(char **args, int argc) {
  */
 int builtin_echo(char **args, int argc) {
     for (int i = 1; i < argc; i++) {
-        printf("%s", args[i]);
+        fprintf(shell_stdout(), "%s", args[i]);
         if (i < argc - 1) {
-            printf(" ");
+            fprintf(shell_stdout(), " ");
         }
     }
-    printf("\n");
+    fprintf(shell_stdout(), "\n");
     return 0;
 }
 
@@ -102,7 +109,10 @@ int builtin_exit(char **args, int argc) {
     }
     
     // Установка флага для выхода из основного цикла
-    g_should_exit = 1;
+    shell_state_t *state = shell_current();
+    if (state) {
+        state->should_exit = 1;
+    }
     
     return exit_code;
 }
@@ -120,22 +130,46 @@ int builtin_help(char **args, int argc) {
     // Проверяем поддержку цветов
     extern int supports_colors(void);
     
-    printf("Custom Shell - Встроенные команды:\n");
-    printf("  cd [директория]     - смена директории\n");
-    printf("  pwd                 - показать текущую директорию\n");
-    printf("  echo [текст]        - вывести текст\n");
-    printf("  exit [код]          - выход из оболочки\n");
-    printf("  help                - показать эту справку\n");
-    printf("  clear               - очистить экран\n");
-    printf("  history             - показать историю команд\n");
-    printf("  touch <файл>        - создать файл\n");
-    printf("  rm <файл>           - удалить файл\n");
-    printf("  mkdir <директория>  - создать директорию\n");
-    printf("  rmdir <директория>  - удалить директорию\n");
-    printf("  ls [директория]     - показать содержимое директории\n");
-    printf("\n");
-    printf("Также поддерживаются внешние команды системы.\n");
-    printf("Используйте Ctrl+C для прерывания команд.\n");
+    fprintf(shell_stdout(), "Custom Shell - Встроенные команды:\n");
+    fprintf(shell_stdout(), "  cd [директория]     - смена директории\n");
+    fprintf(shell_stdout(), "  pwd                 - показать текущую директорию\n");
+    fprintf(shell_stdout(), "  echo [текст]        - вывести текст\n");
+    fprintf(shell_stdout(), "  exit [код]          - выход из оболочки\n");
+    fprintf(shell_stdout(), "  help                - показать эту справку\n");
+    fprintf(shell_stdout(), "  clear               - очистить экран\n");
+    fprintf(shell_stdout(), "  history             - показать историю команд\n");
+    fprintf(shell_stdout(), "  touch <файл>        - создать файл\n");
+    fprintf(shell_stdout(), "  rm <файл>           - удалить файл\n");
+    fprintf(shell_stdout(), "  mkdir <директория>  - создать директорию\n");
+    fprintf(shell_stdout(), "  rmdir <директория>  - удалить директорию\n");
+    fprintf(shell_stdout(), "  ls [директория]     - показать содержимое директории\n");
+    fprintf(shell_stdout(), "  env [-i] [-u имя] [имя=знач] [команда] - запуск с изменённым окружением\n");
+    fprintf(shell_stdout(), "  exec [команда]      - заменить оболочку командой или сохранить перенаправления\n");
+    fprintf(shell_stdout(), "  trap [тело] [сигнал...] - ловушки на сигналы и EXIT/ERR/DEBUG\n");
+    fprintf(shell_stdout(), "  head [-n N|-c N] [файл...] - начало файла\n");
+    fprintf(shell_stdout(), "  tail [-n N|-c N] [-f] [файл...] - конец файла, -f следит за ростом и ротацией\n");
+    fprintf(shell_stdout(), "  cut -f|-c список [-d разд] [-s] [файл...] - выбор полей или байт из строк\n");
+    fprintf(shell_stdout(), "  checksum [-a алг] [-c список] [файл...] - контрольные суммы (crc32c, xxh3, xxh128, sha256)\n");
+    fprintf(shell_stdout(), "  jobs                - список фоновых заданий\n");
+    fprintf(shell_stdout(), "  fg [%%N]             - дождаться задания на переднем плане\n");
+    fprintf(shell_stdout(), "  wait [%%N...]        - дождаться фоновых заданий\n");
+    fprintf(shell_stdout(), "  kill [-сигнал] %%N|pid - послать сигнал или прервать фоновую задачу\n");
+    fprintf(shell_stdout(), "  cache [--ttl T] [--dep файл] [--env имя] команда - кешировать результат команды\n");
+    fprintf(shell_stdout(), "  run-graph [-j N] [-k] файл [задача...] - выполнить граф задач параллельно\n");
+    fprintf(shell_stdout(), "  watch [-d мс] [-x имя]... путь... -- команда - перезапускать команду при изменениях\n");
+    fprintf(shell_stdout(), "  pmap [-j N] [-s размер] [-L] -- команда - обработать ввод параллельно N процессами\n");
+    fprintf(shell_stdout(), "  pv [-q] [-i сек] [-L скорость] [-s размер] [файл] - передать поток, показывая скорость\n");
+    fprintf(shell_stdout(), "  pipestats [-p | -s on|off] - статистика звеньев последнего конвейера\n");
+    fprintf(shell_stdout(), "  shellstats [--reset] - выделения памяти, системные вызовы и кеши самой оболочки\n");
+    fprintf(shell_stdout(), "  set [-x|+x] [-o|+o параметр] - включить или выключить параметр оболочки (xtrace, profile)\n");
+    fprintf(shell_stdout(), "  source <файл>       - выполнить файл в текущей оболочке (также '.')\n");
+    fprintf(shell_stdout(), "  hook [точка тело]   - хуки preexec/precmd (hook -r точка - удалить)\n");
+    fprintf(shell_stdout(), "  enable [-f библиотека имя | -d имя] - загрузить команду из библиотеки или выгрузить её\n");
+    fprintf(shell_stdout(), "  alias [имя[=тело]]  - определить или показать псевдонимы\n");
+    fprintf(shell_stdout(), "  unalias [-a] имя    - удалить псевдонимы\n");
+    fprintf(shell_stdout(), "\n");
+    fprintf(shell_stdout(), "Также поддерживаются внешние команды системы.\n");
+    fprintf(shell_stdout(), "Используйте Ctrl+C для прерывания команд.\n");
     
     return 0;
 }
@@ -151,8 +185,8 @@ int builtin_clear(char **args, int argc) {
     (void)argc; // Неиспользуемый параметр
     
     // ANSI escape sequence для очистки экрана
-    printf("\033[2J\033[H");
-    fflush(stdout);
+    fprintf(shell_stdout(), "\033[2J\033[H");
+    fflush(shell_stdout());
     
     return 0;
 }
@@ -167,69 +201,73 @@ int builtin_history(char **args, int argc) {
     (void)args; // Неиспользуемый параметр
     (void)argc; // Неиспользуемый параметр
     
-    // Получаем указатель на состояние оболочки (глобальная переменная)
-    extern shell_state_t *g_shell_state;
+    // Получаем указатель на состояние оболочки текущего потока
+    shell_state_t *state = shell_current();
     
-    if (!g_shell_state) {
-        printf("История команд недоступна.\n");
+    if (!state || state->embedded) {
+        fprintf(shell_stdout(), "История команд недоступна.\n");
         return -1;
     }
     
-    if (g_shell_state->history_count == 0) {
-        printf("История команд пуста.\n");
+    if (state->history_count == 0) {
+        fprintf(shell_stdout(), "История команд пуста.\n");
         return 0;
     }
     
-    printf("История команд (%d записей):\n", g_shell_state->history_count);
-    printf("%-4s %-20s %-10s %s\n", "№", "Время", "Код", "Команда");
-    printf("---- -------------------- ---------- ------------------------\n");
+    fprintf(shell_stdout(), "История команд (%d записей):\n", state->history_count);
+    fprintf(shell_stdout(), "%-4s %-20s %-10s %s\n", "№", "Время", "Код", "Команда");
+    fprintf(shell_stdout(), "---- -------------------- ---------- ------------------------\n");
     
-    for (int i = 0; i < g_shell_state->history_count; i++) {
+    for (int i = 0; i < state->history_count; i++) {
         char time_str[20];
-        struct tm *tm_info = localtime(&g_shell_state->history[i].timestamp);
-        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
+        struct tm tm_info;
+        localtime_r(&state->history[i].timestamp, &tm_info);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_info);
         
-        printf("%-4d %-20s %-10d %s\n", 
-               i + 1, 
-               time_str, 
-               g_shell_state->history[i].exit_code,
-               g_shell_state->history[i].command);
+        fprintf(shell_stdout(), "%-4d %-20s %-10d %s\n", 
+                i + 1, 
+                time_str, 
+                state->history[i].exit_code,
+                state->history[i].command);
     }
     
-    printf("\nИспользование истории:\n");
-    printf("  !5        - выполнить команду №5 из истории\n");
-    printf("  !ls       - выполнить последнюю команду, начинающуюся с 'ls'\n");
-    printf("  history   - показать эту справку\n");
+    fprintf(shell_stdout(), "\nИспользование истории:\n");
+    fprintf(shell_stdout(), "  !5        - выполнить команду №5 из истории\n");
+    fprintf(shell_stdout(), "  !ls       - выполнить последнюю команду, начинающуюся с 'ls'\n");
+    fprintf(shell_stdout(), "  history   - показать эту справку\n");
     
     return 0;
 }
 
 /**
- * @brief Встроенная команда touch (создание файла)
- * @param args Аргументы команды
+ * @brief Пакетное выполнение файловой операции над аргументами команды
+ * @param op Операция
+ * @param mode Права для создаваемых объектов
+ * @param args Аргументы команды (пути начиная с args[1])
  * @param argc Количество аргументов
- * @return 0 в случае успеха, -1 в случае ошибки
+ * @param error_format Формат сообщения об ошибке (путь, описание ошибки)
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
  */
-int builtin_touch(char **args, int argc) {
-    if (argc < 2) {
-        fprintf(stderr, "touch: требуется указать имя файла\n");
-        fprintf(stderr, "Использование: touch <файл> [файл2] ...\n");
+static int run_fsbatch(fsbatch_op_t op, mode_t mode, char **args, int argc,
+                       const char *error_format) {
+    int count = argc - 1;
+    int *errors = malloc((size_t)count * sizeof(int));
+    if (!errors) {
+        fprintf(shell_stderr(), "%s: недостаточно памяти\n", args[0]);
         return -1;
     }
     
-    int success_count = 0;
-    for (int i = 1; i < argc; i++) {
-        FILE *file = fopen(args[i], "a");
-        if (file) {
-            fclose(file);
-            success_count++;
-        } else {
-            fprintf(stderr, "touch: не удалось создать файл '%s': %s\n", 
-                    args[i], strerror(errno));
+    int success_count = fsbatch_run(op, shell_cwd_fd(), &args[1], count, mode, errors, NULL);
+    
+    // Ошибки выводятся в порядке аргументов, независимо от порядка завершения
+    for (int i = 0; i < count; i++) {
+        if (errors[i] != 0) {
+            fprintf(shell_stderr(), error_format, args[i + 1], strerror(errors[i]));
         }
     }
+    free(errors);
     
-    if (success_count == argc - 1) {
+    if (success_count == count) {
         return 0;
     } else if (success_count > 0) {
         return 1; // Частичный успех
@@ -239,35 +277,37 @@ int builtin_touch(char **args, int argc) {
 }
 
 /**
- * @brief Встроенная команда rm (удаление файла)
+ * @brief Встроенная команда touch (создание файла)
  * @param args Аргументы команды
  * @param argc Количество аргументов
  * @return 0 в случае успеха, -1 в случае ошибки
  */
-int builtin_rm(char **args, int argc) {
+int builtin_touch(char **args, int argc) {
     if (argc < 2) {
-        fprintf(stderr, "rm: требуется указать имя файла\n");
-        fprintf(stderr, "Использование: rm <файл> [файл2] ...\n");
+        fprintf(shell_stderr(), "touch: требуется указать имя файла\n");
+        fprintf(shell_stderr(), "Использование: touch <файл> [файл2] ...\n");
         return -1;
     }
     
-    int success_count = 0;
-    for (int i = 1; i < argc; i++) {
-        if (unlink(args[i]) == 0) {
-            success_count++;
-        } else {
-            fprintf(stderr, "rm: не удалось удалить файл '%s': %s\n", 
-                    args[i], strerror(errno));
-        }
+    return run_fsbatch(FSBATCH_CREATE, 0666, args, argc,
+                       "touch: не удалось создать файл '%s': %s\n");
+}
+
+/**
+ * @brief Встроенная команда rm (удаление файла)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_rm(char **args, int argc) {
+    if (argc < 2) {
+        fprintf(shell_stderr(), "rm: требуется указать имя файла\n");
+        fprintf(shell_stderr(), "Использование: rm <файл> [файл2] ...\n");
+        return -1;
     }
     
-    if (success_count == argc - 1) {
-        return 0;
-    } else if (success_count > 0) {
-        return 1; // Частичный успех
-    } else {
-        return -1; // Полная неудача
-    }
+    return run_fsbatch(FSBATCH_UNLINK, 0, args, argc,
+                       "rm: не удалось удалить файл '%s': %s\n");
 }
 
 /**
@@ -278,28 +318,13 @@ int builtin_rm(char **args, int argc) {
  */
 int builtin_mkdir(char **args, int argc) {
     if (argc < 2) {
-        fprintf(stderr, "mkdir: требуется указать имя директории\n");
-        fprintf(stderr, "Использование: mkdir <директория> [директория2] ...\n");
+        fprintf(shell_stderr(), "mkdir: требуется указать имя директории\n");
+        fprintf(shell_stderr(), "Использование: mkdir <директория> [директория2] ...\n");
         return -1;
     }
     
-    int success_count = 0;
-    for (int i = 1; i < argc; i++) {
-        if (mkdir(args[i], 0755) == 0) {
-            success_count++;
-        } else {
-            fprintf(stderr, "mkdir: не удалось создать директорию '%s': %s\n", 
-                    args[i], strerror(errno));
-        }
-    }
-    
-    if (success_count == argc - 1) {
-        return 0;
-    } else if (success_count > 0) {
-        return 1; // Частичный успех
-    } else {
-        return -1; // Полная неудача
-    }
+    return run_fsbatch(FSBATCH_MKDIR, 0755, args, argc,
+                       "mkdir: не удалось создать директорию '%s': %s\n");
 }
 
 /**
@@ -310,17 +335,17 @@ int builtin_mkdir(char **args, int argc) {
  */
 int builtin_rmdir(char **args, int argc) {
     if (argc < 2) {
-        fprintf(stderr, "rmdir: требуется указать имя директории\n");
-        fprintf(stderr, "Использование: rmdir <директория> [директория2] ...\n");
+        fprintf(shell_stderr(), "rmdir: требуется указать имя директории\n");
+        fprintf(shell_stderr(), "Использование: rmdir <директория> [директория2] ...\n");
         return -1;
     }
     
     int success_count = 0;
     for (int i = 1; i < argc; i++) {
-        if (rmdir(args[i]) == 0) {
+        if (unlinkat(shell_cwd_fd(), args[i], AT_REMOVEDIR) == 0) {
             success_count++;
         } else {
-            fprintf(stderr, "rmdir: не удалось удалить директорию '%s': %s\n", 
+            fprintf(shell_stderr(), "rmdir: не удалось удалить директорию '%s': %s\n", 
                     args[i], strerror(errno));
         }
     }
@@ -350,42 +375,71 @@ int builtin_ls(char **args, int argc) {
     // Проверяем поддержку цветов
     extern int supports_colors(void);
     
-    DIR *dir = opendir(dir_path);
+    int dir_fd = openat(shell_cwd_fd(), dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = dir_fd != -1 ? fdopendir(dir_fd) : NULL;
     if (!dir) {
-        fprintf(stderr, "ls: не удалось открыть директорию '%s': %s\n", 
+        fprintf(shell_stderr(), "ls: не удалось открыть директорию '%s': %s\n", 
                 dir_path, strerror(errno));
+        if (dir_fd != -1) {
+            close(dir_fd);
+        }
         return -1;
     }
     
-    printf("Содержимое директории '%s':\n", dir_path);
-    printf("%-20s %-10s %-8s %s\n", "Имя", "Размер", "Права", "Тип");
-    printf("-------------------- ---------- -------- ------------------------\n");
+    fprintf(shell_stdout(), "Содержимое директории '%s':\n", dir_path);
+    fprintf(shell_stdout(), "%-20s %-10s %-8s %s\n", "Имя", "Размер", "Права", "Тип");
+    fprintf(shell_stdout(), "-------------------- ---------- -------- ------------------------\n");
     
+    // Сначала собираются имена, затем атрибуты запрашиваются одним пакетом
+    char **names = NULL;
+    int name_count = 0;
+    int name_capacity = 0;
     struct dirent *entry;
+    
+    while ((entry = readdir(dir)) != NULL) {
+        if (name_count == name_capacity) {
+            int new_capacity = name_capacity ? name_capacity * 2 : 64;
+            char **grown = realloc(names, (size_t)new_capacity * sizeof(char *));
+            if (!grown) {
+                break;
+            }
+            names = grown;
+            name_capacity = new_capacity;
+        }
+        names[name_count] = strdup(entry->d_name);
+        if (names[name_count]) {
+            name_count++;
+        }
+    }
+    
+    struct statx *stx = name_count ? calloc((size_t)name_count, sizeof(struct statx)) : NULL;
+    int *errors = name_count ? malloc((size_t)name_count * sizeof(int)) : NULL;
+    if (stx && errors) {
+        fsbatch_run(FSBATCH_STATX, dirfd(dir), names, name_count, 0, errors, stx);
+    }
+    
     int file_count = 0;
     int dir_count = 0;
     
-    while ((entry = readdir(dir)) != NULL) {
-        char full_path[1024];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
-        
-        struct stat st;
-        if (stat(full_path, &st) == 0) {
+    for (int i = 0; i < name_count && stx && errors; i++) {
+        if (errors[i] == 0) {
+            mode_t mode = stx[i].stx_mode;
+            
             // Определение типа файла и цвета
             const char *type = "файл";
             const char *color = "\033[37m"; // Белый для обычных файлов
             
-            if (S_ISDIR(st.st_mode)) {
+            if (S_ISDIR(mode)) {
                 type = "директория";
                 color = "\033[34m"; // Синий для директорий
                 dir_count++;
-            } else if (S_ISLNK(st.st_mode)) {
+            } else if (S_ISLNK(mode)) {
                 type = "ссылка";
                 color = "\033[36m"; // Голубой для ссылок
-            } else if (S_ISFIFO(st.st_mode)) {
+            } else if (S_ISFIFO(mode)) {
                 type = "канал";
                 color = "\033[35m"; // Пурпурный для каналов
-            } else if (S_ISSOCK(st.st_mode)) {
+            } else if (S_ISSOCK(mode)) {
                 type = "сокет";
                 color = "\033[33m"; // Желтый для сокетов
             } else {
@@ -395,35 +449,316 @@ int builtin_ls(char **args, int argc) {
             // Форматирование прав доступа
             char perms[10];
             snprintf(perms, sizeof(perms), "%c%c%c%c%c%c%c%c%c",
-                    (st.st_mode & S_IRUSR) ? 'r' : '-',
-                    (st.st_mode & S_IWUSR) ? 'w' : '-',
-                    (st.st_mode & S_IXUSR) ? 'x' : '-',
-                    (st.st_mode & S_IRGRP) ? 'r' : '-',
-                    (st.st_mode & S_IWGRP) ? 'w' : '-',
-                    (st.st_mode & S_IXGRP) ? 'x' : '-',
-                    (st.st_mode & S_IROTH) ? 'r' : '-',
-                    (st.st_mode & S_IWOTH) ? 'w' : '-',
-                    (st.st_mode & S_IXOTH) ? 'x' : '-');
+                    (mode & S_IRUSR) ? 'r' : '-',
+                    (mode & S_IWUSR) ? 'w' : '-',
+                    (mode & S_IXUSR) ? 'x' : '-',
+                    (mode & S_IRGRP) ? 'r' : '-',
+                    (mode & S_IWGRP) ? 'w' : '-',
+                    (mode & S_IXGRP) ? 'x' : '-',
+                    (mode & S_IROTH) ? 'r' : '-',
+                    (mode & S_IWOTH) ? 'w' : '-',
+                    (mode & S_IXOTH) ? 'x' : '-');
             
             // Цветной вывод
             if (supports_colors()) {
-                printf("%s%-20s\033[0m %-10ld %-8s %s\n", 
-                       color, entry->d_name, 
-                       (long)st.st_size, 
-                       perms, 
-                       type);
+                fprintf(shell_stdout(), "%s%-20s\033[0m %-10ld %-8s %s\n", 
+                        color, names[i], 
+                        (long)stx[i].stx_size, 
+                        perms, 
+                        type);
             } else {
-                printf("%-20s %-10ld %-8s %s\n", 
-                       entry->d_name, 
-                       (long)st.st_size, 
-                       perms, 
-                       type);
+                fprintf(shell_stdout(), "%-20s %-10ld %-8s %s\n", 
+                        names[i], 
+                        (long)stx[i].stx_size, 
+                        perms, 
+                        type);
             }
         }
     }
     
+    for (int i = 0; i < name_count; i++) {
+        free(names[i]);
+    }
+    free(names);
+    free(stx);
+    free(errors);
+    
     closedir(dir);
     
-    printf("\nИтого: %d файлов, %d директорий\n", file_count, dir_count);
+    fprintf(shell_stdout(), "\nИтого: %d файлов, %d директорий\n", file_count, dir_count);
     return 0;
 }
+
+/**
+ * @brief Встроенная команда env (запуск с изменённым окружением)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода запущенной команды, -1 в случае ошибки
+ */
+int builtin_env(char **args, int argc) {
+    int clear = 0;
+    // -u не больше, чем половина аргументов; список без ограничения длины
+    char **unsets = malloc(((size_t)argc / 2 + 1) * sizeof(char *));
+    int unset_count = 0;
+    if (!unsets) {
+        fprintf(shell_stderr(), "env: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    int i = 1;
+    for (; i < argc && args[i][0] == '-'; i++) {
+        if (strcmp(args[i], "-i") == 0 || strcmp(args[i], "-") == 0) {
+            clear = 1;
+        } else if (strcmp(args[i], "-u") == 0 && i + 1 < argc) {
+            unsets[unset_count++] = args[++i];
+        } else if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        } else {
+            fprintf(shell_stderr(), "env: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: env [-i] [-u имя] [имя=значение] ... [команда [аргументы]]\n");
+            free(unsets);
+            return -1;
+        }
+    }
+    
+    int assign_start = i;
+    while (i < argc && args[i][0] != '=' && strchr(args[i], '=')) {
+        i++;
+    }
+    
+    // Окружение собирается из хранилища переменных только для этого запуска
+    char **envp = build_child_env(&args[assign_start], i - assign_start,
+                                  clear, unsets, unset_count);
+    free(unsets);
+    if (!envp) {
+        fprintf(shell_stderr(), "env: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    int exit_code = 0;
+    if (i == argc) {
+        for (char **entry = envp; *entry; entry++) {
+            fprintf(shell_stdout(), "%s\n", *entry);
+        }
+    } else {
+        // Команда запускается напрямую, без промежуточного процесса env
+        command_t sub;
+        memset(&sub, 0, sizeof(sub));
+        sub.name = args[i];
+        sub.args = &args[i];
+        sub.argc = argc - i;
+        exit_code = execute_with_env(&sub, envp);
+    }
+    
+    free(envp);
+    return exit_code;
+}
+
+/**
+ * @brief Встроенная команда exec (замена оболочки или перенаправление дескрипторов)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 если команда не указана, -1 если замена не удалась
+ */
+int builtin_exec(char **args, int argc) {
+    // Встроенный контекст не может заместить программу, в которую встроен,
+    // и не меняет её дескрипторы
+    shell_state_t *state = shell_current();
+    if (state && state->embedded) {
+        fprintf(shell_stderr(), "exec: недоступно во встроенном контексте\n");
+        return -1;
+    }
+    
+    if (argc < 2) {
+        // "exec 3>file": перенаправления команды становятся постоянными
+        executor_keep_redirections();
+        return 0;
+    }
+    
+    shell_io_flush();
+    xtrace_flush(state);
+    
+    // Перенаправления команды переносятся в дескрипторы процесса до exec
+    int saved_fds[3];
+    for (int fd = 0; fd < 3; fd++) {
+        saved_fds[fd] = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+    }
+    shell_io_apply();
+    
+    sigset_t saved_mask;
+    sigprocmask(SIG_SETMASK, NULL, &saved_mask);
+    signals_reset_child();
+    
+    // Процесс оболочки замещается программой без fork
+    execvp(args[1], &args[1]);
+    
+    int saved_errno = errno;
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+    for (int fd = 0; fd < 3; fd++) {
+        if (saved_fds[fd] != -1) {
+            dup2(saved_fds[fd], fd);
+            close(saved_fds[fd]);
+        }
+    }
+    fprintf(shell_stderr(), "exec: %s: %s\n", args[1], strerror(saved_errno));
+    return -1;
+}
+
+/**
+ * @brief Встроенная команда trap (установка ловушек на сигналы)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_trap(char **args, int argc) {
+    if (argc == 1 || (argc == 2 && strcmp(args[1], "-p") == 0)) {
+        trap_print();
+        return 0;
+    }
+    
+    if (argc == 2 && strcmp(args[1], "-l") == 0) {
+        trap_list_signals();
+        return 0;
+    }
+    
+    // Ловушки меняют обработку сигналов всего процесса
+    shell_state_t *state = shell_current();
+    if (state && state->embedded) {
+        fprintf(shell_stderr(), "trap: недоступно во встроенном контексте\n");
+        return -1;
+    }
+    
+    int first = 1;
+    if (strcmp(args[first], "--") == 0) {
+        first++;
+    }
+    if (first >= argc) {
+        fprintf(shell_stderr(), "Использование: trap [-lp] [тело|-|''] [сигнал...]\n");
+        return -1;
+    }
+    
+    // Тело - одно слово или слова в кавычках (парсер разбивает их по пробелам),
+    // обозначения сигналов идут только после него
+    char body[MAX_INPUT_SIZE];
+    const char *trap_body = body;
+    int first_spec = quoted_span(args, argc, first, 0);
+    
+    if (strcmp(args[first], "-") == 0) {
+        trap_body = NULL;
+    } else if (args[first][0] != '\'' && args[first][0] != '"' &&
+               trap_parse_spec(args[first]) != -1) {
+        // trap SIG...: все слова - сигналы, ловушки сбрасываются
+        int all_specs = 1;
+        for (int i = first + 1; i < argc && all_specs; i++) {
+            all_specs = trap_parse_spec(args[i]) != -1;
+        }
+        if (all_specs) {
+            trap_body = NULL;
+            first_spec = first;
+        }
+    }
+    if (trap_body) {
+        join_words(args, first, first_spec, 0, body, sizeof(body));
+    }
+    
+    if (first_spec >= argc) {
+        fprintf(shell_stderr(), "Использование: trap [-lp] [тело|-|''] [сигнал...]\n");
+        return -1;
+    }
+    for (int i = first_spec; i < argc; i++) {
+        if (trap_parse_spec(args[i]) == -1) {
+            fprintf(shell_stderr(), "trap: неизвестный сигнал '%s'\n", args[i]);
+            return -1;
+        }
+    }
+    
+    int result = 0;
+    for (int i = first_spec; i < argc; i++) {
+        if (trap_set(trap_parse_spec(args[i]), trap_body) != 0) {
+            result = -1;
+        }
+    }
+    
+    return result;
+}
+
+/**
+ * @brief Встроенная команда set (параметры оболочки)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ * 
+ * @details set -o показывает параметры, set -o profile включает профиль
+ * строк скриптов, set +o profile выводит отчёт и выключает его. set -x
+ * (set -o xtrace) включает трассировку команд, set +x выключает.
+ */
+int builtin_set(char **args, int argc) {
+    shell_state_t *state = shell_current();
+    if (!state) {
+        return -1;
+    }
+    
+    if (argc == 1 || (argc == 2 && strcmp(args[1], "-o") == 0)) {
+        fprintf(shell_stdout(), "profile\t%s\n", state->profile ? "on" : "off");
+        fprintf(shell_stdout(), "xtrace\t%s\n", state->xtrace ? "on" : "off");
+        return 0;
+    }
+    
+    const char *option = NULL;
+    int enable = 0;
+    if (argc == 2 && (strcmp(args[1], "-x") == 0 || strcmp(args[1], "+x") == 0)) {
+        option = "xtrace";
+        enable = args[1][0] == '-';
+    } else if (argc == 3 && (strcmp(args[1], "-o") == 0 || strcmp(args[1], "+o") == 0)) {
+        option = args[2];
+        enable = args[1][0] == '-';
+    } else {
+        fprintf(shell_stderr(), "Использование: set [-x|+x] [-o|+o параметр]\n");
+        return -1;
+    }
+    
+    if (strcmp(option, "xtrace") == 0) {
+        if (!enable) {
+            xtrace_stop(state);
+            return 0;
+        }
+        return xtrace_start(state);
+    }
+    if (strcmp(option, "profile") == 0) {
+        if (!enable) {
+            profile_stop(state);
+        } else if (profile_start(state) != 0) {
+            fprintf(shell_stderr(), "set: недостаточно памяти\n");
+            return -1;
+        }
+        return 0;
+    }
+    
+    fprintf(shell_stderr(), "set: неизвестный параметр: %s\n", option);
+    return -1;
+}
+
+/**
+ * @brief Встроенная команда source (выполнение файла в текущей оболочке)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода последней команды файла, -1 в случае ошибки
+ */
+int builtin_source(char **args, int argc) {
+    shell_state_t *state = shell_current();
+    if (!state) {
+        return -1;
+    }
+    if (argc != 2) {
+        fprintf(shell_stderr(), "Использование: %s файл\n", args[0]);
+        return -1;
+    }
+    
+    if (faccessat(shell_cwd_fd(), args[1], R_OK, 0) != 0) {
+        fprintf(shell_stderr(), "%s: %s: %s\n", args[0], args[1], strerror(errno));
+        return -1;
+    }
+    
+    return shell_source_file(state, args[1]);
+}
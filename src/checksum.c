@@ -0,0 +1,1259 @@
+/**
+ * @file checksum.c
+ * @brief Реализация контрольных сумм CRC32C, XXH3 и SHA-256 и команды checksum
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "checksum.h"
+#include "builtins.h"
+#include "threadpool.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHECKSUM_X86 1
+#endif
+
+/**
+ * @def CHECKSUM_READ_SIZE
+ * @brief Размер блока чтения для каналов и устройств
+ */
+#define CHECKSUM_READ_SIZE (1024 * 1024)
+
+/* ------------------------------------------------------------------------ */
+/* Общие функции                                                            */
+/* ------------------------------------------------------------------------ */
+
+static inline uint32_t read_le32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t read_le64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t rotr32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+/* ------------------------------------------------------------------------ */
+/* CRC32C                                                                   */
+/* ------------------------------------------------------------------------ */
+
+static uint32_t crc32c_table[256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Построение таблицы для переносимой реализации CRC32C
+ */
+static void crc32c_build_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+        }
+        crc32c_table[i] = crc;
+    }
+}
+
+/**
+ * @brief Переносимая табличная реализация CRC32C
+ */
+static uint32_t crc32c_update_portable(uint32_t crc, const uint8_t *data, size_t len) {
+    pthread_once(&crc32c_table_once, crc32c_build_table);
+    for (size_t i = 0; i < len; i++) {
+        crc = crc32c_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_X86
+/**
+ * @brief CRC32C на инструкции crc32 из SSE4.2
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_update_sse42(uint32_t crc, const uint8_t *data, size_t len) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        crc64 = _mm_crc32_u64(crc64, read_le64(data));
+        data += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len >= 4) {
+        crc = _mm_crc32_u32(crc, read_le32(data));
+        data += 4;
+        len -= 4;
+    }
+    while (len > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+        len--;
+    }
+    return crc;
+}
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* SHA-256                                                                  */
+/* ------------------------------------------------------------------------ */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * @brief Переносимая обработка блоков SHA-256
+ */
+static void sha256_blocks_portable(uint32_t h[8], const uint8_t *data, size_t blocks) {
+    while (blocks--) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)data[4 * i] << 24) | ((uint32_t)data[4 * i + 1] << 16) |
+                   ((uint32_t)data[4 * i + 2] << 8) | (uint32_t)data[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+
+        for (int i = 0; i < 64; i++) {
+            uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = hh + s1 + ch + sha256_k[i] + w[i];
+            uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+        h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+        data += 64;
+    }
+}
+
+#ifdef CHECKSUM_X86
+/**
+ * @brief Обработка блоков SHA-256 инструкциями SHA-NI
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_shani(uint32_t h[8], const uint8_t *data, size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Состояние хранится в порядке ABEF/CDGH, как требуют sha256rnds2
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks--) {
+        __m128i abef_save = state0;
+        __m128i cdgh_save = state1;
+        __m128i msg[4];
+
+        for (int i = 0; i < 4; i++) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), byte_swap);
+        }
+
+        for (int r = 0; r < 16; r++) {
+            __m128i wk = _mm_add_epi32(msg[r & 3], _mm_loadu_si128((const __m128i *)&sha256_k[4 * r]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+
+            if (r < 12) {
+                // Слова W[4r+16..4r+19] замещают уже использованные W[4r..4r+3]
+                __m128i t = _mm_sha256msg1_epu32(msg[r & 3], msg[(r + 1) & 3]);
+                t = _mm_add_epi32(t, _mm_alignr_epi8(msg[(r + 3) & 3], msg[(r + 2) & 3], 4));
+                msg[r & 3] = _mm_sha256msg2_epu32(t, msg[(r + 3) & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        data += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128((__m128i *)&h[0], state0);
+    _mm_storeu_si128((__m128i *)&h[4], state1);
+}
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* XXH3                                                                     */
+/* ------------------------------------------------------------------------ */
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH_SECRET_SIZE 192
+#define XXH_STRIPE_LEN 64
+#define XXH_STRIPES_PER_BLOCK ((XXH_SECRET_SIZE - XXH_STRIPE_LEN) / 8)
+#define XXH_MIDSIZE_MAX 240
+
+/** Секрет по умолчанию из спецификации XXH3 */
+static const uint8_t xxh3_secret[XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/**
+ * @struct xxh128_t
+ * @brief 128-битное значение XXH3
+ */
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} xxh128_t;
+
+static inline xxh128_t xxh_mult64to128(uint64_t a, uint64_t b) {
+    unsigned __int128 product = (unsigned __int128)a * b;
+    xxh128_t r = { (uint64_t)product, (uint64_t)(product >> 64) };
+    return r;
+}
+
+static inline uint64_t xxh_mul128_fold64(uint64_t a, uint64_t b) {
+    xxh128_t r = xxh_mult64to128(a, b);
+    return r.low ^ r.high;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XXH_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static inline uint64_t xxh3_mix16(const uint8_t *input, const uint8_t *secret) {
+    return xxh_mul128_fold64(read_le64(input) ^ read_le64(secret),
+                             read_le64(input + 8) ^ read_le64(secret + 8));
+}
+
+/**
+ * @brief XXH3-64 для входа до 240 байт
+ */
+static uint64_t xxh3_64_short(const uint8_t *input, size_t len) {
+    const uint8_t *secret = xxh3_secret;
+
+    if (len == 0) {
+        return xxh64_avalanche(read_le64(secret + 56) ^ read_le64(secret + 64));
+    }
+
+    if (len <= 3) {
+        uint32_t combined = ((uint32_t)input[0] << 16) | ((uint32_t)input[len >> 1] << 24) |
+                            (uint32_t)input[len - 1] | ((uint32_t)len << 8);
+        uint64_t bitflip = read_le32(secret) ^ read_le32(secret + 4);
+        return xxh64_avalanche((uint64_t)combined ^ bitflip);
+    }
+
+    if (len <= 8) {
+        uint64_t bitflip = read_le64(secret + 8) ^ read_le64(secret + 16);
+        uint64_t input64 = read_le32(input + len - 4) + ((uint64_t)read_le32(input) << 32);
+        return xxh3_rrmxmx(input64 ^ bitflip, len);
+    }
+
+    if (len <= 16) {
+        uint64_t bitflip1 = read_le64(secret + 24) ^ read_le64(secret + 32);
+        uint64_t bitflip2 = read_le64(secret + 40) ^ read_le64(secret + 48);
+        uint64_t lo = read_le64(input) ^ bitflip1;
+        uint64_t hi = read_le64(input + len - 8) ^ bitflip2;
+        uint64_t acc = len + __builtin_bswap64(lo) + hi + xxh_mul128_fold64(lo, hi);
+        return xxh3_avalanche(acc);
+    }
+
+    uint64_t acc = len * XXH_PRIME64_1;
+
+    if (len <= 128) {
+        if (len > 32) {
+            if (len > 64) {
+                if (len > 96) {
+                    acc += xxh3_mix16(input + 48, secret + 96);
+                    acc += xxh3_mix16(input + len - 64, secret + 112);
+                }
+                acc += xxh3_mix16(input + 32, secret + 64);
+                acc += xxh3_mix16(input + len - 48, secret + 80);
+            }
+            acc += xxh3_mix16(input + 16, secret + 32);
+            acc += xxh3_mix16(input + len - 32, secret + 48);
+        }
+        acc += xxh3_mix16(input, secret);
+        acc += xxh3_mix16(input + len - 16, secret + 16);
+        return xxh3_avalanche(acc);
+    }
+
+    size_t rounds = len / 16;
+    for (size_t i = 0; i < 8; i++) {
+        acc += xxh3_mix16(input + 16 * i, secret + 16 * i);
+    }
+    acc = xxh3_avalanche(acc);
+    for (size_t i = 8; i < rounds; i++) {
+        acc += xxh3_mix16(input + 16 * i, secret + 16 * (i - 8) + 3);
+    }
+    acc += xxh3_mix16(input + len - 16, secret + 136 - 17);
+    return xxh3_avalanche(acc);
+}
+
+static inline xxh128_t xxh3_mix32(xxh128_t acc, const uint8_t *in1, const uint8_t *in2,
+                                  const uint8_t *secret) {
+    acc.low += xxh3_mix16(in1, secret);
+    acc.low ^= read_le64(in2) + read_le64(in2 + 8);
+    acc.high += xxh3_mix16(in2, secret + 16);
+    acc.high ^= read_le64(in1) + read_le64(in1 + 8);
+    return acc;
+}
+
+/**
+ * @brief XXH3-128 для входа до 240 байт
+ */
+static xxh128_t xxh3_128_short(const uint8_t *input, size_t len) {
+    const uint8_t *secret = xxh3_secret;
+    xxh128_t h;
+
+    if (len == 0) {
+        h.low = xxh64_avalanche(read_le64(secret + 64) ^ read_le64(secret + 72));
+        h.high = xxh64_avalanche(read_le64(secret + 80) ^ read_le64(secret + 88));
+        return h;
+    }
+
+    if (len <= 3) {
+        uint32_t combined_l = ((uint32_t)input[0] << 16) | ((uint32_t)input[len >> 1] << 24) |
+                              (uint32_t)input[len - 1] | ((uint32_t)len << 8);
+        uint32_t combined_h = rotl32(__builtin_bswap32(combined_l), 13);
+        uint64_t bitflip_l = read_le32(secret) ^ read_le32(secret + 4);
+        uint64_t bitflip_h = read_le32(secret + 8) ^ read_le32(secret + 12);
+        h.low = xxh64_avalanche((uint64_t)combined_l ^ bitflip_l);
+        h.high = xxh64_avalanche((uint64_t)combined_h ^ bitflip_h);
+        return h;
+    }
+
+    if (len <= 8) {
+        uint64_t input64 = read_le32(input) + ((uint64_t)read_le32(input + len - 4) << 32);
+        uint64_t bitflip = read_le64(secret + 16) ^ read_le64(secret + 24);
+        xxh128_t m = xxh_mult64to128(input64 ^ bitflip, XXH_PRIME64_1 + (len << 2));
+        m.high += m.low << 1;
+        m.low ^= m.high >> 3;
+        m.low ^= m.low >> 35;
+        m.low *= XXH_PRIME_MX2;
+        m.low ^= m.low >> 28;
+        m.high = xxh3_avalanche(m.high);
+        return m;
+    }
+
+    if (len <= 16) {
+        uint64_t bitflip_l = read_le64(secret + 32) ^ read_le64(secret + 40);
+        uint64_t bitflip_h = read_le64(secret + 48) ^ read_le64(secret + 56);
+        uint64_t in_lo = read_le64(input);
+        uint64_t in_hi = read_le64(input + len - 8);
+        xxh128_t m = xxh_mult64to128(in_lo ^ in_hi ^ bitflip_l, XXH_PRIME64_1);
+        m.low += (uint64_t)(len - 1) << 54;
+        in_hi ^= bitflip_h;
+        m.high += in_hi + (uint64_t)(uint32_t)in_hi * (XXH_PRIME32_2 - 1);
+        m.low ^= __builtin_bswap64(m.high);
+        h = xxh_mult64to128(m.low, XXH_PRIME64_2);
+        h.high += m.high * XXH_PRIME64_2;
+        h.low = xxh3_avalanche(h.low);
+        h.high = xxh3_avalanche(h.high);
+        return h;
+    }
+
+    xxh128_t acc = { len * XXH_PRIME64_1, 0 };
+
+    if (len <= 128) {
+        if (len > 32) {
+            if (len > 64) {
+                if (len > 96) {
+                    acc = xxh3_mix32(acc, input + 48, input + len - 64, secret + 96);
+                }
+                acc = xxh3_mix32(acc, input + 32, input + len - 48, secret + 64);
+            }
+            acc = xxh3_mix32(acc, input + 16, input + len - 32, secret + 32);
+        }
+        acc = xxh3_mix32(acc, input, input + len - 16, secret);
+    } else {
+        size_t rounds = len / 32;
+        for (size_t i = 0; i < 4; i++) {
+            acc = xxh3_mix32(acc, input + 32 * i, input + 32 * i + 16, secret + 32 * i);
+        }
+        acc.low = xxh3_avalanche(acc.low);
+        acc.high = xxh3_avalanche(acc.high);
+        for (size_t i = 4; i < rounds; i++) {
+            acc = xxh3_mix32(acc, input + 32 * i, input + 32 * i + 16, secret + 3 + 32 * (i - 4));
+        }
+        acc = xxh3_mix32(acc, input + len - 16, input + len - 32, secret + 136 - 17 - 16);
+    }
+
+    h.low = acc.low + acc.high;
+    h.high = acc.low * XXH_PRIME64_1 + acc.high * XXH_PRIME64_4 + len * XXH_PRIME64_2;
+    h.low = xxh3_avalanche(h.low);
+    h.high = 0 - xxh3_avalanche(h.high);
+    return h;
+}
+
+/**
+ * @brief Переносимая обработка полос XXH3 (по 64 байта)
+ */
+static void xxh3_accumulate_portable(uint64_t acc[8], const uint8_t *input,
+                                     const uint8_t *secret, size_t stripes) {
+    for (size_t n = 0; n < stripes; n++) {
+        const uint8_t *in = input + n * XXH_STRIPE_LEN;
+        const uint8_t *key = secret + n * 8;
+        for (int i = 0; i < 8; i++) {
+            uint64_t data_val = read_le64(in + 8 * i);
+            uint64_t data_key = data_val ^ read_le64(key + 8 * i);
+            acc[i ^ 1] += data_val;
+            acc[i] += (uint64_t)(uint32_t)data_key * (data_key >> 32);
+        }
+    }
+}
+
+/**
+ * @brief Переносимое перемешивание аккумуляторов XXH3 в конце блока
+ */
+static void xxh3_scramble_portable(uint64_t acc[8], const uint8_t *secret) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read_le64(secret + 8 * i);
+        a *= XXH_PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+#ifdef CHECKSUM_X86
+/**
+ * @brief Обработка полос XXH3 на AVX2 (аккумуляторы в двух регистрах ymm)
+ */
+__attribute__((target("avx2")))
+static void xxh3_accumulate_avx2(uint64_t acc[8], const uint8_t *input,
+                                 const uint8_t *secret, size_t stripes) {
+    __m256i acc0 = _mm256_loadu_si256((const __m256i *)acc);
+    __m256i acc1 = _mm256_loadu_si256((const __m256i *)(acc + 4));
+
+    for (size_t n = 0; n < stripes; n++) {
+        const uint8_t *in = input + n * XXH_STRIPE_LEN;
+        const uint8_t *key = secret + n * 8;
+
+        __m256i data0 = _mm256_loadu_si256((const __m256i *)in);
+        __m256i data1 = _mm256_loadu_si256((const __m256i *)(in + 32));
+        __m256i key0 = _mm256_xor_si256(data0, _mm256_loadu_si256((const __m256i *)key));
+        __m256i key1 = _mm256_xor_si256(data1, _mm256_loadu_si256((const __m256i *)(key + 32)));
+
+        // acc[i] += lo32(key) * hi32(key); acc[i ^ 1] += data[i]
+        __m256i prod0 = _mm256_mul_epu32(key0, _mm256_srli_epi64(key0, 32));
+        __m256i prod1 = _mm256_mul_epu32(key1, _mm256_srli_epi64(key1, 32));
+        __m256i swap0 = _mm256_shuffle_epi32(data0, _MM_SHUFFLE(1, 0, 3, 2));
+        __m256i swap1 = _mm256_shuffle_epi32(data1, _MM_SHUFFLE(1, 0, 3, 2));
+
+        acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(prod0, swap0));
+        acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(prod1, swap1));
+    }
+
+    _mm256_storeu_si256((__m256i *)acc, acc0);
+    _mm256_storeu_si256((__m256i *)(acc + 4), acc1);
+}
+
+/**
+ * @brief Перемешивание аккумуляторов XXH3 на AVX2
+ */
+__attribute__((target("avx2")))
+static void xxh3_scramble_avx2(uint64_t acc[8], const uint8_t *secret) {
+    const __m256i prime = _mm256_set1_epi32((int)XXH_PRIME32_1);
+
+    for (int half = 0; half < 2; half++) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + 4 * half));
+        __m256i key = _mm256_loadu_si256((const __m256i *)(secret + 32 * half));
+        a = _mm256_xor_si256(_mm256_xor_si256(a, _mm256_srli_epi64(a, 47)), key);
+
+        // 64-битное умножение на 32-битную константу из двух mul_epu32
+        __m256i prod_lo = _mm256_mul_epu32(a, prime);
+        __m256i prod_hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        a = _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32));
+
+        _mm256_storeu_si256((__m256i *)(acc + 4 * half), a);
+    }
+}
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* Выбор реализации во время выполнения                                     */
+/* ------------------------------------------------------------------------ */
+
+typedef uint32_t (*crc32c_fn)(uint32_t, const uint8_t *, size_t);
+typedef void (*sha256_fn)(uint32_t *, const uint8_t *, size_t);
+typedef void (*xxh3_acc_fn)(uint64_t *, const uint8_t *, const uint8_t *, size_t);
+typedef void (*xxh3_scramble_fn)(uint64_t *, const uint8_t *);
+
+static crc32c_fn crc32c_impl = crc32c_update_portable;
+static sha256_fn sha256_impl = sha256_blocks_portable;
+static xxh3_acc_fn xxh3_accumulate_impl = xxh3_accumulate_portable;
+static xxh3_scramble_fn xxh3_scramble_impl = xxh3_scramble_portable;
+static char backend_info[64] = "crc32c=portable xxh3=portable sha256=portable";
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Однократный выбор реализаций по возможностям процессора
+ */
+static void checksum_select_backends(void) {
+#ifdef CHECKSUM_X86
+    __builtin_cpu_init();
+
+    int sse42 = __builtin_cpu_supports("sse4.2");
+    int avx2 = __builtin_cpu_supports("avx2");
+    int sha = 0;
+
+#ifdef __x86_64__
+    // SHA-NI: CPUID.(EAX=7,ECX=0):EBX[29]
+    unsigned int eax = 7, ebx = 0, ecx = 0, edx = 0;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    sha = (ebx >> 29) & 1;
+    sha = sha && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3");
+#endif
+
+    if (sse42) {
+        crc32c_impl = crc32c_update_sse42;
+    }
+    if (avx2) {
+        xxh3_accumulate_impl = xxh3_accumulate_avx2;
+        xxh3_scramble_impl = xxh3_scramble_avx2;
+    }
+    if (sha) {
+        sha256_impl = sha256_blocks_shani;
+    }
+
+    snprintf(backend_info, sizeof(backend_info), "crc32c=%s xxh3=%s sha256=%s",
+             sse42 ? "sse4.2" : "portable", avx2 ? "avx2" : "portable",
+             sha ? "sha-ni" : "portable");
+#endif
+}
+
+/**
+ * @brief Описание выбранных реализаций (для диагностики)
+ * @return Строка вида "crc32c=sse4.2 xxh3=avx2 sha256=sha-ni"
+ */
+const char *checksum_backend_info(void) {
+    pthread_once(&dispatch_once, checksum_select_backends);
+    return backend_info;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Потоковый интерфейс                                                      */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Разбор имени алгоритма
+ * @param name Имя (crc32c, xxh3, xxh128, sha256)
+ * @param algo Куда записать алгоритм
+ * @return 0 в случае успеха, -1 если имя неизвестно
+ */
+int checksum_parse_algo(const char *name, checksum_algo_t *algo) {
+    if (!name || !algo) {
+        return -1;
+    }
+
+    if (strcmp(name, "crc32c") == 0) {
+        *algo = CHECKSUM_CRC32C;
+    } else if (strcmp(name, "xxh3") == 0 || strcmp(name, "xxh64") == 0) {
+        *algo = CHECKSUM_XXH3_64;
+    } else if (strcmp(name, "xxh128") == 0) {
+        *algo = CHECKSUM_XXH3_128;
+    } else if (strcmp(name, "sha256") == 0) {
+        *algo = CHECKSUM_SHA256;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Начало вычисления
+ * @param ctx Состояние
+ * @param algo Алгоритм
+ */
+void checksum_init(checksum_ctx_t *ctx, checksum_algo_t algo) {
+    static const uint32_t sha256_iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    static const uint64_t xxh3_acc_init[8] = {
+        XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+        XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1
+    };
+
+    pthread_once(&dispatch_once, checksum_select_backends);
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->algo = algo;
+
+    switch (algo) {
+    case CHECKSUM_CRC32C:
+        ctx->u.crc = 0xFFFFFFFFu;
+        break;
+    case CHECKSUM_SHA256:
+        memcpy(ctx->u.sha.h, sha256_iv, sizeof(sha256_iv));
+        break;
+    case CHECKSUM_XXH3_64:
+    case CHECKSUM_XXH3_128:
+        memcpy(ctx->u.xxh.acc, xxh3_acc_init, sizeof(xxh3_acc_init));
+        break;
+    }
+}
+
+/**
+ * @brief Обработка полос XXH3 с перемешиванием на границах блоков
+ */
+static void xxh3_consume(uint64_t acc[8], size_t *stripes_in_block,
+                         const uint8_t *input, size_t stripes) {
+    while (stripes > 0) {
+        size_t n = XXH_STRIPES_PER_BLOCK - *stripes_in_block;
+        if (n > stripes) {
+            n = stripes;
+        }
+
+        xxh3_accumulate_impl(acc, input, xxh3_secret + *stripes_in_block * 8, n);
+        *stripes_in_block += n;
+        input += n * XXH_STRIPE_LEN;
+        stripes -= n;
+
+        if (*stripes_in_block == XXH_STRIPES_PER_BLOCK) {
+            xxh3_scramble_impl(acc, xxh3_secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+            *stripes_in_block = 0;
+        }
+    }
+}
+
+/**
+ * @brief Добавление данных в состояние XXH3
+ *
+ * @details Данные обрабатываются только когда за ними есть ещё хотя бы
+ * один байт: последняя полоса в XXH3 обрабатывается особым образом.
+ */
+static void xxh3_update(checksum_ctx_t *ctx, const uint8_t *data, size_t len) {
+    size_t buffer_size = sizeof(ctx->u.xxh.buffer);
+
+    if (ctx->u.xxh.buffered + len <= buffer_size) {
+        memcpy(ctx->u.xxh.buffer + ctx->u.xxh.buffered, data, len);
+        ctx->u.xxh.buffered += len;
+        return;
+    }
+
+    if (ctx->u.xxh.buffered > 0) {
+        size_t fill = buffer_size - ctx->u.xxh.buffered;
+        memcpy(ctx->u.xxh.buffer + ctx->u.xxh.buffered, data, fill);
+        data += fill;
+        len -= fill;
+
+        xxh3_consume(ctx->u.xxh.acc, &ctx->u.xxh.stripes_in_block,
+                     ctx->u.xxh.buffer, buffer_size / XXH_STRIPE_LEN);
+        memcpy(ctx->u.xxh.tail, ctx->u.xxh.buffer + buffer_size - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+        ctx->u.xxh.buffered = 0;
+    }
+
+    if (len > buffer_size) {
+        // Крупные фрагменты обрабатываются на месте, без копирования в буфер
+        size_t stripes = (len - 1) / XXH_STRIPE_LEN;
+        xxh3_consume(ctx->u.xxh.acc, &ctx->u.xxh.stripes_in_block, data, stripes);
+        memcpy(ctx->u.xxh.tail, data + (stripes - 1) * XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+        data += stripes * XXH_STRIPE_LEN;
+        len -= stripes * XXH_STRIPE_LEN;
+    }
+
+    memcpy(ctx->u.xxh.buffer, data, len);
+    ctx->u.xxh.buffered = len;
+}
+
+static inline uint64_t xxh3_merge(const uint64_t acc[8], const uint8_t *secret, uint64_t start) {
+    uint64_t result = start;
+    for (int i = 0; i < 4; i++) {
+        result += xxh_mul128_fold64(acc[2 * i] ^ read_le64(secret + 16 * i),
+                                    acc[2 * i + 1] ^ read_le64(secret + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+/**
+ * @brief Завершение XXH3
+ * @param ctx Состояние
+ * @return 128-битный результат (для XXH3-64 используется поле low)
+ */
+static xxh128_t xxh3_digest(checksum_ctx_t *ctx) {
+    uint64_t len = ctx->total_len;
+    const uint8_t *buffer = ctx->u.xxh.buffer;
+    size_t buffered = ctx->u.xxh.buffered;
+    xxh128_t result;
+
+    if (len <= XXH_MIDSIZE_MAX) {
+        if (ctx->algo == CHECKSUM_XXH3_64) {
+            result.low = xxh3_64_short(buffer, buffered);
+            result.high = 0;
+            return result;
+        }
+        return xxh3_128_short(buffer, buffered);
+    }
+
+    uint64_t acc[8];
+    size_t stripes_in_block = ctx->u.xxh.stripes_in_block;
+    memcpy(acc, ctx->u.xxh.acc, sizeof(acc));
+
+    size_t stripes = (buffered - 1) / XXH_STRIPE_LEN;
+    xxh3_consume(acc, &stripes_in_block, buffer, stripes);
+
+    // Последние 64 байта входа могут частично лежать в уже обработанных данных
+    uint8_t last_stripe[XXH_STRIPE_LEN];
+    if (buffered >= XXH_STRIPE_LEN) {
+        memcpy(last_stripe, buffer + buffered - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+    } else {
+        size_t from_tail = XXH_STRIPE_LEN - buffered;
+        memcpy(last_stripe, ctx->u.xxh.tail + buffered, from_tail);
+        memcpy(last_stripe + from_tail, buffer, buffered);
+    }
+    xxh3_accumulate_impl(acc, last_stripe, xxh3_secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - 7, 1);
+
+    result.low = xxh3_merge(acc, xxh3_secret + 11, len * XXH_PRIME64_1);
+    result.high = 0;
+    if (ctx->algo == CHECKSUM_XXH3_128) {
+        result.high = xxh3_merge(acc, xxh3_secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - 11,
+                                 ~(len * XXH_PRIME64_2));
+    }
+    return result;
+}
+
+/**
+ * @brief Добавление данных
+ * @param ctx Состояние
+ * @param data Данные
+ * @param len Длина данных
+ */
+void checksum_update(checksum_ctx_t *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+    ctx->total_len += len;
+
+    switch (ctx->algo) {
+    case CHECKSUM_CRC32C:
+        ctx->u.crc = crc32c_impl(ctx->u.crc, p, len);
+        break;
+    case CHECKSUM_XXH3_64:
+    case CHECKSUM_XXH3_128:
+        xxh3_update(ctx, p, len);
+        break;
+    case CHECKSUM_SHA256:
+        if (ctx->u.sha.block_len > 0) {
+            size_t fill = 64 - ctx->u.sha.block_len;
+            if (fill > len) {
+                fill = len;
+            }
+            memcpy(ctx->u.sha.block + ctx->u.sha.block_len, p, fill);
+            ctx->u.sha.block_len += fill;
+            p += fill;
+            len -= fill;
+            if (ctx->u.sha.block_len < 64) {
+                break;
+            }
+            sha256_impl(ctx->u.sha.h, ctx->u.sha.block, 1);
+            ctx->u.sha.block_len = 0;
+        }
+        if (len >= 64) {
+            sha256_impl(ctx->u.sha.h, p, len / 64);
+            p += len & ~(size_t)63;
+            len &= 63;
+        }
+        memcpy(ctx->u.sha.block, p, len);
+        ctx->u.sha.block_len = len;
+        break;
+    }
+}
+
+/**
+ * @brief Завершение вычисления
+ * @param ctx Состояние
+ * @param hex Буфер размером не менее CHECKSUM_HEX_MAX для шестнадцатеричной записи
+ */
+void checksum_final(checksum_ctx_t *ctx, char *hex) {
+    switch (ctx->algo) {
+    case CHECKSUM_CRC32C:
+        snprintf(hex, CHECKSUM_HEX_MAX, "%08x", ctx->u.crc ^ 0xFFFFFFFFu);
+        break;
+    case CHECKSUM_XXH3_64: {
+        xxh128_t h = xxh3_digest(ctx);
+        snprintf(hex, CHECKSUM_HEX_MAX, "%016llx", (unsigned long long)h.low);
+        break;
+    }
+    case CHECKSUM_XXH3_128: {
+        xxh128_t h = xxh3_digest(ctx);
+        snprintf(hex, CHECKSUM_HEX_MAX, "%016llx%016llx",
+                 (unsigned long long)h.high, (unsigned long long)h.low);
+        break;
+    }
+    case CHECKSUM_SHA256: {
+        uint64_t bit_len = ctx->total_len * 8;
+        uint8_t *block = ctx->u.sha.block;
+        size_t n = ctx->u.sha.block_len;
+
+        block[n++] = 0x80;
+        if (n > 56) {
+            memset(block + n, 0, 64 - n);
+            sha256_impl(ctx->u.sha.h, block, 1);
+            n = 0;
+        }
+        memset(block + n, 0, 56 - n);
+        for (int i = 0; i < 8; i++) {
+            block[56 + i] = (uint8_t)(bit_len >> (56 - 8 * i));
+        }
+        sha256_impl(ctx->u.sha.h, block, 1);
+
+        for (int i = 0; i < 8; i++) {
+            snprintf(hex + 8 * i, CHECKSUM_HEX_MAX - 8 * i, "%08x", ctx->u.sha.h[i]);
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Вычисление суммы файла
+ * @param path Путь к файлу ("-" - стандартный ввод)
+ * @param algo Алгоритм
+ * @param hex Буфер размером не менее CHECKSUM_HEX_MAX
+ * @return 0 в случае успеха, иначе значение errno
+ */
+int checksum_file(const char *path, checksum_algo_t algo, char *hex) {
+    return checksum_file_at(AT_FDCWD, path, algo, hex);
+}
+
+/**
+ * @brief Вычисление суммы открытого файла
+ * @param fd Дескриптор (не закрывается)
+ * @param algo Алгоритм
+ * @param hex Буфер размером не менее CHECKSUM_HEX_MAX
+ * @return 0 в случае успеха, иначе значение errno
+ */
+static int checksum_fd(int fd, checksum_algo_t algo, char *hex) {
+    checksum_ctx_t ctx;
+    checksum_init(&ctx, algo);
+
+    struct stat st;
+    int result = 0;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        // Обычный файл отображается целиком: ни копирования, ни лишних вызовов read
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+            // Частями, чтобы Ctrl+C прерывал хеширование большого файла
+            for (size_t offset = 0; offset < (size_t)st.st_size; offset += CHECKSUM_READ_SIZE * 8) {
+                if (threadpool_cancelled()) {
+                    result = ECANCELED;
+                    break;
+                }
+                size_t len = (size_t)st.st_size - offset;
+                checksum_update(&ctx, (const uint8_t *)data + offset,
+                                len < CHECKSUM_READ_SIZE * 8 ? len : CHECKSUM_READ_SIZE * 8);
+            }
+            munmap(data, (size_t)st.st_size);
+            goto done;
+        }
+    }
+
+    uint8_t *buffer = malloc(CHECKSUM_READ_SIZE);
+    if (!buffer) {
+        result = ENOMEM;
+        goto done;
+    }
+
+    for (;;) {
+        if (threadpool_cancelled()) {
+            result = ECANCELED;
+            break;
+        }
+        ssize_t n = read(fd, buffer, CHECKSUM_READ_SIZE);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = errno;
+            break;
+        }
+        checksum_update(&ctx, buffer, (size_t)n);
+    }
+    free(buffer);
+
+done:
+    if (result == 0) {
+        checksum_final(&ctx, hex);
+    }
+    return result;
+}
+
+/**
+ * @brief Вычисление суммы файла относительно каталога
+ * @param dir_fd Каталог для относительного пути или AT_FDCWD
+ * @param path Путь к файлу ("-" - стандартный ввод)
+ * @param algo Алгоритм
+ * @param hex Буфер размером не менее CHECKSUM_HEX_MAX
+ * @return 0 в случае успеха, иначе значение errno
+ */
+int checksum_file_at(int dir_fd, const char *path, checksum_algo_t algo, char *hex) {
+    if (strcmp(path, "-") == 0) {
+        return checksum_fd(shell_fd(STDIN_FILENO), algo, hex);
+    }
+
+    int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return errno;
+    }
+    int result = checksum_fd(fd, algo, hex);
+    close(fd);
+    return result;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Встроенная команда checksum                                              */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @struct checksum_job_t
+ * @brief Задание на хеширование одного файла
+ */
+typedef struct {
+    const char *path;               /**< Путь к файлу */
+    char hex[CHECKSUM_HEX_MAX];     /**< Результат */
+    int error;                      /**< errno или 0 */
+} checksum_job_t;
+
+/**
+ * @struct checksum_batch_t
+ * @brief Общая очередь заданий для рабочих потоков
+ */
+typedef struct {
+    checksum_job_t *jobs;           /**< Задания */
+    int count;                      /**< Количество заданий */
+    atomic_int next;                /**< Индекс следующего свободного задания */
+    checksum_algo_t algo;           /**< Алгоритм */
+    int dir_fd;                     /**< Каталог для относительных путей */
+    int in_fd;                      /**< Стандартный ввод команды (путь "-") */
+} checksum_batch_t;
+
+/**
+ * @brief Задание пула: забирает файлы из общей очереди пакета
+ * @param arg Пакет заданий
+ */
+static void checksum_worker(void *arg) {
+    checksum_batch_t *batch = arg;
+
+    for (;;) {
+        int i = atomic_fetch_add(&batch->next, 1);
+        if (i >= batch->count) {
+            break;
+        }
+        if (threadpool_cancelled()) {
+            batch->jobs[i].error = ECANCELED;
+            continue;
+        }
+        // Рабочий поток не видит ввод команды, поэтому он передаётся в пакете
+        if (strcmp(batch->jobs[i].path, "-") == 0) {
+            batch->jobs[i].error = checksum_fd(batch->in_fd, batch->algo, batch->jobs[i].hex);
+        } else {
+            batch->jobs[i].error = checksum_file_at(batch->dir_fd, batch->jobs[i].path,
+                                                    batch->algo, batch->jobs[i].hex);
+        }
+    }
+}
+
+/**
+ * @brief Хеширование набора файлов в общем пуле потоков
+ * @param batch Задания
+ * @param threads Количество параллельных обработчиков (0 - по размеру пула)
+ */
+static void checksum_run_batch(checksum_batch_t *batch, int threads) {
+    if (threads <= 0) {
+        threads = threadpool_size();
+    }
+    if (threads > batch->count) {
+        threads = batch->count;
+    }
+
+    threadpool_group_t *group = threadpool_group_create();
+    int submitted = 0;
+    for (int i = 0; group && i < threads; i++) {
+        submitted += threadpool_submit(group, checksum_worker, batch) == 0;
+    }
+
+    if (submitted == 0) {
+        // Пул недоступен: всё выполняется в текущем потоке
+        checksum_worker(batch);
+    } else {
+        threadpool_group_wait(group);
+    }
+    threadpool_group_destroy(group);
+}
+
+/**
+ * @brief Проверка сумм по списку в формате "сумма  файл" (checksum -c)
+ * @param list_path Путь к списку
+ * @param algo Алгоритм
+ * @param threads Количество потоков
+ * @return 0 если все суммы совпали, 1 если нет, -1 в случае ошибки
+ */
+static int checksum_verify(const char *list_path, checksum_algo_t algo, int threads) {
+    FILE *list = stdin;
+    if (strcmp(list_path, "-") == 0 && shell_fd(STDIN_FILENO) != STDIN_FILENO) {
+        // Ввод команды отличается от ввода процесса (конвейер или контекст)
+        int list_fd = fcntl(shell_fd(STDIN_FILENO), F_DUPFD_CLOEXEC, 3);
+        list = list_fd != -1 ? fdopen(list_fd, "r") : NULL;
+        if (!list && list_fd != -1) {
+            close(list_fd);
+        }
+    } else if (strcmp(list_path, "-") != 0) {
+        int list_fd = openat(shell_cwd_fd(), list_path, O_RDONLY | O_CLOEXEC);
+        list = list_fd != -1 ? fdopen(list_fd, "r") : NULL;
+        if (!list && list_fd != -1) {
+            close(list_fd);
+        }
+    }
+    if (!list) {
+        fprintf(shell_stderr(), "checksum: не удалось открыть '%s': %s\n", list_path, strerror(errno));
+        return -1;
+    }
+
+    int capacity = 16;
+    int count = 0;
+    checksum_job_t *jobs = malloc(capacity * sizeof(checksum_job_t));
+    char (*expected)[CHECKSUM_HEX_MAX] = malloc(capacity * CHECKSUM_HEX_MAX);
+    char line[MAX_PATH + CHECKSUM_HEX_MAX + 8];
+
+    while (jobs && expected && fgets(line, sizeof(line), list)) {
+        line[strcspn(line, "\n")] = '\0';
+
+        char *sep = strstr(line, "  ");
+        if (!sep || sep - line >= CHECKSUM_HEX_MAX) {
+            continue;
+        }
+        size_t hex_len = (size_t)(sep - line);
+
+        if (count == capacity) {
+            capacity *= 2;
+            checksum_job_t *new_jobs = realloc(jobs, capacity * sizeof(checksum_job_t));
+            char (*new_expected)[CHECKSUM_HEX_MAX] = realloc(expected, capacity * CHECKSUM_HEX_MAX);
+            if (new_jobs) {
+                jobs = new_jobs;
+            }
+            if (new_expected) {
+                expected = new_expected;
+            }
+            if (!new_jobs || !new_expected) {
+                break;
+            }
+        }
+
+        memset(&jobs[count], 0, sizeof(jobs[count]));
+        jobs[count].path = strdup(sep + 2);
+        // Длина суммы проверена выше, копия помещается в буфер целиком
+        memcpy(expected[count], line, hex_len);
+        expected[count][hex_len] = '\0';
+        if (jobs[count].path) {
+            count++;
+        }
+    }
+
+    if (list != stdin) {
+        fclose(list);
+    }
+
+    int result = 0;
+    if (jobs && expected) {
+        checksum_batch_t batch = { .jobs = jobs, .count = count, .algo = algo,
+                                   .dir_fd = shell_cwd_fd(), .in_fd = shell_fd(STDIN_FILENO) };
+        atomic_init(&batch.next, 0);
+        checksum_run_batch(&batch, threads);
+
+        for (int i = 0; i < count; i++) {
+            if (jobs[i].error) {
+                fprintf(shell_stdout(), "%s: ОШИБКА ЧТЕНИЯ (%s)\n", jobs[i].path, strerror(jobs[i].error));
+                result = 1;
+            } else if (strcasecmp(jobs[i].hex, expected[i]) != 0) {
+                fprintf(shell_stdout(), "%s: НЕ СОВПАДАЕТ\n", jobs[i].path);
+                result = 1;
+            } else {
+                fprintf(shell_stdout(), "%s: OK\n", jobs[i].path);
+            }
+        }
+    } else {
+        fprintf(shell_stderr(), "checksum: %s\n", strerror(ENOMEM));
+        result = -1;
+    }
+
+    if (jobs) {
+        for (int i = 0; i < count; i++) {
+            free((char *)jobs[i].path);
+        }
+    }
+    free(jobs);
+    free(expected);
+    return result;
+}
+
+/**
+ * @brief Встроенная команда checksum (контрольные суммы файлов)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_checksum(char **args, int argc) {
+    checksum_algo_t algo = CHECKSUM_SHA256;
+    const char *verify_list = NULL;
+    int threads = 0;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        if (strcmp(args[i], "-a") == 0 && i + 1 < argc) {
+            if (checksum_parse_algo(args[++i], &algo) != 0) {
+                fprintf(shell_stderr(), "checksum: неизвестный алгоритм '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(args[++i]);
+        } else if (strcmp(args[i], "-c") == 0 && i + 1 < argc) {
+            verify_list = args[++i];
+        } else if (strcmp(args[i], "--info") == 0) {
+            fprintf(shell_stdout(), "%s\n", checksum_backend_info());
+            return 0;
+        } else if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        } else {
+            fprintf(shell_stderr(), "checksum: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: checksum [-a crc32c|xxh3|xxh128|sha256] [-j потоки] [-c список] [файл...]\n");
+            return -1;
+        }
+    }
+
+    if (verify_list) {
+        return checksum_verify(verify_list, algo, threads);
+    }
+
+    char *stdin_name = "-";
+    char **paths = (i < argc) ? &args[i] : &stdin_name;
+    int count = (i < argc) ? argc - i : 1;
+
+    checksum_job_t *jobs = calloc(count, sizeof(checksum_job_t));
+    if (!jobs) {
+        fprintf(shell_stderr(), "checksum: %s\n", strerror(ENOMEM));
+        return -1;
+    }
+    for (int j = 0; j < count; j++) {
+        jobs[j].path = paths[j];
+    }
+
+    // Файлы хешируются параллельно, результаты выводятся в порядке аргументов
+    checksum_batch_t batch = { .jobs = jobs, .count = count, .algo = algo,
+                               .dir_fd = shell_cwd_fd(), .in_fd = shell_fd(STDIN_FILENO) };
+    atomic_init(&batch.next, 0);
+    checksum_run_batch(&batch, threads);
+
+    int success_count = 0;
+    for (int j = 0; j < count; j++) {
+        if (jobs[j].error) {
+            fprintf(shell_stderr(), "checksum: %s: %s\n", jobs[j].path, strerror(jobs[j].error));
+        } else {
+            fprintf(shell_stdout(), "%s  %s\n", jobs[j].hex, jobs[j].path);
+            success_count++;
+        }
+    }
+    free(jobs);
+
+    if (success_count == count) {
+        return 0;
+    } else if (success_count > 0) {
+        return 1; // Частичный успех
+    } else {
+        return -1; // Полная неудача
+    }
+}
@@ -0,0 +1,857 @@
+/**
+ * @file cmdcache.c
+ * @brief Реализация кеша результатов команд (встроенная команда cache)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Устройство хранилища:
+ * - entries/КЛЮЧ - текстовая запись: время создания, код выхода, адреса
+ *   и размеры вывода и потока ошибок; время изменения файла - время
+ *   последнего использования для вытеснения;
+ * - objects/XX/АДРЕС - содержимое вывода, АДРЕС - SHA-256 содержимого;
+ * - tmp/ - файлы, в которые пишет выполняемая команда.
+ * Файлы появляются в хранилище переименованием, поэтому параллельные
+ * оболочки не видят недописанных данных. Запись, объект которой уже
+ * вытеснен, считается промахом.
+ */
+
+#define _GNU_SOURCE
+
+#include "cmdcache.h"
+#include "builtins.h"
+#include "executor.h"
+#include "checksum.h"
+#include "shell.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+/**
+ * @def CMDCACHE_SWEEP_GRACE
+ * @brief Возраст объекта (секунды), после которого он может быть удалён без записи
+ *
+ * @details Другая оболочка могла уже сохранить объект, но ещё не записать
+ * ссылающуюся на него запись.
+ */
+#define CMDCACHE_SWEEP_GRACE 60
+
+/**
+ * @struct cmdcache_entry_t
+ * @brief Запись кеша
+ */
+typedef struct {
+    char key[CHECKSUM_HEX_MAX];         /**< Имя файла записи */
+    long long created;                  /**< Время создания (секунды эпохи) */
+    int exit_code;                      /**< Код выхода команды */
+    char out_hash[CHECKSUM_HEX_MAX];    /**< Адрес стандартного вывода */
+    unsigned long long out_size;        /**< Размер стандартного вывода */
+    char err_hash[CHECKSUM_HEX_MAX];    /**< Адрес потока ошибок */
+    unsigned long long err_size;        /**< Размер потока ошибок */
+    struct timespec used;               /**< Время последнего использования */
+} cmdcache_entry_t;
+
+/**
+ * @struct cmdcache_scan_t
+ * @brief Содержимое каталога записей
+ */
+typedef struct {
+    cmdcache_entry_t *entries;  /**< Записи */
+    int count;                  /**< Количество записей */
+    unsigned long long size;    /**< Суммарный объём вывода записей */
+} cmdcache_scan_t;
+
+// Статистика процесса; общее хранилище её не хранит
+static atomic_ullong stat_hits;
+static atomic_ullong stat_misses;
+static atomic_ullong stat_stores;
+static atomic_ullong stat_evictions;
+static atomic_uint tmp_counter;
+
+/**
+ * @brief Создание каталога вместе с родительскими
+ * @param path Путь
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int cmdcache_mkdirs(const char *path) {
+    char buffer[PATH_MAX];
+    if (snprintf(buffer, sizeof(buffer), "%s", path) >= (int)sizeof(buffer)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    for (char *p = buffer + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdirat(shell_cwd_fd(), buffer, 0700) != 0 && errno != EEXIST) {
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+
+    if (mkdirat(shell_cwd_fd(), buffer, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Открытие хранилища
+ * @param path Буфер для пути к хранилищу (PATH_MAX байт)
+ * @return Дескриптор каталога хранилища или -1 в случае ошибки
+ *
+ * @details Каталог: CUSTOM_SHELL_CACHE_DIR, иначе
+ * $XDG_CACHE_HOME/custom_shell/cmdcache, иначе ~/.cache/custom_shell/cmdcache.
+ */
+static int cmdcache_open_store(char *path) {
+    const char *dir = get_env_var("CUSTOM_SHELL_CACHE_DIR");
+    const char *xdg = get_env_var("XDG_CACHE_HOME");
+    const char *home = get_env_var("HOME");
+    int len;
+
+    if (dir && *dir) {
+        len = snprintf(path, PATH_MAX, "%s", dir);
+    } else if (xdg && *xdg) {
+        len = snprintf(path, PATH_MAX, "%s/custom_shell/cmdcache", xdg);
+    } else if (home && *home) {
+        len = snprintf(path, PATH_MAX, "%s/.cache/custom_shell/cmdcache", home);
+    } else {
+        errno = ENOENT;
+        return -1;
+    }
+    if (len >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    if (cmdcache_mkdirs(path) != 0) {
+        return -1;
+    }
+
+    int fd = openat(shell_cwd_fd(), path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    static const char *const subdirs[] = { "entries", "objects", "tmp" };
+    for (size_t i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); i++) {
+        if (mkdirat(fd, subdirs[i], 0700) != 0 && errno != EEXIST) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Предел объёма хранилища
+ * @return CUSTOM_SHELL_CACHE_SIZE (байт, допустимы суффиксы K, M, G) или значение по умолчанию
+ */
+static unsigned long long cmdcache_limit(void) {
+    const char *value = get_env_var("CUSTOM_SHELL_CACHE_SIZE");
+    if (!value || !*value) {
+        return CMDCACHE_DEFAULT_LIMIT;
+    }
+
+    char *end = NULL;
+    unsigned long long limit = strtoull(value, &end, 10);
+    switch (*end) {
+        case 'K': case 'k': limit <<= 10; end++; break;
+        case 'M': case 'm': limit <<= 20; end++; break;
+        case 'G': case 'g': limit <<= 30; end++; break;
+        default: break;
+    }
+
+    return (end == value || *end != '\0') ? CMDCACHE_DEFAULT_LIMIT : limit;
+}
+
+/**
+ * @brief Разбор срока действия записи
+ * @param text Число секунд с необязательным суффиксом s, m, h или d
+ * @param ttl Указатель для результата (секунды)
+ * @return 0 в случае успеха, -1 если формат неверный
+ */
+static int cmdcache_parse_ttl(const char *text, long long *ttl) {
+    char *end = NULL;
+    errno = 0;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || errno != 0 || value < 0) {
+        return -1;
+    }
+
+    switch (*end) {
+        case '\0': case 's': break;
+        case 'm': value *= 60; break;
+        case 'h': value *= 3600; break;
+        case 'd': value *= 86400; break;
+        default: return -1;
+    }
+    if (*end != '\0' && end[1] != '\0') {
+        return -1;
+    }
+
+    *ttl = value;
+    return 0;
+}
+
+/**
+ * @brief Добавление строки с завершающим нулём в вычисление ключа
+ * @param ctx Состояние SHA-256
+ * @param text Строка
+ */
+static void cmdcache_key_add(checksum_ctx_t *ctx, const char *text) {
+    checksum_update(ctx, text, strlen(text) + 1);
+}
+
+/**
+ * @brief Вычисление ключа записи
+ * @param args Команда и её аргументы
+ * @param argc Количество аргументов
+ * @param deps Файлы, от которых зависит вывод
+ * @param dep_count Количество файлов
+ * @param envs Имена переменных, входящих в ключ
+ * @param env_count Количество переменных
+ * @param key Буфер размером CHECKSUM_HEX_MAX
+ */
+static void cmdcache_key(char **args, int argc, char **deps, int dep_count,
+                         char **envs, int env_count, char *key) {
+    checksum_ctx_t ctx;
+    checksum_init(&ctx, CHECKSUM_SHA256);
+    cmdcache_key_add(&ctx, CMDCACHE_FORMAT);
+
+    char number[32];
+    snprintf(number, sizeof(number), "%d", argc);
+    cmdcache_key_add(&ctx, "argv");
+    cmdcache_key_add(&ctx, number);
+    for (int i = 0; i < argc; i++) {
+        cmdcache_key_add(&ctx, args[i]);
+    }
+
+    char cwd[PATH_MAX];
+    cmdcache_key_add(&ctx, "cwd");
+    cmdcache_key_add(&ctx, shell_getcwd(cwd, sizeof(cwd)) ? cwd : "");
+
+    // PATH определяет, какая программа будет запущена, поэтому входит в ключ всегда
+    const char *path_env = get_env_var("PATH");
+    cmdcache_key_add(&ctx, "env");
+    cmdcache_key_add(&ctx, "PATH");
+    cmdcache_key_add(&ctx, path_env ? path_env : "\001");
+    for (int i = 0; i < env_count; i++) {
+        const char *value = get_env_var(envs[i]);
+        cmdcache_key_add(&ctx, "env");
+        cmdcache_key_add(&ctx, envs[i]);
+        cmdcache_key_add(&ctx, value ? value : "\001");
+    }
+
+    for (int i = 0; i < dep_count; i++) {
+        char hex[CHECKSUM_HEX_MAX];
+        cmdcache_key_add(&ctx, "dep");
+        cmdcache_key_add(&ctx, deps[i]);
+        cmdcache_key_add(&ctx, checksum_file_at(shell_cwd_fd(), deps[i], CHECKSUM_SHA256, hex) == 0
+                                   ? hex : "\001");
+    }
+
+    checksum_final(&ctx, key);
+}
+
+/**
+ * @brief Путь объекта относительно хранилища
+ * @param hash Адрес объекта
+ * @param path Буфер размером не менее 96 байт
+ */
+static void cmdcache_object_path(const char *hash, char *path) {
+    sprintf(path, "objects/%.2s/%s", hash, hash);
+}
+
+/**
+ * @brief Чтение записи
+ * @param store_fd Каталог хранилища
+ * @param key Ключ записи
+ * @param entry Указатель для записи
+ * @return 0 в случае успеха, -1 если записи нет или она повреждена
+ */
+static int cmdcache_read_entry(int store_fd, const char *key, cmdcache_entry_t *entry) {
+    char path[96];
+    snprintf(path, sizeof(path), "entries/%s", key);
+
+    int fd = openat(store_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    char text[512];
+    ssize_t n = read(fd, text, sizeof(text) - 1);
+    struct stat st;
+    int have_stat = fstat(fd, &st) == 0;
+    close(fd);
+    if (n <= 0 || !have_stat) {
+        return -1;
+    }
+    text[n] = '\0';
+
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    entry->used = st.st_mtim;
+
+    int fields = sscanf(text, CMDCACHE_FORMAT "\ncreated %lld\nexit %d\nstdout %64s %llu\nstderr %64s %llu\n",
+                        &entry->created, &entry->exit_code, entry->out_hash, &entry->out_size,
+                        entry->err_hash, &entry->err_size);
+    return fields == 6 ? 0 : -1;
+}
+
+/**
+ * @brief Копирование содержимого файла в дескриптор
+ * @param out_fd Куда копировать
+ * @param in_fd Откуда копировать
+ * @param size Размер данных
+ * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Данные передаются ядром через sendfile без копирования в
+ * оболочку; если sendfile не поддерживается приёмником, используется
+ * обычное чтение и запись.
+ */
+static int cmdcache_replay(int out_fd, int in_fd, unsigned long long size) {
+    off_t offset = 0;
+
+    while ((unsigned long long)offset < size) {
+        ssize_t n = sendfile(out_fd, in_fd, &offset, size - (unsigned long long)offset);
+        if (n > 0) {
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            break;
+        }
+        return -1;
+    }
+
+    char buffer[65536];
+    while ((unsigned long long)offset < size) {
+        ssize_t n = pread(in_fd, buffer, sizeof(buffer), offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        for (ssize_t done = 0; done < n;) {
+            ssize_t written = write(out_fd, buffer + done, (size_t)(n - done));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return -1;
+            }
+            done += written;
+        }
+        offset += n;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Открытие объекта с проверкой размера
+ * @param store_fd Каталог хранилища
+ * @param hash Адрес объекта
+ * @param size Ожидаемый размер
+ * @return Дескриптор или -1
+ */
+static int cmdcache_open_object(int store_fd, const char *hash, unsigned long long size) {
+    char path[96];
+    cmdcache_object_path(hash, path);
+
+    int fd = openat(store_fd, path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd != -1 && (fstat(fd, &st) != 0 || (unsigned long long)st.st_size != size)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Воспроизведение сохранённого результата
+ * @param store_fd Каталог хранилища
+ * @param entry Запись
+ * @return 0 в случае успеха, -1 если объекты недоступны
+ */
+static int cmdcache_replay_entry(int store_fd, const cmdcache_entry_t *entry) {
+    int out = cmdcache_open_object(store_fd, entry->out_hash, entry->out_size);
+    int err = cmdcache_open_object(store_fd, entry->err_hash, entry->err_size);
+    if (out == -1 || err == -1) {
+        if (out != -1) {
+            close(out);
+        }
+        if (err != -1) {
+            close(err);
+        }
+        return -1;
+    }
+
+    fflush(shell_stdout());
+    fflush(shell_stderr());
+    cmdcache_replay(shell_fd(STDOUT_FILENO), out, entry->out_size);
+    cmdcache_replay(shell_fd(STDERR_FILENO), err, entry->err_size);
+    close(out);
+    close(err);
+    return 0;
+}
+
+/**
+ * @brief Создание временного файла для вывода команды
+ * @param store_fd Каталог хранилища
+ * @param path Буфер для пути относительно хранилища (64 байта)
+ * @return Дескриптор (чтение и запись) или -1
+ */
+static int cmdcache_create_tmp(int store_fd, char *path) {
+    for (int attempt = 0; attempt < 16; attempt++) {
+        snprintf(path, 64, "tmp/%d.%u.%ld", (int)getpid(),
+                 atomic_fetch_add(&tmp_counter, 1), (long)time(NULL));
+        int fd = openat(store_fd, path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd != -1 || errno != EEXIST) {
+            return fd;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Перенос временного файла в хранилище объектов
+ * @param store_fd Каталог хранилища
+ * @param tmp_path Путь временного файла относительно хранилища
+ * @param fd Дескриптор временного файла
+ * @param hash Буфер для адреса (CHECKSUM_HEX_MAX байт)
+ * @param size Указатель для размера
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int cmdcache_store_object(int store_fd, const char *tmp_path, int fd,
+                                 char *hash, unsigned long long *size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || checksum_file_at(store_fd, tmp_path, CHECKSUM_SHA256, hash) != 0) {
+        return -1;
+    }
+    *size = (unsigned long long)st.st_size;
+
+    char dir[16];
+    snprintf(dir, sizeof(dir), "objects/%.2s", hash);
+    if (mkdirat(store_fd, dir, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    // Одинаковое содержимое даёт тот же адрес: существующий объект просто заменяется
+    char path[96];
+    cmdcache_object_path(hash, path);
+    return renameat(store_fd, tmp_path, store_fd, path);
+}
+
+/**
+ * @brief Сохранение записи
+ * @param store_fd Каталог хранилища
+ * @param entry Запись
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int cmdcache_write_entry(int store_fd, const cmdcache_entry_t *entry) {
+    char tmp_path[64];
+    int fd = cmdcache_create_tmp(store_fd, tmp_path);
+    if (fd == -1) {
+        return -1;
+    }
+
+    char text[512];
+    int len = snprintf(text, sizeof(text),
+                       CMDCACHE_FORMAT "\ncreated %lld\nexit %d\nstdout %s %llu\nstderr %s %llu\n",
+                       entry->created, entry->exit_code, entry->out_hash, entry->out_size,
+                       entry->err_hash, entry->err_size);
+    int failed = write(fd, text, (size_t)len) != len;
+    close(fd);
+
+    char path[96];
+    snprintf(path, sizeof(path), "entries/%s", entry->key);
+    if (failed || renameat(store_fd, tmp_path, store_fd, path) != 0) {
+        unlinkat(store_fd, tmp_path, 0);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Чтение всех записей хранилища
+ * @param store_fd Каталог хранилища
+ * @param scan Результат (entries освобождается free())
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int cmdcache_scan(int store_fd, cmdcache_scan_t *scan) {
+    memset(scan, 0, sizeof(*scan));
+
+    int fd = openat(store_fd, "entries", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = fd != -1 ? fdopendir(fd) : NULL;
+    if (!dir) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    int capacity = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.' || strlen(de->d_name) >= CHECKSUM_HEX_MAX) {
+            continue;
+        }
+
+        if (scan->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            cmdcache_entry_t *grown = realloc(scan->entries, (size_t)capacity * sizeof(cmdcache_entry_t));
+            if (!grown) {
+                break;
+            }
+            scan->entries = grown;
+        }
+
+        cmdcache_entry_t *entry = &scan->entries[scan->count];
+        if (cmdcache_read_entry(store_fd, de->d_name, entry) == 0) {
+            scan->size += entry->out_size + entry->err_size;
+            scan->count++;
+        }
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+/**
+ * @brief Сравнение записей по времени использования (для qsort)
+ * @param a Первая запись
+ * @param b Вторая запись
+ * @return Отрицательное число, если a использовалась раньше
+ */
+static int cmdcache_compare_used(const void *a, const void *b) {
+    const cmdcache_entry_t *x = a;
+    const cmdcache_entry_t *y = b;
+
+    if (x->used.tv_sec != y->used.tv_sec) {
+        return x->used.tv_sec < y->used.tv_sec ? -1 : 1;
+    }
+    return (x->used.tv_nsec > y->used.tv_nsec) - (x->used.tv_nsec < y->used.tv_nsec);
+}
+
+/**
+ * @brief Сравнение адресов объектов (для qsort и bsearch)
+ * @param a Первый адрес
+ * @param b Второй адрес
+ * @return Результат strcmp
+ */
+static int cmdcache_compare_hash(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/**
+ * @brief Удаление объектов, на которые не ссылается ни одна запись
+ * @param store_fd Каталог хранилища
+ * @param scan Оставшиеся записи
+ * @param all Удалить все объекты, независимо от возраста
+ */
+static void cmdcache_sweep(int store_fd, const cmdcache_scan_t *scan, int all) {
+    const char **live = malloc(((size_t)scan->count * 2 + 1) * sizeof(char *));
+    if (!live) {
+        return;
+    }
+    int live_count = 0;
+    for (int i = 0; i < scan->count; i++) {
+        live[live_count++] = scan->entries[i].out_hash;
+        live[live_count++] = scan->entries[i].err_hash;
+    }
+    qsort(live, (size_t)live_count, sizeof(char *), cmdcache_compare_hash);
+
+    int objects_fd = openat(store_fd, "objects", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *objects = objects_fd != -1 ? fdopendir(objects_fd) : NULL;
+    if (!objects) {
+        if (objects_fd != -1) {
+            close(objects_fd);
+        }
+        free(live);
+        return;
+    }
+
+    time_t now = time(NULL);
+    struct dirent *fan;
+    while ((fan = readdir(objects)) != NULL) {
+        if (fan->d_name[0] == '.') {
+            continue;
+        }
+
+        int sub_fd = openat(objects_fd, fan->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        DIR *sub = sub_fd != -1 ? fdopendir(sub_fd) : NULL;
+        if (!sub) {
+            if (sub_fd != -1) {
+                close(sub_fd);
+            }
+            continue;
+        }
+
+        struct dirent *de;
+        while ((de = readdir(sub)) != NULL) {
+            const char *name = de->d_name;
+            struct stat st;
+            if (name[0] == '.' || bsearch(&name, live, (size_t)live_count, sizeof(char *),
+                                          cmdcache_compare_hash)) {
+                continue;
+            }
+            if (all || (fstatat(sub_fd, name, &st, 0) == 0 && now - st.st_mtime >= CMDCACHE_SWEEP_GRACE)) {
+                unlinkat(sub_fd, name, 0);
+            }
+        }
+
+        closedir(sub);
+    }
+
+    closedir(objects);
+    free(live);
+}
+
+/**
+ * @brief Вытеснение давно не использованных записей сверх предела объёма
+ * @param store_fd Каталог хранилища
+ */
+static void cmdcache_evict(int store_fd) {
+    unsigned long long limit = cmdcache_limit();
+    cmdcache_scan_t scan;
+    if (cmdcache_scan(store_fd, &scan) != 0) {
+        return;
+    }
+    if (scan.size <= limit) {
+        free(scan.entries);
+        return;
+    }
+
+    qsort(scan.entries, (size_t)scan.count, sizeof(cmdcache_entry_t), cmdcache_compare_used);
+
+    int first = 0;
+    while (first < scan.count && scan.size > limit) {
+        char path[96];
+        snprintf(path, sizeof(path), "entries/%s", scan.entries[first].key);
+        unlinkat(store_fd, path, 0);
+        scan.size -= scan.entries[first].out_size + scan.entries[first].err_size;
+        atomic_fetch_add(&stat_evictions, 1);
+        first++;
+    }
+
+    cmdcache_scan_t rest = { scan.entries + first, scan.count - first, scan.size };
+    cmdcache_sweep(store_fd, &rest, 0);
+    free(scan.entries);
+}
+
+/**
+ * @brief Выполнение команды с сохранением результата
+ * @param store_fd Каталог хранилища
+ * @param cmd Команда
+ * @param key Ключ записи
+ * @return Код выхода команды
+ */
+static int cmdcache_run_and_store(int store_fd, command_t *cmd, const char *key) {
+    char out_path[64], err_path[64];
+    int out = cmdcache_create_tmp(store_fd, out_path);
+    int err = out != -1 ? cmdcache_create_tmp(store_fd, err_path) : -1;
+    if (out == -1 || err == -1) {
+        fprintf(shell_stderr(), "cache: временный файл: %s\n", strerror(errno));
+        if (out != -1) {
+            close(out);
+            unlinkat(store_fd, out_path, 0);
+        }
+        return execute_captured(cmd, shell_fd(STDOUT_FILENO), shell_fd(STDERR_FILENO));
+    }
+
+    cmdcache_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    snprintf(entry.key, sizeof(entry.key), "%s", key);
+    entry.created = (long long)time(NULL);
+    entry.exit_code = execute_captured(cmd, out, err);
+
+    struct stat out_st, err_st;
+    fstat(out, &out_st);
+    fstat(err, &err_st);
+    fflush(shell_stdout());
+    fflush(shell_stderr());
+    cmdcache_replay(shell_fd(STDOUT_FILENO), out, (unsigned long long)out_st.st_size);
+    cmdcache_replay(shell_fd(STDERR_FILENO), err, (unsigned long long)err_st.st_size);
+
+    int stored = cmdcache_store_object(store_fd, out_path, out, entry.out_hash, &entry.out_size) == 0 &&
+                 cmdcache_store_object(store_fd, err_path, err, entry.err_hash, &entry.err_size) == 0 &&
+                 cmdcache_write_entry(store_fd, &entry) == 0;
+    close(out);
+    close(err);
+
+    if (stored) {
+        atomic_fetch_add(&stat_stores, 1);
+        cmdcache_evict(store_fd);
+    } else {
+        unlinkat(store_fd, out_path, 0);
+        unlinkat(store_fd, err_path, 0);
+    }
+
+    return entry.exit_code;
+}
+
+/**
+ * @brief Вывод статистики кеша
+ * @param store_fd Каталог хранилища
+ * @param store_path Путь к хранилищу
+ * @return 0
+ */
+static int cmdcache_print_stats(int store_fd, const char *store_path) {
+    cmdcache_scan_t scan;
+    if (cmdcache_scan(store_fd, &scan) != 0) {
+        memset(&scan, 0, sizeof(scan));
+    }
+
+    fprintf(shell_stdout(), "Хранилище: %s\n", store_path);
+    fprintf(shell_stdout(), "Записей: %d, объём: %llu байт, предел: %llu байт\n",
+            scan.count, scan.size, cmdcache_limit());
+    fprintf(shell_stdout(), "Попаданий: %llu, промахов: %llu, сохранено: %llu, вытеснено: %llu\n",
+            (unsigned long long)atomic_load(&stat_hits), (unsigned long long)atomic_load(&stat_misses),
+            (unsigned long long)atomic_load(&stat_stores), (unsigned long long)atomic_load(&stat_evictions));
+
+    free(scan.entries);
+    return 0;
+}
+
+/**
+ * @brief Удаление всех записей и объектов
+ * @param store_fd Каталог хранилища
+ * @return 0 в случае успеха, 1 если удалено не всё
+ */
+static int cmdcache_clear(int store_fd) {
+    cmdcache_scan_t scan;
+    if (cmdcache_scan(store_fd, &scan) != 0) {
+        return 1;
+    }
+
+    int result = 0;
+    for (int i = 0; i < scan.count; i++) {
+        char path[96];
+        snprintf(path, sizeof(path), "entries/%s", scan.entries[i].key);
+        if (unlinkat(store_fd, path, 0) != 0 && errno != ENOENT) {
+            result = 1;
+        }
+    }
+
+    cmdcache_scan_t none;
+    memset(&none, 0, sizeof(none));
+    cmdcache_sweep(store_fd, &none, 1);
+
+    free(scan.entries);
+    return result;
+}
+
+/**
+ * @brief Встроенная команда cache (кеширование результата команды)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода команды (сохранённый или новый), -1 в случае ошибки
+ */
+int builtin_cache(char **args, int argc) {
+    long long ttl = 0;
+    char *deps[CMDCACHE_MAX_DEPS];
+    char *envs[CMDCACHE_MAX_DEPS];
+    int dep_count = 0, env_count = 0;
+    int stats = 0, clear = 0;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-'; i++) {
+        if (strcmp(args[i], "--ttl") == 0 && i + 1 < argc) {
+            if (cmdcache_parse_ttl(args[++i], &ttl) != 0) {
+                fprintf(shell_stderr(), "cache: неверный срок '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (strcmp(args[i], "--dep") == 0 && i + 1 < argc && dep_count < CMDCACHE_MAX_DEPS) {
+            deps[dep_count++] = args[++i];
+        } else if (strcmp(args[i], "--env") == 0 && i + 1 < argc && env_count < CMDCACHE_MAX_DEPS) {
+            envs[env_count++] = args[++i];
+        } else if (strcmp(args[i], "--stats") == 0) {
+            stats = 1;
+        } else if (strcmp(args[i], "--clear") == 0) {
+            clear = 1;
+        } else if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        } else {
+            fprintf(shell_stderr(), "cache: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: cache [--ttl T] [--dep файл]... [--env имя]... команда [аргументы]\n");
+            fprintf(shell_stderr(), "               cache --stats | --clear\n");
+            return -1;
+        }
+    }
+
+    if (!stats && !clear && i == argc) {
+        fprintf(shell_stderr(), "cache: не указана команда\n");
+        return -1;
+    }
+
+    char store_path[PATH_MAX];
+    int store_fd = cmdcache_open_store(store_path);
+    if (store_fd == -1) {
+        fprintf(shell_stderr(), "cache: хранилище недоступно: %s\n", strerror(errno));
+        if (stats || clear) {
+            return -1;
+        }
+    }
+
+    command_t sub;
+    memset(&sub, 0, sizeof(sub));
+    sub.name = args[i];
+    sub.args = &args[i];
+    sub.argc = argc - i;
+
+    int exit_code;
+    if (clear) {
+        exit_code = cmdcache_clear(store_fd);
+    } else if (stats) {
+        exit_code = cmdcache_print_stats(store_fd, store_path);
+    } else if (store_fd == -1) {
+        // Без хранилища команда просто выполняется
+        exit_code = execute_captured(&sub, shell_fd(STDOUT_FILENO), shell_fd(STDERR_FILENO));
+    } else {
+        char key[CHECKSUM_HEX_MAX];
+        cmdcache_key(&args[i], argc - i, deps, dep_count, envs, env_count, key);
+
+        cmdcache_entry_t entry;
+        int fresh = cmdcache_read_entry(store_fd, key, &entry) == 0 &&
+                    (ttl == 0 || (long long)time(NULL) - entry.created <= ttl);
+
+        if (fresh && cmdcache_replay_entry(store_fd, &entry) == 0) {
+            // Время изменения записи - время последнего использования для LRU
+            char path[96];
+            snprintf(path, sizeof(path), "entries/%s", key);
+            utimensat(store_fd, path, NULL, 0);
+            atomic_fetch_add(&stat_hits, 1);
+            exit_code = entry.exit_code;
+        } else {
+            atomic_fetch_add(&stat_misses, 1);
+            exit_code = cmdcache_run_and_store(store_fd, &sub, key);
+        }
+    }
+
+    if (store_fd != -1) {
+        close(store_fd);
+    }
+    return exit_code;
+}
@@ -0,0 +1,277 @@
+/**
+ * @file cmdhash.c
+ * @brief Реализация общей таблицы путей команд
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "cmdhash.h"
+#include "shellstats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * @def CMDHASH_BUCKETS
+ * @brief Количество цепочек хеш-таблицы
+ */
+#define CMDHASH_BUCKETS 1024
+
+/**
+ * @struct cmdhash_entry_t
+ * @brief Запомненный путь команды
+ */
+typedef struct cmdhash_entry {
+    struct cmdhash_entry *next;  /**< Следующая запись цепочки */
+    uint64_t hash;               /**< Хеш имени и PATH */
+    char *name;                  /**< Имя команды */
+    char *path_env;              /**< PATH, по которому искали */
+    char *resolved;              /**< Найденный путь */
+} cmdhash_entry_t;
+
+// Таблица общая для всех потоков: чтение под общей блокировкой, запись - под исключительной
+static cmdhash_entry_t *buckets[CMDHASH_BUCKETS];
+static int entry_count = 0;
+static pthread_rwlock_t table_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/**
+ * @brief Хеш FNV-1a имени команды и PATH
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @return Хеш
+ */
+static uint64_t cmdhash_hash(const char *name, const char *path_env) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    // Нулевой байт разделяет имя и PATH
+    hash *= 1099511628211ULL;
+    for (const unsigned char *p = (const unsigned char *)path_env; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Проверка, что PATH состоит только из абсолютных каталогов
+ * @param path_env Значение PATH
+ * @return 1 если результат поиска не зависит от текущего каталога
+ */
+static int cmdhash_path_cacheable(const char *path_env) {
+    const char *p = path_env;
+
+    for (;;) {
+        // Пустой элемент PATH означает текущий каталог
+        if (*p != '/') {
+            return 0;
+        }
+        p = strchr(p, ':');
+        if (!p) {
+            return 1;
+        }
+        p++;
+    }
+}
+
+/**
+ * @brief Поиск команды по каталогам PATH
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @return Путь (освобождается free()) или NULL
+ */
+static char *cmdhash_search(const char *name, const char *path_env) {
+    char candidate[PATH_MAX];
+    const char *dir = path_env;
+
+    while (dir && *dir) {
+        const char *end = strchr(dir, ':');
+        size_t dir_len = end ? (size_t)(end - dir) : strlen(dir);
+
+        int len = snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)dir_len, dir, name);
+        if (len > 0 && (size_t)len < sizeof(candidate)) {
+            struct stat st;
+            if (access(candidate, X_OK) == 0 && stat(candidate, &st) == 0 && S_ISREG(st.st_mode)) {
+                return strdup(candidate);
+            }
+        }
+
+        dir = end ? end + 1 : NULL;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Освобождение записи таблицы
+ * @param entry Запись
+ */
+static void cmdhash_free_entry(cmdhash_entry_t *entry) {
+    free(entry->name);
+    free(entry->path_env);
+    free(entry->resolved);
+    free(entry);
+}
+
+/**
+ * @brief Удаление всех записей (вызывается под исключительной блокировкой)
+ */
+static void cmdhash_clear_locked(void) {
+    for (int i = 0; i < CMDHASH_BUCKETS; i++) {
+        cmdhash_entry_t *entry = buckets[i];
+        while (entry) {
+            cmdhash_entry_t *next = entry->next;
+            cmdhash_free_entry(entry);
+            entry = next;
+        }
+        buckets[i] = NULL;
+    }
+    entry_count = 0;
+}
+
+/**
+ * @brief Поиск записи в цепочке (вызывается под блокировкой)
+ * @param hash Хеш ключа
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @return Указатель на ссылку на запись (для удаления) или NULL
+ */
+static cmdhash_entry_t **cmdhash_find(uint64_t hash, const char *name, const char *path_env) {
+    cmdhash_entry_t **link = &buckets[hash % CMDHASH_BUCKETS];
+
+    while (*link) {
+        cmdhash_entry_t *entry = *link;
+        if (entry->hash == hash && strcmp(entry->name, name) == 0 &&
+            strcmp(entry->path_env, path_env) == 0) {
+            return link;
+        }
+        link = &entry->next;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Поиск полного пути команды
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @return Путь (освобождается free()) или NULL
+ */
+char *cmdhash_lookup(const char *name, const char *path_env) {
+    if (!name || !*name || strchr(name, '/') || !path_env || !cmdhash_path_cacheable(path_env)) {
+        return NULL;
+    }
+
+    uint64_t hash = cmdhash_hash(name, path_env);
+    char *resolved = NULL;
+
+    pthread_rwlock_rdlock(&table_lock);
+    cmdhash_entry_t **link = cmdhash_find(hash, name, path_env);
+    if (link) {
+        resolved = strdup((*link)->resolved);
+    }
+    pthread_rwlock_unlock(&table_lock);
+
+    if (resolved) {
+        if (access(resolved, X_OK) == 0) {
+            shellstats_count(SHELLSTAT_CMDHASH_HIT);
+            return resolved;
+        }
+
+        // Программа удалена или перемещена: запись устарела
+        free(resolved);
+        pthread_rwlock_wrlock(&table_lock);
+        link = cmdhash_find(hash, name, path_env);
+        if (link) {
+            cmdhash_entry_t *stale = *link;
+            *link = stale->next;
+            cmdhash_free_entry(stale);
+            entry_count--;
+        }
+        pthread_rwlock_unlock(&table_lock);
+    }
+
+    shellstats_count(SHELLSTAT_CMDHASH_MISS);
+    resolved = cmdhash_search(name, path_env);
+    if (!resolved) {
+        return NULL;
+    }
+
+    cmdhash_insert(name, path_env, resolved);
+    return resolved;
+}
+
+/**
+ * @brief Добавление готового пути без поиска по PATH
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @param resolved Путь
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int cmdhash_insert(const char *name, const char *path_env, const char *resolved) {
+    if (!name || !*name || strchr(name, '/') || !path_env || !cmdhash_path_cacheable(path_env) ||
+        !resolved || resolved[0] != '/') {
+        return -1;
+    }
+
+    uint64_t hash = cmdhash_hash(name, path_env);
+
+    cmdhash_entry_t *entry = calloc(1, sizeof(cmdhash_entry_t));
+    if (entry) {
+        entry->hash = hash;
+        entry->name = strdup(name);
+        entry->path_env = strdup(path_env);
+        entry->resolved = strdup(resolved);
+    }
+    if (!entry || !entry->name || !entry->path_env || !entry->resolved) {
+        if (entry) {
+            cmdhash_free_entry(entry);
+        }
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&table_lock);
+    if (cmdhash_find(hash, name, path_env)) {
+        // Другой поток успел добавить ту же команду
+        cmdhash_free_entry(entry);
+    } else {
+        if (entry_count >= CMDHASH_MAX_ENTRIES) {
+            cmdhash_clear_locked();
+        }
+        cmdhash_entry_t **head = &buckets[hash % CMDHASH_BUCKETS];
+        entry->next = *head;
+        *head = entry;
+        entry_count++;
+    }
+    pthread_rwlock_unlock(&table_lock);
+
+    return 0;
+}
+
+/**
+ * @brief Обход всех запомненных путей
+ * @param visit Функция обхода
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit
+ */
+int cmdhash_foreach(cmdhash_visit_fn visit, void *arg) {
+    int result = 0;
+
+    pthread_rwlock_rdlock(&table_lock);
+    for (int i = 0; i < CMDHASH_BUCKETS && result == 0; i++) {
+        for (cmdhash_entry_t *entry = buckets[i]; entry && result == 0; entry = entry->next) {
+            result = visit(entry->name, entry->path_env, entry->resolved, arg);
+        }
+    }
+    pthread_rwlock_unlock(&table_lock);
+
+    return result;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file context.c
+ * @brief Реализация встраиваемого контекста интерпретатора (libcustomshell)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "customshell.h"
+#include "shell.h"
+#include "utils.h"
+#include "pipestats.h"
+#include "profile.h"
+#include "xtrace.h"
+#include "alias.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Создание контекста интерпретатора
+ * @return Контекст или NULL в случае ошибки
+ */
+shell_context_t *shell_context_create(void) {
+    shell_state_t *state = calloc(1, sizeof(shell_state_t));
+    if (!state) {
+        return NULL;
+    }
+
+    state->embedded = 1;
+    state->io_fd = -1;
+
+    // Свой текущий каталог: cd в контексте не меняет каталог процесса
+    char cwd[PATH_MAX];
+    state->cwd_fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    state->current_dir = strdup(getcwd(cwd, sizeof(cwd)) ? cwd : ".");
+    if (state->cwd_fd == -1 || !state->current_dir) {
+        shell_context_destroy(state);
+        return NULL;
+    }
+
+    return state;
+}
+
+/**
+ * @brief Назначение дескриптора вывода контекста
+ * @param ctx Контекст
+ * @param fd Дескриптор для вывода и ошибок команд или -1
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int shell_context_set_output(shell_context_t *ctx, int fd) {
+    if (!ctx || fd < -1) {
+        return -1;
+    }
+
+    // Буфер прежнего вывода записывается туда, куда был адресован
+    shell_io_release(ctx);
+    ctx->io_fd = fd;
+    return 0;
+}
+
+/**
+ * @brief Выполнение скрипта из строки
+ * @param ctx Контекст
+ * @param script Текст скрипта: строки, разделённые '\n'
+ * @return Код выхода последней команды или -1 в случае ошибки
+ */
+int shell_context_eval_string(shell_context_t *ctx, const char *script) {
+    if (!ctx || !script) {
+        return -1;
+    }
+
+    // Строки скрипта завершаются нулём на месте, поэтому нужна копия
+    char *text = strdup(script);
+    if (!text) {
+        return -1;
+    }
+
+    shell_state_t *previous = shell_make_current(ctx);
+    ctx->should_exit = 0;
+
+    char *line = text;
+    while (line && !ctx->should_exit) {
+        char *next = strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+
+        char *start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+
+        // Пустые строки и комментарии (включая #!) не выполняются
+        if (*start != '\0' && *start != '#') {
+            shell_execute_line(ctx, start);
+        }
+
+        line = next;
+    }
+
+    shell_make_current(previous);
+    free(text);
+
+    return ctx->exit_code;
+}
+
+/**
+ * @brief Выполнение скрипта из файла
+ * @param ctx Контекст
+ * @param path Путь к файлу скрипта
+ * @return Код выхода последней команды или -1 в случае ошибки
+ */
+int shell_context_eval_file(shell_context_t *ctx, const char *path) {
+    if (!ctx || !path) {
+        return -1;
+    }
+
+    int fd = openat(ctx->cwd_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "%s: не является обычным файлом\n", path);
+        close(fd);
+        return -1;
+    }
+
+    char *text = malloc((size_t)st.st_size + 1);
+    if (!text) {
+        fprintf(stderr, "%s: %s\n", path, strerror(ENOMEM));
+        close(fd);
+        return -1;
+    }
+
+    // Скрипт читается целиком одним буфером
+    size_t total = 0;
+    while (total < (size_t)st.st_size) {
+        ssize_t n = read(fd, text + total, (size_t)st.st_size - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    text[total] = '\0';
+    close(fd);
+
+    int exit_code = shell_context_eval_string(ctx, text);
+    free(text);
+    return exit_code;
+}
+
+/**
+ * @brief Получение значения переменной
+ * @param ctx Контекст
+ * @param name Имя переменной; "?" - код выхода последней команды,
+ * "PIPESTATUS" - коды звеньев последнего конвейера
+ * @return Значение или NULL, если переменная не задана
+ */
+const char *shell_context_get_var(shell_context_t *ctx, const char *name) {
+    if (!ctx || !name) {
+        return NULL;
+    }
+
+    if (strcmp(name, "?") == 0) {
+        snprintf(ctx->status_text, sizeof(ctx->status_text), "%d", ctx->exit_code);
+        return ctx->status_text;
+    }
+    if (strcmp(name, "PIPESTATUS") == 0) {
+        return ctx->pipe_status[0] ? ctx->pipe_status : NULL;
+    }
+
+    shell_state_t *previous = shell_make_current(ctx);
+    const char *value = get_env_var(name);
+    shell_make_current(previous);
+
+    return value;
+}
+
+/**
+ * @brief Уничтожение контекста
+ * @param ctx Контекст (может быть NULL)
+ */
+void shell_context_destroy(shell_context_t *ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    if (shell_current() == ctx) {
+        shell_make_current(NULL);
+    }
+
+    if (ctx->cwd_fd != -1) {
+        close(ctx->cwd_fd);
+    }
+    shell_io_release(ctx);
+    free_context_vars(ctx);
+    pipestats_free(ctx);
+    profile_free(ctx);
+    xtrace_stop(ctx);
+    alias_clear_all(ctx);
+    free(ctx->prompt);
+    free(ctx->current_dir);
+    free(ctx);
+}
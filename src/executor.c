@@ -6,8 +6,19 @@
  * @date 2024
  */
 
+#define _GNU_SOURCE
+
 #include "executor.h"
 #include "builtins.h"
+#include "utils.h"
+#include "signals.h"
+#include "jobs.h"
+#include "cmdhash.h"
+#include "pipestats.h"
+#include "metrics.h"
+#include "shellstats.h"
+#include "registry.h"
+#include "shellio.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,10 +27,173 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+extern char **environ;
+
+// "exec 3>file": перенаправления текущей команды потока остаются после неё
+static __thread int keep_redirections = 0;
 
-// Глобальные переменные для перенаправления
-static int original_stdin = -1;
-static int original_stdout = -1;
+static int run_builtin(const char *name, char **args, int argc);
+static void run_in_child(command_t *cmd, const char *resolved);
+static int counted_dup2(int old_fd, int new_fd);
+
+/**
+ * @brief Подготовка дочернего процесса сразу после fork
+ *
+ * @details Сбрасывает сигналы и переносит в процесс текущий каталог,
+ * вывод контекста и перенаправления встроенной команды, внутри которой
+ * создан процесс (shellio.h). Вызывается до подключения каналов конвейера.
+ */
+static void prepare_child(void) {
+    signals_reset_child();
+    
+    shell_state_t *state = shell_current();
+    if (state && state->embedded) {
+        // Маска и игнорируемые сигналы встраивающей программы не наследуются
+        sigset_t empty;
+        sigemptyset(&empty);
+        sigprocmask(SIG_SETMASK, &empty, NULL);
+        signal(SIGPIPE, SIG_DFL);
+    }
+    
+    shell_io_child();
+    
+    if (state && state->cwd_fd != -1 && fchdir(state->cwd_fd) != 0) {
+        shell_perror("Ошибка смены каталога");
+        _exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief fork с записью задержки в метрики
+ * @return Результат fork()
+ *
+ * @details Буферы вывода записываются до fork, иначе дочерний процесс
+ * унаследует и повторно выведет их.
+ */
+static pid_t fork_child(void) {
+    shell_io_flush();
+    uint64_t started = metrics_clock();
+    shellstats_count(SHELLSTAT_FORK);
+    pid_t pid = fork();
+    if (pid > 0) {
+        metrics_record(METRIC_SPAWN, started);
+    }
+    return pid;
+}
+
+/**
+ * @brief dup2 с учётом в счётчиках shellstats
+ * @param old_fd Копируемый дескриптор
+ * @param new_fd Номер копии
+ * @return Результат dup2()
+ */
+static int counted_dup2(int old_fd, int new_fd) {
+    shellstats_count(SHELLSTAT_DUP2);
+    return dup2(old_fd, new_fd);
+}
+
+/**
+ * @brief Поиск пути внешней команды в общей таблице
+ * @param cmd Команда
+ * @return Путь (освобождается free()) или NULL - искать через execvp
+ */
+static char *resolve_command(const command_t *cmd) {
+    if (!cmd->name || is_builtin(cmd->name)) {
+        return NULL;
+    }
+    
+    // Префиксное присваивание PATH действует только на этот запуск
+    const char *path_env = NULL;
+    for (int i = 0; i < cmd->assign_count; i++) {
+        if (strncmp(cmd->assigns[i], "PATH=", 5) == 0) {
+            path_env = cmd->assigns[i] + 5;
+        }
+    }
+    
+    return cmdhash_lookup(cmd->name, path_env ? path_env : get_env_var("PATH"));
+}
+
+/**
+ * @brief Ожидание дочернего процесса переднего плана
+ * @param pid Идентификатор процесса
+ * @return Код выхода процесса или -1, если он завершён сигналом
+ */
+static int wait_foreground(pid_t pid) {
+    // Процесс только что создан, поэтому ожидание почти равно его времени
+    uint64_t started = metrics_clock();
+    int status;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    metrics_record(METRIC_CHILD, started);
+    
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        fprintf(shell_stdout(), "Процесс %d завершен сигналом %d\n", pid, WTERMSIG(status));
+    }
+    return -1;
+}
+
+/**
+ * @brief Выполнение внешней команды в дочернем процессе со своими перенаправлениями
+ * @param cmd Команда
+ * @return Код выхода команды
+ *
+ * @details Используется встроенными контекстами: перенаправления
+ * применяются в дочернем процессе, и дескрипторы процесса оболочки,
+ * общие для всех контекстов, не меняются.
+ */
+static int execute_in_child(command_t *cmd) {
+    char *resolved = resolve_command(cmd);
+    
+    pid_t pid = fork_child();
+    if (pid == -1) {
+        shell_perror("Ошибка создания процесса");
+        free(resolved);
+        return -1;
+    } else if (pid == 0) {
+        prepare_child();
+        run_in_child(cmd, resolved);
+    }
+    
+    free(resolved);
+    return wait_foreground(pid);
+}
+
+/**
+ * @brief Запуск встроенной команды в фоне
+ * @param cmd Команда
+ * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Безопасные для потоков команды выполняются задачей внутри
+ * оболочки; остальные - в дочернем процессе, как внешние программы.
+ */
+static int execute_background_builtin(command_t *cmd) {
+    if (jobs_task_safe(cmd)) {
+        return jobs_start_task(cmd) > 0 ? 0 : -1;
+    }
+    
+    pid_t pid = fork_child();
+    if (pid == -1) {
+        shell_perror("Ошибка создания процесса");
+        return -1;
+    } else if (pid == 0) {
+        prepare_child();
+        run_in_child(cmd, NULL);
+    }
+    
+    jobs_add_process(pid, cmd->name);
+    return 0;
+}
 
 /**
  * @brief Выполнение команды
@@ -27,30 +201,415 @@ static int original_stdout = -1;
  * @return Код выхода команды
  */
 int execute_command(command_t *cmd) {
-    if (!cmd || !cmd->name) {
+    if (!cmd || (!cmd->name && cmd->assign_count == 0)) {
         return -1;
     }
     
+    if (cmd->background && cmd->name && is_builtin(cmd->name)) {
+        return execute_background_builtin(cmd);
+    }
+    
+    // Дескрипторы процесса общие для всех контекстов
+    shell_state_t *state = shell_current();
+    if (state && state->embedded && cmd->name && !is_builtin(cmd->name)) {
+        return execute_in_child(cmd);
+    }
+    
     // Настройка перенаправлений
-    if (setup_redirections(cmd) != 0) {
+    shell_io_t io;
+    if (setup_redirections(cmd, &io) != 0) {
+        restore_stdio(&io);
         return -1;
     }
     
     int exit_code = 0;
     
-    // Проверка на встроенную команду
-    if (is_builtin(cmd->name)) {
+    if (!cmd->name) {
+        // Присваивания без команды изменяют переменные самой оболочки
+        exit_code = apply_assignments(cmd->assigns, cmd->assign_count) == 0 ? 0 : -1;
+    } else if (is_builtin(cmd->name)) {
         exit_code = execute_builtin(cmd);
     } else {
         exit_code = execute_external(cmd);
     }
     
     // Восстановление стандартного ввода/вывода
-    restore_stdio();
+    restore_stdio(&io);
     
     return exit_code;
 }
 
+/**
+ * @brief Длина конвейера, начинающегося с данной команды
+ * @param commands Команды, начиная с первого звена
+ * @param count Количество доступных команд
+ * @return Количество звеньев конвейера (не меньше 1)
+ */
+int pipeline_length(const command_t *commands, int count) {
+    int length = 1;
+    
+    while (length < count && commands[length - 1].pipe_next) {
+        length++;
+    }
+    
+    return length;
+}
+
+/**
+ * @brief Выполнение команды в дочернем процессе
+ * @param cmd Команда (звено конвейера или фоновая встроенная команда)
+ * @param resolved Путь внешней команды из общей таблицы или NULL
+ *
+ * @details Процесс уже подготовлен prepare_child(), ввод и вывод звена
+ * подключены к каналам; явные перенаправления применяются поверх них.
+ * Функция не возвращает управление.
+ */
+static void run_in_child(command_t *cmd, const char *resolved) {
+    // Процесс владеет своими дескрипторами: перенаправления переносятся в них
+    shell_io_t io;
+    if (setup_redirections(cmd, &io) != 0) {
+        _exit(EXIT_FAILURE);
+    }
+    shell_io_child();
+    
+    if (!cmd->name) {
+        _exit(EXIT_SUCCESS);
+    }
+    
+    if (is_builtin(cmd->name)) {
+        int exit_code = execute_builtin(cmd);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(exit_code & 0xFF);
+    }
+    
+    if (cmd->assign_count > 0 || context_var_count() > 0) {
+        char **envp = build_child_env(cmd->assigns, cmd->assign_count, 0, NULL, 0);
+        if (envp) {
+            environ = envp;
+        }
+    }
+    
+    if (resolved) {
+        execv(resolved, cmd->args);
+    } else {
+        execvp(cmd->name, cmd->args);
+    }
+    shell_perror("Ошибка выполнения команды");
+    _exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Ожидание одного звена конвейера с записью статистики
+ * @param pid Процесс звена
+ * @param status Указатель для статуса waitpid
+ * @param stage Статистика звена или NULL
+ */
+static void reap_stage(pid_t pid, int *status, pipeline_stage_stats_t *stage) {
+    struct rusage usage;
+    while (wait4(pid, status, 0, &usage) == -1) {
+        if (errno != EINTR) {
+            *status = 0;
+            return;
+        }
+    }
+    
+    if (stage) {
+        stage->wall = pipestats_now() - stage->started;
+        stage->user = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6;
+        stage->sys = (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+        stage->status = WIFEXITED(*status) ? WEXITSTATUS(*status) : 128 + WTERMSIG(*status);
+        metrics_record_value(METRIC_CHILD, (uint64_t)(stage->wall * 1e9));
+    }
+}
+
+/**
+ * @brief Ожидание всех звеньев конвейера
+ * @param pids Процессы звеньев
+ * @param started Количество запущенных процессов
+ * @param statuses Массив для статусов waitpid
+ * @param stats Статистика конвейера или NULL
+ * @param pidfds Дескрипторы процессов звеньев или NULL
+ * @param taps Копии входных каналов звеньев для замера (-1 - нет) или NULL
+ *
+ * @details Через pidfd звенья дожидаются в порядке завершения, и время
+ * каждого не зависит от соседей. Копия канала закрывается, как только
+ * читающее звено завершилось: иначе пишущее звено не получило бы EPIPE.
+ * Без pidfd звенья дожидаются по порядку, а замер не выполняется.
+ */
+static void wait_pipeline(const pid_t *pids, int started, int *statuses,
+                          pipeline_stats_t *stats, int *pidfds, int *taps) {
+    int pollable = pidfds != NULL;
+    for (int i = 0; i < started && pollable; i++) {
+        pollable = pidfds[i] != -1;
+    }
+    
+    struct pollfd *fds = pollable ? calloc((size_t)started, sizeof(*fds)) : NULL;
+    if (!fds) {
+        pollable = 0;
+    }
+    int remaining = started;
+    
+    while (fds && remaining > 0) {
+        for (int i = 0; i < started; i++) {
+            fds[i].fd = pidfds[i];
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        
+        int ready = poll(fds, (nfds_t)started, taps ? PIPESTATS_SAMPLE_MS : -1);
+        if (ready == -1 && errno != EINTR) {
+            break;
+        }
+        
+        for (int i = 0; i < started && ready > 0; i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            reap_stage(pids[i], &statuses[i], &stats->stages[i]);
+            close(pidfds[i]);
+            pidfds[i] = -1;
+            if (taps && taps[i] != -1) {
+                close(taps[i]);
+                taps[i] = -1;
+            }
+            remaining--;
+        }
+        
+        for (int i = 0; taps && i < started; i++) {
+            if (taps[i] != -1) {
+                pipestats_sample(&stats->stages[i], taps[i]);
+            }
+        }
+    }
+    free(fds);
+    
+    // Оставшиеся (или все без pidfd) - по порядку
+    for (int i = 0; i < started; i++) {
+        if (taps && taps[i] != -1) {
+            close(taps[i]);
+            taps[i] = -1;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        if (!pollable || pidfds[i] != -1) {
+            reap_stage(pids[i], &statuses[i], stats ? &stats->stages[i] : NULL);
+        }
+        if (pidfds && pidfds[i] != -1) {
+            close(pidfds[i]);
+            pidfds[i] = -1;
+        }
+    }
+}
+
+/**
+ * @brief Закрытие копии канала в дочернем процессе после dup2
+ * @param fd Дескриптор или -1
+ */
+static void close_pipe_fd(int fd) {
+    if (fd > STDERR_FILENO) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Выполнение конвейера
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ * @return Код выхода последнего звена
+ */
+int execute_pipeline(command_t *commands, int count) {
+    if (!commands || count <= 0) {
+        return -1;
+    }
+    
+    command_t *last = &commands[count - 1];
+    
+    // Фоновое задание пережило бы контекст, который его запустил
+    shell_state_t *state = shell_current();
+    if (last->background && state && state->embedded) {
+        fprintf(shell_stderr(), "%s: фоновое выполнение недоступно во встроенном контексте\n",
+                last->name ? last->name : "&");
+        return -1;
+    }
+    
+    if (count == 1) {
+        int exit_code = execute_command(&commands[0]);
+        if (!commands[0].background) {
+            pipestats_set_single(exit_code);
+        }
+        return exit_code;
+    }
+    
+    // Встроенная команда в конце конвейера читает канал в самой оболочке
+    int last_in_shell = !last->background && last->name && is_builtin(last->name);
+    int forked_count = last_in_shell ? count - 1 : count;
+    
+    pid_t *pids = calloc(count, sizeof(pid_t));
+    int *statuses = calloc(count, sizeof(int));
+    if (!pids || !statuses) {
+        shell_perror("Ошибка выделения памяти");
+        free(pids);
+        free(statuses);
+        return -1;
+    }
+    
+    // Статистика для pipestats; без памяти под неё конвейер всё равно выполняется
+    pipeline_stats_t *stats = last->background ? NULL : pipestats_create(commands, count);
+    int *pidfds = stats ? malloc(count * sizeof(int)) : NULL;
+    int *taps = stats && state && state->pipe_sampling ? malloc(count * sizeof(int)) : NULL;
+    for (int i = 0; i < count; i++) {
+        if (pidfds) {
+            pidfds[i] = -1;
+        }
+        if (taps) {
+            taps[i] = -1;
+        }
+    }
+    
+    int prev_read = -1;
+    int started = 0;
+    int failed = 0;
+    
+    for (int i = 0; i < forked_count; i++) {
+        int pipefd[2] = {-1, -1};
+        
+        if (i < count - 1 && pipe2(pipefd, O_CLOEXEC) == -1) {
+            shell_perror("Ошибка создания канала");
+            failed = 1;
+            break;
+        }
+        
+        char *resolved = resolve_command(&commands[i]);
+        
+        pid_t pid = fork_child();
+        if (pid == -1) {
+            shell_perror("Ошибка создания процесса");
+            if (pipefd[0] != -1) {
+                close(pipefd[0]);
+                close(pipefd[1]);
+            }
+            free(resolved);
+            failed = 1;
+            break;
+        } else if (pid == 0) {
+            // Дочерний процесс: dup2 снимает CLOEXEC с копий 0 и 1
+            prepare_child();
+            if (prev_read != -1) {
+                counted_dup2(prev_read, STDIN_FILENO);
+            }
+            if (pipefd[1] != -1) {
+                counted_dup2(pipefd[1], STDOUT_FILENO);
+            }
+            // Встроенная команда выполняется без exec, и O_CLOEXEC не закроет
+            // концы каналов: иначе писатель держит чтение своего же канала и
+            // не получает EPIPE, когда читатель завершился раньше
+            close_pipe_fd(prev_read);
+            close_pipe_fd(pipefd[0]);
+            close_pipe_fd(pipefd[1]);
+            for (int j = 0; taps && j < i; j++) {
+                close_pipe_fd(taps[j]);
+            }
+            run_in_child(&commands[i], resolved);
+        }
+        
+        free(resolved);
+        pids[started++] = pid;
+        
+        if (stats) {
+            stats->stages[i].started = pipestats_now();
+#ifdef SYS_pidfd_open
+            if (pidfds) {
+                pidfds[i] = (int)syscall(SYS_pidfd_open, pid, 0);
+            }
+#endif
+        }
+        // Копия входного канала звена для FIONREAD, пока звено работает
+        if (taps && prev_read != -1) {
+            taps[i] = fcntl(prev_read, F_DUPFD_CLOEXEC, 10);
+        }
+        
+        if (prev_read != -1) {
+            close(prev_read);
+        }
+        if (pipefd[1] != -1) {
+            close(pipefd[1]);
+        }
+        prev_read = pipefd[0];
+    }
+    
+    int exit_code = 0;
+    
+    if (last_in_shell && !failed) {
+        // Канал становится вводом встроенной команды только в этом потоке
+        shell_io_t io;
+        shell_io_push(&io);
+        shell_io_set(&io, STDIN_FILENO, prev_read, 1);
+        prev_read = -1;
+        
+        struct rusage before, after;
+        getrusage(RUSAGE_THREAD, &before);
+        double stage_started = pipestats_now();
+        
+        exit_code = execute_command(last);
+        
+        if (stats) {
+            pipeline_stage_stats_t *stage = &stats->stages[count - 1];
+            getrusage(RUSAGE_THREAD, &after);
+            stage->wall = pipestats_now() - stage_started;
+            stage->user = (double)(after.ru_utime.tv_sec - before.ru_utime.tv_sec) +
+                          (double)(after.ru_utime.tv_usec - before.ru_utime.tv_usec) / 1e6;
+            stage->sys = (double)(after.ru_stime.tv_sec - before.ru_stime.tv_sec) +
+                         (double)(after.ru_stime.tv_usec - before.ru_stime.tv_usec) / 1e6;
+            stage->status = exit_code;
+        }
+        
+        // Закрытие канала завершает ещё пишущие звенья через EPIPE
+        shell_io_pop(&io);
+    }
+    
+    if (prev_read != -1) {
+        close(prev_read);
+    }
+    
+    if (last->background && !failed) {
+        // Фоновый конвейер отслеживается по последнему звену
+        jobs_add_process(pids[started - 1], last->name);
+        free(pids);
+        free(statuses);
+        return 0;
+    }
+    
+    wait_pipeline(pids, started, statuses, stats, pidfds, taps);
+    
+    for (int i = 0; i < started; i++) {
+        int status = statuses[i];
+        if (i != count - 1) {
+            continue;
+        }
+        
+        if (WIFEXITED(status)) {
+            exit_code = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            fprintf(shell_stdout(), "Процесс %d завершен сигналом %d\n", pids[i], WTERMSIG(status));
+            exit_code = -1;
+        }
+    }
+    
+    if (stats && !failed) {
+        stats->wall = pipestats_now() - stats->started;
+        pipestats_commit(stats);
+    } else if (stats) {
+        free(stats->stages);
+        free(stats);
+    }
+    free(pidfds);
+    free(taps);
+    free(pids);
+    free(statuses);
+    return failed ? -1 : exit_code;
+}
+
 /**
  * @brief Выполнение внешней программы
  * @param cmd Команда для выполнения
@@ -61,41 +620,230 @@ int execute_external(command_t *cmd) {
         return -1;
     }
     
-    pid_t pid = fork();
+    if (cmd->assign_count == 0 && context_var_count() == 0) {
+        return execute_with_env(cmd, environ);
+    }
+    
+    // Окружение строится один раз в родителе и передаётся прямо в execve
+    char **envp = build_child_env(cmd->assigns, cmd->assign_count, 0, NULL, 0);
+    if (!envp) {
+        shell_perror("Ошибка построения окружения");
+        return -1;
+    }
+    
+    int exit_code = execute_with_env(cmd, envp);
+    free(envp);
+    return exit_code;
+}
+
+/**
+ * @brief Выполнение команды с заданным окружением
+ * @param cmd Команда для выполнения
+ * @param envp Окружение только для этого запуска
+ * @return Код выхода команды
+ */
+int execute_with_env(command_t *cmd, char **envp) {
+    if (!cmd || !cmd->name || !envp) {
+        return -1;
+    }
+    
+    if (is_builtin(cmd->name)) {
+        // Встроенная команда видит окружение на время вызова, без fork
+        shell_state_t *state = shell_current();
+        char **saved_environ = environ;
+        environ = envp;
+        
+        // envp уже содержит переменные контекста (или намеренно их лишён)
+        int saved_hidden = state ? state->vars_hidden : 0;
+        if (state) {
+            state->vars_hidden = 1;
+        }
+        
+        int exit_code = run_builtin(cmd->name, cmd->args, cmd->argc);
+        
+        if (state) {
+            state->vars_hidden = saved_hidden;
+        }
+        environ = saved_environ;
+        return exit_code;
+    }
+    
+    // Путь ищется по PATH из envp, с которым программа и будет запущена
+    const char *path_env = NULL;
+    for (char **entry = envp; *entry; entry++) {
+        if (strncmp(*entry, "PATH=", 5) == 0) {
+            path_env = *entry + 5;
+        }
+    }
+    char *resolved = cmdhash_lookup(cmd->name, path_env);
+    
+    pid_t pid = fork_child();
     
     if (pid == -1) {
-        perror("Ошибка создания процесса");
+        shell_perror("Ошибка создания процесса");
+        free(resolved);
         return -1;
     } else if (pid == 0) {
         // Дочерний процесс
         
+        // Сигналы, заблокированные под ловушки, не должны наследоваться
+        prepare_child();
+        
+        // execvp ищет программу по PATH и передаёт ей environ
+        environ = envp;
+        
         // Выполнение команды
-        if (execvp(cmd->name, cmd->args) == -1) {
-            perror("Ошибка выполнения команды");
-            exit(EXIT_FAILURE);
+        if (resolved) {
+            execv(resolved, cmd->args);
+        } else {
+            execvp(cmd->name, cmd->args);
         }
-    } else {
-        // Родительский процесс
+        shell_perror("Ошибка выполнения команды");
+        _exit(EXIT_FAILURE);
+    }
+    
+    // Родительский процесс
+    free(resolved);
+    
+    if (cmd->background) {
+        // Фоновое выполнение
+        jobs_add_process(pid, cmd->name);
+        return 0;
+    }
+    
+    // Ожидание завершения
+    return wait_foreground(pid);
+}
+
+/**
+ * @brief Вызов встроенной команды с учётом в метриках
+ * @param name Имя встроенной команды
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода команды
+ */
+static int run_builtin(const char *name, char **args, int argc) {
+    uint64_t started = metrics_clock();
+    int exit_code = builtin_dispatch(name, args, argc);
+    metrics_record_builtin(name, started);
+    return exit_code;
+}
+
+/**
+ * @brief Выполнение команды с выводом в заданные дескрипторы
+ * @param cmd Команда
+ * @param out_fd Дескриптор для стандартного вывода
+ * @param err_fd Дескриптор для потока ошибок
+ * @return Код выхода команды
+ */
+int execute_captured(command_t *cmd, int out_fd, int err_fd) {
+    if (!cmd || !cmd->name) {
+        return -1;
+    }
+    
+    if (is_builtin(cmd->name)) {
+        // Уже накопленный вывод не должен оказаться после вывода команды
+        shell_io_flush();
+        shell_io_t io;
+        shell_io_push(&io);
+        shell_io_set(&io, STDOUT_FILENO, out_fd, 0);
+        shell_io_set(&io, STDERR_FILENO, err_fd, 0);
         
-        if (cmd->background) {
-            // Фоновое выполнение
-            printf("[%d] %s\n", pid, cmd->name);
-            return 0;
-        } else {
-            // Ожидание завершения
-            int status;
-            waitpid(pid, &status, 0);
-            
-            if (WIFEXITED(status)) {
-                return WEXITSTATUS(status);
-            } else if (WIFSIGNALED(status)) {
-                printf("Процесс %d завершен сигналом %d\n", pid, WTERMSIG(status));
-                return -1;
+        int exit_code = run_builtin(cmd->name, cmd->args, cmd->argc);
+        
+        shell_io_pop(&io);
+        return exit_code;
+    }
+    
+    char *resolved = resolve_command(cmd);
+    
+    pid_t pid = fork_child();
+    if (pid == -1) {
+        shell_perror("Ошибка создания процесса");
+        free(resolved);
+        return -1;
+    } else if (pid == 0) {
+        prepare_child();
+        counted_dup2(out_fd, STDOUT_FILENO);
+        counted_dup2(err_fd, STDERR_FILENO);
+        run_in_child(cmd, resolved);
+    }
+    
+    free(resolved);
+    return wait_foreground(pid);
+}
+
+/**
+ * @brief Запуск строки команд в дочернем процессе без ожидания
+ * @param line Строка команд
+ * @param own_group Создать для процесса отдельную группу
+ * @return Идентификатор процесса или -1 в случае ошибки
+ */
+pid_t execute_spawn(const char *line, int own_group) {
+    // Разбор до fork: блокировка кеша могла бы остаться захваченной в дочернем процессе
+    parsed_line_t *parsed = parse_cache_acquire(line);
+    if (!parsed) {
+        return -1;
+    }
+    
+    pid_t pid = fork_child();
+    if (pid == -1) {
+        shell_perror("Ошибка создания процесса");
+    } else if (pid == 0) {
+        if (own_group) {
+            setpgid(0, 0);
+        }
+        prepare_child();
+        
+        int exit_code = 0;
+        for (int i = 0; i < parsed->count; i++) {
+            int stages = pipeline_length(&parsed->commands[i], parsed->count - i);
+            if (stages > 1 || parsed->commands[i].name || parsed->commands[i].assign_count > 0) {
+                exit_code = execute_pipeline(&parsed->commands[i], stages);
             }
+            i += stages - 1;
         }
+        
+        fflush(stdout);
+        fflush(stderr);
+        _exit(exit_code & 0xFF);
     }
     
-    return 0;
+    // Группа создаётся и в родителе, чтобы kill(-pid) не опередил setpgid в дочернем
+    if (pid > 0 && own_group) {
+        setpgid(pid, pid);
+    }
+    
+    parse_cache_release(parsed);
+    return pid;
+}
+
+/**
+ * @brief Запуск внешней команды с заданными вводом и выводом без ожидания
+ * @param cmd Команда
+ * @param in_fd Дескриптор для стандартного ввода
+ * @param out_fd Дескриптор для стандартного вывода
+ * @return Идентификатор процесса или -1 в случае ошибки
+ */
+pid_t execute_start(command_t *cmd, int in_fd, int out_fd) {
+    if (!cmd || !cmd->name) {
+        return -1;
+    }
+    
+    char *resolved = resolve_command(cmd);
+    
+    pid_t pid = fork_child();
+    if (pid == -1) {
+        shell_perror("Ошибка создания процесса");
+    } else if (pid == 0) {
+        prepare_child();
+        counted_dup2(in_fd, STDIN_FILENO);
+        counted_dup2(out_fd, STDOUT_FILENO);
+        run_in_child(cmd, resolved);
+    }
+    
+    free(resolved);
+    return pid;
 }
 
 /**
@@ -108,81 +856,72 @@ int execute_builtin(command_t *cmd) {
         return -1;
     }
     
-    if (strcmp(cmd->name, "cd") == 0) {
-        return builtin_cd(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "pwd") == 0) {
-        return builtin_pwd(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "echo") == 0) {
-        return builtin_echo(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "exit") == 0) {
-        return builtin_exit(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "help") == 0) {
-        return builtin_help(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "clear") == 0) {
-        return builtin_clear(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "history") == 0) {
-        return builtin_history(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "touch") == 0) {
-        return builtin_touch(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "rm") == 0) {
-        return builtin_rm(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "mkdir") == 0) {
-        return builtin_mkdir(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "rmdir") == 0) {
-        return builtin_rmdir(cmd->args, cmd->argc);
-    } else if (strcmp(cmd->name, "ls") == 0) {
-        return builtin_ls(cmd->args, cmd->argc);
+    if (cmd->assign_count > 0) {
+        char **envp = build_child_env(cmd->assigns, cmd->assign_count, 0, NULL, 0);
+        if (!envp) {
+            shell_perror("Ошибка построения окружения");
+            return -1;
+        }
+        int exit_code = execute_with_env(cmd, envp);
+        free(envp);
+        return exit_code;
     }
     
-    return -1;
+    return run_builtin(cmd->name, cmd->args, cmd->argc);
 }
 
 /**
- * @brief Настройка перенаправления ввода/вывода
- * @param cmd Команда с настройками перенаправления
+ * @brief Перенаправление одного дескриптора на файл
+ * @param io Звено перенаправлений команды
+ * @param path Путь к файлу
+ * @param flags Флаги open()
+ * @param target_fd Перенаправляемый дескриптор
  * @return 0 в случае успеха, -1 в случае ошибки
  */
-int setup_redirections(command_t *cmd) {
-    if (!cmd) {
+static int redirect_fd(shell_io_t *io, const char *path, int flags, int target_fd) {
+    shellstats_count(SHELLSTAT_OPEN);
+    int fd = openat(shell_cwd_fd(), path, flags | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        shell_perror(flags == O_RDONLY ? "Ошибка открытия файла ввода"
+                                       : "Ошибка открытия файла вывода");
         return -1;
     }
     
-    // Сохранение оригинальных дескрипторов
-    if (original_stdin == -1) {
-        original_stdin = dup(STDIN_FILENO);
+    // Дескрипторы процесса не меняются: команда видит файл через звено
+    if (shell_io_set(io, target_fd, fd, 1) != 0) {
+        close(fd);
+        return -1;
     }
-    if (original_stdout == -1) {
-        original_stdout = dup(STDOUT_FILENO);
+    return 0;
+}
+
+/**
+ * @brief Настройка перенаправления ввода/вывода
+ * @param cmd Команда с настройками перенаправления
+ * @param io Звено для перенаправлений команды
+ * @return 0 в случае успеха, -1 в случае ошибки
+ *
+ * @details Звено добавляется в стек потока и в случае ошибки: его снимает
+ * restore_stdio().
+ */
+int setup_redirections(command_t *cmd, shell_io_t *io) {
+    shell_io_push(io);
+    if (!cmd) {
+        return -1;
     }
     
     // Перенаправление ввода
     if (cmd->input_file) {
-        int fd = open(cmd->input_file, O_RDONLY);
-        if (fd == -1) {
-            perror("Ошибка открытия файла ввода");
+        if (redirect_fd(io, cmd->input_file, O_RDONLY, cmd->input_fd) != 0) {
             return -1;
         }
-        if (dup2(fd, STDIN_FILENO) == -1) {
-            perror("Ошибка перенаправления ввода");
-            close(fd);
-            return -1;
-        }
-        close(fd);
     }
     
     // Перенаправление вывода
     if (cmd->output_file) {
-        int fd = open(cmd->output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-        if (fd == -1) {
-            perror("Ошибка открытия файла вывода");
-            return -1;
-        }
-        if (dup2(fd, STDOUT_FILENO) == -1) {
-            perror("Ошибка перенаправления вывода");
-            close(fd);
+        if (redirect_fd(io, cmd->output_file, O_WRONLY | O_CREAT | O_TRUNC, cmd->output_fd) != 0) {
             return -1;
         }
-        close(fd);
     }
     
     return 0;
@@ -190,19 +929,26 @@ int setup_redirections(command_t *cmd) {
 
 /**
  * @brief Восстановление стандартного ввода/вывода
+ * @param io Звено из setup_redirections()
  */
-void restore_stdio(void) {
-    if (original_stdin != -1) {
-        dup2(original_stdin, STDIN_FILENO);
-        close(original_stdin);
-        original_stdin = -1;
+void restore_stdio(shell_io_t *io) {
+    if (keep_redirections) {
+        // "exec 3>file": дескрипторы звена становятся дескрипторами процесса
+        keep_redirections = 0;
+        shell_io_flush();
+        for (int i = 0; i < io->count; i++) {
+            counted_dup2(io->fds[i], io->targets[i]);
+        }
     }
     
-    if (original_stdout != -1) {
-        dup2(original_stdout, STDOUT_FILENO);
-        close(original_stdout);
-        original_stdout = -1;
-    }
+    shell_io_pop(io);
+}
+
+/**
+ * @brief Сохранение текущих перенаправлений после выполнения команды
+ */
+void executor_keep_redirections(void) {
+    keep_redirections = 1;
 }
 
 /**
@@ -212,7 +958,16 @@ void wait_for_background(void) {
     int status;
     pid_t pid;
     
+    // waitpid(-1) забрал бы процессы встраивающей программы и других контекстов
+    shell_state_t *state = shell_current();
+    if (state && state->embedded) {
+        return;
+    }
+    
     while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (jobs_process_finished(pid, status) == 0) {
+            continue;
+        }
         if (WIFEXITED(status)) {
             printf("[%d] Завершен с кодом %d\n", pid, WEXITSTATUS(status));
         } else if (WIFSIGNALED(status)) {
@@ -226,4 +981,5 @@ void wait_for_background(void) {
  */
 void check_background_status(void) {
     wait_for_background();
+    jobs_notify();
 }
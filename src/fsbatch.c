@@ -0,0 +1,496 @@
+/**
+ * @file fsbatch.c
+ * @brief Реализация пакетных файловых операций (io_uring и синхронный запасной путь)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "fsbatch.h"
+#include "jobs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_IO_URING
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+/**
+ * @def FSBATCH_MIN_COUNT
+ * @brief Минимальное количество путей, при котором имеет смысл создавать кольцо
+ */
+#define FSBATCH_MIN_COUNT 16
+
+/**
+ * @def FSBATCH_QUEUE_DEPTH
+ * @brief Максимальное количество одновременно выполняемых операций
+ */
+#define FSBATCH_QUEUE_DEPTH 128
+
+/**
+ * @brief Проверка, не отключён ли io_uring переменной окружения
+ * @return Ненулевое значение если io_uring разрешён
+ */
+static int fsbatch_uring_allowed(void) {
+    const char *value = get_env_var("CUSTOM_SHELL_IO_URING");
+    return !value || strcmp(value, "0") != 0;
+}
+
+/**
+ * @brief Синхронное выполнение операции над одним путём
+ * @param op Операция
+ * @param dirfd Каталог для относительных путей
+ * @param path Путь
+ * @param mode Права для создаваемых объектов
+ * @param stx Результат statx или NULL
+ * @return 0 в случае успеха, иначе значение errno
+ */
+static int fsbatch_one(fsbatch_op_t op, int dirfd, const char *path, mode_t mode,
+                       struct statx *stx) {
+    int result = -1;
+
+    switch (op) {
+        case FSBATCH_UNLINK:
+            result = unlinkat(dirfd, path, 0);
+            break;
+        case FSBATCH_MKDIR:
+            result = mkdirat(dirfd, path, mode);
+            break;
+        case FSBATCH_CREATE:
+            result = openat(dirfd, path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, mode);
+            if (result != -1) {
+                close(result);
+                result = 0;
+            }
+            break;
+        case FSBATCH_STATX:
+            result = statx(dirfd, path, 0, STATX_BASIC_STATS, stx);
+            break;
+    }
+
+    return result == 0 ? 0 : errno;
+}
+
+/**
+ * @brief Синхронное выполнение пакета
+ * @return Количество успешно обработанных путей
+ */
+static int fsbatch_run_sync(fsbatch_op_t op, int dirfd, char *const *paths, int count,
+                            mode_t mode, int *errors, struct statx *stx) {
+    int success_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        // Прерванная фоновая задача оставляет оставшиеся пути нетронутыми
+        errors[i] = task_cancelled()
+            ? ECANCELED
+            : fsbatch_one(op, dirfd, paths[i], mode, stx ? &stx[i] : NULL);
+        if (errors[i] == 0) {
+            success_count++;
+        }
+    }
+
+    return success_count;
+}
+
+#ifdef HAVE_IO_URING
+
+/**
+ * @def FSBATCH_CLOSE_TAG
+ * @brief Признак операции close в user_data (после openat для touch)
+ */
+#define FSBATCH_CLOSE_TAG (1ULL << 32)
+
+/**
+ * @struct fsbatch_ring_t
+ * @brief Отображённое в память кольцо io_uring
+ */
+typedef struct {
+    int fd;                         /**< Дескриптор кольца */
+    void *sq_ptr;                   /**< Отображение очереди отправки */
+    void *cq_ptr;                   /**< Отображение очереди завершения */
+    size_t sq_size;                 /**< Размер отображения SQ */
+    size_t cq_size;                 /**< Размер отображения CQ */
+    struct io_uring_sqe *sqes;      /**< Массив SQE */
+    size_t sqes_size;               /**< Размер массива SQE */
+    unsigned *sq_tail;              /**< Хвост SQ */
+    unsigned *sq_mask;              /**< Маска SQ */
+    unsigned *sq_array;             /**< Индексы SQE */
+    unsigned *cq_head;              /**< Голова CQ */
+    unsigned *cq_tail;              /**< Хвост CQ */
+    unsigned *cq_mask;              /**< Маска CQ */
+    struct io_uring_cqe *cqes;      /**< Массив CQE */
+    unsigned entries;               /**< Размер SQ */
+    unsigned local_tail;            /**< Хвост SQ с ещё не опубликованными SQE */
+} fsbatch_ring_t;
+
+/**
+ * @brief Освобождение кольца
+ * @param ring Кольцо
+ */
+static void fsbatch_ring_close(fsbatch_ring_t *ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    if (ring->sq_ptr) {
+        munmap(ring->sq_ptr, ring->sq_size);
+    }
+    if (ring->fd != -1) {
+        close(ring->fd);
+    }
+}
+
+/**
+ * @brief Проверка поддержки кода операции ядром
+ * @param fd Дескриптор кольца
+ * @param opcode Код операции
+ * @return Ненулевое значение если операция поддерживается
+ */
+static int fsbatch_probe(int fd, unsigned opcode) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    if (!probe) {
+        return 0;
+    }
+
+    int supported = 0;
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        supported = opcode <= probe->last_op &&
+                    (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    free(probe);
+    return supported;
+}
+
+/**
+ * @brief Создание кольца и проверка поддержки нужных операций
+ * @param ring Кольцо для заполнения
+ * @param opcode Основная операция пакета
+ * @return 0 в случае успеха, -1 если io_uring использовать нельзя
+ */
+static int fsbatch_ring_open(fsbatch_ring_t *ring, unsigned opcode) {
+    memset(ring, 0, sizeof(*ring));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, FSBATCH_QUEUE_DEPTH, &params);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return -1;
+    }
+
+    if (!fsbatch_probe(ring->fd, opcode) ||
+        (opcode == IORING_OP_OPENAT && !fsbatch_probe(ring->fd, IORING_OP_CLOSE))) {
+        fsbatch_ring_close(ring);
+        return -1;
+    }
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        if (ring->cq_size > ring->sq_size) {
+            ring->sq_size = ring->cq_size;
+        }
+        ring->cq_size = ring->sq_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        ring->sq_ptr = NULL;
+        fsbatch_ring_close(ring);
+        return -1;
+    }
+
+    if (single_mmap) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            ring->cq_ptr = NULL;
+            fsbatch_ring_close(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        fsbatch_ring_close(ring);
+        return -1;
+    }
+
+    char *sq = ring->sq_ptr;
+    char *cq = ring->cq_ptr;
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->entries = params.sq_entries;
+    ring->local_tail = *ring->sq_tail;
+
+    return 0;
+}
+
+/**
+ * @brief Получение свободного SQE (вызывающий следит за глубиной очереди)
+ * @param ring Кольцо
+ * @return Обнулённый SQE
+ */
+static struct io_uring_sqe *fsbatch_get_sqe(fsbatch_ring_t *ring) {
+    unsigned index = ring->local_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->local_tail++;
+    return sqe;
+}
+
+/**
+ * @brief Публикация заполненных SQE и ожидание хотя бы одного завершения
+ * @param ring Кольцо
+ * @param to_submit Количество ещё не принятых ядром SQE
+ * @return Количество принятых SQE или -1 в случае ошибки
+ */
+static int fsbatch_submit_and_wait(fsbatch_ring_t *ring, unsigned to_submit) {
+    // Ядро увидит SQE только после публикации нового хвоста
+    __atomic_store_n(ring->sq_tail, ring->local_tail, __ATOMIC_RELEASE);
+    return (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, 1,
+                        IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+/**
+ * @brief Заполнение SQE основной операции пакета
+ * @param sqe SQE
+ * @param op Операция
+ * @param dirfd Каталог для относительных путей
+ * @param path Путь
+ * @param mode Права для создаваемых объектов
+ * @param stx Буфер statx или NULL
+ */
+static void fsbatch_prep(struct io_uring_sqe *sqe, fsbatch_op_t op, int dirfd,
+                         const char *path, mode_t mode, struct statx *stx) {
+    sqe->fd = dirfd;
+    sqe->addr = (uint64_t)(uintptr_t)path;
+
+    switch (op) {
+        case FSBATCH_UNLINK:
+            sqe->opcode = IORING_OP_UNLINKAT;
+            break;
+        case FSBATCH_MKDIR:
+            sqe->opcode = IORING_OP_MKDIRAT;
+            sqe->len = mode;
+            // Вложенный путь может зависеть от ранее созданных каталогов
+            if (strchr(path, '/')) {
+                sqe->flags |= IOSQE_IO_DRAIN;
+            }
+            break;
+        case FSBATCH_CREATE:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->len = mode;
+            sqe->open_flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+            break;
+        case FSBATCH_STATX:
+            sqe->opcode = IORING_OP_STATX;
+            sqe->len = STATX_BASIC_STATS;
+            sqe->off = (uint64_t)(uintptr_t)stx;
+            break;
+    }
+}
+
+/**
+ * @brief Код операции io_uring для пакетной операции
+ * @param op Операция
+ * @return Код IORING_OP_*
+ */
+static unsigned fsbatch_opcode(fsbatch_op_t op) {
+    switch (op) {
+        case FSBATCH_UNLINK:
+            return IORING_OP_UNLINKAT;
+        case FSBATCH_MKDIR:
+            return IORING_OP_MKDIRAT;
+        case FSBATCH_CREATE:
+            return IORING_OP_OPENAT;
+        case FSBATCH_STATX:
+            return IORING_OP_STATX;
+    }
+    return IORING_OP_NOP;
+}
+
+/**
+ * @brief Выполнение пакета через io_uring
+ * @return Количество успешно обработанных путей или -1, если кольцо недоступно
+ */
+static int fsbatch_run_uring(fsbatch_op_t op, int dirfd, char *const *paths, int count,
+                             mode_t mode, int *errors, struct statx *stx) {
+    fsbatch_ring_t ring;
+    if (fsbatch_ring_open(&ring, fsbatch_opcode(op)) != 0) {
+        return -1;
+    }
+
+    int next = 0;
+    int inflight = 0;
+    int pending_close = 0;
+    int success_count = 0;
+    unsigned to_submit = 0;
+    int *close_fds = NULL;
+
+    // -1 - путь ещё не обработан
+    for (int i = 0; i < count; i++) {
+        errors[i] = -1;
+    }
+
+    if (op == FSBATCH_CREATE) {
+        // Дескрипторы, открытые openat, закрываются через то же кольцо
+        close_fds = malloc((size_t)count * sizeof(int));
+        if (!close_fds) {
+            fsbatch_ring_close(&ring);
+            return -1;
+        }
+    }
+
+    while (next < count || inflight > 0) {
+        // Сначала закрытия, затем новые пути, не превышая глубину очереди
+        while (pending_close > 0 && inflight < (int)ring.entries) {
+            int fd = close_fds[--pending_close];
+            struct io_uring_sqe *sqe = fsbatch_get_sqe(&ring);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = fd;
+            sqe->user_data = FSBATCH_CLOSE_TAG;
+            inflight++;
+            to_submit++;
+        }
+        while (next < count && task_cancelled()) {
+            errors[next++] = ECANCELED;
+        }
+        while (next < count && inflight < (int)ring.entries) {
+            struct io_uring_sqe *sqe = fsbatch_get_sqe(&ring);
+            fsbatch_prep(sqe, op, dirfd, paths[next], mode, stx ? &stx[next] : NULL);
+            sqe->user_data = (uint64_t)next;
+            next++;
+            inflight++;
+            to_submit++;
+        }
+
+        int ret = fsbatch_submit_and_wait(&ring, to_submit);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+
+        // Разбор завершённых операций
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            inflight--;
+
+            if (!(cqe->user_data & FSBATCH_CLOSE_TAG)) {
+                int index = (int)cqe->user_data;
+                errors[index] = cqe->res < 0 ? -cqe->res : 0;
+                if (cqe->res >= 0) {
+                    success_count++;
+                    if (op == FSBATCH_CREATE) {
+                        close_fds[pending_close++] = cqe->res;
+                    }
+                }
+            }
+            head++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // Аварийный выход из цикла: необработанные пути выполняются синхронно
+    if (next < count || inflight > 0) {
+        for (int i = 0; i < count; i++) {
+            if (errors[i] == -1) {
+                errors[i] = fsbatch_one(op, dirfd, paths[i], mode, stx ? &stx[i] : NULL);
+                success_count += errors[i] == 0;
+            }
+        }
+    }
+    while (pending_close > 0) {
+        close(close_fds[--pending_close]);
+    }
+
+    free(close_fds);
+    fsbatch_ring_close(&ring);
+    return success_count;
+}
+
+#endif /* HAVE_IO_URING */
+
+/**
+ * @brief Выполнение операции над набором путей
+ * @param op Операция
+ * @param dirfd Каталог для относительных путей (AT_FDCWD - текущий)
+ * @param paths Пути
+ * @param count Количество путей
+ * @param mode Права для FSBATCH_MKDIR и FSBATCH_CREATE
+ * @param errors Массив из count элементов: 0 или значение errno для каждого пути
+ * @param stx Массив из count элементов для FSBATCH_STATX, иначе NULL
+ * @return Количество успешно обработанных путей
+ */
+int fsbatch_run(fsbatch_op_t op, int dirfd, char *const *paths, int count,
+                mode_t mode, int *errors, struct statx *stx) {
+    if (!paths || !errors || count <= 0 || (op == FSBATCH_STATX && !stx)) {
+        return 0;
+    }
+
+#ifdef HAVE_IO_URING
+    if (count >= FSBATCH_MIN_COUNT && fsbatch_uring_allowed()) {
+        int success_count = fsbatch_run_uring(op, dirfd, paths, count, mode, errors, stx);
+        if (success_count >= 0) {
+            return success_count;
+        }
+    }
+#endif
+
+    return fsbatch_run_sync(op, dirfd, paths, count, mode, errors, stx);
+}
+
+/**
+ * @brief Название механизма, которым будет выполнен пакет из count путей
+ * @param count Количество путей
+ * @return "io_uring" или "sync"
+ */
+const char *fsbatch_backend(int count) {
+#ifdef HAVE_IO_URING
+    if (count >= FSBATCH_MIN_COUNT && fsbatch_uring_allowed()) {
+        fsbatch_ring_t ring;
+        if (fsbatch_ring_open(&ring, IORING_OP_UNLINKAT) == 0) {
+            fsbatch_ring_close(&ring);
+            return "io_uring";
+        }
+    }
+#else
+    (void)count;
+#endif
+    return "sync";
+}
@@ -0,0 +1,329 @@
+/**
+ * @file hooks.c
+ * @brief Реализация хуков preexec и precmd
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "hooks.h"
+#include "builtins.h"
+#include "parser.h"
+#include "executor.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @struct hook_entry_t
+ * @brief Установленный хук в предварительно разобранном виде
+ */
+typedef struct hook_entry {
+    char *text;                 /**< Исходный текст тела (для вывода hook) */
+    command_t *commands;        /**< Разобранные команды тела */
+    int count;                  /**< Количество команд */
+    struct hook_entry *retired; /**< Следующее тело, удалённое во время выполнения */
+} hook_entry_t;
+
+/**
+ * @struct hook_table
+ * @brief Хуки состояния оболочки
+ */
+struct hook_table {
+    hook_entry_t *entries[HOOK_POINTS][HOOK_MAX];  /**< Тела по точкам */
+    int counts[HOOK_POINTS];                       /**< Количество тел */
+    int running;                                   /**< Выполняются хуки (защита от рекурсии) */
+    hook_entry_t *retired;                         /**< Тела, удалённые во время выполнения */
+};
+
+static const char *const hook_names[HOOK_POINTS] = {
+    [HOOK_PREEXEC] = "preexec",
+    [HOOK_PRECMD] = "precmd",
+};
+
+/**
+ * @brief Освобождение тела хука
+ * @param entry Тело
+ */
+static void hook_entry_free(hook_entry_t *entry) {
+    if (entry->commands) {
+        free_commands(entry->commands, entry->count);
+        free(entry->commands);
+    }
+    free(entry->text);
+    free(entry);
+}
+
+/**
+ * @brief Удаление тела (отложенное, если хуки выполняются)
+ * @param table Хуки
+ * @param entry Тело
+ */
+static void hook_entry_release(hook_table_t *table, hook_entry_t *entry) {
+    if (table->running) {
+        entry->retired = table->retired;
+        table->retired = entry;
+    } else {
+        hook_entry_free(entry);
+    }
+}
+
+/**
+ * @brief Обновление маски установленных хуков
+ * @param state Состояние оболочки
+ * @param point Точка
+ */
+static void hook_update_mask(shell_state_t *state, hook_point_t point) {
+    if (state->hooks->counts[point] > 0) {
+        state->hook_mask |= 1u << point;
+    } else {
+        state->hook_mask &= ~(1u << point);
+    }
+}
+
+/**
+ * @brief Добавление тела хука
+ * @param state Состояние оболочки
+ * @param point Точка
+ * @param body Тело
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int hook_add(shell_state_t *state, hook_point_t point, const char *body) {
+    if (!state->hooks) {
+        state->hooks = calloc(1, sizeof(*state->hooks));
+        if (!state->hooks) {
+            return -1;
+        }
+    }
+    hook_table_t *table = state->hooks;
+    if (table->counts[point] == HOOK_MAX) {
+        fprintf(shell_stderr(), "hook: не больше %d хуков %s\n", HOOK_MAX, hook_names[point]);
+        return -1;
+    }
+
+    // Тело разбирается один раз; при вызове выполняются готовые команды
+    hook_entry_t *entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        return -1;
+    }
+    entry->text = strdup(body);
+    entry->commands = malloc(MAX_ARGS * sizeof(command_t));
+    if (!entry->text || !entry->commands) {
+        hook_entry_free(entry);
+        return -1;
+    }
+    entry->count = parse_input(body, entry->commands, MAX_ARGS);
+    if (entry->count <= 0) {
+        fprintf(shell_stderr(), "hook: пустое тело хука\n");
+        hook_entry_free(entry);
+        return -1;
+    }
+
+    table->entries[point][table->counts[point]++] = entry;
+    hook_update_mask(state, point);
+    return 0;
+}
+
+/**
+ * @brief Удаление всех тел точки
+ * @param state Состояние оболочки
+ * @param point Точка
+ */
+static void hook_remove(shell_state_t *state, hook_point_t point) {
+    hook_table_t *table = state->hooks;
+    if (!table) {
+        return;
+    }
+    for (int i = 0; i < table->counts[point]; i++) {
+        hook_entry_release(table, table->entries[point][i]);
+        table->entries[point][i] = NULL;
+    }
+    table->counts[point] = 0;
+    hook_update_mask(state, point);
+}
+
+/**
+ * @brief Удаление всех хуков (при выходе)
+ * @param state Состояние оболочки
+ */
+void hook_clear_all(shell_state_t *state) {
+    if (!state->hooks) {
+        return;
+    }
+    for (int point = 0; point < HOOK_POINTS; point++) {
+        hook_remove(state, (hook_point_t)point);
+    }
+    free(state->hooks);
+    state->hooks = NULL;
+}
+
+/**
+ * @brief Обход установленных хуков (для образа сессии)
+ * @param state Состояние оболочки
+ * @param visit Функция обхода
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit (0 если обход завершён)
+ */
+int hook_foreach(shell_state_t *state, hook_visit_fn visit, void *arg) {
+    if (!state->hooks) {
+        return 0;
+    }
+    for (int point = 0; point < HOOK_POINTS; point++) {
+        for (int i = 0; i < state->hooks->counts[point]; i++) {
+            int result = visit((hook_point_t)point, state->hooks->entries[point][i]->text, arg);
+            if (result != 0) {
+                return result;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Выполнение хуков точки
+ * @param state Состояние оболочки
+ * @param point Точка
+ * @param line Строка ввода (для preexec) или NULL
+ */
+void hook_run(shell_state_t *state, hook_point_t point, const char *line) {
+    hook_table_t *table = state->hooks;
+    if (!table || table->running || table->counts[point] == 0) {
+        return;
+    }
+    table->running = 1;
+
+    // Строка ввода видна только командам хука: прежнее значение возвращается после них
+    char *saved_command = NULL;
+    int had_command = 0;
+    if (line) {
+        const char *previous = get_env_var(HOOK_COMMAND_VAR);
+        had_command = previous != NULL;
+        saved_command = previous ? strdup(previous) : NULL;
+        set_env_var(HOOK_COMMAND_VAR, line);
+    }
+
+    // Хук может изменить список хуков: выполняется снимок на момент вызова
+    hook_entry_t *snapshot[HOOK_MAX];
+    int count = table->counts[point];
+    memcpy(snapshot, table->entries[point], (size_t)count * sizeof(*snapshot));
+
+    int exit_code = state->exit_code;
+    for (int h = 0; h < count && !state->should_exit; h++) {
+        command_t *commands = snapshot[h]->commands;
+        int total = snapshot[h]->count;
+        for (int i = 0; i < total; i++) {
+            int stages = pipeline_length(&commands[i], total - i);
+            if (stages > 1 || commands[i].name || commands[i].assign_count > 0) {
+                execute_pipeline(&commands[i], stages);
+            }
+            i += stages - 1;
+        }
+    }
+    state->exit_code = exit_code;
+
+    if (line) {
+        if (saved_command) {
+            set_env_var(HOOK_COMMAND_VAR, saved_command);
+        } else if (!had_command) {
+            unsetenv(HOOK_COMMAND_VAR);
+        }
+        free(saved_command);
+    }
+
+    table->running = 0;
+    while (table->retired) {
+        hook_entry_t *next = table->retired->retired;
+        hook_entry_free(table->retired);
+        table->retired = next;
+    }
+}
+
+/**
+ * @brief Разбор имени точки
+ * @param name Имя
+ * @return Точка или -1, если имя неизвестно
+ */
+static int hook_parse_point(const char *name) {
+    for (int point = 0; point < HOOK_POINTS; point++) {
+        if (strcmp(name, hook_names[point]) == 0) {
+            return point;
+        }
+    }
+    fprintf(shell_stderr(), "hook: неизвестная точка: %s (preexec или precmd)\n", name);
+    return -1;
+}
+
+/**
+ * @brief Вывод хука в формате hook (функция обхода)
+ * @param point Точка
+ * @param body Тело
+ * @param arg Не используется
+ * @return 0
+ */
+static int hook_print(hook_point_t point, const char *body, void *arg) {
+    (void)arg;
+    fprintf(shell_stdout(), "hook %s '", hook_names[point]);
+    // Одинарная кавычка тела записывается как '\'', чтобы вывод читался обратно
+    for (const char *p = body; *p; p++) {
+        if (*p == '\'') {
+            fputs("'\\''", shell_stdout());
+        } else {
+            fputc(*p, shell_stdout());
+        }
+    }
+    fputs("'\n", shell_stdout());
+    return 0;
+}
+
+/**
+ * @brief Встроенная команда hook
+ * @param args Аргументы
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_hook(char **args, int argc) {
+    shell_state_t *state = shell_current();
+    if (!state) {
+        return -1;
+    }
+    if (argc == 1) {
+        hook_foreach(state, hook_print, NULL);
+        return 0;
+    }
+
+    // Хуки вызывает основной цикл процесса, а не встроенный контекст
+    if (state->embedded) {
+        fprintf(shell_stderr(), "hook: недоступно во встроенном контексте\n");
+        return -1;
+    }
+
+    if (strcmp(args[1], "-r") == 0) {
+        if (argc != 3) {
+            fprintf(shell_stderr(), "Использование: hook -r preexec|precmd\n");
+            return -1;
+        }
+        int point = hook_parse_point(args[2]);
+        if (point == -1) {
+            return -1;
+        }
+        hook_remove(state, (hook_point_t)point);
+        return 0;
+    }
+
+    if (argc < 3) {
+        fprintf(shell_stderr(), "Использование: hook [preexec|precmd тело | -r preexec|precmd]\n");
+        return -1;
+    }
+    int point = hook_parse_point(args[1]);
+    if (point == -1) {
+        return -1;
+    }
+
+    // Парсер разбивает тело по пробелам, поэтому собираем его обратно
+    char body[MAX_INPUT_SIZE];
+    join_words(args, 2, argc, 0, body, sizeof(body));
+
+    return hook_add(state, (hook_point_t)point, body);
+}
@@ -0,0 +1,810 @@
+/**
+ * @file image.c
+ * @brief Реализация образа сессии для быстрого запуска
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "image.h"
+#include "cmdhash.h"
+#include "hooks.h"
+#include "alias.h"
+#include "signals.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+extern char **environ;
+
+/**
+ * @enum image_section_type_t
+ * @brief Типы разделов образа
+ */
+typedef enum {
+    IMAGE_SECTION_STRINGS = 1,  /**< Строки, завершённые нулём */
+    IMAGE_SECTION_FILES,        /**< Выполненные файлы (image_file_t) */
+    IMAGE_SECTION_VARS,         /**< Переменные (image_var_t) */
+    IMAGE_SECTION_COMMANDS,     /**< Пути команд (image_command_t) */
+    IMAGE_SECTION_HOOKS,        /**< Хуки (image_hook_t) */
+    IMAGE_SECTION_ALIASES,      /**< Псевдонимы (image_alias_t) */
+    IMAGE_SECTION_TRAPS,        /**< Ловушки (image_trap_t) */
+    IMAGE_SECTION_UNSETS,       /**< Удалённые переменные (image_unset_t) */
+    IMAGE_SECTION_COUNT         /**< Количество типов + 1 */
+} image_section_type_t;
+
+/**
+ * @struct image_section_t
+ * @brief Описание раздела в заголовке
+ */
+typedef struct {
+    uint32_t type;    /**< Тип раздела */
+    uint32_t count;   /**< Количество записей */
+    uint64_t offset;  /**< Смещение от начала образа (кратно 8) */
+    uint64_t size;    /**< Размер в байтах */
+} image_section_t;
+
+/**
+ * @struct image_header_t
+ * @brief Заголовок образа
+ */
+typedef struct {
+    char magic[8];                                       /**< IMAGE_MAGIC */
+    uint32_t version;                                    /**< IMAGE_VERSION */
+    uint32_t section_count;                              /**< Количество разделов */
+    uint64_t image_size;                                 /**< Полный размер файла */
+    char build_id[IMAGE_BUILD_ID_MAX];                   /**< Build ID исполняемого файла */
+    image_section_t sections[IMAGE_SECTION_COUNT - 1];   /**< Разделы */
+} image_header_t;
+
+/**
+ * @struct image_file_t
+ * @brief Выполненный файл и его состояние на момент создания образа
+ */
+typedef struct {
+    uint32_t path;        /**< Смещение пути в строках */
+    uint32_t exists;      /**< Файл существовал */
+    int64_t size;         /**< Размер */
+    int64_t mtime_sec;    /**< Время изменения, секунды */
+    int64_t mtime_nsec;   /**< Время изменения, наносекунды */
+} image_file_t;
+
+/**
+ * @struct image_var_t
+ * @brief Переменная
+ */
+typedef struct {
+    uint32_t name;   /**< Смещение имени в строках */
+    uint32_t value;  /**< Смещение значения в строках */
+} image_var_t;
+
+/**
+ * @struct image_command_t
+ * @brief Запомненный путь команды
+ */
+typedef struct {
+    uint32_t name;      /**< Смещение имени команды */
+    uint32_t path_env;  /**< Смещение значения PATH */
+    uint32_t resolved;  /**< Смещение найденного пути */
+    uint32_t reserved;  /**< Выравнивание */
+} image_command_t;
+
+/**
+ * @struct image_hook_t
+ * @brief Хук preexec или precmd
+ */
+typedef struct {
+    uint32_t point;  /**< Точка (hook_point_t) */
+    uint32_t body;   /**< Смещение тела в строках */
+} image_hook_t;
+
+/**
+ * @struct image_alias_t
+ * @brief Псевдоним
+ */
+typedef struct {
+    uint32_t name;   /**< Смещение имени в строках */
+    uint32_t text;   /**< Смещение тела в строках */
+} image_alias_t;
+
+/**
+ * @struct image_trap_t
+ * @brief Ловушка
+ */
+typedef struct {
+    uint32_t slot;   /**< Номер ячейки (сигнал или TRAP_EXIT/TRAP_ERR/TRAP_DEBUG) */
+    uint32_t body;   /**< Смещение тела в строках; пустое тело - игнорирование */
+} image_trap_t;
+
+/**
+ * @struct image_unset_t
+ * @brief Переменная, удалённая файлом настроек
+ */
+typedef struct {
+    uint32_t name;   /**< Смещение имени в строках */
+} image_unset_t;
+
+/**
+ * @struct image_buffer_t
+ * @brief Растущий буфер для сборки раздела
+ */
+typedef struct {
+    char *data;       /**< Данные */
+    size_t length;    /**< Длина данных */
+    size_t capacity;  /**< Размер буфера */
+} image_buffer_t;
+
+static const char IMAGE_MAGIC[8] = { 'C', 'S', 'H', 'I', 'M', 'G', '\0', '\1' };
+
+// Состояние, накопленное с image_begin() до image_dump()
+static char **tracked_files = NULL;
+static int tracked_count = 0;
+static char **initial_environ = NULL;
+static int initial_count = 0;
+
+/**
+ * @brief Добавление данных в буфер
+ * @param buffer Буфер
+ * @param data Данные
+ * @param size Размер данных
+ * @return Смещение добавленных данных или -1 в случае ошибки
+ */
+static long image_buffer_append(image_buffer_t *buffer, const void *data, size_t size) {
+    if (buffer->length + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (capacity < buffer->length + size) {
+            capacity *= 2;
+        }
+        char *grown = realloc(buffer->data, capacity);
+        if (!grown) {
+            return -1;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    long offset = (long)buffer->length;
+    memcpy(buffer->data + buffer->length, data, size);
+    buffer->length += size;
+    return offset;
+}
+
+/**
+ * @brief Добавление строки в раздел строк
+ * @param strings Раздел строк
+ * @param text Строка
+ * @param offset Указатель для смещения строки
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int image_add_string(image_buffer_t *strings, const char *text, uint32_t *offset) {
+    long at = image_buffer_append(strings, text, strlen(text) + 1);
+    if (at < 0 || (uint64_t)at > UINT32_MAX) {
+        return -1;
+    }
+    *offset = (uint32_t)at;
+    return 0;
+}
+
+/**
+ * @brief Поиск build ID объекта, содержащего код оболочки
+ * @param info Описание загруженного объекта
+ * @param size Размер описания
+ * @param arg Буфер для build ID (IMAGE_BUILD_ID_MAX байт)
+ * @return 1 если объект найден, 0 для продолжения обхода
+ */
+static int image_build_id_visit(struct dl_phdr_info *info, size_t size, void *arg) {
+    (void)size;
+    char *out = arg;
+    uintptr_t self = (uintptr_t)&image_build_id_visit;
+    int contains = 0;
+
+    // Код может находиться в custom_shell или в разделяемой libcustomshell
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+        if (ph->p_type == PT_LOAD && self >= start && self < start + ph->p_memsz) {
+            contains = 1;
+        }
+    }
+    if (!contains) {
+        return 0;
+    }
+
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        if (ph->p_type != PT_NOTE) {
+            continue;
+        }
+
+        const char *p = (const char *)(info->dlpi_addr + ph->p_vaddr);
+        const char *end = p + ph->p_memsz;
+        while (p + sizeof(ElfW(Nhdr)) <= end) {
+            const ElfW(Nhdr) *note = (const ElfW(Nhdr) *)p;
+            const char *name = p + sizeof(ElfW(Nhdr));
+            const unsigned char *desc = (const unsigned char *)name + ((note->n_namesz + 3) & ~3u);
+
+            if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 &&
+                memcmp(name, "GNU", 4) == 0 && note->n_descsz * 2 < IMAGE_BUILD_ID_MAX) {
+                for (unsigned j = 0; j < note->n_descsz; j++) {
+                    sprintf(out + j * 2, "%02x", desc[j]);
+                }
+                return 1;
+            }
+            p = (const char *)desc + ((note->n_descsz + 3) & ~3u);
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Build ID исполняемого кода оболочки
+ * @return Шестнадцатеричная строка
+ *
+ * @details Без заметки NT_GNU_BUILD_ID (сборка с --build-id=none)
+ * используются размер и время изменения исполняемого файла.
+ */
+static const char *image_build_id(void) {
+    static char build_id[IMAGE_BUILD_ID_MAX];
+
+    if (build_id[0] == '\0') {
+        dl_iterate_phdr(image_build_id_visit, build_id);
+    }
+    if (build_id[0] == '\0') {
+        struct stat st;
+        if (stat("/proc/self/exe", &st) == 0) {
+            snprintf(build_id, sizeof(build_id), "exe-%llx-%llx.%09ld",
+                     (unsigned long long)st.st_size, (unsigned long long)st.st_mtim.tv_sec,
+                     st.st_mtim.tv_nsec);
+        }
+    }
+
+    return build_id;
+}
+
+/**
+ * @brief Путь к образу сессии
+ * @return Путь (освобождается free()) или NULL
+ */
+char *image_default_path(void) {
+    const char *path = getenv("CUSTOM_SHELL_IMAGE");
+    if (path && *path) {
+        return strdup(path);
+    }
+
+    const char *home = getenv("HOME");
+    if (!home) {
+        return NULL;
+    }
+
+    char *result = malloc(strlen(home) + strlen(IMAGE_FILE_NAME) + 1);
+    if (result) {
+        strcpy(result, home);
+        strcat(result, IMAGE_FILE_NAME);
+    }
+    return result;
+}
+
+/**
+ * @brief Начало записи состояния для образа
+ */
+void image_begin(void) {
+    // Повторный вызов начинает запись заново
+    free_string_array(initial_environ, initial_count);
+    free_string_array(tracked_files, tracked_count);
+    initial_environ = NULL;
+    initial_count = 0;
+    tracked_files = NULL;
+    tracked_count = 0;
+
+    int count = 0;
+    while (environ && environ[count]) {
+        count++;
+    }
+
+    initial_environ = calloc((size_t)count + 1, sizeof(char *));
+    if (!initial_environ) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        initial_environ[i] = strdup(environ[i]);
+    }
+    initial_count = count;
+}
+
+/**
+ * @brief Регистрация выполненного файла
+ * @param path Путь к файлу
+ */
+void image_track_file(const char *path) {
+    if (!initial_environ || !path) {
+        return;
+    }
+
+    for (int i = 0; i < tracked_count; i++) {
+        if (strcmp(tracked_files[i], path) == 0) {
+            return;
+        }
+    }
+
+    char **grown = realloc(tracked_files, (size_t)(tracked_count + 1) * sizeof(char *));
+    if (!grown) {
+        return;
+    }
+    tracked_files = grown;
+
+    // Относительный путь проверялся бы от другого каталога
+    char *copy = realpath(path, NULL);
+    if (!copy) {
+        copy = strdup(path);
+    }
+    if (copy) {
+        tracked_files[tracked_count++] = copy;
+    }
+}
+
+/**
+ * @brief Проверка, была ли переменная в окружении до image_begin()
+ * @param entry Строка вида NAME=value
+ * @return 1 если строка не изменилась
+ */
+static int image_var_unchanged(const char *entry) {
+    for (int i = 0; i < initial_count; i++) {
+        if (initial_environ[i] && strcmp(initial_environ[i], entry) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @struct image_dump_state_t
+ * @brief Разделы, собираемые при создании образа
+ */
+typedef struct {
+    image_buffer_t strings;   /**< Раздел строк */
+    image_buffer_t files;     /**< Раздел файлов */
+    image_buffer_t vars;      /**< Раздел переменных */
+    image_buffer_t commands;  /**< Раздел путей команд */
+    image_buffer_t hooks;     /**< Раздел хуков */
+    image_buffer_t aliases;   /**< Раздел псевдонимов */
+    image_buffer_t traps;     /**< Раздел ловушек */
+    image_buffer_t unsets;    /**< Раздел удалённых переменных */
+} image_dump_state_t;
+
+/**
+ * @brief Добавление пути команды в образ (функция обхода cmdhash)
+ * @param name Имя команды
+ * @param path_env Значение PATH
+ * @param resolved Найденный путь
+ * @param arg Состояние сборки образа
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int image_add_command(const char *name, const char *path_env, const char *resolved, void *arg) {
+    image_dump_state_t *dump = arg;
+    image_command_t record = { 0, 0, 0, 0 };
+
+    if (image_add_string(&dump->strings, name, &record.name) != 0 ||
+        image_add_string(&dump->strings, path_env, &record.path_env) != 0 ||
+        image_add_string(&dump->strings, resolved, &record.resolved) != 0 ||
+        image_buffer_append(&dump->commands, &record, sizeof(record)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Добавление хука в образ (функция обхода hook_foreach)
+ * @param point Точка
+ * @param body Тело
+ * @param arg Состояние сборки образа
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int image_add_hook(hook_point_t point, const char *body, void *arg) {
+    image_dump_state_t *dump = arg;
+    image_hook_t record = { (uint32_t)point, 0 };
+
+    if (image_add_string(&dump->strings, body, &record.body) != 0 ||
+        image_buffer_append(&dump->hooks, &record, sizeof(record)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Добавление псевдонима в образ (функция обхода alias_foreach)
+ * @param name Имя
+ * @param text Тело
+ * @param arg Состояние сборки образа
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int image_add_alias(const char *name, const char *text, void *arg) {
+    image_dump_state_t *dump = arg;
+    image_alias_t record = { 0, 0 };
+
+    if (image_add_string(&dump->strings, name, &record.name) != 0 ||
+        image_add_string(&dump->strings, text, &record.text) != 0 ||
+        image_buffer_append(&dump->aliases, &record, sizeof(record)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Добавление ловушки в образ (функция обхода trap_foreach)
+ * @param slot Номер ячейки
+ * @param body Тело
+ * @param arg Состояние сборки образа
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int image_add_trap(int slot, const char *body, void *arg) {
+    image_dump_state_t *dump = arg;
+    image_trap_t record = { (uint32_t)slot, 0 };
+
+    if (image_add_string(&dump->strings, body, &record.body) != 0 ||
+        image_buffer_append(&dump->traps, &record, sizeof(record)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Сборка разделов образа из текущего состояния
+ * @param dump Состояние сборки
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int image_collect(image_dump_state_t *dump) {
+    for (int i = 0; i < tracked_count; i++) {
+        image_file_t record;
+        memset(&record, 0, sizeof(record));
+
+        struct stat st;
+        if (stat(tracked_files[i], &st) == 0) {
+            record.exists = 1;
+            record.size = (int64_t)st.st_size;
+            record.mtime_sec = (int64_t)st.st_mtim.tv_sec;
+            record.mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+        }
+
+        if (image_add_string(&dump->strings, tracked_files[i], &record.path) != 0 ||
+            image_buffer_append(&dump->files, &record, sizeof(record)) < 0) {
+            return -1;
+        }
+    }
+
+    for (int i = 0; environ && environ[i]; i++) {
+        char *eq = strchr(environ[i], '=');
+        if (!eq || image_var_unchanged(environ[i])) {
+            continue;
+        }
+
+        image_var_t record = { 0, 0 };
+        *eq = '\0';
+        int failed = image_add_string(&dump->strings, environ[i], &record.name) != 0;
+        *eq = '=';
+        if (failed || image_add_string(&dump->strings, eq + 1, &record.value) != 0 ||
+            image_buffer_append(&dump->vars, &record, sizeof(record)) < 0) {
+            return -1;
+        }
+    }
+
+    // Переменные, которые были до файла настроек и удалены им (unset)
+    for (int i = 0; i < initial_count; i++) {
+        char *eq = initial_environ[i] ? strchr(initial_environ[i], '=') : NULL;
+        if (!eq) {
+            continue;
+        }
+
+        *eq = '\0';
+        image_unset_t record = { 0 };
+        int failed = !getenv(initial_environ[i]) &&
+                     (image_add_string(&dump->strings, initial_environ[i], &record.name) != 0 ||
+                      image_buffer_append(&dump->unsets, &record, sizeof(record)) < 0);
+        *eq = '=';
+        if (failed) {
+            return -1;
+        }
+    }
+
+    // Хуки, псевдонимы и ловушки, заданные файлом настроек, иначе терялись бы
+    // при загрузке образа
+    shell_state_t *state = shell_current();
+    if (state && (hook_foreach(state, image_add_hook, dump) != 0 ||
+                  alias_foreach(state, image_add_alias, dump) != 0)) {
+        return -1;
+    }
+    if (trap_foreach(image_add_trap, dump) != 0) {
+        return -1;
+    }
+
+    return cmdhash_foreach(image_add_command, dump);
+}
+
+/**
+ * @brief Запись буфера в файл целиком
+ * @param fd Дескриптор файла
+ * @param data Данные
+ * @param size Размер
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int image_write_all(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Сохранение образа сессии
+ * @param path Путь к файлу образа
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int image_dump(const char *path) {
+    image_dump_state_t dump;
+    memset(&dump, 0, sizeof(dump));
+
+    if (image_collect(&dump) != 0) {
+        fprintf(stderr, "dump-image: недостаточно памяти\n");
+        free(dump.strings.data);
+        free(dump.files.data);
+        free(dump.vars.data);
+        free(dump.commands.data);
+        free(dump.hooks.data);
+        free(dump.aliases.data);
+        free(dump.traps.data);
+        free(dump.unsets.data);
+        return -1;
+    }
+
+    image_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    snprintf(header.build_id, sizeof(header.build_id), "%s", image_build_id());
+
+    // Разделы идут за заголовком в порядке типов, каждый с границы 8 байт
+    const image_buffer_t *parts[] = { &dump.strings, &dump.files, &dump.vars, &dump.commands, &dump.hooks,
+                                      &dump.aliases, &dump.traps, &dump.unsets };
+    const size_t record_sizes[] = { 1, sizeof(image_file_t), sizeof(image_var_t), sizeof(image_command_t),
+                                    sizeof(image_hook_t), sizeof(image_alias_t), sizeof(image_trap_t),
+                                    sizeof(image_unset_t) };
+    uint64_t offset = sizeof(header);
+
+    for (int i = 0; i < IMAGE_SECTION_COUNT - 1; i++) {
+        image_section_t *section = &header.sections[i];
+        section->type = (uint32_t)(IMAGE_SECTION_STRINGS + i);
+        section->count = (uint32_t)(parts[i]->length / record_sizes[i]);
+        section->offset = offset;
+        section->size = parts[i]->length;
+        offset = (offset + parts[i]->length + 7) & ~(uint64_t)7;
+    }
+    header.section_count = IMAGE_SECTION_COUNT - 1;
+    header.image_size = offset;
+
+    // Образ заменяется переименованием, чтобы параллельный запуск не увидел половину
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof(tmp_path)) {
+        fprintf(stderr, "dump-image: слишком длинный путь: %s\n", path);
+        return -1;
+    }
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int failed = fd == -1 || image_write_all(fd, &header, sizeof(header)) != 0;
+
+    static const char padding[8] = { 0 };
+    for (int i = 0; i < IMAGE_SECTION_COUNT - 1 && !failed; i++) {
+        size_t pad = (size_t)((8 - parts[i]->length % 8) % 8);
+        failed = (parts[i]->length > 0 && image_write_all(fd, parts[i]->data, parts[i]->length) != 0) ||
+                 (pad > 0 && image_write_all(fd, padding, pad) != 0);
+    }
+
+    if (fd != -1 && close(fd) != 0) {
+        failed = 1;
+    }
+    if (!failed && rename(tmp_path, path) != 0) {
+        failed = 1;
+    }
+    if (failed) {
+        fprintf(stderr, "dump-image: %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+    }
+
+    free(dump.strings.data);
+    free(dump.files.data);
+    free(dump.vars.data);
+    free(dump.commands.data);
+    free(dump.hooks.data);
+    free(dump.aliases.data);
+    free(dump.traps.data);
+    free(dump.unsets.data);
+
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Поиск и проверка раздела образа
+ * @param base Начало образа
+ * @param header Заголовок
+ * @param type Тип раздела
+ * @param record_size Размер записи
+ * @param count Указатель для количества записей
+ * @return Начало раздела или NULL, если раздел повреждён
+ */
+static const void *image_section(const char *base, const image_header_t *header,
+                                 uint32_t type, size_t record_size, uint32_t *count) {
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        const image_section_t *section = &header->sections[i];
+        if (section->type != type) {
+            continue;
+        }
+
+        if (section->offset % 8 != 0 || section->offset < sizeof(*header) ||
+            section->offset > header->image_size ||
+            section->size > header->image_size - section->offset ||
+            section->size != (uint64_t)section->count * record_size) {
+            return NULL;
+        }
+
+        *count = section->count;
+        return base + section->offset;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Проверка смещения строки
+ * @param offset Смещение
+ * @param strings_size Размер раздела строк
+ * @return 1 если смещение внутри раздела
+ */
+static int image_string_valid(uint32_t offset, uint32_t strings_size) {
+    return offset < strings_size;
+}
+
+/**
+ * @brief Загрузка образа сессии
+ * @param path Путь к файлу образа
+ * @return 0 если образ применён, -1 иначе
+ */
+int image_load(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(image_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    // Весь образ - одно отображение; оно не нужно после применения
+    size_t size = (size_t)st.st_size;
+    const char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    const image_header_t *header = (const image_header_t *)base;
+    int valid = memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 &&
+                header->version == IMAGE_VERSION &&
+                header->image_size == size &&
+                header->section_count <= IMAGE_SECTION_COUNT - 1 &&
+                memchr(header->build_id, '\0', sizeof(header->build_id)) != NULL &&
+                strcmp(header->build_id, image_build_id()) == 0;
+
+    uint32_t strings_size = 0, file_count = 0, var_count = 0, command_count = 0, hook_count = 0;
+    uint32_t alias_count = 0, trap_count = 0, unset_count = 0;
+    const char *strings = NULL;
+    const image_file_t *files = NULL;
+    const image_var_t *vars = NULL;
+    const image_command_t *commands = NULL;
+    const image_hook_t *hooks = NULL;
+    const image_alias_t *aliases = NULL;
+    const image_trap_t *traps = NULL;
+    const image_unset_t *unsets = NULL;
+
+    if (valid) {
+        strings = image_section(base, header, IMAGE_SECTION_STRINGS, 1, &strings_size);
+        files = image_section(base, header, IMAGE_SECTION_FILES, sizeof(image_file_t), &file_count);
+        vars = image_section(base, header, IMAGE_SECTION_VARS, sizeof(image_var_t), &var_count);
+        commands = image_section(base, header, IMAGE_SECTION_COMMANDS, sizeof(image_command_t), &command_count);
+        hooks = image_section(base, header, IMAGE_SECTION_HOOKS, sizeof(image_hook_t), &hook_count);
+        aliases = image_section(base, header, IMAGE_SECTION_ALIASES, sizeof(image_alias_t), &alias_count);
+        traps = image_section(base, header, IMAGE_SECTION_TRAPS, sizeof(image_trap_t), &trap_count);
+        unsets = image_section(base, header, IMAGE_SECTION_UNSETS, sizeof(image_unset_t), &unset_count);
+
+        // Строки завершены нулём, если им завершён весь раздел
+        valid = strings && files && vars && commands && hooks && aliases && traps && unsets &&
+                (strings_size == 0 || strings[strings_size - 1] == '\0');
+    }
+
+    // Изменение или появление любого выполненного файла делает образ устаревшим
+    for (uint32_t i = 0; valid && i < file_count; i++) {
+        const image_file_t *file = &files[i];
+        if (!image_string_valid(file->path, strings_size)) {
+            valid = 0;
+            break;
+        }
+
+        struct stat file_st;
+        int exists = stat(strings + file->path, &file_st) == 0;
+        if (exists != (int)file->exists ||
+            (exists && ((int64_t)file_st.st_size != file->size ||
+                        (int64_t)file_st.st_mtim.tv_sec != file->mtime_sec ||
+                        (int64_t)file_st.st_mtim.tv_nsec != file->mtime_nsec))) {
+            valid = 0;
+        }
+    }
+
+    for (uint32_t i = 0; valid && i < var_count; i++) {
+        valid = image_string_valid(vars[i].name, strings_size) &&
+                image_string_valid(vars[i].value, strings_size);
+    }
+    for (uint32_t i = 0; valid && i < command_count; i++) {
+        valid = image_string_valid(commands[i].name, strings_size) &&
+                image_string_valid(commands[i].path_env, strings_size) &&
+                image_string_valid(commands[i].resolved, strings_size);
+    }
+    for (uint32_t i = 0; valid && i < hook_count; i++) {
+        valid = hooks[i].point < HOOK_POINTS && image_string_valid(hooks[i].body, strings_size);
+    }
+    for (uint32_t i = 0; valid && i < alias_count; i++) {
+        valid = image_string_valid(aliases[i].name, strings_size) &&
+                image_string_valid(aliases[i].text, strings_size);
+    }
+    for (uint32_t i = 0; valid && i < trap_count; i++) {
+        valid = traps[i].slot < TRAP_SLOTS && image_string_valid(traps[i].body, strings_size);
+    }
+    for (uint32_t i = 0; valid && i < unset_count; i++) {
+        valid = image_string_valid(unsets[i].name, strings_size);
+    }
+
+    if (valid) {
+        for (uint32_t i = 0; i < unset_count; i++) {
+            unsetenv(strings + unsets[i].name);
+        }
+        for (uint32_t i = 0; i < var_count; i++) {
+            setenv(strings + vars[i].name, strings + vars[i].value, 1);
+        }
+        for (uint32_t i = 0; i < command_count; i++) {
+            cmdhash_insert(strings + commands[i].name, strings + commands[i].path_env,
+                           strings + commands[i].resolved);
+        }
+        shell_state_t *state = shell_current();
+        for (uint32_t i = 0; state && i < hook_count; i++) {
+            hook_add(state, (hook_point_t)hooks[i].point, strings + hooks[i].body);
+        }
+        for (uint32_t i = 0; state && i < alias_count; i++) {
+            alias_define(state, strings + aliases[i].name, strings + aliases[i].text);
+        }
+        for (uint32_t i = 0; i < trap_count; i++) {
+            trap_set((int)traps[i].slot, strings + traps[i].body);
+        }
+    }
+
+    munmap((void *)base, size);
+    return valid ? 0 : -1;
+}
@@ -0,0 +1,588 @@
+/**
+ * @file jobs.c
+ * @brief Реализация таблицы фоновых заданий и команд jobs, fg, wait, kill
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "jobs.h"
+#include "builtins.h"
+#include "executor.h"
+#include "signals.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**
+ * @enum job_kind_t
+ * @brief Вид фонового задания
+ */
+typedef enum {
+    JOB_PROCESS = 0,  /**< Дочерний процесс */
+    JOB_TASK          /**< Поток внутри оболочки */
+} job_kind_t;
+
+/**
+ * @struct job_t
+ * @brief Запись таблицы заданий
+ */
+typedef struct {
+    int id;                 /**< Номер задания (0 - ячейка свободна) */
+    job_kind_t kind;        /**< Вид задания */
+    pid_t pid;              /**< Процесс (для JOB_PROCESS) */
+    pthread_t thread;       /**< Поток (для JOB_TASK) */
+    char *command;          /**< Имя команды для вывода */
+    char **args;            /**< Копия аргументов задачи */
+    int argc;               /**< Количество аргументов задачи */
+    int running;            /**< Задание ещё выполняется */
+    int exit_code;          /**< Код завершения */
+    int term_signal;        /**< Сигнал, завершивший процесс, или 0 */
+    atomic_int cancelled;   /**< Запрошено прерывание задачи */
+} job_t;
+
+// Таблица заданий; ячейки не перемещаются, поток задачи хранит указатель
+static job_t jobs[MAX_JOBS];
+
+// Защищает поля running/exit_code и выделение ячеек
+static pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_cond = PTHREAD_COND_INITIALIZER;
+
+// Задача, выполняемая текущим потоком
+static __thread job_t *current_task = NULL;
+
+// Прерывание ожидания в fg по Ctrl+C
+static volatile sig_atomic_t wait_interrupted = 0;
+
+/**
+ * @brief Встроенные команды, безопасные для выполнения в потоке
+ */
+static const char *task_safe_builtins[] = {
+    "checksum", "rm", "mkdir", "rmdir", "touch", "ls"
+};
+
+/**
+ * @brief Проверка, может ли встроенная команда выполняться потоком
+ * @param cmd Команда
+ * @return Ненулевое значение если команду можно запустить как задачу
+ */
+int jobs_task_safe(const command_t *cmd) {
+    if (!cmd || !cmd->name || cmd->input_file || cmd->output_file || cmd->assign_count > 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(task_safe_builtins) / sizeof(task_safe_builtins[0]); i++) {
+        if (strcmp(cmd->name, task_safe_builtins[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Выделение свободной ячейки (вызывается под jobs_mutex)
+ * @return Ячейка или NULL, если таблица заполнена
+ */
+static job_t *job_alloc(void) {
+    int max_id = 0;
+    job_t *free_slot = NULL;
+
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].id > max_id) {
+            max_id = jobs[i].id;
+        } else if (jobs[i].id == 0 && !free_slot) {
+            free_slot = &jobs[i];
+        }
+    }
+
+    if (free_slot) {
+        // Номера как в bash: следующий после наибольшего занятого
+        free_slot->id = max_id + 1;
+        free_slot->running = 1;
+        free_slot->exit_code = 0;
+        free_slot->term_signal = 0;
+        atomic_store(&free_slot->cancelled, 0);
+    }
+    return free_slot;
+}
+
+/**
+ * @brief Освобождение ячейки завершившегося задания
+ * @param job Ячейка
+ */
+static void job_release(job_t *job) {
+    if (job->kind == JOB_TASK) {
+        pthread_join(job->thread, NULL);
+        for (int i = 0; i < job->argc; i++) {
+            free(job->args[i]);
+        }
+        free(job->args);
+    }
+    free(job->command);
+    memset(job, 0, sizeof(*job));
+}
+
+/**
+ * @brief Поток задачи
+ * @param arg Ячейка задания
+ * @return NULL
+ */
+static void *task_main(void *arg) {
+    job_t *job = arg;
+    current_task = job;
+
+    command_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.name = job->args[0];
+    cmd.args = job->args;
+    cmd.argc = job->argc;
+
+    int exit_code = execute_builtin(&cmd);
+    fflush(shell_stdout());
+
+    pthread_mutex_lock(&jobs_mutex);
+    job->exit_code = exit_code;
+    job->running = 0;
+    pthread_cond_broadcast(&jobs_cond);
+    pthread_mutex_unlock(&jobs_mutex);
+    return NULL;
+}
+
+/**
+ * @brief Запуск встроенной команды как фоновой задачи
+ * @param cmd Команда (копируется)
+ * @return Номер задания или -1 в случае ошибки
+ */
+int jobs_start_task(const command_t *cmd) {
+    if (!cmd || !cmd->name || cmd->argc <= 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&jobs_mutex);
+    job_t *job = job_alloc();
+    pthread_mutex_unlock(&jobs_mutex);
+    if (!job) {
+        fprintf(shell_stderr(), "Слишком много фоновых заданий\n");
+        return -1;
+    }
+
+    // Команды освобождаются после строки ввода, задаче нужна своя копия
+    job->kind = JOB_TASK;
+    job->command = strdup(cmd->name);
+    job->args = calloc((size_t)cmd->argc + 1, sizeof(char *));
+    job->argc = 0;
+    int ok = job->command && job->args;
+    for (int i = 0; ok && i < cmd->argc; i++) {
+        job->args[i] = strdup(cmd->args[i]);
+        ok = job->args[i] != NULL;
+        job->argc += ok;
+    }
+
+    // Асинхронные сигналы обрабатывает основной поток, а не задача
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &saved);
+    int created = ok && pthread_create(&job->thread, NULL, task_main, job) == 0;
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (!created) {
+        shell_perror("Ошибка запуска фоновой задачи");
+        job->kind = JOB_PROCESS;
+        for (int i = 0; i < job->argc; i++) {
+            free(job->args[i]);
+        }
+        free(job->args);
+        free(job->command);
+        pthread_mutex_lock(&jobs_mutex);
+        memset(job, 0, sizeof(*job));
+        pthread_mutex_unlock(&jobs_mutex);
+        return -1;
+    }
+
+    fprintf(shell_stdout(), "[%d] %s\n", job->id, job->command);
+    return job->id;
+}
+
+/**
+ * @brief Регистрация фонового процесса
+ * @param pid Идентификатор процесса
+ * @param command Имя команды
+ * @return Номер задания или -1, если таблица заполнена
+ */
+int jobs_add_process(pid_t pid, const char *command) {
+    pthread_mutex_lock(&jobs_mutex);
+    job_t *job = job_alloc();
+    if (job) {
+        job->kind = JOB_PROCESS;
+        job->pid = pid;
+        job->command = strdup(command ? command : "");
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+
+    if (!job) {
+        fprintf(shell_stdout(), "[%d] %s\n", pid, command ? command : "");
+        return -1;
+    }
+
+    fprintf(shell_stdout(), "[%d] %d\n", job->id, pid);
+    return job->id;
+}
+
+/**
+ * @brief Запись статуса waitpid в ячейку (вызывается под jobs_mutex)
+ * @param job Ячейка
+ * @param status Статус waitpid
+ */
+static void job_set_status(job_t *job, int status) {
+    job->running = 0;
+    if (WIFEXITED(status)) {
+        job->exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        job->term_signal = WTERMSIG(status);
+        job->exit_code = 128 + job->term_signal;
+    }
+}
+
+/**
+ * @brief Учёт завершения процесса, полученного waitpid
+ * @param pid Идентификатор процесса
+ * @param status Статус waitpid
+ * @return 0 если процесс принадлежит заданию, -1 иначе
+ */
+int jobs_process_finished(pid_t pid, int status) {
+    int found = -1;
+
+    pthread_mutex_lock(&jobs_mutex);
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].id && jobs[i].kind == JOB_PROCESS && jobs[i].pid == pid) {
+            job_set_status(&jobs[i], status);
+            found = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+
+    return found;
+}
+
+/**
+ * @brief Вывод итога завершившегося задания
+ * @param job Ячейка
+ */
+static void job_print_done(const job_t *job) {
+    if (job->term_signal) {
+        fprintf(shell_stdout(), "[%d] Завершен сигналом %d: %s\n", job->id, job->term_signal, job->command);
+    } else if (atomic_load(&job->cancelled)) {
+        fprintf(shell_stdout(), "[%d] Прервано: %s\n", job->id, job->command);
+    } else {
+        fprintf(shell_stdout(), "[%d] Завершен с кодом %d: %s\n", job->id, job->exit_code, job->command);
+    }
+}
+
+/**
+ * @brief Вывод сообщений о завершившихся заданиях и освобождение их ячеек
+ */
+void jobs_notify(void) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        pthread_mutex_lock(&jobs_mutex);
+        int done = jobs[i].id && !jobs[i].running;
+        pthread_mutex_unlock(&jobs_mutex);
+
+        if (done) {
+            job_print_done(&jobs[i]);
+            job_release(&jobs[i]);
+        }
+    }
+}
+
+/**
+ * @brief Прерывание задач и ожидание их завершения при выходе из оболочки
+ */
+void jobs_shutdown(void) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].id && jobs[i].kind == JOB_TASK) {
+            atomic_store(&jobs[i].cancelled, 1);
+        }
+    }
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].id) {
+            job_release(&jobs[i]);
+        }
+    }
+}
+
+/**
+ * @brief Флаг прерывания текущей задачи
+ * @return Указатель на флаг или NULL, если поток не является задачей
+ */
+const atomic_int *task_cancel_flag(void) {
+    return current_task ? &current_task->cancelled : NULL;
+}
+
+/**
+ * @brief Проверка, запрошено ли прерывание текущей задачи
+ * @return Ненулевое значение если задачу нужно завершить
+ */
+int task_cancelled(void) {
+    return current_task && atomic_load(&current_task->cancelled);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Встроенные команды                                                       */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Поиск задания по обозначению %N или N
+ * @param spec Обозначение; NULL - последнее запущенное задание
+ * @return Ячейка или NULL
+ */
+static job_t *job_find(const char *spec) {
+    job_t *found = NULL;
+
+    if (!spec) {
+        for (int i = 0; i < MAX_JOBS; i++) {
+            if (jobs[i].id && (!found || jobs[i].id > found->id)) {
+                found = &jobs[i];
+            }
+        }
+        return found;
+    }
+
+    char *end = NULL;
+    long id = strtol(spec[0] == '%' ? spec + 1 : spec, &end, 10);
+    if (*end != '\0' || id <= 0) {
+        return NULL;
+    }
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].id == id) {
+            return &jobs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Обработчик SIGINT на время ожидания задачи в fg/wait
+ * @param sig Номер сигнала
+ */
+static void wait_interrupt_handler(int sig) {
+    (void)sig;
+    wait_interrupted = 1;
+}
+
+/**
+ * @brief Ожидание завершения задания
+ * @param job Ячейка
+ * @return Код завершения задания
+ */
+static int job_wait(job_t *job) {
+    if (job->kind == JOB_PROCESS) {
+        int status;
+        pid_t r;
+        while ((r = waitpid(job->pid, &status, 0)) == -1 && errno == EINTR) {
+        }
+        pthread_mutex_lock(&jobs_mutex);
+        if (r == job->pid) {
+            job_set_status(job, status);
+        } else {
+            job->running = 0; // Процесс уже собран в другом месте
+        }
+        pthread_mutex_unlock(&jobs_mutex);
+        return job->exit_code;
+    }
+
+    // Ctrl+C во время ожидания прерывает задачу, а не оболочку
+    struct sigaction sa, saved;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = wait_interrupt_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &saved);
+    wait_interrupted = 0;
+
+    pthread_mutex_lock(&jobs_mutex);
+    while (job->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100 * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&jobs_cond, &jobs_mutex, &deadline);
+
+        if (wait_interrupted) {
+            wait_interrupted = 0;
+            atomic_store(&job->cancelled, 1);
+        }
+    }
+    int exit_code = job->exit_code;
+    pthread_mutex_unlock(&jobs_mutex);
+
+    sigaction(SIGINT, &saved, NULL);
+    return exit_code;
+}
+
+/**
+ * @brief Встроенная команда jobs (список фоновых заданий)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха
+ */
+int builtin_jobs(char **args, int argc) {
+    (void)args;
+    (void)argc;
+
+    check_background_status();
+
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].id) {
+            if (jobs[i].kind == JOB_PROCESS) {
+                fprintf(shell_stdout(), "[%d] %-8d Выполняется  %s\n", jobs[i].id, jobs[i].pid, jobs[i].command);
+            } else {
+                fprintf(shell_stdout(), "[%d] %-8s Выполняется  %s%s\n", jobs[i].id, "задача", jobs[i].command,
+                        atomic_load(&jobs[i].cancelled) ? " (прерывается)" : "");
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Встроенная команда fg (ожидание задания на переднем плане)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код завершения задания или -1 в случае ошибки
+ */
+int builtin_fg(char **args, int argc) {
+    job_t *job = job_find(argc > 1 ? args[1] : NULL);
+    if (!job) {
+        fprintf(shell_stderr(), "fg: %s: нет такого задания\n", argc > 1 ? args[1] : "текущее");
+        return -1;
+    }
+
+    fprintf(shell_stdout(), "%s\n", job->command);
+    fflush(shell_stdout());
+
+    int exit_code = job_wait(job);
+    job_release(job);
+    return exit_code;
+}
+
+/**
+ * @brief Встроенная команда wait (ожидание фоновых заданий)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код завершения последнего ожидаемого задания или -1 в случае ошибки
+ */
+int builtin_wait(char **args, int argc) {
+    int exit_code = 0;
+
+    if (argc == 1) {
+        for (int i = 0; i < MAX_JOBS; i++) {
+            if (jobs[i].id) {
+                exit_code = job_wait(&jobs[i]);
+                job_print_done(&jobs[i]);
+                job_release(&jobs[i]);
+            }
+        }
+        return exit_code;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        job_t *job = job_find(args[i]);
+        if (!job) {
+            fprintf(shell_stderr(), "wait: %s: нет такого задания\n", args[i]);
+            exit_code = -1;
+            continue;
+        }
+        exit_code = job_wait(job);
+        job_release(job);
+    }
+    return exit_code;
+}
+
+/**
+ * @brief Встроенная команда kill (отправка сигнала процессу или прерывание задачи)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_kill(char **args, int argc) {
+    int sig = SIGTERM;
+    int i = 1;
+
+    if (i < argc && strcmp(args[i], "-l") == 0) {
+        trap_list_signals();
+        return 0;
+    }
+    if (i < argc && args[i][0] == '-' && args[i][1] != '\0') {
+        const char *spec = args[i][1] == 's' && args[i][2] == '\0' && i + 1 < argc
+                               ? args[++i] : args[i] + 1;
+        int slot = trap_parse_spec(spec);
+        if (slot < 0 || slot >= NSIG) {
+            fprintf(shell_stderr(), "kill: неизвестный сигнал '%s'\n", spec);
+            return -1;
+        }
+        sig = slot;
+        i++;
+    }
+
+    if (i >= argc) {
+        fprintf(shell_stderr(), "Использование: kill [-s сигнал | -сигнал] %%задание|pid...\n");
+        return -1;
+    }
+
+    int targets = argc - i;
+    int success_count = 0;
+
+    for (; i < argc; i++) {
+        if (args[i][0] == '%') {
+            job_t *job = job_find(args[i]);
+            if (!job) {
+                fprintf(shell_stderr(), "kill: %s: нет такого задания\n", args[i]);
+                continue;
+            }
+            if (job->kind == JOB_TASK) {
+                // Задача не может быть убита сигналом, только прервана
+                if (sig != 0) {
+                    atomic_store(&job->cancelled, 1);
+                }
+                success_count++;
+                continue;
+            }
+            if (kill(job->pid, sig) == 0) {
+                success_count++;
+            } else {
+                fprintf(shell_stderr(), "kill: (%d): %s\n", job->pid, strerror(errno));
+            }
+            continue;
+        }
+
+        char *end = NULL;
+        long pid = strtol(args[i], &end, 10);
+        if (*end != '\0' || end == args[i]) {
+            fprintf(shell_stderr(), "kill: %s: аргументом должен быть pid или %%задание\n", args[i]);
+        } else if (kill((pid_t)pid, sig) == 0) {
+            success_count++;
+        } else {
+            fprintf(shell_stderr(), "kill: (%ld): %s\n", pid, strerror(errno));
+        }
+    }
+
+    if (success_count == targets) {
+        return 0;
+    } else if (success_count > 0) {
+        return 1; // Частичный успех
+    } else {
+        return -1; // Полная неудача
+    }
+}
@@ -14,29 +14,86 @@
 #include "executor.h"
 #include "builtins.h"
 #include "utils.h"
+#include "server.h"
+#include "image.h"
+#include "signals.h"
+#include "metrics.h"
+#include "audit.h"
 
 /**
  * @brief Главная функция программы
  * @param argc Количество аргументов командной строки
  * @param argv Массив аргументов командной строки
  * @return Код выхода программы
+ *
+ * @details С параметрами --server ПУТЬ [--workers N] вместо интерактивного
+ * режима запускается сервер сессий на Unix-сокете. С --dump-image ФАЙЛ
+ * оболочка выполняет ~/.custom_shellrc, сохраняет образ сессии и завершается.
+ * Если задан CUSTOM_SHELL_METRICS_SOCKET, в обоих режимах работает сервер
+ * метрик (metrics.h), а если задан CUSTOM_SHELL_AUDIT_LOG или
+ * CUSTOM_SHELL_AUDIT_SOCKET - журнал аудита команд (audit.h).
  */
 int main(int argc, char *argv[]) {
     shell_state_t shell_state;
     int exit_code = 0;
     
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        int workers = SERVER_DEFAULT_WORKERS;
+        
+        if (argc == 5 && strcmp(argv[3], "--workers") == 0) {
+            workers = atoi(argv[4]);
+        } else if (argc != 3) {
+            fprintf(stderr, "Использование: %s --server ПУТЬ [--workers N]\n", argv[0]);
+            return 1;
+        }
+        
+        metrics_start();
+        audit_start();
+        exit_code = server_run(argv[2], workers);
+        audit_stop();
+        metrics_stop();
+        return exit_code;
+    }
+    
+    int dump_image = argc > 1 && strcmp(argv[1], "--dump-image") == 0;
+    if (dump_image && argc != 3) {
+        fprintf(stderr, "Использование: %s --dump-image ФАЙЛ\n", argv[0]);
+        return 1;
+    }
+    
     // Инициализация оболочки
     if (shell_init(&shell_state) != 0) {
         fprintf(stderr, "Ошибка инициализации оболочки\n");
         return 1;
     }
     
+    if (dump_image) {
+        image_begin();
+        shell_source_rc(&shell_state);
+        exit_code = image_dump(argv[2]) == 0 ? 0 : 1;
+        // Ловушка EXIT сохранена в образе и сработает в загрузившей его сессии
+        trap_set(TRAP_EXIT, NULL);
+        shell_cleanup(&shell_state);
+        return exit_code;
+    }
+    
+    // Готовый образ заменяет выполнение файла настроек
+    char *image_path = image_default_path();
+    if (!image_path || image_load(image_path) != 0) {
+        shell_source_rc(&shell_state);
+    }
+    free(image_path);
+    
     // Установка обработчика сигналов
     signal(SIGINT, signal_handler);
     signal(SIGTSTP, signal_handler);
     
     // Основной цикл оболочки
+    metrics_start();
+    audit_start();
     exit_code = shell_run(&shell_state);
+    audit_stop();
+    metrics_stop();
     
     // Очистка ресурсов
     shell_cleanup(&shell_state);
@@ -0,0 +1,489 @@
+/**
+ * @file metrics.c
+ * @brief Реализация метрик оболочки (формат Prometheus на Unix-сокете)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @struct metrics_builtin_t
+ * @brief Счётчик вызовов одной встроенной команды
+ */
+typedef struct {
+    uint64_t hash;      /**< Хеш имени (0 - слот свободен) */
+    char name[24];      /**< Имя команды */
+    uint64_t count;     /**< Количество вызовов */
+} metrics_builtin_t;
+
+/**
+ * @struct metrics_thread_t
+ * @brief Счётчики одного потока
+ *
+ * @details Пишет в блок только его поток, поток сервера метрик только
+ * читает. При завершении потока блок складывается в блок завершившихся
+ * потоков и освобождается, поэтому его счётчики остаются в сумме.
+ */
+typedef struct metrics_thread {
+    uint64_t buckets[METRIC_COUNT][METRICS_BUCKETS];    /**< Гистограммы */
+    uint64_t sum_ns[METRIC_COUNT];                      /**< Суммы задержек (нс) */
+    metrics_builtin_t builtins[METRICS_MAX_BUILTINS];   /**< Вызовы встроенных команд */
+    struct metrics_thread *next;                        /**< Следующий блок */
+} metrics_thread_t;
+
+/**
+ * @struct metric_info_t
+ * @brief Имя и описание метрики для вывода
+ */
+typedef struct {
+    const char *name;   /**< Имя без суффиксов */
+    const char *help;   /**< Описание */
+} metric_info_t;
+
+static const metric_info_t metric_info[METRIC_COUNT] = {
+    [METRIC_PROMPT]  = { "custom_shell_prompt_seconds", "Время построения приглашения" },
+    [METRIC_PARSE]   = { "custom_shell_parse_seconds", "Время разбора строки (с учётом кэша разбора)" },
+    [METRIC_SPAWN]   = { "custom_shell_spawn_seconds", "Время fork в родительском процессе" },
+    [METRIC_CHILD]   = { "custom_shell_child_seconds", "Время выполнения дочернего процесса" },
+    [METRIC_HISTORY] = { "custom_shell_history_append_seconds", "Время добавления команды в историю" },
+    [METRIC_BUILTIN] = { "custom_shell_builtin_seconds", "Время выполнения встроенной команды" },
+};
+
+int metrics_enabled = 0;
+
+// Список блоков под metrics_lock; блок завершившихся потоков всегда последний
+static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+static metrics_thread_t metrics_retired;
+static metrics_thread_t *metrics_threads = &metrics_retired;
+static __thread metrics_thread_t *metrics_self = NULL;
+static pthread_key_t metrics_key;
+static pthread_once_t metrics_key_once = PTHREAD_ONCE_INIT;
+
+static int metrics_fd = -1;
+static char *metrics_path = NULL;
+static pthread_t metrics_thread;
+
+/**
+ * @brief Хеш имени встроенной команды (FNV-1a, никогда не 0)
+ * @param name Имя
+ * @return Хеш
+ */
+static uint64_t metrics_builtin_hash(const char *name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = name; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    return hash | 1;
+}
+
+/**
+ * @brief Поиск или занятие слота встроенной команды в блоке
+ * @param block Блок
+ * @param name Имя команды
+ * @param hash Хеш имени
+ * @return Слот или NULL, если таблица заполнена
+ *
+ * @details Слот ищется по хешу имени открытой адресацией; имя
+ * записывается до хеша, поэтому читатель, увидевший хеш, видит и имя.
+ */
+static metrics_builtin_t *metrics_builtin_slot(metrics_thread_t *block, const char *name, uint64_t hash) {
+    for (int probe = 0; probe < METRICS_MAX_BUILTINS; probe++) {
+        metrics_builtin_t *slot = &block->builtins[(hash + (uint64_t)probe) % METRICS_MAX_BUILTINS];
+        if (slot->hash == 0) {
+            snprintf(slot->name, sizeof(slot->name), "%s", name);
+            __atomic_store_n(&slot->hash, hash, __ATOMIC_RELEASE);
+        }
+        if (slot->hash == hash && strncmp(slot->name, name, sizeof(slot->name) - 1) == 0) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Сложение блока завершившегося потока с общим и его освобождение
+ * @param arg Блок (значение ключа потока)
+ *
+ * @details Сервер метрик читает список под той же блокировкой, поэтому
+ * счётчики не пропадают и не учитываются дважды.
+ */
+static void metrics_retire(void *arg) {
+    metrics_thread_t *block = arg;
+
+    pthread_mutex_lock(&metrics_lock);
+    metrics_thread_t **link = &metrics_threads;
+    while (*link != block) {
+        link = &(*link)->next;
+    }
+    *link = block->next;
+
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            metrics_retired.buckets[id][b] += block->buckets[id][b];
+        }
+        metrics_retired.sum_ns[id] += block->sum_ns[id];
+    }
+    for (int s = 0; s < METRICS_MAX_BUILTINS; s++) {
+        const metrics_builtin_t *from = &block->builtins[s];
+        metrics_builtin_t *to = from->hash ? metrics_builtin_slot(&metrics_retired, from->name, from->hash) : NULL;
+        if (to) {
+            to->count += from->count;
+        }
+    }
+    pthread_mutex_unlock(&metrics_lock);
+
+    metrics_self = NULL;
+    free(block);
+}
+
+/**
+ * @brief Создание ключа потока с деструктором блока
+ */
+static void metrics_key_create(void) {
+    pthread_key_create(&metrics_key, metrics_retire);
+}
+
+/**
+ * @brief Блок счётчиков текущего потока
+ * @return Блок или NULL при нехватке памяти
+ */
+static metrics_thread_t *metrics_local(void) {
+    if (metrics_self) {
+        return metrics_self;
+    }
+
+    pthread_once(&metrics_key_once, metrics_key_create);
+    metrics_thread_t *block = calloc(1, sizeof(*block));
+    if (!block) {
+        return NULL;
+    }
+    pthread_mutex_lock(&metrics_lock);
+    block->next = metrics_threads;
+    metrics_threads = block;
+    pthread_mutex_unlock(&metrics_lock);
+
+    pthread_setspecific(metrics_key, block);
+    metrics_self = block;
+    return block;
+}
+
+/**
+ * @brief Увеличение счётчика своего потока
+ * @param counter Счётчик
+ * @param delta Приращение
+ *
+ * @details Писатель один, поэтому хватает атомарных чтения и записи без
+ * lock-префикса: читатель видит целое значение, старое или новое.
+ */
+static inline void metrics_add(uint64_t *counter, uint64_t delta) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Номер корзины для задержки
+ * @param ns Задержка (нс)
+ * @return Номер корзины
+ */
+static int metrics_bucket(uint64_t ns) {
+    if (ns < (1ULL << METRICS_MIN_SHIFT)) {
+        return 0;
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    if (msb >= METRICS_MIN_SHIFT + METRICS_OCTAVES) {
+        return METRICS_BUCKETS - 1;
+    }
+    // Два бита после старшего выбирают четверть октавы
+    int sub = (int)((ns >> (msb - 2)) & (METRICS_SUB_BUCKETS - 1));
+    return 1 + (msb - METRICS_MIN_SHIFT) * METRICS_SUB_BUCKETS + sub;
+}
+
+/**
+ * @brief Верхняя граница корзины
+ * @param bucket Номер корзины (кроме последней)
+ * @return Граница (нс)
+ */
+static uint64_t metrics_bucket_bound(int bucket) {
+    if (bucket == 0) {
+        return 1ULL << METRICS_MIN_SHIFT;
+    }
+    int octave = (bucket - 1) / METRICS_SUB_BUCKETS;
+    int sub = (bucket - 1) % METRICS_SUB_BUCKETS;
+    return (uint64_t)(METRICS_SUB_BUCKETS + sub + 1) << (METRICS_MIN_SHIFT + octave - 2);
+}
+
+/**
+ * @brief Запись задержки
+ * @param id Метрика
+ * @param started Результат metrics_clock() в начале замера
+ */
+void metrics_record(metric_id_t id, uint64_t started) {
+    if (started != 0) {
+        metrics_record_value(id, metrics_clock() - started);
+    }
+}
+
+/**
+ * @brief Запись уже измеренной задержки
+ * @param id Метрика
+ * @param ns Задержка (нс)
+ */
+void metrics_record_value(metric_id_t id, uint64_t ns) {
+    metrics_thread_t *block = metrics_enabled ? metrics_local() : NULL;
+    if (!block) {
+        return;
+    }
+    metrics_add(&block->buckets[id][metrics_bucket(ns)], 1);
+    metrics_add(&block->sum_ns[id], ns);
+}
+
+/**
+ * @brief Учёт вызова встроенной команды
+ * @param name Имя команды
+ * @param started Результат metrics_clock() перед вызовом
+ */
+void metrics_record_builtin(const char *name, uint64_t started) {
+    if (started == 0 || !name) {
+        return;
+    }
+    metrics_record(METRIC_BUILTIN, started);
+
+    metrics_thread_t *block = metrics_local();
+    if (!block) {
+        return;
+    }
+
+    metrics_builtin_t *slot = metrics_builtin_slot(block, name, metrics_builtin_hash(name));
+    if (slot) {
+        metrics_add(&slot->count, 1);
+    }
+}
+
+/**
+ * @brief Вывод гистограмм в формате Prometheus
+ * @param out Поток вывода
+ * @param blocks Снимок списка блоков
+ */
+static void metrics_write_histograms(FILE *out, metrics_thread_t *blocks) {
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        uint64_t buckets[METRICS_BUCKETS] = { 0 };
+        uint64_t sum = 0;
+        for (metrics_thread_t *block = blocks; block; block = block->next) {
+            for (int b = 0; b < METRICS_BUCKETS; b++) {
+                buckets[b] += __atomic_load_n(&block->buckets[id][b], __ATOMIC_RELAXED);
+            }
+            sum += __atomic_load_n(&block->sum_ns[id], __ATOMIC_RELAXED);
+        }
+
+        const char *name = metric_info[id].name;
+        fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, metric_info[id].help, name);
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRICS_BUCKETS - 1; b++) {
+            cumulative += buckets[b];
+            fprintf(out, "%s_bucket{le=\"%.9g\"} %llu\n", name,
+                    (double)metrics_bucket_bound(b) / 1e9, (unsigned long long)cumulative);
+        }
+        cumulative += buckets[METRICS_BUCKETS - 1];
+        fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+        fprintf(out, "%s_sum %.9f\n", name, (double)sum / 1e9);
+        fprintf(out, "%s_count %llu\n", name, (unsigned long long)cumulative);
+    }
+}
+
+/**
+ * @brief Вывод счётчиков встроенных команд
+ * @param out Поток вывода
+ * @param blocks Снимок списка блоков
+ *
+ * @details Одна и та же команда в разных потоках может занимать разные
+ * слоты, поэтому счётчики складываются по имени.
+ */
+static void metrics_write_builtins(FILE *out, metrics_thread_t *blocks) {
+    metrics_builtin_t total[METRICS_MAX_BUILTINS];
+    int count = 0;
+
+    for (metrics_thread_t *block = blocks; block; block = block->next) {
+        for (int s = 0; s < METRICS_MAX_BUILTINS; s++) {
+            const metrics_builtin_t *slot = &block->builtins[s];
+            if (__atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE) == 0) {
+                continue;
+            }
+            int index = 0;
+            while (index < count && strcmp(total[index].name, slot->name) != 0) {
+                index++;
+            }
+            if (index == count) {
+                if (count == METRICS_MAX_BUILTINS) {
+                    continue;
+                }
+                memcpy(total[count].name, slot->name, sizeof(total[count].name));
+                total[count++].count = 0;
+            }
+            total[index].count += __atomic_load_n(&slot->count, __ATOMIC_RELAXED);
+        }
+    }
+
+    fprintf(out, "# HELP custom_shell_builtin_invocations_total Вызовы встроенных команд\n");
+    fprintf(out, "# TYPE custom_shell_builtin_invocations_total counter\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "custom_shell_builtin_invocations_total{builtin=\"%s\"} %llu\n",
+                total[i].name, (unsigned long long)total[i].count);
+    }
+}
+
+/**
+ * @brief Ответ на один запрос
+ * @param client Сокет клиента
+ *
+ * @details Запрос не разбирается: на любой отвечают метриками. Заголовки
+ * HTTP нужны curl --unix-socket и прокси; передача - с MSG_NOSIGNAL, чтобы
+ * закрывший соединение клиент не завершил оболочку сигналом SIGPIPE.
+ */
+static void metrics_respond(int client) {
+    struct pollfd request = { .fd = client, .events = POLLIN };
+    if (poll(&request, 1, 1000) > 0) {
+        char buffer[1024];
+        if (recv(client, buffer, sizeof(buffer), MSG_DONTWAIT) < 0) {
+            return;
+        }
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+    FILE *out = open_memstream(&body, &body_len);
+    if (!out) {
+        return;
+    }
+    // Блоки завершившихся потоков освобождаются под этой же блокировкой
+    pthread_mutex_lock(&metrics_lock);
+    metrics_write_histograms(out, metrics_threads);
+    metrics_write_builtins(out, metrics_threads);
+    pthread_mutex_unlock(&metrics_lock);
+    fclose(out);
+
+    char header[160];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\n"
+                              "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                              "Content-Length: %zu\r\n\r\n", body_len);
+    if (send(client, header, (size_t)header_len, MSG_NOSIGNAL) == header_len) {
+        for (size_t sent = 0; sent < body_len;) {
+            ssize_t n = send(client, body + sent, body_len - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            sent += (size_t)n;
+        }
+    }
+    free(body);
+}
+
+/**
+ * @brief Поток сервера метрик
+ * @param arg Не используется
+ * @return NULL
+ */
+static void *metrics_serve(void *arg) {
+    (void)arg;
+    for (;;) {
+        int client = accept4(metrics_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client == -1) {
+            // shutdown() в metrics_stop завершает ожидание ошибкой
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        metrics_respond(client);
+        close(client);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Запуск сервера метрик, если задан CUSTOM_SHELL_METRICS_SOCKET
+ * @return 0 в случае успеха или если метрики не заданы, -1 в случае ошибки
+ */
+int metrics_start(void) {
+    const char *path = getenv(METRICS_SOCKET_ENV);
+    if (!path || !*path || metrics_enabled) {
+        return 0;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "metrics: слишком длинный путь к сокету: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    metrics_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (metrics_fd == -1) {
+        perror("metrics: socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(metrics_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(metrics_fd, 16) != 0) {
+        fprintf(stderr, "metrics: %s: %s\n", path, strerror(errno));
+        close(metrics_fd);
+        metrics_fd = -1;
+        return -1;
+    }
+    metrics_path = strdup(path);
+    metrics_enabled = 1;
+
+    // Сигналы оболочки обрабатывает основной поток
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &saved);
+    int failed = pthread_create(&metrics_thread, NULL, metrics_serve, NULL);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (failed) {
+        fprintf(stderr, "metrics: pthread_create: %s\n", strerror(failed));
+        metrics_enabled = 0;
+        close(metrics_fd);
+        metrics_fd = -1;
+        unlink(path);
+        free(metrics_path);
+        metrics_path = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Остановка сервера метрик и удаление сокета
+ */
+void metrics_stop(void) {
+    if (metrics_fd == -1) {
+        return;
+    }
+
+    shutdown(metrics_fd, SHUT_RDWR);
+    pthread_join(metrics_thread, NULL);
+    close(metrics_fd);
+    metrics_fd = -1;
+    metrics_enabled = 0;
+
+    if (metrics_path) {
+        unlink(metrics_path);
+        free(metrics_path);
+        metrics_path = NULL;
+    }
+}
@@ -10,10 +10,54 @@
 #include "builtins.h"
 #include "utils.h"
 #include "shell.h"
+#include "registry.h"
+#include "alias.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
+
+/**
+ * @brief Проверка, является ли слово присваиванием вида NAME=value
+ * @param word Слово для проверки
+ * @return 1 если присваивание, 0 если нет
+ */
+static int is_assignment(const char *word) {
+    if (!word || !(isalpha((unsigned char)*word) || *word == '_')) {
+        return 0;
+    }
+    
+    const char *p = word + 1;
+    while (isalnum((unsigned char)*p) || *p == '_') {
+        p++;
+    }
+    
+    return *p == '=';
+}
+
+/**
+ * @brief Извлечение номера дескриптора перед оператором перенаправления
+ * @param start Начало строки команды
+ * @param op Указатель на оператор '<' или '>'
+ * @param default_fd Дескриптор по умолчанию
+ * @return Номер дескриптора (цифры номера затираются пробелами)
+ */
+static int take_redirect_fd(char *start, char *op, int default_fd) {
+    char *p = op;
+    while (p > start && isdigit((unsigned char)p[-1])) {
+        p--;
+    }
+    
+    // Номер должен быть отдельным словом: "exec 3>file", но не "file3>out"
+    if (p == op || (p > start && !isspace((unsigned char)p[-1]))) {
+        return default_fd;
+    }
+    
+    int fd = atoi(p);
+    memset(p, ' ', op - p);
+    return fd;
+}
 
 /**
  * @brief Разбор входной строки на команды
@@ -41,12 +85,28 @@ int parse_input(const char *input, command_t *commands, int max_commands) {
         cmd_count = max_commands;
     }
     
-    // Разбор каждой команды
+    // Разбор каждой команды; звенья конвейера "a | b" идут подряд
     int parsed_count = 0;
     for (int i = 0; i < cmd_count && parsed_count < max_commands; i++) {
-        if (parse_command(cmd_strings[i], &commands[parsed_count]) == 0) {
-            parsed_count++;
+        int stage_count = 0;
+        char **stages = split_string(cmd_strings[i], "|", &stage_count);
+        if (!stages) {
+            continue;
         }
+        
+        for (int s = 0; s < stage_count && parsed_count < max_commands; s++) {
+            if (parse_command(stages[s], &commands[parsed_count]) == 0) {
+                commands[parsed_count].pipe_next = 1;
+                parsed_count++;
+            }
+        }
+        
+        // Последнее звено пишет уже не в канал
+        if (parsed_count > 0) {
+            commands[parsed_count - 1].pipe_next = 0;
+        }
+        
+        free_string_array(stages, stage_count);
     }
     
     // Очистка временных строк
@@ -55,6 +115,171 @@ int parse_input(const char *input, command_t *commands, int max_commands) {
     return parsed_count;
 }
 
+/**
+ * @def PARSE_CACHE_BUCKETS
+ * @brief Количество цепочек хеш-таблицы кэша разбора
+ */
+#define PARSE_CACHE_BUCKETS 256
+
+// Общий кэш разобранных строк
+static parsed_line_t *parse_cache[PARSE_CACHE_BUCKETS];
+static int parse_cache_count = 0;
+static unsigned long parse_cache_clock = 0;
+static pthread_mutex_t parse_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Хеш строки (FNV-1a)
+ * @param text Строка
+ * @return Хеш
+ */
+static unsigned long parse_cache_hash(const char *text) {
+    unsigned long hash = 2166136261UL;
+    
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        hash = (hash ^ *p) * 16777619UL;
+    }
+    
+    return hash;
+}
+
+/**
+ * @brief Освобождение разобранной строки
+ * @param line Разобранная строка
+ */
+static void parse_cache_free(parsed_line_t *line) {
+    free_commands(line->commands, line->count);
+    free(line->commands);
+    free(line->text);
+    free(line);
+}
+
+/**
+ * @brief Вытеснение давно не используемой записи (вызывается под блокировкой)
+ *
+ * @details Записи, которые сейчас выполняются, не вытесняются.
+ */
+static void parse_cache_evict(void) {
+    parsed_line_t **victim = NULL;
+    
+    for (int i = 0; i < PARSE_CACHE_BUCKETS; i++) {
+        for (parsed_line_t **link = &parse_cache[i]; *link; link = &(*link)->next) {
+            if ((*link)->refs == 0 && (!victim || (*link)->last_used < (*victim)->last_used)) {
+                victim = link;
+            }
+        }
+    }
+    
+    if (victim) {
+        parsed_line_t *line = *victim;
+        *victim = line->next;
+        parse_cache_free(line);
+        parse_cache_count--;
+    }
+}
+
+/**
+ * @brief Разбор строки через общий кэш
+ * @param input Входная строка
+ * @return Разобранная строка или NULL, если строка не содержит команд
+ */
+parsed_line_t *parse_cache_acquire(const char *input) {
+    if (!input) {
+        return NULL;
+    }
+    
+    // Одна и та же строка с разными псевдонимами разбирается по-разному
+    shell_state_t *state = shell_current();
+    unsigned long alias_key = state ? state->alias_key : 0;
+    unsigned long hash = parse_cache_hash(input);
+    parsed_line_t **bucket = &parse_cache[hash % PARSE_CACHE_BUCKETS];
+    
+    pthread_mutex_lock(&parse_cache_lock);
+    for (parsed_line_t *line = *bucket; line; line = line->next) {
+        if (line->hash == hash && line->alias_key == alias_key && strcmp(line->text, input) == 0) {
+            line->refs++;
+            line->last_used = ++parse_cache_clock;
+            pthread_mutex_unlock(&parse_cache_lock);
+            return line;
+        }
+    }
+    pthread_mutex_unlock(&parse_cache_lock);
+    
+    // Разбор выполняется без блокировки
+    command_t commands[MAX_ARGS];
+    int count = parse_input(input, commands, MAX_ARGS);
+    if (count <= 0) {
+        return NULL;
+    }
+    
+    parsed_line_t *line = calloc(1, sizeof(parsed_line_t));
+    if (line) {
+        line->commands = malloc((size_t)count * sizeof(command_t));
+        line->text = strdup(input);
+    }
+    if (!line || !line->commands || !line->text) {
+        free_commands(commands, count);
+        if (line) {
+            free(line->commands);
+            free(line->text);
+            free(line);
+        }
+        return NULL;
+    }
+    memcpy(line->commands, commands, (size_t)count * sizeof(command_t));
+    line->count = count;
+    line->hash = hash;
+    line->alias_key = alias_key;
+    line->refs = 1;
+    
+    // Слишком длинные строки не кэшируются
+    if (strlen(input) >= MAX_INPUT_SIZE) {
+        return line;
+    }
+    
+    pthread_mutex_lock(&parse_cache_lock);
+    for (parsed_line_t *other = *bucket; other; other = other->next) {
+        if (other->hash == hash && other->alias_key == alias_key && strcmp(other->text, input) == 0) {
+            // Другой поток уже разобрал ту же строку
+            other->refs++;
+            other->last_used = ++parse_cache_clock;
+            pthread_mutex_unlock(&parse_cache_lock);
+            parse_cache_free(line);
+            return other;
+        }
+    }
+    
+    if (parse_cache_count >= PARSE_CACHE_MAX_ENTRIES) {
+        parse_cache_evict();
+    }
+    line->cached = 1;
+    line->last_used = ++parse_cache_clock;
+    line->next = *bucket;
+    *bucket = line;
+    parse_cache_count++;
+    pthread_mutex_unlock(&parse_cache_lock);
+    
+    return line;
+}
+
+/**
+ * @brief Возврат разобранной строки в кэш
+ * @param line Разобранная строка
+ */
+void parse_cache_release(parsed_line_t *line) {
+    if (!line) {
+        return;
+    }
+    
+    if (!line->cached) {
+        parse_cache_free(line);
+        return;
+    }
+    
+    pthread_mutex_lock(&parse_cache_lock);
+    line->refs--;
+    pthread_mutex_unlock(&parse_cache_lock);
+}
+
 /**
  * @brief Разбор одной команды
  * @param cmd_str Строка команды
@@ -69,15 +294,17 @@ int parse_command(const char *cmd_str, command_t *cmd) {
     // Инициализация структуры команды
     memset(cmd, 0, sizeof(command_t));
     
-    // Удаление пробелов в начале и конце
-    char *trimmed = trim_string(strdup(cmd_str));
+    // Удаление пробелов в начале и конце; trim_string сдвигает начало,
+    // поэтому освобождается исходная копия
+    char *copy = strdup(cmd_str);
+    char *trimmed = trim_string(copy);
     if (!trimmed) {
         return -1;
     }
     
     // Проверка на пустую команду
     if (strlen(trimmed) == 0) {
-        free(trimmed);
+        free(copy);
         return -1;
     }
     
@@ -86,35 +313,82 @@ int parse_command(const char *cmd_str, command_t *cmd) {
     char *output_redir = strstr(trimmed, ">");
     char *background = strstr(trimmed, "&");
     
+    cmd->input_fd = STDIN_FILENO;
+    cmd->output_fd = STDOUT_FILENO;
+    
     // Установка флагов
     if (background) {
         cmd->background = 1;
         *background = '\0';
+        if (input_redir > background) input_redir = NULL;
+        if (output_redir > background) output_redir = NULL;
+    }
+    
+    // Номера дескрипторов вида "3>file" определяем до разметки строки
+    if (input_redir) {
+        cmd->input_fd = take_redirect_fd(trimmed, input_redir, STDIN_FILENO);
+    }
+    if (output_redir) {
+        cmd->output_fd = take_redirect_fd(trimmed, output_redir, STDOUT_FILENO);
+    }
+    
+    // Завершаем строку на операторах, чтобы цели не захватывали друг друга
+    if (input_redir) {
+        *input_redir++ = '\0';
+    }
+    if (output_redir) {
+        *output_redir++ = '\0';
     }
     
     // Обработка перенаправления ввода
     if (input_redir) {
-        *input_redir = '\0';
-        input_redir++;
-        while (isspace(*input_redir)) input_redir++;
-        cmd->input_file = strdup(input_redir);
+        cmd->input_file = strdup(trim_string(input_redir));
     }
     
     // Обработка перенаправления вывода
     if (output_redir) {
-        *output_redir = '\0';
-        output_redir++;
-        while (isspace(*output_redir)) output_redir++;
-        cmd->output_file = strdup(output_redir);
+        cmd->output_file = strdup(trim_string(output_redir));
     }
     
     // Разбор аргументов
-    cmd->argc = parse_arguments(trimmed, &cmd->args, MAX_ARGS);
+    cmd->argc = parse_arguments(trimmed, &cmd->args);
+    
+    // Псевдоним в позиции команды: после префиксных присваиваний
+    shell_state_t *state = shell_current();
+    if (state && state->alias_key != 0) {
+        int position = 0;
+        while (position < cmd->argc && is_assignment(cmd->args[position])) {
+            position++;
+        }
+        alias_expand(state, &cmd->args, &cmd->argc, position);
+    }
+    
+    // Префиксные присваивания NAME=value переносим из аргументов
+    int assign_count = 0;
+    while (assign_count < cmd->argc && is_assignment(cmd->args[assign_count])) {
+        assign_count++;
+    }
+    if (assign_count > 0) {
+        cmd->assigns = malloc((assign_count + 1) * sizeof(char *));
+        if (!cmd->assigns) {
+            free_command(cmd);
+            free(copy);
+            return -1;
+        }
+        memcpy(cmd->assigns, cmd->args, assign_count * sizeof(char *));
+        cmd->assigns[assign_count] = NULL;
+        cmd->assign_count = assign_count;
+        
+        memmove(cmd->args, cmd->args + assign_count,
+                (cmd->argc - assign_count + 1) * sizeof(char *));
+        cmd->argc -= assign_count;
+    }
+    
     if (cmd->argc > 0) {
         cmd->name = strdup(cmd->args[0]);
     }
     
-    free(trimmed);
+    free(copy);
     return 0;
 }
 
@@ -131,8 +405,8 @@ int process_history_expansion(const char *input, char *output, size_t max_output
     }
     
     // Получаем доступ к состоянию оболочки
-    extern shell_state_t *g_shell_state;
-    if (!g_shell_state) {
+    shell_state_t *state = shell_current();
+    if (!state) {
         strncpy(output, input, max_output_size - 1);
         output[max_output_size - 1] = '\0';
         return 0;
@@ -153,7 +427,7 @@ int process_history_expansion(const char *input, char *output, size_t max_output
                     j++;
                 }
                 
-                const char *history_cmd = get_history_by_number(g_shell_state, number);
+                const char *history_cmd = get_history_by_number(state, number);
                 if (history_cmd) {
                     size_t cmd_len = strlen(history_cmd);
                     if (output_pos + cmd_len < max_output_size - 1) {
@@ -179,7 +453,7 @@ int process_history_expansion(const char *input, char *output, size_t max_output
                     strncpy(prefix, input + i + 1, prefix_len);
                     prefix[prefix_len] = '\0';
                     
-                    const char *history_cmd = get_last_command_by_prefix(g_shell_state, prefix);
+                    const char *history_cmd = get_last_command_by_prefix(state, prefix);
                     if (history_cmd) {
                         size_t cmd_len = strlen(history_cmd);
                         if (output_pos + cmd_len < max_output_size - 1) {
@@ -207,12 +481,11 @@ int process_history_expansion(const char *input, char *output, size_t max_output
 /**
  * @brief Разбор аргументов команды
  * @param args_str Строка с аргументами
- * @param args Массив для аргументов
- * @param max_args Максимальное количество аргументов
+ * @param args Массив для аргументов (размер по числу слов, завершён NULL)
  * @return Количество аргументов
  */
-int parse_arguments(const char *args_str, char ***args, int max_args) {
-    if (!args_str || !args || max_args <= 0) {
+int parse_arguments(const char *args_str, char ***args) {
+    if (!args_str || !args) {
         return 0;
     }
     
@@ -232,9 +505,10 @@ int parse_arguments(const char *args_str, char ***args, int max_args) {
         return 0;
     }
     
-    // Копирование аргументов
+    // Копирование аргументов: массив рассчитан на все слова строки, лишние
+    // слова не отбрасываются
     int arg_count = 0;
-    for (int i = 0; i < part_count && arg_count < max_args; i++) {
+    for (int i = 0; i < part_count; i++) {
         if (strlen(parts[i]) > 0) {
             (*args)[arg_count] = strdup(parts[i]);
             arg_count++;
@@ -279,6 +553,13 @@ void free_command(command_t *cmd) {
         free(cmd->output_file);
     }
     
+    if (cmd->assigns) {
+        for (int i = 0; i < cmd->assign_count; i++) {
+            free(cmd->assigns[i]);
+        }
+        free(cmd->assigns);
+    }
+    
     memset(cmd, 0, sizeof(command_t));
 }
 
@@ -307,18 +588,5 @@ int is_builtin(const char *cmd_name) {
         return 0;
     }
     
-    const char *builtins[] = {
-        "cd", "pwd", "echo", "exit", "help", "clear", "history",
-        "touch", "rm", "mkdir", "rmdir", "ls"
-    };
-    
-    int builtin_count = sizeof(builtins) / sizeof(builtins[0]);
-    
-    for (int i = 0; i < builtin_count; i++) {
-        if (strcmp(cmd_name, builtins[i]) == 0) {
-            return 1;
-        }
-    }
-    
-    return 0;
+    return builtin_exists(cmd_name);
 }
@@ -0,0 +1,229 @@
+/**
+ * @file pipestats.c
+ * @brief Реализация статистики звеньев конвейера (PIPESTATUS, pipestats)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "pipestats.h"
+#include "builtins.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/**
+ * @brief Текущее время по монотонным часам
+ * @return Секунды
+ */
+double pipestats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Создание пустой статистики конвейера
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ * @return Статистика или NULL при нехватке памяти
+ */
+pipeline_stats_t *pipestats_create(const command_t *commands, int count) {
+    pipeline_stats_t *stats = malloc(sizeof(*stats));
+    if (!stats) {
+        return NULL;
+    }
+    stats->stages = calloc((size_t)count, sizeof(*stats->stages));
+    if (!stats->stages) {
+        free(stats);
+        return NULL;
+    }
+
+    stats->count = count;
+    stats->started = pipestats_now();
+    stats->wall = 0;
+    for (int i = 0; i < count; i++) {
+        snprintf(stats->stages[i].name, PIPESTATS_NAME_MAX, "%s",
+                 commands[i].name ? commands[i].name : "-");
+        stats->stages[i].status = -1;
+    }
+    return stats;
+}
+
+/**
+ * @brief Замер заполнения входного канала звена
+ * @param stage Звено
+ * @param fd Копия читающего конца канала
+ *
+ * @details Канал считается заполненным, если в нём не помещается ещё
+ * PIPE_BUF байт: запись такого размера уже остановила бы пишущее звено.
+ */
+void pipestats_sample(pipeline_stage_stats_t *stage, int fd) {
+    int queued = 0;
+    if (ioctl(fd, FIONREAD, &queued) == -1) {
+        return;
+    }
+    int capacity = fcntl(fd, F_GETPIPE_SZ);
+
+    stage->samples++;
+    stage->pipe_total += queued;
+    if (queued > stage->pipe_max) {
+        stage->pipe_max = queued;
+    }
+    if (capacity > 0 && queued + PIPE_BUF > capacity) {
+        stage->full_samples++;
+    }
+}
+
+/**
+ * @brief Сохранение завершённого конвейера в текущем состоянии
+ * @param stats Статистика
+ */
+void pipestats_commit(pipeline_stats_t *stats) {
+    shell_state_t *state = shell_current();
+    if (!state) {
+        free(stats->stages);
+        free(stats);
+        return;
+    }
+
+    size_t used = 0;
+    state->pipe_status[0] = '\0';
+    for (int i = 0; i < stats->count && used < sizeof(state->pipe_status); i++) {
+        int n = snprintf(state->pipe_status + used, sizeof(state->pipe_status) - used,
+                         i > 0 ? " %d" : "%d", stats->stages[i].status);
+        if (n < 0) {
+            break;
+        }
+        used += (size_t)n;
+    }
+
+    pipestats_free(state);
+    state->pipeline = stats;
+}
+
+/**
+ * @brief Обновление PIPESTATUS после одиночной команды
+ * @param exit_code Код выхода команды
+ */
+void pipestats_set_single(int exit_code) {
+    shell_state_t *state = shell_current();
+    if (state) {
+        snprintf(state->pipe_status, sizeof(state->pipe_status), "%d", exit_code);
+    }
+}
+
+/**
+ * @brief Освобождение статистики состояния
+ * @param state Состояние оболочки
+ */
+void pipestats_free(shell_state_t *state) {
+    if (state && state->pipeline) {
+        free(state->pipeline->stages);
+        free(state->pipeline);
+        state->pipeline = NULL;
+    }
+}
+
+/**
+ * @brief Вывод таблицы последнего конвейера
+ * @param stats Статистика
+ */
+static void pipestats_print(const pipeline_stats_t *stats) {
+    fprintf(shell_stdout(), "Конвейер из %d звеньев, %.3f с\n", stats->count, stats->wall);
+    // Заголовок выровнен вручную: printf считает ширину в байтах, а не символах
+    fprintf(shell_stdout(), "%s\n", "  #  команда            код     время    польз.     сист.  входной канал: ср./макс., полон");
+
+    int sampled = 0;
+    for (int i = 0; i < stats->count; i++) {
+        const pipeline_stage_stats_t *stage = &stats->stages[i];
+        fprintf(shell_stdout(), "%3d  %-16s %5d %9.3f %9.3f %9.3f  ", i + 1, stage->name,
+                stage->status, stage->wall, stage->user, stage->sys);
+        if (stage->samples > 0) {
+            fprintf(shell_stdout(), "%lld / %lld байт, %d%%\n", stage->pipe_total / stage->samples,
+                    stage->pipe_max, stage->full_samples * 100 / stage->samples);
+            sampled = 1;
+        } else {
+            fprintf(shell_stdout(), "-\n");
+        }
+    }
+
+    if (!sampled) {
+        fprintf(shell_stdout(), "Заполнение каналов не замерялось (pipestats -s on)\n");
+    }
+
+    // Полный канал значит, что звено после него не успевает читать и
+    // задерживает всех, кто пишет до него
+    int slowest = -1;
+    if (sampled) {
+        int best = 0;
+        for (int i = 1; i < stats->count; i++) {
+            const pipeline_stage_stats_t *stage = &stats->stages[i];
+            int full = stage->samples > 0 ? stage->full_samples * 100 / stage->samples : 0;
+            if (full > best) {
+                best = full;
+                slowest = i;
+            }
+        }
+        if (slowest != -1) {
+            fprintf(shell_stdout(), "Узкое место: звено %d (%s), канал перед ним заполнен в %d%% замеров\n",
+                    slowest + 1, stats->stages[slowest].name, best);
+            return;
+        }
+    }
+
+    double best = 0;
+    for (int i = 0; i < stats->count; i++) {
+        double cpu = stats->stages[i].user + stats->stages[i].sys;
+        if (cpu > best) {
+            best = cpu;
+            slowest = i;
+        }
+    }
+    if (slowest != -1) {
+        fprintf(shell_stdout(), "Больше всего процессорного времени: звено %d (%s), %.3f с\n",
+                slowest + 1, stats->stages[slowest].name, best);
+    }
+}
+
+/**
+ * @brief Встроенная команда pipestats
+ * @param args Аргументы
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если конвейеров ещё не было, -1 в случае ошибки
+ */
+int builtin_pipestats(char **args, int argc) {
+    shell_state_t *state = shell_current();
+    if (!state) {
+        return -1;
+    }
+
+    if (argc == 2 && strcmp(args[1], "-p") == 0) {
+        fprintf(shell_stdout(), "%s\n", state->pipe_status);
+        return 0;
+    }
+    if (argc == 3 && strcmp(args[1], "-s") == 0 &&
+        (strcmp(args[2], "on") == 0 || strcmp(args[2], "off") == 0)) {
+        state->pipe_sampling = strcmp(args[2], "on") == 0;
+        return 0;
+    }
+    if (argc != 1) {
+        fprintf(shell_stderr(), "Использование: pipestats [-p | -s on|off]\n");
+        return -1;
+    }
+
+    if (!state->pipeline) {
+        fprintf(shell_stdout(), "Конвейеров ещё не было\n");
+        return 1;
+    }
+    pipestats_print(state->pipeline);
+    return 0;
+}
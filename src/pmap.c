@@ -0,0 +1,764 @@
+/**
+ * @file pmap.c
+ * @brief Реализация параллельной обработки потока (встроенная команда pmap)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "pmap.h"
+#include "builtins.h"
+#include "executor.h"
+#include "threadpool.h"
+#include "shell.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**
+ * @def PMAP_READ_SIZE
+ * @brief Размер одного чтения вывода процесса
+ */
+#define PMAP_READ_SIZE 65536
+
+/**
+ * @struct pmap_buffer_t
+ * @brief Растущий буфер
+ */
+typedef struct {
+    char *data;     /**< Данные */
+    size_t len;     /**< Заполнено байт */
+    size_t cap;     /**< Вместимость */
+} pmap_buffer_t;
+
+/**
+ * @struct pmap_chunk_t
+ * @brief Фрагмент в окне порядка вывода
+ */
+typedef struct {
+    long long seq;        /**< Номер фрагмента */
+    pmap_buffer_t out;    /**< Вывод, ещё не переданный дальше */
+    size_t lines;         /**< С -L: сколько строк вывода ещё ожидается */
+    int done;             /**< Вывод фрагмента получен полностью */
+} pmap_chunk_t;
+
+/**
+ * @struct pmap_worker_t
+ * @brief Процесс команды
+ */
+typedef struct {
+    pid_t pid;            /**< Процесс или -1 */
+    int in_fd;            /**< Запись в ввод процесса или -1 */
+    int out_fd;           /**< Чтение вывода процесса или -1 */
+    char *input;          /**< Фрагмент, передаваемый процессу, или NULL */
+    size_t input_len;     /**< Длина фрагмента */
+    size_t input_off;     /**< Уже передано байт */
+    long long out_seq;    /**< Фрагмент, которому принадлежит вывод, или -1 */
+    long long last_seq;   /**< С -L: последний назначенный фрагмент или -1 */
+} pmap_worker_t;
+
+/**
+ * @struct pmap_t
+ * @brief Состояние pmap
+ */
+typedef struct {
+    command_t cmd;            /**< Команда обработки */
+    int jobs;                 /**< Число процессов */
+    int window;               /**< Размер окна в фрагментах */
+    int long_lived;           /**< Режим -L */
+    size_t chunk_size;        /**< Размер фрагмента */
+    pmap_worker_t *workers;   /**< Процессы */
+    pmap_chunk_t *chunks;     /**< Окно (индекс - номер по модулю window) */
+    long long head;           /**< Первый невыведенный фрагмент */
+    long long next_seq;       /**< Номер следующего фрагмента */
+    pmap_buffer_t in;         /**< Прочитанный и ещё не нарезанный ввод */
+    int in_eof;               /**< Ввод закончился */
+    char *staged;             /**< Готовый к отправке фрагмент или NULL */
+    size_t staged_len;        /**< Его длина */
+    size_t staged_lines;      /**< Количество строк в нём */
+    int failed;               /**< Хотя бы один процесс завершился с ошибкой */
+    int mismatch;             /**< С -L: сообщение о числе строк уже выведено */
+} pmap_t;
+
+/**
+ * @brief Добавление данных в буфер
+ * @param buffer Буфер
+ * @param data Данные
+ * @param len Их длина
+ * @return 0 при успехе, -1 при нехватке памяти
+ */
+static int pmap_append(pmap_buffer_t *buffer, const char *data, size_t len) {
+    if (buffer->len + len > buffer->cap) {
+        size_t cap = buffer->cap ? buffer->cap : PMAP_READ_SIZE;
+        while (cap < buffer->len + len) {
+            cap *= 2;
+        }
+        char *grown = realloc(buffer->data, cap);
+        if (!grown) {
+            return -1;
+        }
+        buffer->data = grown;
+        buffer->cap = cap;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return 0;
+}
+
+/**
+ * @brief Полная запись в стандартный вывод
+ * @param data Данные
+ * @param len Их длина
+ * @return 0 при успехе, -1 в случае ошибки
+ */
+static int pmap_write_out(const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(shell_fd(STDOUT_FILENO), data, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Количество строк во фрагменте
+ * @param data Данные
+ * @param len Их длина
+ * @return Число переводов строки плюс незавершённая последняя строка
+ */
+static size_t pmap_count_lines(const char *data, size_t len) {
+    size_t lines = 0;
+    const char *end = data + len;
+    for (const char *p = data; p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL; p++) {
+        lines++;
+    }
+    if (len > 0 && data[len - 1] != '\n') {
+        lines++;
+    }
+    return lines;
+}
+
+/**
+ * @brief Нарезка следующего фрагмента из прочитанного ввода
+ * @param pm Состояние
+ * @return 0 при успехе, -1 при нехватке памяти
+ *
+ * @details Фрагмент заканчивается на последнем переводе строки в буфере.
+ * Строка длиннее фрагмента не разрезается: буфер растёт, пока она не
+ * прочитается целиком.
+ */
+static int pmap_stage(pmap_t *pm) {
+    if (pm->staged || pm->in.len == 0 || (pm->in.len < pm->chunk_size && !pm->in_eof)) {
+        return 0;
+    }
+
+    size_t cut = pm->in.len;
+    if (!pm->in_eof) {
+        while (cut > 0 && pm->in.data[cut - 1] != '\n') {
+            cut--;
+        }
+        if (cut == 0) {
+            size_t cap = pm->in.cap * 2;
+            char *grown = realloc(pm->in.data, cap);
+            if (!grown) {
+                return -1;
+            }
+            pm->in.data = grown;
+            pm->in.cap = cap;
+            return 0;
+        }
+    }
+
+    pm->staged = malloc(cut);
+    if (!pm->staged) {
+        return -1;
+    }
+    memcpy(pm->staged, pm->in.data, cut);
+    pm->staged_len = cut;
+    pm->staged_lines = pmap_count_lines(pm->staged, cut);
+    memmove(pm->in.data, pm->in.data + cut, pm->in.len - cut);
+    pm->in.len -= cut;
+    return 0;
+}
+
+/**
+ * @brief Чтение стандартного ввода
+ * @param pm Состояние
+ * @return 0 при успехе, -1 в случае ошибки
+ *
+ * @details Вызывается после POLLIN, поэтому read не блокируется; O_NONBLOCK
+ * на дескриптор 0 не ставится - он общий с другими процессами.
+ */
+static int pmap_read_input(pmap_t *pm) {
+    if (pm->in.len == pm->in.cap) {
+        return pmap_stage(pm);
+    }
+
+    ssize_t n = read(shell_fd(STDIN_FILENO), pm->in.data + pm->in.len, pm->in.cap - pm->in.len);
+    if (n == -1) {
+        if (errno == EINTR || errno == EAGAIN) {
+            return 0;
+        }
+        fprintf(shell_stderr(), "pmap: чтение ввода: %s\n", strerror(errno));
+        return -1;
+    }
+    if (n == 0) {
+        pm->in_eof = 1;
+    }
+    pm->in.len += (size_t)n;
+    return pmap_stage(pm);
+}
+
+/**
+ * @brief Запуск процесса команды
+ * @param pm Состояние
+ * @param worker Слот процесса
+ * @return 0 при успехе, -1 в случае ошибки
+ *
+ * @details Концы каналов создаются с O_CLOEXEC: иначе процесс унаследовал
+ * бы ввод соседей, и они не получили бы конец ввода.
+ */
+static int pmap_start_worker(pmap_t *pm, pmap_worker_t *worker) {
+    int in_pipe[2], out_pipe[2];
+    if (pipe2(in_pipe, O_CLOEXEC) == -1) {
+        shell_perror("pmap: pipe");
+        return -1;
+    }
+    if (pipe2(out_pipe, O_CLOEXEC) == -1) {
+        shell_perror("pmap: pipe");
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        return -1;
+    }
+
+    worker->pid = execute_start(&pm->cmd, in_pipe[0], out_pipe[1]);
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    if (worker->pid == -1) {
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        return -1;
+    }
+
+    fcntl(in_pipe[1], F_SETFL, O_NONBLOCK);
+    worker->in_fd = in_pipe[1];
+    worker->out_fd = out_pipe[0];
+    worker->out_seq = -1;
+    worker->last_seq = -1;
+    return 0;
+}
+
+/**
+ * @brief Отправка готового фрагмента процессу
+ * @param pm Состояние
+ * @return 1 если фрагмент отправлен, 0 если ждать, -1 в случае ошибки
+ *
+ * @details Без -L фрагмент получает свободный слот и новый процесс, с -L -
+ * процесс с номером seq % N, когда тот принял предыдущий фрагмент.
+ */
+static int pmap_dispatch(pmap_t *pm) {
+    if (!pm->staged || pm->next_seq - pm->head >= pm->window) {
+        return 0;
+    }
+
+    pmap_worker_t *worker = NULL;
+    if (pm->long_lived) {
+        worker = &pm->workers[pm->next_seq % pm->jobs];
+        if (worker->input) {
+            return 0;
+        }
+        if (worker->pid == -1 && pmap_start_worker(pm, worker) != 0) {
+            return -1;
+        }
+    } else {
+        for (int i = 0; i < pm->jobs && !worker; i++) {
+            if (pm->workers[i].pid == -1) {
+                worker = &pm->workers[i];
+            }
+        }
+        if (!worker) {
+            return 0;
+        }
+        if (pmap_start_worker(pm, worker) != 0) {
+            return -1;
+        }
+    }
+
+    long long seq = pm->next_seq++;
+    pmap_chunk_t *chunk = &pm->chunks[seq % pm->window];
+    chunk->seq = seq;
+    chunk->out.len = 0;
+    chunk->lines = pm->staged_lines;
+    chunk->done = 0;
+
+    if (worker->in_fd == -1) {
+        // С -L процесс уже закрыл ввод: фрагмент некому обработать
+        chunk->done = 1;
+        free(pm->staged);
+    } else {
+        worker->input = pm->staged;
+        worker->input_len = pm->staged_len;
+        worker->input_off = 0;
+        worker->last_seq = seq;
+        if (worker->out_seq == -1) {
+            worker->out_seq = seq;
+        }
+    }
+    pm->staged = NULL;
+    return 1;
+}
+
+/**
+ * @brief Передача очередной части фрагмента в ввод процесса
+ * @param pm Состояние
+ * @param worker Процесс
+ *
+ * @details SIGPIPE на время записи блокируется: процесс, завершившийся не
+ * дочитав ввод, даёт EPIPE, а не завершение всей оболочки.
+ */
+static void pmap_feed(pmap_t *pm, pmap_worker_t *worker) {
+    sigset_t pipe_set, saved;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &saved);
+
+    ssize_t n = write(worker->in_fd, worker->input + worker->input_off,
+                      worker->input_len - worker->input_off);
+    int broken = n == -1 && errno == EPIPE;
+    if (n > 0) {
+        worker->input_off += (size_t)n;
+    }
+
+    if (broken) {
+        struct timespec zero = { 0, 0 };
+        sigset_t pending;
+        sigpending(&pending);
+        if (sigismember(&pending, SIGPIPE) && !sigismember(&saved, SIGPIPE)) {
+            sigtimedwait(&pipe_set, NULL, &zero);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (broken || worker->input_off == worker->input_len) {
+        free(worker->input);
+        worker->input = NULL;
+    }
+    // Без -L процесс получает один фрагмент; после EPIPE ввод не нужен
+    if (broken || (!pm->long_lived && !worker->input)) {
+        close(worker->in_fd);
+        worker->in_fd = -1;
+    }
+}
+
+/**
+ * @brief Передача вывода фрагмента дальше или в буфер окна
+ * @param pm Состояние
+ * @param chunk Фрагмент
+ * @param data Данные
+ * @param len Их длина
+ * @return 0 при успехе, -1 в случае ошибки
+ *
+ * @details Вывод первого невыведенного фрагмента пишется сразу, без
+ * копирования; вывод остальных ждёт своей очереди в окне.
+ */
+static int pmap_deliver(pmap_t *pm, pmap_chunk_t *chunk, const char *data, size_t len) {
+    if (chunk->seq == pm->head && chunk->out.len == 0) {
+        return pmap_write_out(data, len);
+    }
+    if (pmap_append(&chunk->out, data, len) != 0) {
+        fprintf(shell_stderr(), "pmap: ошибка выделения памяти\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Вывод готовых фрагментов по порядку
+ * @param pm Состояние
+ * @return 0 при успехе, -1 в случае ошибки
+ */
+static int pmap_emit(pmap_t *pm) {
+    while (pm->head < pm->next_seq) {
+        pmap_chunk_t *chunk = &pm->chunks[pm->head % pm->window];
+        if (chunk->out.len > 0) {
+            if (pmap_write_out(chunk->out.data, chunk->out.len) != 0) {
+                return -1;
+            }
+            chunk->out.len = 0;
+        }
+        if (!chunk->done) {
+            break;
+        }
+        pm->head++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Отметка оставшихся фрагментов процесса завершёнными
+ * @param pm Состояние
+ * @param worker Процесс, закрывший вывод
+ */
+static void pmap_finish_worker_chunks(pmap_t *pm, pmap_worker_t *worker) {
+    if (worker->out_seq == -1) {
+        return;
+    }
+    long long step = pm->long_lived ? pm->jobs : 1;
+    long long last = pm->long_lived ? worker->last_seq : worker->out_seq;
+    for (long long seq = worker->out_seq; seq <= last; seq += step) {
+        pmap_chunk_t *chunk = &pm->chunks[seq % pm->window];
+        if (pm->long_lived && chunk->lines > 0 && !chunk->done && !pm->mismatch) {
+            fprintf(shell_stderr(), "pmap: команда вывела меньше строк, чем получила\n");
+            pm->mismatch = 1;
+            pm->failed = 1;
+        }
+        chunk->done = 1;
+    }
+    worker->out_seq = -1;
+}
+
+/**
+ * @brief Чтение вывода процесса
+ * @param pm Состояние
+ * @param worker Процесс
+ * @return 0 при успехе, -1 в случае ошибки
+ *
+ * @details С -L вывод делится между фрагментами по числу строк: фрагмент
+ * из K строк получает следующие K строк вывода своего процесса.
+ */
+static int pmap_collect(pmap_t *pm, pmap_worker_t *worker) {
+    char buffer[PMAP_READ_SIZE];
+    ssize_t n = read(worker->out_fd, buffer, sizeof(buffer));
+    if (n == -1) {
+        return errno == EINTR || errno == EAGAIN ? 0 : -1;
+    }
+
+    if (n == 0) {
+        close(worker->out_fd);
+        worker->out_fd = -1;
+        pmap_finish_worker_chunks(pm, worker);
+        if (worker->in_fd != -1) {
+            close(worker->in_fd);
+            worker->in_fd = -1;
+        }
+        free(worker->input);
+        worker->input = NULL;
+
+        int status;
+        while (waitpid(worker->pid, &status, 0) == -1 && errno == EINTR) {
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            pm->failed = 1;
+        }
+        worker->pid = -1;
+        return 0;
+    }
+
+    if (!pm->long_lived) {
+        return pmap_deliver(pm, &pm->chunks[worker->out_seq % pm->window], buffer, (size_t)n);
+    }
+
+    const char *p = buffer;
+    const char *end = buffer + n;
+    while (p < end) {
+        if (worker->out_seq == -1) {
+            if (!pm->mismatch) {
+                fprintf(shell_stderr(), "pmap: команда вывела больше строк, чем получила\n");
+                pm->mismatch = 1;
+                pm->failed = 1;
+            }
+            return pmap_write_out(p, (size_t)(end - p));
+        }
+
+        pmap_chunk_t *chunk = &pm->chunks[worker->out_seq % pm->window];
+        const char *q = p;
+        while (q < end && chunk->lines > 0) {
+            const char *newline = memchr(q, '\n', (size_t)(end - q));
+            if (!newline) {
+                q = end;
+                break;
+            }
+            q = newline + 1;
+            chunk->lines--;
+        }
+        if (pmap_deliver(pm, chunk, p, (size_t)(q - p)) != 0) {
+            return -1;
+        }
+        p = q;
+
+        if (chunk->lines == 0) {
+            chunk->done = 1;
+            worker->out_seq = worker->out_seq + pm->jobs <= worker->last_seq
+                              ? worker->out_seq + pm->jobs : -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Проверка, нужно ли приостановить чтение вывода процесса
+ * @param pm Состояние
+ * @param worker Процесс
+ * @return 1 если фрагмент, которому идёт вывод, ждёт очереди и его буфер
+ *         заполнен до PMAP_MAX_BUFFERED
+ *
+ * @details Процесс первого невыведенного фрагмента читается всегда: его
+ * вывод пишется сразу, поэтому остановленные процессы дождутся своей
+ * очереди и взаимной блокировки нет.
+ */
+static int pmap_output_paused(const pmap_t *pm, const pmap_worker_t *worker) {
+    if (worker->out_seq == -1 || worker->out_seq == pm->head) {
+        return 0;
+    }
+    return pm->chunks[worker->out_seq % pm->window].out.len >= PMAP_MAX_BUFFERED;
+}
+
+/**
+ * @brief Завершение всех процессов после прерывания или ошибки
+ * @param pm Состояние
+ */
+static void pmap_abort(pmap_t *pm) {
+    for (int i = 0; i < pm->jobs; i++) {
+        if (pm->workers[i].pid != -1) {
+            kill(pm->workers[i].pid, SIGTERM);
+        }
+    }
+    for (int i = 0; i < pm->jobs; i++) {
+        if (pm->workers[i].pid != -1) {
+            while (waitpid(pm->workers[i].pid, NULL, 0) == -1 && errno == EINTR) {
+            }
+            pm->workers[i].pid = -1;
+        }
+    }
+}
+
+/**
+ * @brief Основной цикл: чтение ввода, раздача фрагментов, сборка вывода
+ * @param pm Состояние
+ * @return 0 в случае успеха, -1 в случае ошибки или прерывания
+ */
+static int pmap_run(pmap_t *pm) {
+    struct pollfd *fds = malloc((size_t)(2 * pm->jobs + 1) * sizeof(*fds));
+    pmap_worker_t **owners = malloc((size_t)(2 * pm->jobs + 1) * sizeof(*owners));
+    if (!fds || !owners) {
+        free(fds);
+        free(owners);
+        fprintf(shell_stderr(), "pmap: ошибка выделения памяти\n");
+        return -1;
+    }
+
+    int result = 0;
+    for (;;) {
+        int dispatched;
+        while ((dispatched = pmap_dispatch(pm)) == 1 && pmap_stage(pm) == 0) {
+        }
+        if (dispatched == -1 || pmap_emit(pm) != 0) {
+            result = -1;
+            break;
+        }
+
+        // С -L ввод процессов закрывается, когда фрагментов больше не будет
+        int input_done = pm->in_eof && pm->in.len == 0 && !pm->staged;
+        int running = 0;
+        for (int i = 0; i < pm->jobs; i++) {
+            pmap_worker_t *worker = &pm->workers[i];
+            if (input_done && worker->in_fd != -1 && !worker->input) {
+                close(worker->in_fd);
+                worker->in_fd = -1;
+            }
+            running += worker->pid != -1;
+        }
+        if (input_done && running == 0 && pm->head == pm->next_seq) {
+            break;
+        }
+
+        nfds_t nfds = 0;
+        if (!pm->staged && !pm->in_eof) {
+            fds[nfds].fd = shell_fd(STDIN_FILENO);
+            fds[nfds].events = POLLIN;
+            owners[nfds++] = NULL;
+        }
+        for (int i = 0; i < pm->jobs; i++) {
+            pmap_worker_t *worker = &pm->workers[i];
+            if (worker->input && worker->in_fd != -1) {
+                fds[nfds].fd = worker->in_fd;
+                fds[nfds].events = POLLOUT;
+                owners[nfds++] = worker;
+            }
+            if (worker->out_fd != -1 && !pmap_output_paused(pm, worker)) {
+                fds[nfds].fd = worker->out_fd;
+                fds[nfds].events = POLLIN;
+                owners[nfds++] = worker;
+            }
+        }
+
+        // Ctrl+C прерывает poll (EINTR) и обработку целиком
+        if (poll(fds, nfds, -1) == -1) {
+            result = -1;
+            break;
+        }
+
+        for (nfds_t i = 0; i < nfds && result == 0; i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            if (!owners[i]) {
+                result = pmap_read_input(pm);
+            } else if (fds[i].events == POLLOUT) {
+                if (owners[i]->in_fd != -1 && owners[i]->input) {
+                    pmap_feed(pm, owners[i]);
+                }
+            } else if (owners[i]->out_fd != -1) {
+                result = pmap_collect(pm, owners[i]);
+            }
+        }
+        if (result != 0) {
+            break;
+        }
+    }
+
+    if (result != 0) {
+        pmap_abort(pm);
+    }
+    free(fds);
+    free(owners);
+    return result;
+}
+
+/**
+ * @brief Разбор размера фрагмента
+ * @param text Число байт с необязательным суффиксом K или M
+ * @param size Указатель для результата
+ * @return 0 в случае успеха, -1 если формат неверный
+ */
+static int pmap_parse_size(const char *text, size_t *size) {
+    char *end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+    switch (*end) {
+        case 'K': case 'k': value <<= 10; end++; break;
+        case 'M': case 'm': value <<= 20; end++; break;
+        default: break;
+    }
+    if (end == text || *end != '\0' || value == 0 || value > (1ULL << 30)) {
+        return -1;
+    }
+    *size = (size_t)value;
+    return 0;
+}
+
+/**
+ * @brief Встроенная команда pmap
+ * @param args Аргументы
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если процесс команды завершился с ошибкой, -1 в случае ошибки
+ */
+int builtin_pmap(char **args, int argc) {
+    pmap_t pm;
+    memset(&pm, 0, sizeof(pm));
+    pm.jobs = threadpool_size();
+    pm.chunk_size = PMAP_DEFAULT_CHUNK;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && strcmp(args[i], "--") != 0; i++) {
+        if (strcmp(args[i], "-j") == 0 && i + 1 < argc) {
+            pm.jobs = atoi(args[++i]);
+            if (pm.jobs < 1 || pm.jobs > PMAP_MAX_JOBS) {
+                fprintf(shell_stderr(), "pmap: число процессов должно быть от 1 до %d\n", PMAP_MAX_JOBS);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-s") == 0 && i + 1 < argc) {
+            if (pmap_parse_size(args[++i], &pm.chunk_size) != 0) {
+                fprintf(shell_stderr(), "pmap: неверный размер фрагмента '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-L") == 0) {
+            pm.long_lived = 1;
+        } else {
+            fprintf(shell_stderr(), "pmap: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: pmap [-j N] [-s размер] [-L] -- команда [аргументы]\n");
+            return -1;
+        }
+    }
+    if (i < argc && strcmp(args[i], "--") == 0) {
+        i++;
+    }
+    if (i >= argc) {
+        fprintf(shell_stderr(), "Использование: pmap [-j N] [-s размер] [-L] -- команда [аргументы]\n");
+        return -1;
+    }
+    // Встроенная команда выполнялась бы в копии оболочки с унаследованными
+    // концами каналов соседних процессов
+    if (is_builtin(args[i])) {
+        fprintf(shell_stderr(), "pmap: %s: встроенные команды не поддерживаются\n", args[i]);
+        return -1;
+    }
+    if (pm.jobs > PMAP_MAX_JOBS) {
+        pm.jobs = PMAP_MAX_JOBS;
+    }
+
+    pm.cmd.name = args[i];
+    pm.cmd.args = &args[i];
+    pm.cmd.argc = argc - i;
+    pm.window = pm.jobs * PMAP_WINDOW_PER_JOB;
+    pm.workers = calloc((size_t)pm.jobs, sizeof(*pm.workers));
+    pm.chunks = calloc((size_t)pm.window, sizeof(*pm.chunks));
+    pm.in.data = malloc(pm.chunk_size);
+    pm.in.cap = pm.chunk_size;
+    if (!pm.workers || !pm.chunks || !pm.in.data) {
+        fprintf(shell_stderr(), "pmap: ошибка выделения памяти\n");
+        free(pm.workers);
+        free(pm.chunks);
+        free(pm.in.data);
+        return -1;
+    }
+    for (int w = 0; w < pm.jobs; w++) {
+        pm.workers[w].pid = -1;
+        pm.workers[w].in_fd = -1;
+        pm.workers[w].out_fd = -1;
+        pm.workers[w].out_seq = -1;
+        pm.workers[w].last_seq = -1;
+    }
+
+    fflush(shell_stdout());
+    int result = pmap_run(&pm);
+
+    for (int w = 0; w < pm.jobs; w++) {
+        if (pm.workers[w].in_fd != -1) {
+            close(pm.workers[w].in_fd);
+        }
+        if (pm.workers[w].out_fd != -1) {
+            close(pm.workers[w].out_fd);
+        }
+        free(pm.workers[w].input);
+    }
+    for (int c = 0; c < pm.window; c++) {
+        free(pm.chunks[c].out.data);
+    }
+    free(pm.workers);
+    free(pm.chunks);
+    free(pm.in.data);
+    free(pm.staged);
+
+    if (result != 0) {
+        return -1;
+    }
+    return pm.failed ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * @file profile.c
+ * @brief Реализация профилировщика строк скриптов (set -o profile)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "profile.h"
+#include "shellstats.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/**
+ * @struct profile_line_t
+ * @brief Накопленная статистика строки скрипта
+ */
+typedef struct profile_line {
+    char *file;                 /**< Файл */
+    int line;                   /**< Номер строки */
+    char *text;                 /**< Текст при первом выполнении */
+    unsigned long calls;        /**< Вызовов */
+    unsigned long long forks;   /**< fork за время строки */
+    uint64_t wall_ns;           /**< Время выполнения */
+    uint64_t cpu_ns;            /**< Процессорное время */
+    struct profile_line *next;  /**< Следующая запись цепочки */
+} profile_line_t;
+
+/**
+ * @struct profile_stack_t
+ * @brief Собственное время одного стека строк
+ */
+typedef struct profile_stack {
+    char *stack;                /**< Стек в свёрнутом формате */
+    uint64_t self_ns;           /**< Собственное время */
+    struct profile_stack *next; /**< Следующая запись цепочки */
+} profile_stack_t;
+
+/**
+ * @struct profile_t
+ * @brief Профиль состояния оболочки
+ */
+typedef struct profile {
+    unsigned long session;                      /**< Номер сеанса */
+    profile_line_t *lines[PROFILE_BUCKETS];     /**< Строки */
+    profile_stack_t *stacks[PROFILE_BUCKETS];   /**< Стеки */
+    int line_count;                             /**< Количество строк */
+    profile_frame_t *top;                       /**< Выполняемая строка */
+    uint64_t total_ns;                          /**< Время строк верхнего уровня */
+} profile_t;
+
+// Номер сеанса отличает записи строк, начатых до перезапуска профиля
+static unsigned long profile_sessions = 0;
+
+/**
+ * @brief Монотонное время
+ * @return Наносекунды
+ */
+static uint64_t profile_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Процессорное время потока и завершившихся дочерних процессов
+ * @return Наносекунды
+ */
+static uint64_t profile_cpu(void) {
+    struct rusage self, children;
+    getrusage(RUSAGE_THREAD, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    uint64_t usec = 0;
+    usec += (uint64_t)self.ru_utime.tv_sec * 1000000 + (uint64_t)self.ru_utime.tv_usec;
+    usec += (uint64_t)self.ru_stime.tv_sec * 1000000 + (uint64_t)self.ru_stime.tv_usec;
+    usec += (uint64_t)children.ru_utime.tv_sec * 1000000 + (uint64_t)children.ru_utime.tv_usec;
+    usec += (uint64_t)children.ru_stime.tv_sec * 1000000 + (uint64_t)children.ru_stime.tv_usec;
+    return usec * 1000;
+}
+
+/**
+ * @brief Хеш строки (FNV-1a)
+ * @param text Строка
+ * @param seed Начальное значение
+ * @return Хеш
+ */
+static uint64_t profile_hash(const char *text, uint64_t seed) {
+    uint64_t hash = 14695981039346656037ULL ^ seed;
+    for (const char *p = text; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Включение профилирования (set -o profile)
+ * @param state Состояние оболочки
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int profile_start(shell_state_t *state) {
+    if (state->profile) {
+        return 0;
+    }
+    state->profile = calloc(1, sizeof(*state->profile));
+    if (!state->profile) {
+        return -1;
+    }
+    state->profile->session = ++profile_sessions;
+    return 0;
+}
+
+/**
+ * @brief Начало строки скрипта
+ * @param state Состояние оболочки
+ * @param frame Запись строки
+ * @param file Файл (строка должна жить до profile_leave)
+ * @param line Номер строки
+ * @param text Текст строки
+ * @return 1 если профилирование включено, 0 иначе
+ */
+int profile_enter(shell_state_t *state, profile_frame_t *frame,
+                  const char *file, int line, const char *text) {
+    profile_t *profile = state->profile;
+    if (!profile) {
+        return 0;
+    }
+
+    frame->parent = profile->top;
+    frame->session = profile->session;
+    frame->file = file;
+    frame->line = line;
+    frame->text = text;
+    frame->child_ns = 0;
+    frame->forks_started = __atomic_load_n(&shellstats_counters[SHELLSTAT_FORK], __ATOMIC_RELAXED);
+    frame->cpu_started_ns = profile_cpu();
+    frame->started_ns = profile_clock();
+    profile->top = frame;
+    return 1;
+}
+
+/**
+ * @brief Запись строки в таблицу
+ * @param profile Профиль
+ * @param frame Строка
+ * @return Запись или NULL при нехватке памяти
+ */
+static profile_line_t *profile_line(profile_t *profile, const profile_frame_t *frame) {
+    uint64_t hash = profile_hash(frame->file, (uint64_t)frame->line);
+    profile_line_t **link = &profile->lines[hash % PROFILE_BUCKETS];
+    for (; *link; link = &(*link)->next) {
+        if ((*link)->line == frame->line && strcmp((*link)->file, frame->file) == 0) {
+            return *link;
+        }
+    }
+
+    profile_line_t *entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        return NULL;
+    }
+    entry->file = strdup(frame->file);
+    entry->text = strdup(frame->text ? frame->text : "");
+    if (!entry->file || !entry->text) {
+        free(entry->file);
+        free(entry->text);
+        free(entry);
+        return NULL;
+    }
+    entry->line = frame->line;
+    *link = entry;
+    profile->line_count++;
+    return entry;
+}
+
+/**
+ * @brief Добавление собственного времени к стеку строки
+ * @param profile Профиль
+ * @param frame Строка (вершина стека)
+ * @param self_ns Собственное время
+ */
+static void profile_add_stack(profile_t *profile, const profile_frame_t *frame, uint64_t self_ns) {
+    const profile_frame_t *chain[PROFILE_MAX_DEPTH];
+    int depth = 0;
+    for (const profile_frame_t *f = frame; f && depth < PROFILE_MAX_DEPTH; f = f->parent) {
+        chain[depth++] = f;
+    }
+
+    char stack[PROFILE_MAX_DEPTH * 64];
+    size_t used = 0;
+    for (int i = depth - 1; i >= 0 && used < sizeof(stack); i--) {
+        int n = snprintf(stack + used, sizeof(stack) - used, "%s%s:%d",
+                         i == depth - 1 ? "" : ";", chain[i]->file, chain[i]->line);
+        if (n < 0) {
+            return;
+        }
+        used += (size_t)n;
+    }
+    if (used >= sizeof(stack)) {
+        used = sizeof(stack) - 1;
+        stack[used] = '\0';
+    }
+    // Перевод строки в имени файла разорвал бы запись свёрнутого формата
+    for (size_t i = 0; i < used; i++) {
+        if (stack[i] == '\n') {
+            stack[i] = '_';
+        }
+    }
+
+    uint64_t hash = profile_hash(stack, 0);
+    profile_stack_t **link = &profile->stacks[hash % PROFILE_BUCKETS];
+    for (; *link; link = &(*link)->next) {
+        if (strcmp((*link)->stack, stack) == 0) {
+            (*link)->self_ns += self_ns;
+            return;
+        }
+    }
+
+    profile_stack_t *entry = malloc(sizeof(*entry));
+    if (!entry || !(entry->stack = strdup(stack))) {
+        free(entry);
+        return;
+    }
+    entry->self_ns = self_ns;
+    entry->next = NULL;
+    *link = entry;
+}
+
+/**
+ * @brief Конец строки скрипта
+ * @param state Состояние оболочки
+ * @param frame Запись строки из profile_enter
+ */
+void profile_leave(shell_state_t *state, profile_frame_t *frame) {
+    profile_t *profile = state->profile;
+    if (!profile || frame->session != profile->session) {
+        // Профиль выключен или перезапущен, пока строка выполнялась
+        return;
+    }
+
+    uint64_t wall = profile_clock() - frame->started_ns;
+    uint64_t cpu = profile_cpu() - frame->cpu_started_ns;
+    unsigned long long forks = __atomic_load_n(&shellstats_counters[SHELLSTAT_FORK], __ATOMIC_RELAXED) -
+                               frame->forks_started;
+
+    profile_line_t *entry = profile_line(profile, frame);
+    if (entry) {
+        entry->calls++;
+        entry->wall_ns += wall;
+        entry->cpu_ns += cpu;
+        entry->forks += forks;
+    }
+
+    profile_add_stack(profile, frame, wall > frame->child_ns ? wall - frame->child_ns : 0);
+
+    if (frame->parent && frame->parent->session == frame->session) {
+        frame->parent->child_ns += wall;
+    } else {
+        profile->total_ns += wall;
+    }
+    profile->top = frame->parent;
+}
+
+/**
+ * @brief Сравнение строк по убыванию времени для qsort
+ * @param a Первая запись
+ * @param b Вторая запись
+ * @return Результат сравнения
+ */
+static int profile_compare(const void *a, const void *b) {
+    const profile_line_t *left = *(profile_line_t *const *)a;
+    const profile_line_t *right = *(profile_line_t *const *)b;
+    if (left->wall_ns != right->wall_ns) {
+        return left->wall_ns < right->wall_ns ? 1 : -1;
+    }
+    int by_file = strcmp(left->file, right->file);
+    return by_file != 0 ? by_file : left->line - right->line;
+}
+
+/**
+ * @brief Вывод таблицы строк
+ * @param profile Профиль
+ */
+static void profile_report(const profile_t *profile) {
+    profile_line_t **sorted = malloc((size_t)(profile->line_count ? profile->line_count : 1) * sizeof(*sorted));
+    if (!sorted) {
+        return;
+    }
+    int count = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        for (profile_line_t *entry = profile->lines[b]; entry; entry = entry->next) {
+            sorted[count++] = entry;
+        }
+    }
+    qsort(sorted, (size_t)count, sizeof(*sorted), profile_compare);
+
+    fprintf(shell_stderr(), "Профиль: %d строк, %.6f с\n", count, (double)profile->total_ns / 1e9);
+    // Заголовок выровнен вручную: printf считает ширину в байтах, а не символах
+    fprintf(shell_stderr(), "%s\n", "     время, с      ЦП, с   fork  вызовов  строка");
+    for (int i = 0; i < count; i++) {
+        const profile_line_t *entry = sorted[i];
+        fprintf(shell_stderr(), "%13.6f %10.6f %6llu %8lu  %s:%d  %.60s\n",
+                (double)entry->wall_ns / 1e9, (double)entry->cpu_ns / 1e9,
+                entry->forks, entry->calls, entry->file, entry->line, entry->text);
+    }
+    free(sorted);
+}
+
+/**
+ * @brief Запись стеков в свёрнутом формате flamegraph.pl
+ * @param profile Профиль
+ * @param path Файл
+ */
+static void profile_write_collapsed(const profile_t *profile, const char *path) {
+    int fd = openat(shell_cwd_fd(), path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    FILE *out = fd != -1 ? fdopen(fd, "w") : NULL;
+    if (!out) {
+        fprintf(shell_stderr(), "profile: %s: %s\n", path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        for (profile_stack_t *entry = profile->stacks[b]; entry; entry = entry->next) {
+            uint64_t usec = entry->self_ns / 1000;
+            if (usec > 0) {
+                fprintf(out, "%s %llu\n", entry->stack, (unsigned long long)usec);
+            }
+        }
+    }
+    if (fclose(out) != 0) {
+        fprintf(shell_stderr(), "profile: %s: %s\n", path, strerror(errno));
+    }
+}
+
+/**
+ * @brief Освобождение профиля без отчёта
+ * @param state Состояние оболочки
+ */
+void profile_free(shell_state_t *state) {
+    profile_t *profile = state ? state->profile : NULL;
+    if (!profile) {
+        return;
+    }
+
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        profile_line_t *line = profile->lines[b];
+        while (line) {
+            profile_line_t *next = line->next;
+            free(line->file);
+            free(line->text);
+            free(line);
+            line = next;
+        }
+        profile_stack_t *stack = profile->stacks[b];
+        while (stack) {
+            profile_stack_t *next = stack->next;
+            free(stack->stack);
+            free(stack);
+            stack = next;
+        }
+    }
+    free(profile);
+    state->profile = NULL;
+}
+
+/**
+ * @brief Выключение профилирования с выводом отчёта (set +o profile, выход)
+ * @param state Состояние оболочки
+ */
+void profile_stop(shell_state_t *state) {
+    if (!state->profile) {
+        return;
+    }
+
+    profile_report(state->profile);
+    const char *path = get_env_var(PROFILE_OUT_VAR);
+    if (path && *path) {
+        profile_write_collapsed(state->profile, path);
+    }
+    profile_free(state);
+}
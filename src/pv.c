@@ -0,0 +1,388 @@
+/**
+ * @file pv.c
+ * @brief Реализация измерителя потока (встроенная команда pv)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "pv.h"
+#include "builtins.h"
+#include "shell.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * @enum pv_mode_t
+ * @brief Способ переноса данных
+ */
+typedef enum {
+    PV_SPLICE_DIRECT,   /**< Ввод или вывод - канал: один splice */
+    PV_SPLICE_PIPE,     /**< splice через промежуточный канал */
+    PV_COPY             /**< read и write через буфер */
+} pv_mode_t;
+
+/**
+ * @struct pv_t
+ * @brief Состояние pv
+ */
+typedef struct {
+    int in_fd;                  /**< Источник */
+    int out_fd;                 /**< Приёмник */
+    pv_mode_t mode;             /**< Способ переноса */
+    int pipe_fds[2];            /**< Промежуточный канал или -1 */
+    char *buffer;               /**< Буфер режима PV_COPY */
+    unsigned long long total;   /**< Передано байт */
+    unsigned long long size;    /**< Ожидаемый объём или 0 */
+    unsigned long long rate;    /**< Предел скорости (байт/с) или 0 */
+    int interval;               /**< Период обновления (мс) */
+    int quiet;                  /**< Без строки состояния */
+    int live;                   /**< Поток ошибок - терминал: строка обновляется на месте */
+    double started;             /**< Момент начала */
+    double last_report;         /**< Момент последнего обновления */
+    unsigned long long last_total; /**< Объём на момент последнего обновления */
+} pv_t;
+
+/**
+ * @brief Текущее время по монотонным часам
+ * @return Секунды
+ */
+static double pv_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Разбор объёма или скорости
+ * @param text Число с необязательным суффиксом K, M или G
+ * @param value Указатель для результата
+ * @return 0 в случае успеха, -1 если формат неверный
+ */
+static int pv_parse_size(const char *text, unsigned long long *value) {
+    char *end = NULL;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    switch (*end) {
+        case 'K': case 'k': parsed <<= 10; end++; break;
+        case 'M': case 'm': parsed <<= 20; end++; break;
+        case 'G': case 'g': parsed <<= 30; end++; break;
+        default: break;
+    }
+    if (end == text || *end != '\0' || parsed == 0) {
+        return -1;
+    }
+    *value = parsed;
+    return 0;
+}
+
+/**
+ * @brief Форматирование объёма в двоичных единицах
+ * @param bytes Объём
+ * @param buffer Буфер результата
+ * @param size Размер буфера
+ */
+static void pv_format_size(double bytes, char *buffer, size_t size) {
+    static const char *units[] = { "Б", "КиБ", "МиБ", "ГиБ", "ТиБ" };
+    int unit = 0;
+    while (bytes >= 1024.0 && unit < 4) {
+        bytes /= 1024.0;
+        unit++;
+    }
+    if (unit == 0) {
+        snprintf(buffer, size, "%.0f %s", bytes, units[unit]);
+    } else {
+        snprintf(buffer, size, "%.1f %s", bytes, units[unit]);
+    }
+}
+
+/**
+ * @brief Форматирование продолжительности
+ * @param seconds Секунды
+ * @param buffer Буфер результата
+ * @param size Размер буфера
+ */
+static void pv_format_time(double seconds, char *buffer, size_t size) {
+    long long s = (long long)seconds;
+    snprintf(buffer, size, "%lld:%02lld:%02lld", s / 3600, s / 60 % 60, s % 60);
+}
+
+/**
+ * @brief Вывод строки состояния
+ * @param pv Состояние
+ * @param final Итоговая строка (средняя скорость, перевод строки)
+ *
+ * @details Промежуточная скорость считается за период с прошлого
+ * обновления, итоговая - за всё время. На терминале строка
+ * перезаписывается через \\r и очистку до конца строки.
+ */
+static void pv_report(pv_t *pv, int final) {
+    double now = pv_now();
+    double elapsed = now - pv->started;
+    double span = final ? elapsed : now - pv->last_report;
+    unsigned long long moved = final ? pv->total : pv->total - pv->last_total;
+    double speed = span > 0 ? (double)moved / span : 0;
+
+    char total[32], rate[32], time[32];
+    pv_format_size((double)pv->total, total, sizeof(total));
+    pv_format_size(speed, rate, sizeof(rate));
+    pv_format_time(elapsed, time, sizeof(time));
+
+    fprintf(shell_stderr(), "%s%s %s [%s/с]", pv->live ? "\r" : "", total, time, rate);
+    if (pv->size > 0 && !final) {
+        unsigned long long percent = pv->total * 100 / pv->size;
+        fprintf(shell_stderr(), " %llu%%", percent > 100 ? 100 : percent);
+        if (speed > 0 && pv->total < pv->size) {
+            char eta[32];
+            pv_format_time((double)(pv->size - pv->total) / speed, eta, sizeof(eta));
+            fprintf(shell_stderr(), " ETA %s", eta);
+        }
+    }
+    fprintf(shell_stderr(), "%s", pv->live ? "\033[K" : "");
+    if (final || !pv->live) {
+        fprintf(shell_stderr(), "\n");
+    }
+    fflush(shell_stderr());
+
+    pv->last_report = now;
+    pv->last_total = pv->total;
+}
+
+/**
+ * @brief Выбор способа переноса по типам дескрипторов
+ * @param pv Состояние
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int pv_setup(pv_t *pv) {
+    struct stat in_st, out_st;
+    if (fstat(pv->in_fd, &in_st) == -1 || fstat(pv->out_fd, &out_st) == -1) {
+        fprintf(shell_stderr(), "pv: fstat: %s\n", strerror(errno));
+        return -1;
+    }
+
+    // Размер известен только для обычного файла: с текущей позиции до конца
+    if (pv->size == 0 && S_ISREG(in_st.st_mode)) {
+        off_t offset = lseek(pv->in_fd, 0, SEEK_CUR);
+        if (offset >= 0 && in_st.st_size > offset) {
+            pv->size = (unsigned long long)(in_st.st_size - offset);
+        }
+    }
+
+    if (S_ISFIFO(in_st.st_mode) || S_ISFIFO(out_st.st_mode)) {
+        pv->mode = PV_SPLICE_DIRECT;
+    } else if (pipe2(pv->pipe_fds, O_CLOEXEC) == 0) {
+        fcntl(pv->pipe_fds[1], F_SETPIPE_SZ, PV_CHUNK);
+        pv->mode = PV_SPLICE_PIPE;
+    } else {
+        pv->mode = PV_COPY;
+    }
+    return 0;
+}
+
+/**
+ * @brief Перенос следующей порции данных
+ * @param pv Состояние
+ * @param max Наибольший объём порции
+ * @return Перенесено байт, 0 в конце ввода, -1 в случае ошибки
+ *
+ * @details splice отвечает EINVAL, если дескриптор его не поддерживает
+ * (терминал, некоторые файловые системы); тогда pv переходит к read и
+ * write, пока в промежуточном канале ещё нет данных.
+ */
+static ssize_t pv_move(pv_t *pv, size_t max) {
+    if (pv->mode == PV_SPLICE_DIRECT) {
+        ssize_t n = splice(pv->in_fd, NULL, pv->out_fd, NULL, max, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n != -1 || errno != EINVAL || pv->total > 0) {
+            return n;
+        }
+        pv->mode = PV_COPY;
+    }
+
+    if (pv->mode == PV_SPLICE_PIPE) {
+        ssize_t n = splice(pv->in_fd, NULL, pv->pipe_fds[1], NULL, max, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n == -1 && errno == EINVAL && pv->total == 0) {
+            pv->mode = PV_COPY;
+        } else {
+            for (ssize_t left = n; left > 0;) {
+                ssize_t out = splice(pv->pipe_fds[0], NULL, pv->out_fd, NULL, (size_t)left,
+                                     SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (out == -1 && errno == EINTR) {
+                    continue;
+                }
+                if (out <= 0) {
+                    return -1;
+                }
+                left -= out;
+            }
+            return n;
+        }
+    }
+
+    if (!pv->buffer) {
+        pv->buffer = malloc(PV_CHUNK);
+        if (!pv->buffer) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    ssize_t n = read(pv->in_fd, pv->buffer, max < PV_CHUNK ? max : PV_CHUNK);
+    for (ssize_t done = 0; n > 0 && done < n;) {
+        ssize_t out = write(pv->out_fd, pv->buffer + done, (size_t)(n - done));
+        if (out == -1 && errno == EINTR) {
+            continue;
+        }
+        if (out <= 0) {
+            return -1;
+        }
+        done += out;
+    }
+    return n;
+}
+
+/**
+ * @brief Основной цикл переноса
+ * @param pv Состояние
+ * @return 0 в случае успеха, -1 в случае ошибки или прерывания
+ *
+ * @details Перед каждой порцией ввод ждётся через poll не дольше, чем до
+ * следующего обновления, чтобы строка состояния обновлялась и при
+ * остановившемся потоке. С пределом скорости порция не больше десятой
+ * доли секундного объёма, а после неё pv спит, пока средняя скорость
+ * с начала не опустится до предела.
+ */
+static int pv_run(pv_t *pv) {
+    pv->started = pv_now();
+    pv->last_report = pv->started;
+
+    for (;;) {
+        double now = pv_now();
+        if (!pv->quiet && pv->live && (now - pv->last_report) * 1000 >= pv->interval) {
+            pv_report(pv, 0);
+        }
+
+        int timeout = pv->quiet || !pv->live
+                      ? -1 : (int)(pv->interval - (now - pv->last_report) * 1000) + 1;
+        struct pollfd fd = { .fd = pv->in_fd, .events = POLLIN };
+        int ready = poll(&fd, 1, timeout);
+        // Ctrl+C прерывает poll (EINTR)
+        if (ready == -1) {
+            return -1;
+        }
+        if (ready == 0) {
+            continue;
+        }
+
+        size_t max = PV_CHUNK;
+        if (pv->rate > 0 && pv->rate / 10 < max) {
+            max = pv->rate / 10 > 0 ? (size_t)(pv->rate / 10) : 1;
+        }
+
+        ssize_t n = pv_move(pv, max);
+        if (n == 0) {
+            return 0;
+        }
+        if (n == -1) {
+            if (errno == EINTR) {
+                return -1;
+            }
+            fprintf(shell_stderr(), "pv: %s\n", strerror(errno));
+            return -1;
+        }
+        pv->total += (unsigned long long)n;
+
+        if (pv->rate > 0) {
+            double ahead = (double)pv->total / (double)pv->rate - (pv_now() - pv->started);
+            if (ahead > 0) {
+                struct timespec pause = { (time_t)ahead, (long)((ahead - (double)(time_t)ahead) * 1e9) };
+                if (nanosleep(&pause, NULL) == -1) {
+                    return -1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Встроенная команда pv
+ * @param args Аргументы
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки или прерывания
+ */
+int builtin_pv(char **args, int argc) {
+    pv_t pv;
+    memset(&pv, 0, sizeof(pv));
+    pv.in_fd = shell_fd(STDIN_FILENO);
+    pv.out_fd = shell_fd(STDOUT_FILENO);
+    pv.pipe_fds[0] = pv.pipe_fds[1] = -1;
+    pv.interval = PV_DEFAULT_INTERVAL_MS;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        if (strcmp(args[i], "-q") == 0) {
+            pv.quiet = 1;
+        } else if (strcmp(args[i], "-i") == 0 && i + 1 < argc) {
+            double seconds = atof(args[++i]);
+            if (seconds <= 0) {
+                fprintf(shell_stderr(), "pv: период обновления должен быть положительным\n");
+                return -1;
+            }
+            pv.interval = (int)(seconds * 1000);
+        } else if (strcmp(args[i], "-L") == 0 && i + 1 < argc) {
+            if (pv_parse_size(args[++i], &pv.rate) != 0) {
+                fprintf(shell_stderr(), "pv: неверная скорость '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-s") == 0 && i + 1 < argc) {
+            if (pv_parse_size(args[++i], &pv.size) != 0) {
+                fprintf(shell_stderr(), "pv: неверный размер '%s'\n", args[i]);
+                return -1;
+            }
+        } else {
+            fprintf(shell_stderr(), "pv: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: pv [-q] [-i секунды] [-L скорость] [-s размер] [файл]\n");
+            return -1;
+        }
+    }
+
+    if (i + 1 < argc) {
+        fprintf(shell_stderr(), "Использование: pv [-q] [-i секунды] [-L скорость] [-s размер] [файл]\n");
+        return -1;
+    }
+    if (i < argc) {
+        pv.in_fd = openat(shell_cwd_fd(), args[i], O_RDONLY | O_CLOEXEC);
+        if (pv.in_fd == -1) {
+            fprintf(shell_stderr(), "pv: %s: %s\n", args[i], strerror(errno));
+            return -1;
+        }
+    }
+
+    fflush(shell_stdout());
+    pv.live = isatty(shell_fd(STDERR_FILENO));
+    int result = pv_setup(&pv);
+    if (result == 0) {
+        result = pv_run(&pv);
+        if (!pv.quiet) {
+            pv_report(&pv, 1);
+        }
+    }
+
+    if (pv.pipe_fds[0] != -1) {
+        close(pv.pipe_fds[0]);
+        close(pv.pipe_fds[1]);
+    }
+    if (i < argc) {
+        close(pv.in_fd);
+    }
+    free(pv.buffer);
+    return result;
+}
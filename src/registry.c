@@ -0,0 +1,349 @@
+/**
+ * @file registry.c
+ * @brief Реализация таблицы встроенных команд и загрузки enable -f
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "registry.h"
+#include "shellplugin.h"
+#include "builtins.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+/**
+ * @struct builtin_entry_t
+ * @brief Собственная команда оболочки
+ */
+typedef struct {
+    const char *name;                       /**< Имя команды */
+    int (*run)(char **args, int argc);      /**< Обработчик */
+} builtin_entry_t;
+
+static const builtin_entry_t builtin_table[] = {
+    {"cd", builtin_cd},
+    {"pwd", builtin_pwd},
+    {"echo", builtin_echo},
+    {"exit", builtin_exit},
+    {"help", builtin_help},
+    {"clear", builtin_clear},
+    {"history", builtin_history},
+    {"touch", builtin_touch},
+    {"rm", builtin_rm},
+    {"mkdir", builtin_mkdir},
+    {"rmdir", builtin_rmdir},
+    {"ls", builtin_ls},
+    {"env", builtin_env},
+    {"exec", builtin_exec},
+    {"trap", builtin_trap},
+    {"checksum", builtin_checksum},
+    {"head", builtin_head},
+    {"tail", builtin_tail},
+    {"cut", builtin_cut},
+    {"jobs", builtin_jobs},
+    {"fg", builtin_fg},
+    {"wait", builtin_wait},
+    {"kill", builtin_kill},
+    {"cache", builtin_cache},
+    {"run-graph", builtin_run_graph},
+    {"watch", builtin_watch},
+    {"pmap", builtin_pmap},
+    {"pv", builtin_pv},
+    {"pipestats", builtin_pipestats},
+    {"shellstats", builtin_shellstats},
+    {"set", builtin_set},
+    {"source", builtin_source},
+    {".", builtin_source},
+    {"hook", builtin_hook},
+    {"enable", builtin_enable},
+    {"alias", builtin_alias},
+    {"unalias", builtin_unalias},
+};
+
+#define BUILTIN_TABLE_SIZE ((int)(sizeof(builtin_table) / sizeof(builtin_table[0])))
+
+/**
+ * @struct plugin_slot_t
+ * @brief Загруженная команда
+ *
+ * @details def публикуется последним (release), читатели загружают его
+ * с acquire; остальные поля меняются только под plugin_lock.
+ */
+typedef struct {
+    const shell_builtin_def_t *def;     /**< Описание из библиотеки или NULL */
+    void *handle;                       /**< Дескриптор dlopen */
+    char *path;                         /**< Путь к библиотеке (для enable) */
+} plugin_slot_t;
+
+static plugin_slot_t plugin_slots[REGISTRY_MAX_PLUGINS];
+
+// Количество когда-либо занятых слотов: граница поиска для читателей
+static int plugin_slots_used = 0;
+
+static pthread_mutex_t plugin_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Поиск собственной команды
+ * @param name Имя команды
+ * @return Запись таблицы или NULL
+ */
+static const builtin_entry_t *builtin_find(const char *name) {
+    for (int i = 0; i < BUILTIN_TABLE_SIZE; i++) {
+        if (strcmp(name, builtin_table[i].name) == 0) {
+            return &builtin_table[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Поиск загруженной команды
+ * @param name Имя команды
+ * @return Описание команды или NULL
+ */
+static const shell_builtin_def_t *plugin_find(const char *name) {
+    int used = __atomic_load_n(&plugin_slots_used, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < used; i++) {
+        const shell_builtin_def_t *def = __atomic_load_n(&plugin_slots[i].def, __ATOMIC_ACQUIRE);
+        if (def && strcmp(name, def->name) == 0) {
+            return def;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Поиск встроенной команды
+ * @param name Имя команды
+ * @return 1 если команда встроенная или загруженная, 0 иначе
+ */
+int builtin_exists(const char *name) {
+    return builtin_find(name) != NULL || plugin_find(name) != NULL;
+}
+
+/**
+ * @brief Запись в поток stdio (приёмник вывода загруженной команды)
+ * @param handle Поток
+ * @param data Данные
+ * @param size Размер
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int plugin_sink_write(void *handle, const char *data, size_t size) {
+    // Через stdio вывод не обгоняет ещё не записанный вывод встроенных команд
+    return fwrite(data, 1, size, (FILE *)handle) == size ? 0 : -1;
+}
+
+/**
+ * @brief Чтение переменной для загруженной команды
+ * @param name Имя переменной
+ * @return Значение или NULL
+ */
+static const char *plugin_get_var(const char *name) {
+    return get_env_var(name);
+}
+
+/**
+ * @brief Вызов встроенной команды по имени
+ * @param name Имя команды
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return Код выхода команды или -1, если команды нет
+ */
+int builtin_dispatch(const char *name, char **args, int argc) {
+    const builtin_entry_t *entry = builtin_find(name);
+    if (entry) {
+        return entry->run(args, argc);
+    }
+
+    const shell_builtin_def_t *def = plugin_find(name);
+    if (!def) {
+        return -1;
+    }
+    shell_builtin_call_t call = {
+        .abi_version = SHELL_BUILTIN_ABI_VERSION,
+        .argc = argc,
+        .argv = (const char *const *)args,
+        .out = {shell_stdout(), plugin_sink_write},
+        .err = {shell_stderr(), plugin_sink_write},
+        .get_var = plugin_get_var,
+        .set_var = set_env_var,
+    };
+    return def->run(&call);
+}
+
+/**
+ * @brief Загрузка команды из разделяемой библиотеки
+ * @param path Путь к библиотеке
+ * @param name Имя команды
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_load(const char *path, const char *name) {
+    if (builtin_find(name)) {
+        fprintf(shell_stderr(), "enable: %s: собственная команда оболочки\n", name);
+        return -1;
+    }
+
+    char symbol[128];
+    if (snprintf(symbol, sizeof(symbol), "%s%s", name, SHELL_BUILTIN_SYMBOL_SUFFIX) >= (int)sizeof(symbol)) {
+        fprintf(shell_stderr(), "enable: %s: слишком длинное имя\n", name);
+        return -1;
+    }
+    for (char *p = symbol; *p; p++) {
+        if (*p == '-') {
+            *p = '_';
+        }
+    }
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(shell_stderr(), "enable: %s\n", dlerror());
+        return -1;
+    }
+    const shell_builtin_def_t *def = dlsym(handle, symbol);
+    if (!def) {
+        fprintf(shell_stderr(), "enable: %s: нет символа %s\n", path, symbol);
+        dlclose(handle);
+        return -1;
+    }
+    if (def->abi_version != SHELL_BUILTIN_ABI_VERSION) {
+        fprintf(shell_stderr(), "enable: %s: версия ABI %u, оболочка поддерживает %d\n",
+                path, def->abi_version, SHELL_BUILTIN_ABI_VERSION);
+        dlclose(handle);
+        return -1;
+    }
+    if (!def->name || strcmp(def->name, name) != 0 || !def->run) {
+        fprintf(shell_stderr(), "enable: %s: неверное описание команды %s\n", path, name);
+        dlclose(handle);
+        return -1;
+    }
+
+    pthread_mutex_lock(&plugin_lock);
+    int free_slot = -1;
+    for (int i = 0; i < REGISTRY_MAX_PLUGINS; i++) {
+        if (plugin_slots[i].def && strcmp(plugin_slots[i].def->name, name) == 0) {
+            pthread_mutex_unlock(&plugin_lock);
+            fprintf(shell_stderr(), "enable: %s: команда уже загружена\n", name);
+            dlclose(handle);
+            return -1;
+        }
+        if (!plugin_slots[i].def && free_slot == -1) {
+            free_slot = i;
+        }
+    }
+    if (free_slot == -1) {
+        pthread_mutex_unlock(&plugin_lock);
+        fprintf(shell_stderr(), "enable: не больше %d загруженных команд\n", REGISTRY_MAX_PLUGINS);
+        dlclose(handle);
+        return -1;
+    }
+    char *path_copy = strdup(path);
+    if (!path_copy) {
+        pthread_mutex_unlock(&plugin_lock);
+        fprintf(shell_stderr(), "enable: недостаточно памяти\n");
+        dlclose(handle);
+        return -1;
+    }
+
+    plugin_slot_t *slot = &plugin_slots[free_slot];
+    free(slot->path);
+    slot->path = path_copy;
+    slot->handle = handle;
+    __atomic_store_n(&slot->def, def, __ATOMIC_RELEASE);
+    if (free_slot >= plugin_slots_used) {
+        __atomic_store_n(&plugin_slots_used, free_slot + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&plugin_lock);
+    return 0;
+}
+
+/**
+ * @brief Удаление загруженной команды
+ * @param name Имя команды
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_unload(const char *name) {
+    pthread_mutex_lock(&plugin_lock);
+    for (int i = 0; i < plugin_slots_used; i++) {
+        if (plugin_slots[i].def && strcmp(plugin_slots[i].def->name, name) == 0) {
+            // dlclose не вызывается: обработчик может выполняться в другом контексте
+            __atomic_store_n(&plugin_slots[i].def, NULL, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&plugin_lock);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&plugin_lock);
+    fprintf(shell_stderr(), "enable: %s: не загруженная команда\n", name);
+    return -1;
+}
+
+/**
+ * @brief Вывод списка команд в формате enable
+ * @param out Поток вывода
+ */
+void builtin_list(FILE *out) {
+    for (int i = 0; i < BUILTIN_TABLE_SIZE; i++) {
+        fprintf(out, "enable %s\n", builtin_table[i].name);
+    }
+    pthread_mutex_lock(&plugin_lock);
+    for (int i = 0; i < plugin_slots_used; i++) {
+        const shell_builtin_def_t *def = plugin_slots[i].def;
+        if (def) {
+            fprintf(out, "enable -f %s %s", plugin_slots[i].path, def->name);
+            if (def->usage) {
+                fprintf(out, "\t# %s", def->usage);
+            }
+            fprintf(out, "\n");
+        }
+    }
+    pthread_mutex_unlock(&plugin_lock);
+}
+
+/**
+ * @brief Встроенная команда enable (загрузка команд из библиотек)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если часть команд не обработана, -1 в случае ошибки
+ */
+int builtin_enable(char **args, int argc) {
+    if (argc == 1) {
+        builtin_list(shell_stdout());
+        return 0;
+    }
+
+    // Таблица общая для процесса: контекст не меняет команды встраивающей программы
+    shell_state_t *state = shell_current();
+    if (state && state->embedded) {
+        fprintf(shell_stderr(), "enable: недоступно во встроенном контексте\n");
+        return -1;
+    }
+
+    int first = 0;
+    const char *path = NULL;
+    if (strcmp(args[1], "-f") == 0 && argc >= 4) {
+        path = args[2];
+        first = 3;
+    } else if (strcmp(args[1], "-d") == 0 && argc >= 3) {
+        first = 2;
+    } else {
+        fprintf(shell_stderr(), "Использование: enable [-f библиотека имя... | -d имя...]\n");
+        return -1;
+    }
+
+    int failed = 0;
+    for (int i = first; i < argc; i++) {
+        int result = path ? builtin_load(path, args[i]) : builtin_unload(args[i]);
+        if (result != 0) {
+            failed++;
+        }
+    }
+    if (failed == 0) {
+        return 0;
+    }
+    return failed < argc - first ? 1 : -1;
+}
@@ -0,0 +1,402 @@
+/**
+ * @file server.c
+ * @brief Реализация многосессионного сервера оболочки
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "server.h"
+#include "customshell.h"
+#include "shell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/**
+ * @def SERVER_READ_CHUNK
+ * @brief Минимальное свободное место в буфере сессии перед чтением
+ */
+#define SERVER_READ_CHUNK 4096
+
+/**
+ * @struct server_session_t
+ * @brief Соединение клиента
+ */
+typedef struct server_session {
+    int fd;                       /**< Сокет клиента */
+    shell_context_t *ctx;         /**< Контекст интерпретатора сессии */
+    char *buffer;                 /**< Принятые, но ещё не выполненные данные */
+    size_t length;                /**< Длина данных в буфере */
+    size_t capacity;              /**< Размер буфера */
+    pthread_mutex_t lock;         /**< Обработка событий сессии рабочим потоком */
+    struct server_session *prev;  /**< Предыдущая сессия списка */
+    struct server_session *next;  /**< Следующая сессия списка */
+} server_session_t;
+
+// Сокет в epoll зарегистрирован с EPOLLONESHOT: событие получает ровно
+// один рабочий поток, и сессия никогда не обрабатывается двумя потоками сразу.
+// Мьютекс сессии при этом не ждёт, а явно передаёт её данные следующему потоку:
+// повторная подписка (EPOLL_CTL_MOD) не упорядочивает память для TSan
+static int epoll_fd = -1;
+static int listen_fd = -1;
+static int stop_fd = -1;
+
+// Список открытых сессий для закрытия при остановке сервера
+static server_session_t *sessions = NULL;
+static pthread_mutex_t sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Повторная подписка на событие сокета
+ * @param fd Дескриптор
+ * @param events Маска событий
+ * @param ptr Данные события
+ * @param op EPOLL_CTL_ADD или EPOLL_CTL_MOD
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int server_arm(int fd, uint32_t events, void *ptr, int op) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events | EPOLLONESHOT;
+    ev.data.ptr = ptr;
+    return epoll_ctl(epoll_fd, op, fd, &ev);
+}
+
+/**
+ * @brief Закрытие сессии
+ * @param session Сессия
+ */
+static void session_close(server_session_t *session) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+    
+    pthread_mutex_lock(&sessions_lock);
+    if (session->prev) {
+        session->prev->next = session->next;
+    } else {
+        sessions = session->next;
+    }
+    if (session->next) {
+        session->next->prev = session->prev;
+    }
+    pthread_mutex_unlock(&sessions_lock);
+    
+    shell_context_destroy(session->ctx);
+    close(session->fd);
+    free(session->buffer);
+    pthread_mutex_destroy(&session->lock);
+    free(session);
+}
+
+/**
+ * @brief Создание сессии для принятого соединения
+ * @param fd Сокет клиента
+ */
+static void session_open(int fd) {
+    server_session_t *session = calloc(1, sizeof(server_session_t));
+    if (session) {
+        session->fd = fd;
+        session->ctx = shell_context_create();
+        pthread_mutex_init(&session->lock, NULL);
+    }
+    if (!session || !session->ctx) {
+        fprintf(stderr, "server: не удалось создать сессию\n");
+        if (session) {
+            pthread_mutex_destroy(&session->lock);
+            free(session);
+        }
+        close(fd);
+        return;
+    }
+    
+    shell_context_set_output(session->ctx, fd);
+    
+    pthread_mutex_lock(&sessions_lock);
+    session->next = sessions;
+    if (sessions) {
+        sessions->prev = session;
+    }
+    sessions = session;
+    pthread_mutex_unlock(&sessions_lock);
+    
+    if (server_arm(fd, EPOLLIN | EPOLLRDHUP, session, EPOLL_CTL_ADD) != 0) {
+        perror("server: epoll_ctl");
+        session_close(session);
+    }
+}
+
+/**
+ * @brief Приём всех ожидающих соединений
+ */
+static void server_accept(void) {
+    for (;;) {
+        // Сокет клиента не наследуется командами других сессий
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("server: accept");
+            }
+            break;
+        }
+        session_open(fd);
+    }
+    
+    server_arm(listen_fd, EPOLLIN, &listen_fd, EPOLL_CTL_MOD);
+}
+
+/**
+ * @brief Выполнение полных строк из буфера сессии
+ * @param session Сессия
+ * @param flush Выполнить и неполную последнюю строку (клиент закрыл запись)
+ * @return 0 если сессия продолжается, -1 если клиент выполнил exit
+ */
+static int session_execute(server_session_t *session, int flush) {
+    if (session->length == 0) {
+        return 0;
+    }
+    
+    char *end = flush ? session->buffer + session->length - 1
+                      : memrchr(session->buffer, '\n', session->length);
+    if (!end) {
+        return 0;
+    }
+    
+    // Строки до последнего '\n' выполняются одним скриптом
+    size_t used = (size_t)(end - session->buffer) + 1;
+    char saved = session->buffer[used];
+    session->buffer[used] = '\0';
+    shell_context_eval_string(session->ctx, session->buffer);
+    session->buffer[used] = saved;
+    
+    session->length -= used;
+    memmove(session->buffer, session->buffer + used, session->length);
+    
+    return session->ctx->should_exit ? -1 : 0;
+}
+
+/**
+ * @brief Чтение и выполнение команд сессии
+ * @param session Сессия
+ * @return 0 если сессия продолжается, -1 если её нужно закрыть
+ */
+static int session_read(server_session_t *session) {
+    for (;;) {
+        if (session->capacity - session->length < SERVER_READ_CHUNK) {
+            if (session->length >= SERVER_MAX_LINE) {
+                dprintf(session->fd, "server: строка длиннее %d байт\n", SERVER_MAX_LINE);
+                return -1;
+            }
+            size_t capacity = session->capacity ? session->capacity * 2 : SERVER_READ_CHUNK * 2;
+            char *buffer = realloc(session->buffer, capacity);
+            if (!buffer) {
+                return -1;
+            }
+            session->buffer = buffer;
+            session->capacity = capacity;
+        }
+        
+        // Место под завершающий ноль остаётся всегда
+        ssize_t n = recv(session->fd, session->buffer + session->length,
+                         session->capacity - session->length - 1, MSG_DONTWAIT);
+        if (n > 0) {
+            session->length += (size_t)n;
+            if (session_execute(session, 0) != 0) {
+                return -1;
+            }
+        } else if (n == 0) {
+            session_execute(session, 1);
+            return -1;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+    }
+}
+
+/**
+ * @brief Рабочий поток сервера
+ * @param arg Не используется
+ * @return NULL
+ */
+static void *server_worker(void *arg) {
+    (void)arg;
+    
+    for (;;) {
+        struct epoll_event ev;
+        int ready = epoll_wait(epoll_fd, &ev, 1, -1);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("server: epoll_wait");
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+        
+        if (ev.data.ptr == &stop_fd) {
+            break;
+        } else if (ev.data.ptr == &listen_fd) {
+            server_accept();
+            continue;
+        }
+        
+        server_session_t *session = ev.data.ptr;
+        pthread_mutex_lock(&session->lock);
+        int closing = session_read(session) != 0 || (ev.events & (EPOLLERR | EPOLLHUP));
+        if (!closing) {
+            server_arm(session->fd, EPOLLIN | EPOLLRDHUP, session, EPOLL_CTL_MOD);
+        }
+        pthread_mutex_unlock(&session->lock);
+        if (closing) {
+            session_close(session);
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Создание слушающего сокета
+ * @param socket_path Путь к Unix-сокету
+ * @return Дескриптор или -1 в случае ошибки
+ */
+static int server_listen(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "server: слишком длинный путь к сокету: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("server: socket");
+        return -1;
+    }
+    
+    unlink(socket_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        fprintf(stderr, "server: %s: %s\n", socket_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+/**
+ * @brief Запуск сервера
+ * @param socket_path Путь к Unix-сокету
+ * @param workers Количество рабочих потоков
+ * @return 0 после остановки по сигналу, 1 в случае ошибки
+ */
+int server_run(const char *socket_path, int workers) {
+    if (workers < 1 || workers > SERVER_MAX_WORKERS) {
+        fprintf(stderr, "server: число потоков должно быть от 1 до %d\n", SERVER_MAX_WORKERS);
+        return 1;
+    }
+    
+    // Сигналы остановки принимает только главный поток через sigwait;
+    // запись в закрытый клиентом сокет не должна завершать сервер
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigaddset(&stop_signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    
+    listen_fd = server_listen(socket_path);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (listen_fd == -1 || epoll_fd == -1 || stop_fd == -1) {
+        if (epoll_fd == -1 || stop_fd == -1) {
+            perror("server");
+        }
+        goto fail;
+    }
+    
+    // Событие остановки без EPOLLONESHOT будит все рабочие потоки
+    struct epoll_event stop_ev;
+    memset(&stop_ev, 0, sizeof(stop_ev));
+    stop_ev.events = EPOLLIN;
+    stop_ev.data.ptr = &stop_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &stop_ev) != 0 ||
+        server_arm(listen_fd, EPOLLIN, &listen_fd, EPOLL_CTL_ADD) != 0) {
+        perror("server: epoll_ctl");
+        goto fail;
+    }
+    
+    pthread_t *threads = calloc((size_t)workers, sizeof(pthread_t));
+    if (!threads) {
+        perror("server");
+        goto fail;
+    }
+    
+    int started = 0;
+    while (started < workers && pthread_create(&threads[started], NULL, server_worker, NULL) == 0) {
+        started++;
+    }
+    
+    if (started == 0) {
+        fprintf(stderr, "server: не удалось создать рабочие потоки\n");
+        free(threads);
+        goto fail;
+    }
+    
+    printf("Сервер слушает %s (%d потоков)\n", socket_path, started);
+    fflush(stdout);
+    
+    int signo = 0;
+    sigwait(&stop_signals, &signo);
+    
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        perror("server: eventfd");
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    
+    while (sessions) {
+        session_close(sessions);
+    }
+    
+    close(stop_fd);
+    close(epoll_fd);
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+    
+fail:
+    if (stop_fd != -1) {
+        close(stop_fd);
+    }
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    if (listen_fd != -1) {
+        close(listen_fd);
+        unlink(socket_path);
+    }
+    return 1;
+}
@@ -6,10 +6,24 @@
  * @date 2024
  */
 
+#define _GNU_SOURCE
+
 #include "shell.h"
 #include "parser.h"
 #include "executor.h"
 #include "utils.h"
+#include "signals.h"
+#include "jobs.h"
+#include "threadpool.h"
+#include "image.h"
+#include "pipestats.h"
+#include "metrics.h"
+#include "shellstats.h"
+#include "audit.h"
+#include "profile.h"
+#include "xtrace.h"
+#include "hooks.h"
+#include "alias.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,28 +31,149 @@
 #include <sys/wait.h>
 #include <signal.h>
 #include <time.h>
+#include <fcntl.h>
+#include <limits.h>
+
+// Состояние оболочки, с которым работает поток
+static __thread shell_state_t *current_state = NULL;
+
+// Увеличивается при каждой смене каталога процесса (cd)
+static unsigned long cwd_generation = 0;
+
+/**
+ * @struct prompt_cache_t
+ * @brief Кеш приглашения основного цикла
+ *
+ * @details Каталог процесса меняет только cd, поэтому getcwd нужен лишь
+ * после него (как $PWD в bash: переименование каталога извне не видно
+ * до следующего cd). Имя хоста читается один раз; приглашение строится
+ * заново, только если изменились каталог или USER.
+ */
+typedef struct {
+    unsigned long cwd_generation;   /**< Поколение каталога в current_dir */
+    int cwd_valid;                  /**< current_dir заполнен */
+    char hostname[256];             /**< Имя хоста (пусто - ещё не прочитано) */
+    char username[64];              /**< USER, для которого построено приглашение */
+} prompt_cache_t;
 
-// Глобальные переменные для обработки сигналов
-static volatile sig_atomic_t g_signal_received = 0;
-static volatile sig_atomic_t g_signal_number = 0;
+static prompt_cache_t prompt_cache;
 
-// Глобальная переменная для выхода из оболочки
-int g_should_exit = 0;
+/**
+ * @brief Имя хоста для приглашения
+ * @return Имя из кеша
+ */
+static const char *prompt_hostname(void) {
+    if (!prompt_cache.hostname[0]) {
+        shellstats_count(SHELLSTAT_GETHOSTNAME);
+        if (gethostname(prompt_cache.hostname, sizeof(prompt_cache.hostname)) != 0 ||
+            !prompt_cache.hostname[0]) {
+            strcpy(prompt_cache.hostname, "localhost");
+        }
+    }
+    return prompt_cache.hostname;
+}
+
+/**
+ * @brief Состояние оболочки, с которым работает текущий поток
+ * @return Указатель на состояние или NULL
+ */
+shell_state_t *shell_current(void) {
+    return current_state;
+}
+
+/**
+ * @brief Назначение состояния оболочки текущему потоку
+ * @param state Новое состояние (может быть NULL)
+ * @return Предыдущее состояние потока
+ */
+shell_state_t *shell_make_current(shell_state_t *state) {
+    shell_state_t *previous = current_state;
+    current_state = state;
+    return previous;
+}
+
+/**
+ * @brief Дескриптор текущего каталога для вызовов *at
+ * @return Каталог контекста текущего потока или AT_FDCWD
+ */
+int shell_cwd_fd(void) {
+    return current_state && current_state->cwd_fd != -1 ? current_state->cwd_fd : AT_FDCWD;
+}
+
+/**
+ * @brief Смена текущего каталога
+ * @param path Новый каталог
+ * @return 0 в случае успеха, -1 в случае ошибки (errno установлен)
+ */
+int shell_chdir(const char *path) {
+    shell_state_t *state = current_state;
+    if (!state || state->cwd_fd == -1) {
+        if (chdir(path) != 0) {
+            return -1;
+        }
+        cwd_generation++;
+        return 0;
+    }
+    
+    shellstats_count(SHELLSTAT_OPEN);
+    int fd = openat(state->cwd_fd, path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    
+    // Путь восстанавливается по дескриптору: ".." и символические ссылки уже разрешены
+    char link[64];
+    char resolved[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t len = readlink(link, resolved, sizeof(resolved) - 1);
+    char *dir = len > 0 ? strndup(resolved, (size_t)len) : NULL;
+    if (!dir) {
+        int saved_errno = len > 0 ? ENOMEM : errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    
+    close(state->cwd_fd);
+    state->cwd_fd = fd;
+    free(state->current_dir);
+    state->current_dir = dir;
+    return 0;
+}
 
-// Глобальная переменная для доступа к состоянию оболочки
-shell_state_t *g_shell_state = NULL;
+/**
+ * @brief Путь текущего каталога
+ * @param buffer Буфер
+ * @param size Размер буфера
+ * @return buffer или NULL в случае ошибки
+ */
+char *shell_getcwd(char *buffer, size_t size) {
+    shell_state_t *state = current_state;
+    if (!state || state->cwd_fd == -1) {
+        return getcwd(buffer, size);
+    }
+    
+    if (!state->current_dir || strlen(state->current_dir) >= size) {
+        errno = ERANGE;
+        return NULL;
+    }
+    
+    strcpy(buffer, state->current_dir);
+    return buffer;
+}
 
 /**
  * @brief Обработчик сигналов
  * @param sig Номер сигнала
  */
 void signal_handler(int sig) {
-    g_signal_received = 1;
-    g_signal_number = sig;
-    
     if (sig == SIGINT) {
-        printf("\n");
-        fflush(stdout);
+        // В обработчике допустимы только async-signal-safe вызовы
+        ssize_t written = write(STDOUT_FILENO, "\n", 1);
+        (void)written;
+        
+        // Параллельная работа встроенной команды прекращается
+        threadpool_interrupt();
     }
 }
 
@@ -52,30 +187,30 @@ int shell_init(shell_state_t *state) {
         return -1;
     }
     
+    memset(state, 0, sizeof(*state));
+    state->cwd_fd = -1;
+    state->io_fd = -1;
+    
     // Получаем имя пользователя и хоста
-    char *username = getenv("USER");
+    const char *username = getenv("USER");
     if (!username) {
-        strcpy(username, "user");
+        username = "user";
     }
     
-    char hostname[256];
-    if (gethostname(hostname, sizeof(hostname)) != 0) {
-        strcpy(hostname, "localhost");
-    }
+    const char *hostname = prompt_hostname();
     
-    // Получение текущей директории
-    char cwd[MAX_PATH];
-    if (getcwd(cwd, sizeof(cwd)) != NULL) {
-        state->current_dir = strdup(cwd);
-        if (!state->current_dir) {
-            return -1;
-        }
-    } else {
-        state->current_dir = strdup(".");
-        if (!state->current_dir) {
-            return -1;
-        }
+    // Получение текущей директории; основной цикл обновляет её на месте
+    state->current_dir = malloc(MAX_PATH);
+    if (!state->current_dir) {
+        return -1;
+    }
+    shellstats_count(SHELLSTAT_GETCWD);
+    if (getcwd(state->current_dir, MAX_PATH) == NULL) {
+        strcpy(state->current_dir, ".");
     }
+    prompt_cache.cwd_generation = cwd_generation;
+    prompt_cache.cwd_valid = 1;
+    snprintf(prompt_cache.username, sizeof(prompt_cache.username), "%s", username);
     
     // Создание цветного приглашения
     state->prompt = create_colored_prompt(username, hostname, state->current_dir);
@@ -88,20 +223,152 @@ int shell_init(shell_state_t *state) {
         }
     }
     
-    state->exit_code = 0;
-    state->should_exit = 0;
-    
-    // Инициализация истории команд
-    state->history_count = 0;
-    state->history_index = 0;
-    memset(state->history, 0, sizeof(state->history));
-    
     // Загружаем историю команд из файла
     load_history_from_file(state);
     
-    // Устанавливаем глобальную переменную
-    g_shell_state = state;
+    // Основной поток работает с состоянием интерактивной оболочки
+    shell_make_current(state);
+    
+    return 0;
+}
+
+/**
+ * @brief Выполнение одной строки ввода
+ * @param state Указатель на состояние оболочки
+ * @param line Строка с командами
+ * @return Код выхода последней команды
+ */
+int shell_execute_line(shell_state_t *state, const char *line) {
+    // Разбор ввода; одинаковые строки разбираются один раз на процесс
+    uint64_t parse_started = metrics_clock();
+    parsed_line_t *parsed = parse_cache_acquire(line);
+    metrics_record(METRIC_PARSE, parse_started);
+    if (!parsed) {
+        return state->exit_code;
+    }
+    command_t *commands = parsed->commands;
+    int cmd_count = parsed->count;
+    
+    // Ловушки принадлежат процессу, поэтому встроенный контекст их не вызывает
+    int traps = !state->embedded;
+    
+    // Выполнение команд
+    for (int i = 0; i < cmd_count; i++) {
+        // Конвейер выполняется как одна команда
+        int stages = pipeline_length(&commands[i], cmd_count - i);
+        int first = i;
+        i += stages - 1;
+        
+        if (stages > 1 || commands[first].name || commands[first].assign_count > 0) {
+            if (traps && trap_pseudo_installed(TRAP_DEBUG)) {
+                trap_run_pseudo(TRAP_DEBUG);
+            }
+            
+            if (state->xtrace) {
+                xtrace_command(state, &commands[first], stages);
+            }
+            
+            audit_mark_t audit_mark;
+            int audited = audit_begin(&audit_mark);
+            state->exit_code = execute_pipeline(&commands[first], stages);
+            // Вывод встроенных команд контекста не задерживается до следующей команды
+            if (state->io_out) {
+                fflush(state->io_out);
+            }
+            if (audited) {
+                audit_end(&audit_mark, &commands[first], stages, state->exit_code);
+            }
+            if (!state->embedded && !state->sourcing) {
+                // Добавляем команду в историю
+                uint64_t history_started = metrics_clock();
+                add_to_history(state, line, state->exit_code);
+                metrics_record(METRIC_HISTORY, history_started);
+            }
+            
+            if (traps && state->exit_code != 0 && trap_pseudo_installed(TRAP_ERR)) {
+                trap_run_pseudo(TRAP_ERR);
+            }
+            if (traps && g_trap_signal_fd != -1) {
+                trap_dispatch_signals();
+            }
+            if (state->should_exit) {
+                break;
+            }
+        }
+    }
+    
+    parse_cache_release(parsed);
+    
+    return state->exit_code;
+}
+
+/**
+ * @brief Выполнение файла команд в текущей оболочке
+ * @param state Указатель на состояние оболочки
+ * @param path Путь к файлу
+ * @return Код выхода последней команды или -1, если файл не открыт
+ */
+int shell_source_file(shell_state_t *state, const char *path) {
+    // Отсутствие файла тоже входит в условия действительности образа
+    image_track_file(path);
+    
+    int fd = openat(shell_cwd_fd(), path, O_RDONLY | O_CLOEXEC);
+    FILE *file = fd != -1 ? fdopen(fd, "r") : NULL;
+    if (!file) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    
+    char line[MAX_INPUT_SIZE];
+    int line_number = 0;
+    int previous = state->sourcing;
+    state->sourcing = 1;
+    state->source_depth++;
+    
+    while (!state->should_exit && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\n")] = '\0';
+        line_number++;
+        
+        char *start = line;
+        while (*start == ' ' || *start == '\t') {
+            start++;
+        }
+        if (*start != '\0' && *start != '#') {
+            profile_frame_t frame;
+            int profiled = profile_enter(state, &frame, path, line_number, start);
+            shell_execute_line(state, start);
+            if (profiled) {
+                profile_leave(state, &frame);
+            }
+        }
+    }
+    
+    state->sourcing = previous;
+    state->source_depth--;
+    fclose(file);
+    
+    return state->exit_code;
+}
+
+/**
+ * @brief Выполнение файла настроек ~/.custom_shellrc
+ * @param state Указатель на состояние оболочки
+ * @return 0 если файл выполнен или отсутствует, -1 если HOME не задан
+ */
+int shell_source_rc(shell_state_t *state) {
+    const char *home = getenv("HOME");
+    if (!home) {
+        return -1;
+    }
+    
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s%s", home, RC_FILE_NAME) >= (int)sizeof(path)) {
+        return -1;
+    }
     
+    shell_source_file(state, path);
     return 0;
 }
 
@@ -112,39 +379,71 @@ int shell_init(shell_state_t *state) {
  */
 int shell_run(shell_state_t *state) {
     char input[MAX_INPUT_SIZE];
-    command_t commands[MAX_ARGS];
     
     printf("Добро пожаловать в Custom Shell!\n");
     printf("Введите 'help' для получения справки, 'exit' для выхода.\n\n");
     
+    // Ожидание ввода через poll нужно только терминалу: буфер stdin пуст после строки
+    int interactive = isatty(STDIN_FILENO);
+    // Номер строки ввода для профиля
+    int line_number = 0;
+    
     while (!state->should_exit) {
-        // Обновление текущей директории
-        if (getcwd(state->current_dir, MAX_PATH) == NULL) {
-            strcpy(state->current_dir, ".");
+        // Ловушки на сигналы выполняются здесь, а не в обработчике
+        if (g_trap_signal_fd != -1) {
+            trap_dispatch_signals();
         }
         
-        // Обновляем приглашение с новой директорией
-        const char *username = getenv("USER") ? getenv("USER") : "user";
-        char hostname[256];
-        if (gethostname(hostname, sizeof(hostname)) != 0) {
-            strcpy(hostname, "localhost");
+        // Сообщения о завершившихся фоновых заданиях
+        check_background_status();
+        
+        if (hook_installed(state, HOOK_PRECMD)) {
+            hook_run(state, HOOK_PRECMD, NULL);
         }
         
-        // Освобождаем старое приглашение
-        if (state->prompt) {
-            free(state->prompt);
+        // Обновление текущей директории, если её мог сменить cd
+        uint64_t prompt_started = metrics_clock();
+        int prompt_changed = !state->prompt;
+        if (prompt_cache.cwd_valid && prompt_cache.cwd_generation == cwd_generation) {
+            shellstats_count(SHELLSTAT_DIR_HIT);
+        } else {
+            shellstats_count(SHELLSTAT_DIR_MISS);
+            shellstats_count(SHELLSTAT_GETCWD);
+            if (getcwd(state->current_dir, MAX_PATH) == NULL) {
+                strcpy(state->current_dir, ".");
+            }
+            prompt_cache.cwd_generation = cwd_generation;
+            prompt_cache.cwd_valid = 1;
+            prompt_changed = 1;
         }
         
-        // Создаем новое цветное приглашение
-        state->prompt = create_colored_prompt(username, hostname, state->current_dir);
-        if (!state->prompt) {
-            state->prompt = strdup("custom_shell$ ");
+        // Приглашение строится заново только при смене каталога или USER
+        const char *username = getenv("USER") ? getenv("USER") : "user";
+        if (strncmp(prompt_cache.username, username, sizeof(prompt_cache.username) - 1) != 0) {
+            snprintf(prompt_cache.username, sizeof(prompt_cache.username), "%s", username);
+            prompt_changed = 1;
         }
         
+        if (prompt_changed) {
+            shellstats_count(SHELLSTAT_PROMPT_MISS);
+            free(state->prompt);
+            state->prompt = create_colored_prompt(username, prompt_hostname(), state->current_dir);
+            if (!state->prompt) {
+                state->prompt = strdup("custom_shell$ ");
+            }
+        } else {
+            shellstats_count(SHELLSTAT_PROMPT_HIT);
+        }
+        metrics_record(METRIC_PROMPT, prompt_started);
+        
         // Вывод приглашения
         printf("%s", state->prompt);
         fflush(stdout);
         
+        if (interactive && g_trap_signal_fd != -1) {
+            trap_wait_input(STDIN_FILENO);
+        }
+        
         // Чтение ввода
         if (!fgets(input, sizeof(input), stdin)) {
             if (feof(stdin)) {
@@ -156,6 +455,7 @@ int shell_run(shell_state_t *state) {
         
         // Удаление символа новой строки
         input[strcspn(input, "\n")] = 0;
+        line_number++;
         
         // Пропуск пустых строк
         if (strlen(input) == 0) {
@@ -172,37 +472,15 @@ int shell_run(shell_state_t *state) {
             strcpy(input, expanded_input);
         }
         
-        // Разбор ввода
-        int cmd_count = parse_input(input, commands, MAX_ARGS);
-        if (cmd_count <= 0) {
-            continue;
-        }
-        
-        // Выполнение команд
-        for (int i = 0; i < cmd_count; i++) {
-            if (commands[i].name) {
-                state->exit_code = execute_command(&commands[i]);
-                // Добавляем команду в историю
-                add_to_history(state, input, state->exit_code);
-                if (state->should_exit) {
-                    break;
-                }
-            }
-        }
-        
-        // Очистка команд
-        free_commands(commands, cmd_count);
-        
-        // Проверка сигналов
-        if (g_signal_received) {
-            g_signal_received = 0;
-            continue;
+        // Скрипт, поданный на stdin, профилируется как файл "-"
+        profile_frame_t frame;
+        int profiled = profile_enter(state, &frame, "-", line_number, input);
+        if (hook_installed(state, HOOK_PREEXEC)) {
+            hook_run(state, HOOK_PREEXEC, input);
         }
-        
-        // Проверка глобального флага выхода
-        if (g_should_exit) {
-            state->should_exit = 1;
-            break;
+        shell_execute_line(state, input);
+        if (profiled) {
+            profile_leave(state, &frame);
         }
     }
     
@@ -215,12 +493,24 @@ int shell_run(shell_state_t *state) {
  */
 void shell_cleanup(shell_state_t *state) {
     if (state) {
+        trap_run_pseudo(TRAP_EXIT);
+        jobs_shutdown();
+        
+        if (shell_current() == state) {
+            shell_make_current(NULL);
+        }
+        
         if (state->prompt) {
             free(state->prompt);
         }
         if (state->current_dir) {
             free(state->current_dir);
         }
+        pipestats_free(state);
+        profile_stop(state);
+        xtrace_stop(state);
+        hook_clear_all(state);
+        alias_clear_all(state);
         // Сохраняем историю при выходе
         save_history_to_file(state);
     }
@@ -438,15 +728,16 @@ int load_history_from_file(shell_state_t *state) {
         
         if (strlen(line) > 0) {
             // Парсим строку: timestamp|exit_code|command
-            char *token = strtok(line, "|");
+            char *saveptr = NULL;
+            char *token = strtok_r(line, "|", &saveptr);
             if (token) {
                 time_t timestamp = (time_t)atol(token);
                 
-                token = strtok(NULL, "|");
+                token = strtok_r(NULL, "|", &saveptr);
                 if (token) {
                     int exit_code = atoi(token);
                     
-                    token = strtok(NULL, "|");
+                    token = strtok_r(NULL, "|", &saveptr);
                     if (token) {
                         strncpy(state->history[loaded_count].command, token, MAX_HISTORY_LENGTH - 1);
                         state->history[loaded_count].command[MAX_HISTORY_LENGTH - 1] = '\0';
@@ -0,0 +1,352 @@
+/**
+ * @file shellio.c
+ * @brief Реализация ввода-вывода встроенных команд по потокам
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "shellio.h"
+#include "shellstats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/**
+ * @def SHELL_IO_TARGETS
+ * @brief Наибольшее количество разных дескрипторов, переносимых в процесс
+ */
+#define SHELL_IO_TARGETS 16
+
+// Вершина стека звеньев текущего потока
+static __thread shell_io_t *io_top = NULL;
+
+// /dev/null - ввод встроенных команд контекстов со своим выводом
+static int null_fd = -1;
+static pthread_once_t null_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Однократное открытие /dev/null
+ */
+static void shell_io_open_null(void) {
+    null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+/**
+ * @brief Добавление пустого звена на вершину стека потока
+ * @param io Звено
+ */
+void shell_io_push(shell_io_t *io) {
+    memset(io, 0, sizeof(*io));
+    io->prev = io_top;
+    io_top = io;
+}
+
+/**
+ * @brief Назначение дескриптора в звене
+ * @param io Звено
+ * @param target Номер дескриптора в команде
+ * @param fd Дескриптор
+ * @param owned Закрыть fd при снятии звена
+ * @return 0 в случае успеха, -1 если слоты звена заняты
+ */
+int shell_io_set(shell_io_t *io, int target, int fd, int owned) {
+    int slot = 0;
+    while (slot < io->count && io->targets[slot] != target) {
+        slot++;
+    }
+    if (slot == SHELL_IO_SLOTS) {
+        return -1;
+    }
+
+    // Повторное перенаправление того же дескриптора заменяет прежнее
+    if (slot < io->count && (io->owned & (1u << slot))) {
+        close(io->fds[slot]);
+    }
+    if (slot == io->count) {
+        io->count++;
+    }
+    io->targets[slot] = target;
+    io->fds[slot] = fd;
+    if (owned) {
+        io->owned |= 1u << slot;
+    } else {
+        io->owned &= ~(1u << slot);
+    }
+
+    // Поток для прежнего дескриптора больше не нужен
+    FILE **stream = target == STDOUT_FILENO ? &io->out : target == STDERR_FILENO ? &io->err : NULL;
+    if (stream && *stream) {
+        fclose(*stream);
+        *stream = NULL;
+    }
+    return 0;
+}
+
+/**
+ * @brief Снятие звена с вершины стека
+ * @param io Звено
+ */
+void shell_io_pop(shell_io_t *io) {
+    if (io->out) {
+        fclose(io->out);
+    }
+    if (io->err) {
+        fclose(io->err);
+    }
+    for (int i = 0; i < io->count; i++) {
+        if (io->owned & (1u << i)) {
+            close(io->fds[i]);
+        }
+    }
+    if (io_top == io) {
+        io_top = io->prev;
+    }
+}
+
+/**
+ * @brief Поиск дескриптора в звеньях потока
+ * @param fd Номер дескриптора в команде
+ * @param owner Куда записать звено, в котором он задан (может быть NULL)
+ * @return Дескриптор или -1, если звенья его не задают
+ */
+static int shell_io_lookup(int fd, shell_io_t **owner) {
+    for (shell_io_t *io = io_top; io; io = io->prev) {
+        for (int i = 0; i < io->count; i++) {
+            if (io->targets[i] == fd) {
+                if (owner) {
+                    *owner = io;
+                }
+                return io->fds[i];
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Дескриптор текущего потока
+ * @param fd Номер дескриптора в команде
+ * @return Дескриптор, на который указывает fd
+ */
+int shell_fd(int fd) {
+    int found = shell_io_lookup(fd, NULL);
+    if (found != -1) {
+        return found;
+    }
+
+    shell_state_t *state = shell_current();
+    if (!state || state->io_fd == -1 || fd > STDERR_FILENO) {
+        return fd;
+    }
+    if (fd == STDIN_FILENO) {
+        pthread_once(&null_once, shell_io_open_null);
+        return null_fd != -1 ? null_fd : fd;
+    }
+    return state->io_fd;
+}
+
+/**
+ * @brief Поток stdio поверх копии дескриптора
+ * @param fd Дескриптор
+ * @param unbuffered Без буферизации (поток ошибок)
+ * @return Поток или NULL в случае ошибки
+ */
+static FILE *shell_io_open(int fd, int unbuffered) {
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+    if (copy == -1) {
+        return NULL;
+    }
+    FILE *stream = fdopen(copy, "w");
+    if (!stream) {
+        close(copy);
+        return NULL;
+    }
+    if (unbuffered) {
+        setvbuf(stream, NULL, _IONBF, 0);
+    }
+    return stream;
+}
+
+/**
+ * @brief Поток вывода для дескриптора 1 или 2
+ * @param fd STDOUT_FILENO или STDERR_FILENO
+ * @return Поток
+ */
+static FILE *shell_stream(int fd) {
+    FILE *standard = fd == STDOUT_FILENO ? stdout : stderr;
+    shell_io_t *owner = NULL;
+    int target = shell_io_lookup(fd, &owner);
+
+    if (target == -1) {
+        shell_state_t *state = shell_current();
+        if (!state || state->io_fd == -1) {
+            return standard;
+        }
+        target = state->io_fd;
+        if (target == STDOUT_FILENO || target == STDERR_FILENO) {
+            return target == STDOUT_FILENO ? stdout : stderr;
+        }
+        // Вывод и ошибки контекста идут в один дескриптор через один поток:
+        // порядок строк сохраняется, буфер пишется после каждой команды
+        if (!state->io_out) {
+            state->io_out = shell_io_open(target, 0);
+        }
+        return state->io_out ? state->io_out : standard;
+    }
+
+    if (target == STDOUT_FILENO || target == STDERR_FILENO) {
+        return target == STDOUT_FILENO ? stdout : stderr;
+    }
+    FILE **stream = fd == STDOUT_FILENO ? &owner->out : &owner->err;
+    if (!*stream) {
+        *stream = shell_io_open(target, fd == STDERR_FILENO);
+    }
+    return *stream ? *stream : standard;
+}
+
+/**
+ * @brief Стандартный вывод текущего потока
+ * @return Поток вывода
+ */
+FILE *shell_stdout(void) {
+    return shell_stream(STDOUT_FILENO);
+}
+
+/**
+ * @brief Поток ошибок текущего потока
+ * @return Поток ошибок
+ */
+FILE *shell_stderr(void) {
+    return shell_stream(STDERR_FILENO);
+}
+
+/**
+ * @brief perror() в поток ошибок текущего потока
+ * @param message Префикс сообщения
+ */
+void shell_perror(const char *message) {
+    int saved_errno = errno;
+    FILE *err = shell_stderr();
+    if (message && *message) {
+        fprintf(err, "%s: %s\n", message, strerror(saved_errno));
+    } else {
+        fprintf(err, "%s\n", strerror(saved_errno));
+    }
+    errno = saved_errno;
+}
+
+/**
+ * @brief Запись буферов всех потоков вывода перед fork и после команды
+ */
+void shell_io_flush(void) {
+    for (shell_io_t *io = io_top; io; io = io->prev) {
+        if (io->out) {
+            fflush(io->out);
+        }
+        if (io->err) {
+            fflush(io->err);
+        }
+    }
+    shell_state_t *state = shell_current();
+    if (state && state->io_out) {
+        fflush(state->io_out);
+    }
+    fflush(stdout);
+    fflush(stderr);
+}
+
+/**
+ * @brief Перенос звеньев в дескрипторы процесса
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int shell_io_apply(void) {
+    // Разных номеров дескрипторов в командах немного: 0-2 и редкие "3>файл"
+    int targets[SHELL_IO_TARGETS];
+    int fds[SHELL_IO_TARGETS];
+    int count = 0;
+
+    // Верхнее звено перекрывает нижние
+    for (shell_io_t *io = io_top; io; io = io->prev) {
+        for (int i = 0; i < io->count; i++) {
+            int seen = 0;
+            for (int j = 0; j < count && !seen; j++) {
+                seen = targets[j] == io->targets[i];
+            }
+            if (!seen && count == SHELL_IO_TARGETS - 3) {
+                return -1;
+            }
+            if (!seen) {
+                targets[count] = io->targets[i];
+                fds[count++] = io->fds[i];
+            }
+        }
+    }
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++) {
+        int seen = 0;
+        for (int j = 0; j < count && !seen; j++) {
+            seen = targets[j] == fd;
+        }
+        if (!seen && shell_fd(fd) != fd) {
+            targets[count] = fd;
+            fds[count++] = shell_fd(fd);
+        }
+    }
+
+    // Источник, совпадающий с номером другого дескриптора, сначала уводится в сторону
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < count; j++) {
+            if (i != j && fds[i] == targets[j] && fds[i] != targets[i]) {
+                int moved = fcntl(fds[i], F_DUPFD_CLOEXEC, 10);
+                if (moved == -1) {
+                    return -1;
+                }
+                fds[i] = moved;
+                break;
+            }
+        }
+    }
+
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        if (fds[i] != targets[i]) {
+            shellstats_count(SHELLSTAT_DUP2);
+            if (dup2(fds[i], targets[i]) == -1) {
+                result = -1;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Подготовка ввода-вывода дочернего процесса сразу после fork
+ */
+void shell_io_child(void) {
+    shell_io_apply();
+
+    // Потоки остались от родителя с пустыми буферами и здесь не закрываются
+    io_top = NULL;
+    shell_state_t *state = shell_current();
+    if (state) {
+        state->io_fd = -1;
+        state->io_out = NULL;
+    }
+}
+
+/**
+ * @brief Освобождение потока вывода контекста
+ * @param state Состояние оболочки
+ */
+void shell_io_release(shell_state_t *state) {
+    if (state && state->io_out) {
+        fclose(state->io_out);
+        state->io_out = NULL;
+    }
+}
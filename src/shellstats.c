@@ -0,0 +1,143 @@
+/**
+ * @file shellstats.c
+ * @brief Реализация счётчиков накладных расходов оболочки (shellstats)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "shellstats.h"
+#include "builtins.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+unsigned long long shellstats_counters[SHELLSTAT_COUNT];
+shellstats_alloc_t shellstats_alloc;
+
+/**
+ * @brief Чтение счётчика
+ * @param counter Счётчик
+ * @return Значение
+ */
+static unsigned long long shellstats_load(const unsigned long long *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Пиковый RSS процесса
+ * @return КиБ
+ *
+ * @details VmHWM из /proc/self/status сбрасывается вместе со счётчиками;
+ * без /proc используется ru_maxrss, который сбросить нельзя.
+ */
+static long shellstats_peak_rss(void) {
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status) {
+        char line[128];
+        long peak = -1;
+        while (fgets(line, sizeof(line), status)) {
+            if (sscanf(line, "VmHWM: %ld", &peak) == 1) {
+                break;
+            }
+        }
+        fclose(status);
+        if (peak >= 0) {
+            return peak;
+        }
+    }
+
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+/**
+ * @brief Обнуление всех счётчиков и пикового RSS
+ */
+static void shellstats_reset(void) {
+    for (int i = 0; i < SHELLSTAT_COUNT; i++) {
+        __atomic_store_n(&shellstats_counters[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&shellstats_alloc.mallocs, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&shellstats_alloc.frees, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&shellstats_alloc.bytes_allocated, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&shellstats_alloc.bytes_freed, 0, __ATOMIC_RELAXED);
+
+    // "5" сбрасывает VmHWM до текущего RSS (Linux 4.0+)
+    int fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd != -1) {
+        if (write(fd, "5", 1) != 1) {
+            // Старое ядро: пиковый RSS останется с запуска
+        }
+        close(fd);
+    }
+}
+
+/**
+ * @brief Вывод строки о попаданиях в кеш
+ * @param name Название кеша
+ * @param hit Счётчик попаданий
+ * @param miss Счётчик промахов
+ */
+static void shellstats_print_cache(const char *name, shellstat_id_t hit, shellstat_id_t miss) {
+    unsigned long long hits = shellstats_load(&shellstats_counters[hit]);
+    unsigned long long total = hits + shellstats_load(&shellstats_counters[miss]);
+    fprintf(shell_stdout(), "  %s: %llu из %llu", name, hits, total);
+    if (total > 0) {
+        fprintf(shell_stdout(), " (%.1f%%)", 100.0 * (double)hits / (double)total);
+    }
+    fprintf(shell_stdout(), "\n");
+}
+
+/**
+ * @brief Встроенная команда shellstats
+ * @param args Аргументы
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int builtin_shellstats(char **args, int argc) {
+    if (argc == 2 && strcmp(args[1], "--reset") == 0) {
+        shellstats_reset();
+        return 0;
+    }
+    if (argc != 1) {
+        fprintf(shell_stderr(), "Использование: shellstats [--reset]\n");
+        return -1;
+    }
+
+    fprintf(shell_stdout(), "Память:\n");
+    if (shellstats_alloc.hooked) {
+        unsigned long long allocated = shellstats_load(&shellstats_alloc.bytes_allocated);
+        unsigned long long freed = shellstats_load(&shellstats_alloc.bytes_freed);
+        fprintf(shell_stdout(), "  выделений: %llu, %llu байт\n", shellstats_load(&shellstats_alloc.mallocs), allocated);
+        fprintf(shell_stdout(), "  освобождений: %llu, %llu байт\n", shellstats_load(&shellstats_alloc.frees), freed);
+        fprintf(shell_stdout(), "  прирост: %lld байт\n", (long long)(allocated - freed));
+    } else {
+        fprintf(shell_stdout(), "  учёт выделений не подключён (сборка без ENABLE_ALLOC_STATS)\n");
+    }
+    fprintf(shell_stdout(), "  пиковый RSS: %ld КиБ\n", shellstats_peak_rss());
+
+    static const char *const syscall_names[] = {
+        [SHELLSTAT_FORK] = "fork",
+        [SHELLSTAT_DUP2] = "dup2",
+        [SHELLSTAT_OPEN] = "open",
+        [SHELLSTAT_GETCWD] = "getcwd",
+        [SHELLSTAT_GETHOSTNAME] = "gethostname",
+    };
+    fprintf(shell_stdout(), "Системные вызовы:\n");
+    for (int i = SHELLSTAT_FORK; i <= SHELLSTAT_GETHOSTNAME; i++) {
+        fprintf(shell_stdout(), "  %-12s %llu\n", syscall_names[i], shellstats_load(&shellstats_counters[i]));
+    }
+
+    fprintf(shell_stdout(), "Кеши (попаданий):\n");
+    shellstats_print_cache("пути команд", SHELLSTAT_CMDHASH_HIT, SHELLSTAT_CMDHASH_MISS);
+    shellstats_print_cache("приглашение", SHELLSTAT_PROMPT_HIT, SHELLSTAT_PROMPT_MISS);
+    shellstats_print_cache("текущий каталог", SHELLSTAT_DIR_HIT, SHELLSTAT_DIR_MISS);
+    return 0;
+}
@@ -0,0 +1,437 @@
+/**
+ * @file signals.c
+ * @brief Реализация ловушек (trap) с приёмом сигналов через signalfd
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "signals.h"
+#include "parser.h"
+#include "executor.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+
+/**
+ * @brief Состояние ячейки ловушки
+ */
+typedef enum {
+    TRAP_STATE_DEFAULT = 0,  /**< Действие по умолчанию */
+    TRAP_STATE_IGNORE,       /**< Сигнал игнорируется (trap '' SIG) */
+    TRAP_STATE_COMMANDS      /**< Выполняются команды ловушки */
+} trap_state_t;
+
+/**
+ * @struct trap_entry_t
+ * @brief Установленная ловушка в предварительно разобранном виде
+ */
+typedef struct {
+    trap_state_t state;   /**< Состояние ячейки */
+    char *text;           /**< Исходный текст тела (для вывода trap) */
+    command_t *commands;  /**< Разобранные команды тела */
+    int count;            /**< Количество команд */
+} trap_entry_t;
+
+/**
+ * @struct signal_name_t
+ * @brief Соответствие имени сигнала его номеру
+ */
+typedef struct {
+    const char *name;     /**< Имя без префикса SIG */
+    int number;           /**< Номер сигнала */
+} signal_name_t;
+
+static const signal_name_t signal_names[] = {
+    {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"ILL", SIGILL},
+    {"TRAP", SIGTRAP}, {"ABRT", SIGABRT}, {"BUS", SIGBUS}, {"FPE", SIGFPE},
+    {"KILL", SIGKILL}, {"USR1", SIGUSR1}, {"SEGV", SIGSEGV}, {"USR2", SIGUSR2},
+    {"PIPE", SIGPIPE}, {"ALRM", SIGALRM}, {"TERM", SIGTERM}, {"CHLD", SIGCHLD},
+    {"CONT", SIGCONT}, {"STOP", SIGSTOP}, {"TSTP", SIGTSTP}, {"TTIN", SIGTTIN},
+    {"TTOU", SIGTTOU}, {"URG", SIGURG}, {"XCPU", SIGXCPU}, {"XFSZ", SIGXFSZ},
+    {"VTALRM", SIGVTALRM}, {"PROF", SIGPROF}, {"WINCH", SIGWINCH}, {"IO", SIGIO},
+    {"SYS", SIGSYS}
+};
+
+#define SIGNAL_NAME_COUNT ((int)(sizeof(signal_names) / sizeof(signal_names[0])))
+
+// Дескриптор signalfd и маска псевдосигналов (проверяются в основном цикле)
+int g_trap_signal_fd = -1;
+unsigned int g_trap_pseudo_mask = 0;
+
+// Таблица ловушек и множество перехватываемых сигналов
+static trap_entry_t traps[TRAP_SLOTS];
+static sigset_t trapped_signals;
+static int trapped_initialized = 0;
+
+// Ловушка, выполняемая в данный момент (-1 - нет)
+static int running_slot = -1;
+
+// Тело выполняемой ловушки, заменённое из неё самой; освобождается после выполнения
+static trap_entry_t retired_entry;
+
+/**
+ * @brief Имя ячейки ловушки для вывода
+ * @param slot Номер ячейки
+ * @param buffer Буфер для числового имени
+ * @param size Размер буфера
+ * @return Имя ячейки
+ */
+static const char *trap_slot_name(int slot, char *buffer, size_t size) {
+    if (slot == TRAP_EXIT) {
+        return "EXIT";
+    } else if (slot == TRAP_ERR) {
+        return "ERR";
+    } else if (slot == TRAP_DEBUG) {
+        return "DEBUG";
+    }
+
+    for (int i = 0; i < SIGNAL_NAME_COUNT; i++) {
+        if (signal_names[i].number == slot) {
+            snprintf(buffer, size, "SIG%s", signal_names[i].name);
+            return buffer;
+        }
+    }
+
+    snprintf(buffer, size, "%d", slot);
+    return buffer;
+}
+
+/**
+ * @brief Разбор обозначения сигнала (INT, SIGINT, 2, EXIT, ERR, DEBUG)
+ * @param spec Обозначение сигнала
+ * @return Номер ячейки ловушки или -1 если обозначение неизвестно
+ */
+int trap_parse_spec(const char *spec) {
+    if (!spec || !*spec) {
+        return -1;
+    }
+
+    if (isdigit((unsigned char)*spec)) {
+        char *end = NULL;
+        long number = strtol(spec, &end, 10);
+        if (*end != '\0' || number < 0 || number >= NSIG) {
+            return -1;
+        }
+        return (int)number;
+    }
+
+    if (strcasecmp(spec, "EXIT") == 0) {
+        return TRAP_EXIT;
+    } else if (strcasecmp(spec, "ERR") == 0) {
+        return TRAP_ERR;
+    } else if (strcasecmp(spec, "DEBUG") == 0) {
+        return TRAP_DEBUG;
+    }
+
+    if (strncasecmp(spec, "SIG", 3) == 0) {
+        spec += 3;
+    }
+
+    for (int i = 0; i < SIGNAL_NAME_COUNT; i++) {
+        if (strcasecmp(spec, signal_names[i].name) == 0) {
+            return signal_names[i].number;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Освобождение разобранного тела ловушки
+ * @param entry Ячейка ловушки
+ */
+static void trap_entry_clear(trap_entry_t *entry) {
+    if (entry->commands) {
+        free_commands(entry->commands, entry->count);
+        free(entry->commands);
+    }
+    free(entry->text);
+    memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * @brief Перестройка signalfd под текущее множество перехватываемых сигналов
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int trap_update_signalfd(void) {
+    int empty = 1;
+    for (int sig = 1; sig < NSIG; sig++) {
+        if (sigismember(&trapped_signals, sig) == 1) {
+            empty = 0;
+            break;
+        }
+    }
+
+    if (empty) {
+        // Без ловушек на сигналы основной цикл не платит ни за что
+        if (g_trap_signal_fd != -1) {
+            close(g_trap_signal_fd);
+            g_trap_signal_fd = -1;
+        }
+        return 0;
+    }
+
+    int fd = signalfd(g_trap_signal_fd, &trapped_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd == -1) {
+        shell_perror("trap: signalfd");
+        return -1;
+    }
+    g_trap_signal_fd = fd;
+
+    return 0;
+}
+
+/**
+ * @brief Применение нового состояния ловушки к диспозиции сигнала
+ * @param sig Номер сигнала
+ * @param state Новое состояние
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int trap_apply_signal(int sig, trap_state_t state) {
+    sigset_t one;
+    sigemptyset(&one);
+    sigaddset(&one, sig);
+
+    if (state == TRAP_STATE_COMMANDS) {
+        // Заблокированный сигнал остаётся в очереди и читается через signalfd
+        signal(sig, SIG_DFL);
+        sigaddset(&trapped_signals, sig);
+        sigprocmask(SIG_BLOCK, &one, NULL);
+        return trap_update_signalfd();
+    }
+
+    sigdelset(&trapped_signals, sig);
+    int result = trap_update_signalfd();
+
+    if (state == TRAP_STATE_IGNORE) {
+        signal(sig, SIG_IGN);
+    } else if (sig == SIGINT || sig == SIGTSTP) {
+        signal(sig, signal_handler);
+    } else {
+        signal(sig, SIG_DFL);
+    }
+    sigprocmask(SIG_UNBLOCK, &one, NULL);
+
+    return result;
+}
+
+/**
+ * @brief Установка ловушки
+ * @param slot Номер ячейки (сигнал или TRAP_EXIT/TRAP_ERR/TRAP_DEBUG)
+ * @param body Тело ловушки; NULL - сброс, пустая строка - игнорирование
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int trap_set(int slot, const char *body) {
+    if (slot < 0 || slot >= TRAP_SLOTS) {
+        return -1;
+    }
+
+    if (slot == SIGKILL || slot == SIGSTOP) {
+        fprintf(shell_stderr(), "trap: сигнал %d нельзя перехватить\n", slot);
+        return -1;
+    }
+
+    if (!trapped_initialized) {
+        sigemptyset(&trapped_signals);
+        trapped_initialized = 1;
+    }
+
+    trap_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+
+    if (!body) {
+        entry.state = TRAP_STATE_DEFAULT;
+    } else if (*body == '\0') {
+        entry.state = TRAP_STATE_IGNORE;
+        entry.text = strdup("");
+    } else {
+        // Тело разбирается один раз; при срабатывании выполняются готовые команды
+        entry.state = TRAP_STATE_COMMANDS;
+        entry.text = strdup(body);
+        entry.commands = malloc(MAX_ARGS * sizeof(command_t));
+        if (!entry.text || !entry.commands) {
+            trap_entry_clear(&entry);
+            return -1;
+        }
+        entry.count = parse_input(body, entry.commands, MAX_ARGS);
+        if (entry.count <= 0) {
+            fprintf(shell_stderr(), "trap: пустое тело ловушки\n");
+            trap_entry_clear(&entry);
+            return -1;
+        }
+    }
+
+    if (slot == running_slot && !retired_entry.commands) {
+        // Ловушка переустанавливается из собственного тела
+        retired_entry = traps[slot];
+    } else {
+        trap_entry_clear(&traps[slot]);
+    }
+    traps[slot] = entry;
+
+    if (slot == TRAP_EXIT || slot == TRAP_ERR || slot == TRAP_DEBUG) {
+        unsigned int bit = 1u << (slot == TRAP_EXIT ? 0 : slot - NSIG + 1);
+        if (entry.state == TRAP_STATE_COMMANDS) {
+            g_trap_pseudo_mask |= bit;
+        } else {
+            g_trap_pseudo_mask &= ~bit;
+        }
+        return 0;
+    }
+
+    return trap_apply_signal(slot, entry.state);
+}
+
+/**
+ * @brief Вывод установленных ловушек в формате, пригодном для повторного ввода
+ */
+void trap_print(void) {
+    char name_buffer[16];
+
+    for (int slot = 0; slot < TRAP_SLOTS; slot++) {
+        if (traps[slot].state == TRAP_STATE_DEFAULT) {
+            continue;
+        }
+        // ' внутри тела выводится как '\'', чтобы строку можно было ввести повторно
+        fprintf(shell_stdout(), "trap -- '");
+        for (const char *p = traps[slot].text ? traps[slot].text : ""; *p; p++) {
+            if (*p == '\'') {
+                fputs("'\\''", shell_stdout());
+            } else {
+                fputc(*p, shell_stdout());
+            }
+        }
+        fprintf(shell_stdout(), "' %s\n", trap_slot_name(slot, name_buffer, sizeof(name_buffer)));
+    }
+}
+
+/**
+ * @brief Обход установленных ловушек по номерам ячеек
+ * @param visit Функция обхода
+ * @param arg Аргумент функции
+ * @return Результат последнего вызова visit (0 если обход завершён)
+ */
+int trap_foreach(trap_visit_fn visit, void *arg) {
+    for (int slot = 0; slot < TRAP_SLOTS; slot++) {
+        if (traps[slot].state == TRAP_STATE_DEFAULT) {
+            continue;
+        }
+        int result = visit(slot, traps[slot].text ? traps[slot].text : "", arg);
+        if (result != 0) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Выполнение тела ловушки
+ * @param slot Номер ячейки
+ */
+static void trap_run(int slot) {
+    if (running_slot != -1 || traps[slot].state != TRAP_STATE_COMMANDS) {
+        return;
+    }
+
+    running_slot = slot;
+
+    command_t *commands = traps[slot].commands;
+    int count = traps[slot].count;
+    for (int i = 0; i < count; i++) {
+        int stages = pipeline_length(&commands[i], count - i);
+        if (stages > 1 || commands[i].name || commands[i].assign_count > 0) {
+            execute_pipeline(&commands[i], stages);
+        }
+        i += stages - 1;
+    }
+
+    running_slot = -1;
+    if (retired_entry.commands) {
+        trap_entry_clear(&retired_entry);
+    }
+}
+
+/**
+ * @brief Выполнение ловушек для сигналов, накопившихся в signalfd
+ */
+void trap_dispatch_signals(void) {
+    if (g_trap_signal_fd == -1 || running_slot != -1) {
+        return;
+    }
+
+    struct signalfd_siginfo info;
+    while (g_trap_signal_fd != -1 &&
+           read(g_trap_signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        if (info.ssi_signo > 0 && info.ssi_signo < NSIG) {
+            trap_run((int)info.ssi_signo);
+        }
+    }
+}
+
+/**
+ * @brief Выполнение ловушки псевдосигнала
+ * @param slot TRAP_EXIT, TRAP_ERR или TRAP_DEBUG
+ */
+void trap_run_pseudo(int slot) {
+    if (trap_pseudo_installed(slot)) {
+        trap_run(slot);
+    }
+}
+
+/**
+ * @brief Ожидание готовности ввода с одновременным выполнением ловушек
+ * @param fd Дескриптор ввода
+ * @return 0 когда ввод готов, -1 в случае ошибки
+ */
+int trap_wait_input(int fd) {
+    while (g_trap_signal_fd != -1) {
+        struct pollfd fds[2] = {
+            { .fd = fd, .events = POLLIN },
+            { .fd = g_trap_signal_fd, .events = POLLIN }
+        };
+
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            trap_dispatch_signals();
+        }
+        if (fds[0].revents) {
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Восстановление маски сигналов в дочернем процессе перед exec
+ */
+void signals_reset_child(void) {
+    if (trapped_initialized) {
+        sigprocmask(SIG_UNBLOCK, &trapped_signals, NULL);
+    }
+}
+
+/**
+ * @brief Вывод списка имён сигналов (trap -l)
+ */
+void trap_list_signals(void) {
+    for (int i = 0; i < SIGNAL_NAME_COUNT; i++) {
+        fprintf(shell_stdout(), "%2d) SIG%-8s%s", signal_names[i].number, signal_names[i].name,
+               (i % 4 == 3 || i == SIGNAL_NAME_COUNT - 1) ? "\n" : " ");
+    }
+}
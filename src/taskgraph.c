@@ -0,0 +1,749 @@
+/**
+ * @file taskgraph.c
+ * @brief Реализация запуска графа задач (встроенная команда run-graph)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "taskgraph.h"
+#include "builtins.h"
+#include "executor.h"
+#include "threadpool.h"
+#include "shell.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+/**
+ * @enum task_status_t
+ * @brief Состояние задачи
+ */
+typedef enum {
+    TASK_WAITING = 0,  /**< Ожидает зависимостей или свободного места */
+    TASK_RUNNING,      /**< Выполняется */
+    TASK_DONE,         /**< Выполнена успешно */
+    TASK_UP_TO_DATE,   /**< Пропущена: выходы новее входов */
+    TASK_FAILED,       /**< Завершилась с ошибкой */
+    TASK_BLOCKED       /**< Не запускалась из-за ошибки зависимости */
+} task_status_t;
+
+/**
+ * @struct graph_task_t
+ * @brief Задача графа
+ */
+typedef struct {
+    char *name;             /**< Имя задачи */
+    char **deps;            /**< Имена зависимостей */
+    int dep_count;          /**< Количество зависимостей */
+    int *dep_index;         /**< Индексы зависимостей */
+    char **inputs;          /**< Входные файлы */
+    int input_count;        /**< Количество входов */
+    char **outputs;         /**< Выходные файлы */
+    int output_count;       /**< Количество выходов */
+    char *command;          /**< Строка команд или NULL */
+    int *dependents;        /**< Задачи, зависящие от этой */
+    int dependent_count;    /**< Количество зависящих задач */
+    int pending;            /**< Незавершённые зависимости */
+    int needed;             /**< Задача нужна для выбранных целей */
+    task_status_t status;   /**< Состояние */
+    double start;           /**< Начало выполнения от запуска графа (секунды) */
+    double duration;        /**< Длительность выполнения (секунды) */
+    double path_time;       /**< Длительность самой долгой цепочки, кончающейся задачей */
+    int path_prev;          /**< Предыдущая задача этой цепочки или -1 */
+} graph_task_t;
+
+/**
+ * @struct task_graph_t
+ * @brief Граф задач
+ */
+typedef struct {
+    graph_task_t *tasks;  /**< Задачи */
+    int count;            /**< Количество задач */
+    int capacity;         /**< Ёмкость массива задач */
+    int *order;           /**< Топологический порядок */
+} task_graph_t;
+
+/**
+ * @struct running_task_t
+ * @brief Выполняемая задача
+ */
+typedef struct {
+    int task;    /**< Индекс задачи */
+    pid_t pid;   /**< Процесс задачи */
+    int pidfd;   /**< Дескриптор процесса для poll или -1 */
+} running_task_t;
+
+/**
+ * @brief Текущее время по монотонным часам
+ * @return Секунды
+ */
+static double taskgraph_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Освобождение графа
+ * @param graph Граф
+ */
+static void taskgraph_free(task_graph_t *graph) {
+    for (int i = 0; i < graph->count; i++) {
+        graph_task_t *task = &graph->tasks[i];
+        free(task->name);
+        free_string_array(task->deps, task->dep_count);
+        free_string_array(task->inputs, task->input_count);
+        free_string_array(task->outputs, task->output_count);
+        free(task->dep_index);
+        free(task->dependents);
+        free(task->command);
+    }
+    free(graph->tasks);
+    free(graph->order);
+}
+
+/**
+ * @brief Поиск задачи по имени
+ * @param graph Граф
+ * @param name Имя
+ * @return Индекс задачи или -1
+ */
+static int taskgraph_find(const task_graph_t *graph, const char *name) {
+    for (int i = 0; i < graph->count; i++) {
+        if (strcmp(graph->tasks[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Добавление элементов списка к полю задачи
+ * @param list Поле задачи
+ * @param count Количество элементов поля
+ * @param value Список через пробелы
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int taskgraph_append_list(char ***list, int *count, const char *value) {
+    int added = 0;
+    char **parts = split_string(value, " \t", &added);
+    if (!parts || added == 0) {
+        free_string_array(parts, added);
+        return 0;
+    }
+
+    char **grown = realloc(*list, (size_t)(*count + added) * sizeof(char *));
+    if (!grown) {
+        free_string_array(parts, added);
+        return -1;
+    }
+
+    memcpy(grown + *count, parts, (size_t)added * sizeof(char *));
+    free(parts);
+    *list = grown;
+    *count += added;
+    return 0;
+}
+
+/**
+ * @brief Разбор файла задач
+ * @param path Путь к файлу
+ * @param graph Граф для заполнения
+ * @return 0 в случае успеха, -1 в случае ошибки (сообщение уже выведено)
+ */
+static int taskgraph_parse(const char *path, task_graph_t *graph) {
+    int fd = openat(shell_cwd_fd(), path, O_RDONLY | O_CLOEXEC);
+    FILE *file = fd != -1 ? fdopen(fd, "r") : NULL;
+    if (!file) {
+        fprintf(shell_stderr(), "run-graph: %s: %s\n", path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    char line[TASKGRAPH_MAX_LINE];
+    int line_number = 0;
+    int result = 0;
+    graph_task_t *task = NULL;
+
+    while (result == 0 && fgets(line, sizeof(line), file)) {
+        line_number++;
+        line[strcspn(line, "\n")] = '\0';
+        char *text = trim_string(line);
+
+        if (*text == '\0' || *text == '#') {
+            continue;
+        }
+
+        if (*text == '[') {
+            char *end = strchr(text, ']');
+            if (!end || end == text + 1 || end[1] != '\0') {
+                fprintf(shell_stderr(), "run-graph: %s:%d: ожидается [имя]\n", path, line_number);
+                result = -1;
+                break;
+            }
+            *end = '\0';
+
+            if (taskgraph_find(graph, text + 1) != -1) {
+                fprintf(shell_stderr(), "run-graph: %s:%d: задача '%s' уже описана\n", path, line_number, text + 1);
+                result = -1;
+                break;
+            }
+
+            if (graph->count == graph->capacity) {
+                int capacity = graph->capacity ? graph->capacity * 2 : 16;
+                graph_task_t *grown = realloc(graph->tasks, (size_t)capacity * sizeof(graph_task_t));
+                if (!grown) {
+                    result = -1;
+                    break;
+                }
+                graph->tasks = grown;
+                graph->capacity = capacity;
+            }
+
+            task = &graph->tasks[graph->count];
+            memset(task, 0, sizeof(*task));
+            task->path_prev = -1;
+            task->name = strdup(text + 1);
+            if (!task->name) {
+                result = -1;
+                break;
+            }
+            graph->count++;
+            continue;
+        }
+
+        char *eq = strchr(text, '=');
+        if (!task || !eq) {
+            fprintf(shell_stderr(), "run-graph: %s:%d: ожидается ключ = значение внутри [задачи]\n",
+                    path, line_number);
+            result = -1;
+            break;
+        }
+
+        *eq = '\0';
+        char *key = trim_string(text);
+        char *value = trim_string(eq + 1);
+
+        if (strcmp(key, "deps") == 0) {
+            result = taskgraph_append_list(&task->deps, &task->dep_count, value);
+        } else if (strcmp(key, "inputs") == 0) {
+            result = taskgraph_append_list(&task->inputs, &task->input_count, value);
+        } else if (strcmp(key, "outputs") == 0) {
+            result = taskgraph_append_list(&task->outputs, &task->output_count, value);
+        } else if (strcmp(key, "command") == 0) {
+            // Несколько строк command выполняются одна за другой
+            size_t old_len = task->command ? strlen(task->command) : 0;
+            char *joined = realloc(task->command, old_len + strlen(value) + 3);
+            if (!joined) {
+                result = -1;
+                break;
+            }
+            if (old_len > 0) {
+                strcpy(joined + old_len, "; ");
+                strcat(joined, value);
+            } else {
+                strcpy(joined, value);
+            }
+            task->command = joined;
+        } else {
+            fprintf(shell_stderr(), "run-graph: %s:%d: неизвестный ключ '%s'\n", path, line_number, key);
+            result = -1;
+        }
+    }
+
+    fclose(file);
+    return result;
+}
+
+/**
+ * @brief Связывание зависимостей и топологическая сортировка
+ * @param graph Граф
+ * @return 0 в случае успеха, -1 если есть неизвестная задача или цикл
+ */
+static int taskgraph_link(task_graph_t *graph) {
+    for (int i = 0; i < graph->count; i++) {
+        graph_task_t *task = &graph->tasks[i];
+        task->dep_index = calloc((size_t)task->dep_count + 1, sizeof(int));
+        task->dependents = calloc((size_t)graph->count + 1, sizeof(int));
+        if (!task->dep_index || !task->dependents) {
+            fprintf(shell_stderr(), "run-graph: %s\n", strerror(ENOMEM));
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < graph->count; i++) {
+        graph_task_t *task = &graph->tasks[i];
+        int unique = 0;
+        for (int d = 0; d < task->dep_count; d++) {
+            int dep = taskgraph_find(graph, task->deps[d]);
+            if (dep == -1) {
+                fprintf(shell_stderr(), "run-graph: задача '%s' зависит от неизвестной задачи '%s'\n",
+                        task->name, task->deps[d]);
+                return -1;
+            }
+
+            // Повторное имя в deps отбрасывается: у каждой задачи не больше
+            // graph->count зависящих, и под столько выделен dependents
+            int seen = 0;
+            for (int k = 0; k < unique && !seen; k++) {
+                seen = task->dep_index[k] == dep;
+            }
+            char *name = task->deps[d];
+            task->deps[d] = NULL;
+            if (seen) {
+                free(name);
+                continue;
+            }
+            task->deps[unique] = name;
+            task->dep_index[unique++] = dep;
+            graph->tasks[dep].dependents[graph->tasks[dep].dependent_count++] = i;
+        }
+        task->dep_count = unique;
+    }
+
+    // Алгоритм Кана: задача попадает в порядок, когда упорядочены все её зависимости
+    graph->order = malloc(((size_t)graph->count + 1) * sizeof(int));
+    int *remaining = malloc(((size_t)graph->count + 1) * sizeof(int));
+    if (!graph->order || !remaining) {
+        free(remaining);
+        fprintf(shell_stderr(), "run-graph: %s\n", strerror(ENOMEM));
+        return -1;
+    }
+
+    int ordered = 0;
+    for (int i = 0; i < graph->count; i++) {
+        remaining[i] = graph->tasks[i].dep_count;
+        if (remaining[i] == 0) {
+            graph->order[ordered++] = i;
+        }
+    }
+    for (int head = 0; head < ordered; head++) {
+        const graph_task_t *task = &graph->tasks[graph->order[head]];
+        for (int k = 0; k < task->dependent_count; k++) {
+            if (--remaining[task->dependents[k]] == 0) {
+                graph->order[ordered++] = task->dependents[k];
+            }
+        }
+    }
+
+    if (ordered < graph->count) {
+        for (int i = 0; i < graph->count; i++) {
+            if (remaining[i] > 0) {
+                fprintf(shell_stderr(), "run-graph: цикл зависимостей через задачу '%s'\n", graph->tasks[i].name);
+                break;
+            }
+        }
+        free(remaining);
+        return -1;
+    }
+
+    free(remaining);
+    return 0;
+}
+
+/**
+ * @brief Отметка задачи и её зависимостей как нужных
+ * @param graph Граф
+ * @param index Индекс задачи
+ */
+static void taskgraph_mark_needed(task_graph_t *graph, int index) {
+    graph_task_t *task = &graph->tasks[index];
+    if (task->needed) {
+        return;
+    }
+
+    task->needed = 1;
+    for (int d = 0; d < task->dep_count; d++) {
+        taskgraph_mark_needed(graph, task->dep_index[d]);
+    }
+}
+
+/**
+ * @brief Сравнение времён изменения
+ * @param a Первое время
+ * @param b Второе время
+ * @return Отрицательное число, если a раньше b
+ */
+static int taskgraph_compare_time(const struct statx_timestamp *a, const struct statx_timestamp *b) {
+    if (a->tv_sec != b->tv_sec) {
+        return a->tv_sec < b->tv_sec ? -1 : 1;
+    }
+    return (a->tv_nsec > b->tv_nsec) - (a->tv_nsec < b->tv_nsec);
+}
+
+/**
+ * @brief Проверка актуальности выходов задачи
+ * @param task Задача
+ * @return 1 если выходы актуальны, 0 если задачу нужно выполнить, -1 если нет входа
+ *
+ * @details Задача без выходов выполняется всегда. Времена берутся через
+ * statx только с маской STATX_MTIME.
+ */
+static int taskgraph_up_to_date(const graph_task_t *task) {
+    if (task->output_count == 0) {
+        return 0;
+    }
+
+    struct statx_timestamp newest_input = { 0 };
+    for (int i = 0; i < task->input_count; i++) {
+        struct statx stx;
+        if (statx(shell_cwd_fd(), task->inputs[i], AT_STATX_SYNC_AS_STAT, STATX_MTIME, &stx) != 0) {
+            fprintf(shell_stderr(), "run-graph: %s: вход %s: %s\n", task->name, task->inputs[i], strerror(errno));
+            return -1;
+        }
+        if (taskgraph_compare_time(&stx.stx_mtime, &newest_input) > 0) {
+            newest_input = stx.stx_mtime;
+        }
+    }
+
+    for (int i = 0; i < task->output_count; i++) {
+        struct statx stx;
+        if (statx(shell_cwd_fd(), task->outputs[i], AT_STATX_SYNC_AS_STAT, STATX_MTIME, &stx) != 0 ||
+            taskgraph_compare_time(&stx.stx_mtime, &newest_input) < 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Ожидание завершения любой выполняемой задачи
+ * @param running Выполняемые задачи
+ * @param count Их количество
+ * @param status Указатель для статуса waitpid
+ * @return Индекс в running или -1 в случае ошибки
+ *
+ * @details Ожидание идёт через pidfd и poll, а не waitpid(-1): процессы
+ * фоновых заданий оболочки остаются в таблице заданий.
+ */
+static int taskgraph_wait_any(const running_task_t *running, int count, int *status) {
+    int index = 0;
+    int pollable = 1;
+    for (int i = 0; i < count; i++) {
+        if (running[i].pidfd == -1) {
+            pollable = 0;
+        }
+    }
+
+    if (pollable) {
+        struct pollfd fds[TASKGRAPH_MAX_JOBS];
+        for (int i = 0; i < count; i++) {
+            fds[i].fd = running[i].pidfd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        int ready;
+        do {
+            ready = poll(fds, (nfds_t)count, -1);
+        } while (ready == -1 && errno == EINTR);
+
+        for (int i = 0; i < count && ready > 0; i++) {
+            if (fds[i].revents) {
+                index = i;
+                break;
+            }
+        }
+    }
+
+    // Без pidfd (ядро старше 5.3) задачи дожидаются по порядку запуска
+    while (waitpid(running[index].pid, status, 0) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return index;
+}
+
+/**
+ * @brief Завершение задачи и освобождение зависящих от неё
+ * @param graph Граф
+ * @param index Индекс задачи
+ * @param ready Очередь готовых задач
+ * @param ready_tail Конец очереди
+ */
+static void taskgraph_complete(task_graph_t *graph, int index, int *ready, int *ready_tail) {
+    graph_task_t *task = &graph->tasks[index];
+    if (task->status == TASK_FAILED) {
+        return;
+    }
+
+    for (int k = 0; k < task->dependent_count; k++) {
+        graph_task_t *dependent = &graph->tasks[task->dependents[k]];
+        if (dependent->needed && --dependent->pending == 0) {
+            ready[(*ready_tail)++] = task->dependents[k];
+        }
+    }
+}
+
+/**
+ * @brief Выполнение графа
+ * @param graph Граф
+ * @param jobs Количество одновременно выполняемых задач
+ * @param keep_going Продолжать независимые задачи после ошибки
+ * @return 0 если все нужные задачи выполнены, 1 если есть ошибки
+ */
+static int taskgraph_run(task_graph_t *graph, int jobs, int keep_going) {
+    int *ready = malloc(((size_t)graph->count + 1) * sizeof(int));
+    running_task_t running[TASKGRAPH_MAX_JOBS];
+    int running_count = 0;
+    int ready_head = 0, ready_tail = 0;
+    int failed = 0;
+
+    if (!ready) {
+        fprintf(shell_stderr(), "run-graph: %s\n", strerror(ENOMEM));
+        return 1;
+    }
+
+    for (int i = 0; i < graph->count; i++) {
+        graph_task_t *task = &graph->tasks[i];
+        task->pending = task->dep_count;
+        if (task->needed && task->pending == 0) {
+            ready[ready_tail++] = i;
+        }
+    }
+
+    double started = taskgraph_now();
+
+    for (;;) {
+        while ((!failed || keep_going) && running_count < jobs && ready_head < ready_tail) {
+            int index = ready[ready_head++];
+            graph_task_t *task = &graph->tasks[index];
+            task->start = taskgraph_now() - started;
+
+            int state = taskgraph_up_to_date(task);
+            if (state != 0 || !task->command) {
+                task->status = state < 0 ? TASK_FAILED : (state > 0 ? TASK_UP_TO_DATE : TASK_DONE);
+                failed |= state < 0;
+                taskgraph_complete(graph, index, ready, &ready_tail);
+                continue;
+            }
+
+            fprintf(shell_stdout(), "==> %s\n", task->name);
+            fflush(shell_stdout());
+
+            pid_t pid = execute_spawn(task->command, 0);
+            if (pid == -1) {
+                task->status = TASK_FAILED;
+                failed = 1;
+                continue;
+            }
+
+            task->status = TASK_RUNNING;
+            running[running_count].task = index;
+            running[running_count].pid = pid;
+#ifdef SYS_pidfd_open
+            running[running_count].pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+            running[running_count].pidfd = -1;
+#endif
+            running_count++;
+        }
+
+        if (running_count == 0) {
+            break;
+        }
+
+        int status = 0;
+        int slot = taskgraph_wait_any(running, running_count, &status);
+        if (slot == -1) {
+            shell_perror("run-graph: waitpid");
+            failed = 1;
+            break;
+        }
+
+        graph_task_t *task = &graph->tasks[running[slot].task];
+        task->duration = taskgraph_now() - started - task->start;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            task->status = TASK_DONE;
+        } else {
+            task->status = TASK_FAILED;
+            failed = 1;
+            if (WIFSIGNALED(status)) {
+                fprintf(shell_stderr(), "run-graph: %s: завершена сигналом %d\n", task->name, WTERMSIG(status));
+            } else {
+                fprintf(shell_stderr(), "run-graph: %s: код выхода %d\n", task->name, WEXITSTATUS(status));
+            }
+        }
+        taskgraph_complete(graph, running[slot].task, ready, &ready_tail);
+
+        if (running[slot].pidfd != -1) {
+            close(running[slot].pidfd);
+        }
+        running[slot] = running[--running_count];
+    }
+
+    for (int i = 0; i < graph->count; i++) {
+        if (graph->tasks[i].needed && graph->tasks[i].status == TASK_WAITING) {
+            graph->tasks[i].status = TASK_BLOCKED;
+        }
+    }
+
+    free(ready);
+    return failed ? 1 : 0;
+}
+
+/**
+ * @brief Вывод строки, дополненной пробелами до ширины в символах
+ * @param text Строка UTF-8
+ * @param width Ширина в символах
+ */
+static void taskgraph_print_padded(const char *text, int width) {
+    // printf считает ширину в байтах, а кириллица занимает по два
+    int chars = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        chars += (*p & 0xC0) != 0x80;
+    }
+    fprintf(shell_stdout(), "%s%*s", text, width > chars ? width - chars : 0, "");
+}
+
+/**
+ * @brief Вывод времени задач и критического пути
+ * @param graph Граф после выполнения
+ * @param wall Общее время выполнения (секунды)
+ */
+static void taskgraph_report(task_graph_t *graph, double wall) {
+    static const char *const status_names[] = {
+        "ожидает", "выполняется", "выполнена", "актуальна", "ошибка", "не запущена"
+    };
+
+    // Самая долгая цепочка считается в топологическом порядке
+    int last = -1;
+    int counts[TASK_BLOCKED + 1] = { 0 };
+    for (int k = 0; k < graph->count; k++) {
+        int index = graph->order[k];
+        graph_task_t *task = &graph->tasks[index];
+        if (!task->needed) {
+            continue;
+        }
+
+        counts[task->status]++;
+        task->path_time = 0;
+        task->path_prev = -1;
+        for (int d = 0; d < task->dep_count; d++) {
+            const graph_task_t *dep = &graph->tasks[task->dep_index[d]];
+            if (dep->path_time > task->path_time || task->path_prev == -1) {
+                task->path_time = dep->path_time;
+                task->path_prev = task->dep_index[d];
+            }
+        }
+        task->path_time += task->duration;
+
+        if (last == -1 || task->path_time > graph->tasks[last].path_time) {
+            last = index;
+        }
+    }
+
+    fprintf(shell_stdout(), "\n");
+    taskgraph_print_padded("Задача", 25);
+    taskgraph_print_padded("Состояние", 13);
+    fprintf(shell_stdout(), "   Начало    Время\n");
+    for (int k = 0; k < graph->count; k++) {
+        const graph_task_t *task = &graph->tasks[graph->order[k]];
+        if (task->needed) {
+            taskgraph_print_padded(task->name, 25);
+            taskgraph_print_padded(status_names[task->status], 13);
+            fprintf(shell_stdout(), "%8.2fс %8.2fс\n", task->start, task->duration);
+        }
+    }
+
+    int *chain = last != -1 && graph->tasks[last].path_time > 0 ? malloc((size_t)graph->count * sizeof(int)) : NULL;
+    if (chain) {
+        int length = 0;
+        for (int index = last; index != -1; index = graph->tasks[index].path_prev) {
+            chain[length++] = index;
+        }
+
+        fprintf(shell_stdout(), "\nКритический путь (%.2f с): ", graph->tasks[last].path_time);
+        for (int i = length - 1; i >= 0; i--) {
+            fprintf(shell_stdout(), "%s%s", graph->tasks[chain[i]].name, i > 0 ? " -> " : "\n");
+        }
+        free(chain);
+    }
+
+    fprintf(shell_stdout(), "Всего: %.2f с; выполнено: %d, актуальных: %d, с ошибкой: %d, не запущено: %d\n",
+            wall, counts[TASK_DONE], counts[TASK_UP_TO_DATE], counts[TASK_FAILED], counts[TASK_BLOCKED]);
+}
+
+/**
+ * @brief Встроенная команда run-graph (параллельное выполнение графа задач)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 если задачи завершились с ошибкой, -1 в случае ошибки
+ */
+int builtin_run_graph(char **args, int argc) {
+    int jobs = threadpool_size();
+    int keep_going = 0;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        if (strcmp(args[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(args[++i]);
+            if (jobs < 1 || jobs > TASKGRAPH_MAX_JOBS) {
+                fprintf(shell_stderr(), "run-graph: число задач должно быть от 1 до %d\n", TASKGRAPH_MAX_JOBS);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-k") == 0) {
+            keep_going = 1;
+        } else {
+            fprintf(shell_stderr(), "run-graph: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: run-graph [-j N] [-k] файл [задача...]\n");
+            return -1;
+        }
+    }
+
+    if (i >= argc) {
+        fprintf(shell_stderr(), "Использование: run-graph [-j N] [-k] файл [задача...]\n");
+        return -1;
+    }
+    if (jobs > TASKGRAPH_MAX_JOBS) {
+        jobs = TASKGRAPH_MAX_JOBS;
+    }
+
+    task_graph_t graph;
+    memset(&graph, 0, sizeof(graph));
+
+    if (taskgraph_parse(args[i], &graph) != 0 || taskgraph_link(&graph) != 0) {
+        taskgraph_free(&graph);
+        return -1;
+    }
+
+    // Без целей выполняется весь граф
+    if (i + 1 == argc) {
+        for (int t = 0; t < graph.count; t++) {
+            graph.tasks[t].needed = 1;
+        }
+    }
+    for (int t = i + 1; t < argc; t++) {
+        int index = taskgraph_find(&graph, args[t]);
+        if (index == -1) {
+            fprintf(shell_stderr(), "run-graph: неизвестная задача '%s'\n", args[t]);
+            taskgraph_free(&graph);
+            return -1;
+        }
+        taskgraph_mark_needed(&graph, index);
+    }
+
+    double started = taskgraph_now();
+    int result = taskgraph_run(&graph, jobs, keep_going);
+    taskgraph_report(&graph, taskgraph_now() - started);
+
+    taskgraph_free(&graph);
+    return result;
+}
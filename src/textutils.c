@@ -0,0 +1,1241 @@
+/**
+ * @file textutils.c
+ * @brief Реализация встроенных команд обработки текста (head, tail, cut)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "builtins.h"
+#include "signals.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <libgen.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#define TEXT_X86 1
+#endif
+
+/**
+ * @def TEXT_BLOCK_SIZE
+ * @brief Размер блока чтения (и обратного чтения в tail)
+ */
+#define TEXT_BLOCK_SIZE (64 * 1024)
+
+/**
+ * @brief Разбор неотрицательного числа из аргумента
+ * @param str Строка
+ * @param value Куда записать значение
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int parse_count(const char *str, long *value) {
+    char *end = NULL;
+    errno = 0;
+    long v = strtol(str, &end, 10);
+    if (errno != 0 || end == str || *end != '\0' || v < 0) {
+        return -1;
+    }
+    *value = v;
+    return 0;
+}
+
+/**
+ * @brief Открытие входного файла ("-" - стандартный ввод)
+ * @param path Путь
+ * @return Дескриптор или -1 в случае ошибки
+ */
+static int open_input(const char *path) {
+    if (strcmp(path, "-") == 0) {
+        return shell_fd(STDIN_FILENO);
+    }
+    return openat(shell_cwd_fd(), path, O_RDONLY | O_CLOEXEC);
+}
+
+/**
+ * @brief Закрытие входного файла, открытого open_input()
+ * @param fd Дескриптор
+ */
+static void close_input(int fd) {
+    if (fd != shell_fd(STDIN_FILENO)) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Вывод заголовка файла при обработке нескольких файлов
+ * @param path Имя файла
+ * @param first Признак первого файла
+ */
+static void print_file_header(const char *path, int first) {
+    fprintf(shell_stdout(), "%s==> %s <==\n", first ? "" : "\n",
+            strcmp(path, "-") == 0 ? "стандартный ввод" : path);
+}
+
+/* ------------------------------------------------------------------------ */
+/* head                                                                     */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Вывод начала файла
+ * @param fd Дескриптор
+ * @param lines Количество строк (используется, если bytes < 0)
+ * @param bytes Количество байт или -1
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int head_fd(int fd, long lines, long bytes) {
+    char *buffer = malloc(TEXT_BLOCK_SIZE);
+    if (!buffer) {
+        return -1;
+    }
+
+    long remaining = bytes >= 0 ? bytes : lines;
+    int result = 0;
+
+    // Чтение прекращается, как только набрано нужное количество
+    while (remaining > 0) {
+        ssize_t n = read(fd, buffer, TEXT_BLOCK_SIZE);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = -1;
+            break;
+        }
+
+        size_t take = (size_t)n;
+        if (bytes >= 0) {
+            if ((long)take > remaining) {
+                take = (size_t)remaining;
+            }
+            remaining -= (long)take;
+        } else {
+            const char *p = buffer;
+            const char *end = buffer + n;
+            while (remaining > 0 && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+                p++;
+                remaining--;
+            }
+            if (remaining == 0) {
+                take = (size_t)(p - buffer);
+            }
+        }
+
+        fwrite(buffer, 1, take, shell_stdout());
+    }
+
+    free(buffer);
+    return result;
+}
+
+/**
+ * @brief Встроенная команда head (начало файла)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_head(char **args, int argc) {
+    long lines = 10;
+    long bytes = -1;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        if (strcmp(args[i], "-n") == 0 && i + 1 < argc) {
+            if (parse_count(args[++i], &lines) != 0) {
+                fprintf(shell_stderr(), "head: неверное количество строк '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-c") == 0 && i + 1 < argc) {
+            if (parse_count(args[++i], &bytes) != 0) {
+                fprintf(shell_stderr(), "head: неверное количество байт '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (parse_count(args[i] + 1, &lines) == 0) {
+            // Краткая форма head -5
+        } else if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        } else {
+            fprintf(shell_stderr(), "head: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: head [-n строк | -c байт] [файл...]\n");
+            return -1;
+        }
+    }
+
+    char *stdin_name = "-";
+    char **paths = (i < argc) ? &args[i] : &stdin_name;
+    int count = (i < argc) ? argc - i : 1;
+    int success_count = 0;
+
+    for (int j = 0; j < count; j++) {
+        int fd = open_input(paths[j]);
+        if (fd == -1) {
+            fprintf(shell_stderr(), "head: не удалось открыть '%s': %s\n", paths[j], strerror(errno));
+            continue;
+        }
+
+        if (count > 1) {
+            print_file_header(paths[j], j == 0);
+        }
+        if (head_fd(fd, lines, bytes) == 0) {
+            success_count++;
+        } else {
+            fprintf(shell_stderr(), "head: ошибка чтения '%s': %s\n", paths[j], strerror(errno));
+        }
+        close_input(fd);
+    }
+
+    fflush(shell_stdout());
+
+    if (success_count == count) {
+        return 0;
+    } else if (success_count > 0) {
+        return 1; // Частичный успех
+    } else {
+        return -1; // Полная неудача
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* tail                                                                     */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @brief Поиск начала последних строк в буфере памяти
+ * @param data Данные
+ * @param len Длина данных
+ * @param lines Количество строк
+ * @return Смещение начала последних lines строк
+ */
+static size_t tail_offset_in_memory(const char *data, size_t len, long lines) {
+    if (lines == 0) {
+        return len;
+    }
+
+    // Завершающий перевод строки не начинает новую строку
+    size_t end = (len > 0 && data[len - 1] == '\n') ? len - 1 : len;
+    long found = 0;
+
+    const char *p;
+    while ((p = memrchr(data, '\n', end)) != NULL) {
+        if (++found == lines) {
+            return (size_t)(p - data) + 1;
+        }
+        end = (size_t)(p - data);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Поиск начала последних строк файла обратным чтением блоками
+ * @param fd Дескриптор файла с произвольным доступом
+ * @param size Размер файла
+ * @param lines Количество строк
+ * @return Смещение начала последних lines строк или -1 в случае ошибки
+ */
+static off_t tail_offset_in_file(int fd, off_t size, long lines) {
+    if (lines == 0) {
+        return size;
+    }
+
+    char *buffer = malloc(TEXT_BLOCK_SIZE);
+    if (!buffer) {
+        return -1;
+    }
+
+    off_t pos = size;
+    long found = 0;
+    off_t result = 0;
+
+    // Читается только хвост файла, от конца к началу, без последовательного прохода
+    while (pos > 0) {
+        size_t chunk = pos > TEXT_BLOCK_SIZE ? TEXT_BLOCK_SIZE : (size_t)pos;
+        pos -= (off_t)chunk;
+
+        ssize_t n = pread(fd, buffer, chunk, pos);
+        if (n != (ssize_t)chunk) {
+            result = -1;
+            break;
+        }
+
+        size_t end = chunk;
+        if (pos + (off_t)chunk == size && buffer[chunk - 1] == '\n') {
+            end--;
+        }
+
+        const char *p;
+        while ((p = memrchr(buffer, '\n', end)) != NULL) {
+            if (++found == lines) {
+                result = pos + (p - buffer) + 1;
+                free(buffer);
+                return result;
+            }
+            end = (size_t)(p - buffer);
+        }
+    }
+
+    free(buffer);
+    return result;
+}
+
+/**
+ * @brief Копирование файла с заданного смещения до конца в стандартный вывод
+ * @param fd Дескриптор
+ * @param offset Начальное смещение
+ * @return Смещение после последнего прочитанного байта или -1 в случае ошибки
+ */
+static off_t copy_from_offset(int fd, off_t offset) {
+    char *buffer = malloc(TEXT_BLOCK_SIZE);
+    if (!buffer) {
+        return -1;
+    }
+
+    for (;;) {
+        ssize_t n = pread(fd, buffer, TEXT_BLOCK_SIZE, offset);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            offset = -1;
+            break;
+        }
+        fwrite(buffer, 1, (size_t)n, shell_stdout());
+        offset += n;
+    }
+
+    free(buffer);
+    fflush(shell_stdout());
+    return offset;
+}
+
+/**
+ * @brief tail для канала или устройства: хранится только хвост входа
+ * @param fd Дескриптор
+ * @param lines Количество строк (используется, если bytes < 0)
+ * @param bytes Количество байт или -1
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int tail_stream(int fd, long lines, long bytes) {
+    size_t capacity = 2 * TEXT_BLOCK_SIZE;
+    size_t len = 0;
+    char *data = malloc(capacity);
+    if (!data) {
+        return -1;
+    }
+
+    for (;;) {
+        if (capacity - len < TEXT_BLOCK_SIZE) {
+            // Перед расширением буфера отбрасываем то, что точно не понадобится
+            size_t keep_from = bytes >= 0
+                ? (len > (size_t)bytes ? len - (size_t)bytes : 0)
+                : tail_offset_in_memory(data, len, lines);
+            if (keep_from > 0) {
+                memmove(data, data + keep_from, len - keep_from);
+                len -= keep_from;
+            }
+            if (capacity - len < TEXT_BLOCK_SIZE) {
+                char *grown = realloc(data, capacity * 2);
+                if (!grown) {
+                    free(data);
+                    return -1;
+                }
+                data = grown;
+                capacity *= 2;
+            }
+        }
+
+        ssize_t n = read(fd, data + len, capacity - len);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(data);
+            return -1;
+        }
+        len += (size_t)n;
+    }
+
+    size_t start = bytes >= 0
+        ? (len > (size_t)bytes ? len - (size_t)bytes : 0)
+        : tail_offset_in_memory(data, len, lines);
+    fwrite(data + start, 1, len - start, shell_stdout());
+    fflush(shell_stdout());
+
+    free(data);
+    return 0;
+}
+
+/**
+ * @brief Слежение за ростом файла через inotify (tail -f)
+ * @param path Имя файла
+ * @param fd Открытый дескриптор файла
+ * @param offset Смещение, до которого файл уже выведен
+ * @return 0 после прерывания, -1 в случае ошибки
+ *
+ * @details Следим и за самим файлом, и за его каталогом: при ротации
+ * (переименование или удаление и создание заново) файл открывается
+ * повторно по имени, если у него сменился номер inode.
+ */
+static int tail_follow(const char *path, int fd, off_t offset) {
+    int ifd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (ifd == -1) {
+        fprintf(shell_stderr(), "tail: inotify: %s\n", strerror(errno));
+        return -1;
+    }
+
+    // inotify принимает только пути: каталог сеанса подставляется через /proc
+    char watch_path[PATH_MAX];
+    if (path[0] != '/' && shell_cwd_fd() != AT_FDCWD) {
+        snprintf(watch_path, sizeof(watch_path), "/proc/self/fd/%d/%s", shell_cwd_fd(), path);
+    } else {
+        snprintf(watch_path, sizeof(watch_path), "%s", path);
+    }
+
+    char dir_buffer[PATH_MAX];
+    char base_buffer[PATH_MAX];
+    snprintf(dir_buffer, sizeof(dir_buffer), "%s", watch_path);
+    snprintf(base_buffer, sizeof(base_buffer), "%s", path);
+    const char *dir = dirname(dir_buffer);
+    const char *base = basename(base_buffer);
+
+    const uint32_t file_mask = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+    int file_wd = inotify_add_watch(ifd, watch_path, file_mask);
+    int dir_wd = inotify_add_watch(ifd, dir, IN_CREATE | IN_MOVED_TO);
+
+    struct stat st;
+    fstat(fd, &st);
+    dev_t dev = st.st_dev;
+    ino_t ino = st.st_ino;
+
+    char events[sizeof(struct inotify_event) + NAME_MAX + 1]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    int result = 0;
+
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = ifd, .events = POLLIN },
+            { .fd = g_trap_signal_fd, .events = POLLIN }
+        };
+        int nfds = g_trap_signal_fd != -1 ? 2 : 1;
+
+        // Ctrl+C прерывает poll (EINTR), сигнал под ловушкой приходит в signalfd
+        if (poll(fds, nfds, -1) == -1 || (nfds == 2 && fds[1].revents)) {
+            break;
+        }
+
+        int reopen = 0;
+        ssize_t n;
+        while ((n = read(ifd, events, sizeof(events))) > 0) {
+            for (char *p = events; p < events + n;) {
+                struct inotify_event *ev = (struct inotify_event *)p;
+                if (ev->wd == file_wd && (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF))) {
+                    reopen = 1;
+                } else if (ev->wd == dir_wd && ev->len > 0 && strcmp(ev->name, base) == 0) {
+                    reopen = 1;
+                }
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+        }
+
+        // Усечение файла (например, "> log"): продолжаем с начала
+        if (fstat(fd, &st) == 0 && st.st_size < offset) {
+            fprintf(shell_stderr(), "tail: %s: файл усечён\n", path);
+            offset = 0;
+        }
+        offset = copy_from_offset(fd, offset);
+        if (offset < 0) {
+            result = -1;
+            break;
+        }
+
+        if (reopen) {
+            struct stat new_st;
+            int new_fd = openat(shell_cwd_fd(), path, O_RDONLY | O_CLOEXEC);
+            if (new_fd != -1 && fstat(new_fd, &new_st) == 0 &&
+                (new_st.st_ino != ino || new_st.st_dev != dev)) {
+                fprintf(shell_stderr(), "tail: %s: файл заменён, следим за новым файлом\n", path);
+                close(fd);
+                fd = new_fd;
+                dev = new_st.st_dev;
+                ino = new_st.st_ino;
+                offset = copy_from_offset(fd, 0);
+
+                if (file_wd != -1) {
+                    inotify_rm_watch(ifd, file_wd);
+                }
+                file_wd = inotify_add_watch(ifd, watch_path, file_mask);
+            } else if (new_fd != -1) {
+                close(new_fd);
+            }
+        }
+    }
+
+    close(ifd);
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief Встроенная команда tail (конец файла, слежение за файлом)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_tail(char **args, int argc) {
+    long lines = 10;
+    long bytes = -1;
+    int follow = 0;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        if (strcmp(args[i], "-n") == 0 && i + 1 < argc) {
+            if (parse_count(args[++i], &lines) != 0) {
+                fprintf(shell_stderr(), "tail: неверное количество строк '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-c") == 0 && i + 1 < argc) {
+            if (parse_count(args[++i], &bytes) != 0) {
+                fprintf(shell_stderr(), "tail: неверное количество байт '%s'\n", args[i]);
+                return -1;
+            }
+        } else if (strcmp(args[i], "-f") == 0 || strcmp(args[i], "-F") == 0) {
+            follow = 1;
+        } else if (parse_count(args[i] + 1, &lines) == 0) {
+            // Краткая форма tail -5
+        } else if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        } else {
+            fprintf(shell_stderr(), "tail: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: tail [-n строк | -c байт] [-f] [файл...]\n");
+            return -1;
+        }
+    }
+
+    char *stdin_name = "-";
+    char **paths = (i < argc) ? &args[i] : &stdin_name;
+    int count = (i < argc) ? argc - i : 1;
+
+    if (follow && (count != 1 || strcmp(paths[0], "-") == 0)) {
+        fprintf(shell_stderr(), "tail: -f поддерживается только для одного файла\n");
+        return -1;
+    }
+
+    int success_count = 0;
+
+    for (int j = 0; j < count; j++) {
+        int fd = open_input(paths[j]);
+        if (fd == -1) {
+            fprintf(shell_stderr(), "tail: не удалось открыть '%s': %s\n", paths[j], strerror(errno));
+            continue;
+        }
+
+        if (count > 1) {
+            print_file_header(paths[j], j == 0);
+        }
+        fflush(shell_stdout());
+
+        struct stat st;
+        int result;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            off_t start = bytes >= 0
+                ? (st.st_size > bytes ? st.st_size - bytes : 0)
+                : tail_offset_in_file(fd, st.st_size, lines);
+            off_t end = start >= 0 ? copy_from_offset(fd, start) : -1;
+            result = end >= 0 ? 0 : -1;
+
+            if (result == 0 && follow) {
+                result = tail_follow(paths[j], fd, end);
+                fd = -1;
+            }
+        } else {
+            result = tail_stream(fd, lines, bytes);
+        }
+
+        if (result == 0) {
+            success_count++;
+        } else {
+            fprintf(shell_stderr(), "tail: ошибка чтения '%s': %s\n", paths[j], strerror(errno));
+        }
+        if (fd != -1) {
+            close_input(fd);
+        }
+    }
+
+    if (success_count == count) {
+        return 0;
+    } else if (success_count > 0) {
+        return 1; // Частичный успех
+    } else {
+        return -1; // Полная неудача
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* cut                                                                      */
+/* ------------------------------------------------------------------------ */
+
+/**
+ * @def CUT_BLOCK_SIZE
+ * @brief Начальный размер блока чтения cut
+ */
+#define CUT_BLOCK_SIZE (256 * 1024)
+
+/**
+ * @def CUT_IOV_MAX
+ * @brief Количество фрагментов в буфере вывода до вызова writev
+ */
+#define CUT_IOV_MAX 512
+
+/**
+ * @def CUT_WINDOW
+ * @brief Ширина окна векторного поиска разделителей
+ */
+#define CUT_WINDOW 32
+
+/**
+ * @struct cut_range_t
+ * @brief Диапазон номеров полей или байт (с 1, включительно)
+ */
+typedef struct {
+    size_t lo;  /**< Начало диапазона */
+    size_t hi;  /**< Конец диапазона (SIZE_MAX - до конца строки) */
+} cut_range_t;
+
+/**
+ * @struct cut_options_t
+ * @brief Параметры команды cut
+ */
+typedef struct {
+    cut_range_t *ranges;     /**< Упорядоченные непересекающиеся диапазоны */
+    int range_count;         /**< Количество диапазонов */
+    int by_fields;           /**< 1 - выбор полей (-f), 0 - байт (-c/-b) */
+    char delim;              /**< Разделитель полей */
+    const char *out_delim;   /**< Разделитель при выводе */
+    size_t out_delim_len;    /**< Длина разделителя при выводе */
+    int only_delimited;      /**< Пропускать строки без разделителя (-s) */
+} cut_options_t;
+
+/**
+ * @struct cut_output_t
+ * @brief Буфер вывода из ссылок на фрагменты входного блока
+ */
+typedef struct {
+    struct iovec iov[CUT_IOV_MAX];  /**< Фрагменты для writev */
+    int count;                      /**< Заполненность */
+    int error;                      /**< errno первой ошибки записи */
+} cut_output_t;
+
+/**
+ * @brief Поиск разделителей и переводов строк в окне
+ * @param p Начало окна из CUT_WINDOW байт
+ * @param delim Разделитель
+ * @return Битовая маска найденных позиций
+ */
+typedef uint32_t (*cut_mask_fn)(const char *p, char delim);
+
+/**
+ * @struct cut_scanner_t
+ * @brief Последовательный перебор разделителей и переводов строк
+ */
+typedef struct {
+    const char *window;  /**< Начало текущего окна */
+    const char *end;     /**< Конец данных */
+    uint32_t mask;       /**< Ещё не выданные позиции текущего окна */
+    char delim;          /**< Разделитель */
+    cut_mask_fn fn;      /**< Реализация поиска в полном окне */
+} cut_scanner_t;
+
+#ifdef TEXT_X86
+/**
+ * @brief Поиск в окне двумя сравнениями SSE2 по 16 байт
+ * @param p Начало окна
+ * @param delim Разделитель
+ * @return Битовая маска найденных позиций
+ */
+static uint32_t cut_mask_sse2(const char *p, char delim) {
+    __m128i d = _mm_set1_epi8(delim);
+    __m128i nl = _mm_set1_epi8('\n');
+    __m128i a = _mm_loadu_si128((const __m128i *)p);
+    __m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+    uint32_t lo = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(a, d),
+                                                           _mm_cmpeq_epi8(a, nl)));
+    uint32_t hi = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(b, d),
+                                                           _mm_cmpeq_epi8(b, nl)));
+    return lo | (hi << 16);
+}
+
+/**
+ * @brief Поиск в окне одним сравнением AVX2 по 32 байта
+ * @param p Начало окна
+ * @param delim Разделитель
+ * @return Битовая маска найденных позиций
+ */
+__attribute__((target("avx2")))
+static uint32_t cut_mask_avx2(const char *p, char delim) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(delim)),
+                                   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    return (uint32_t)_mm256_movemask_epi8(hits);
+}
+#else
+/**
+ * @brief Поиск в окне без векторных инструкций
+ * @param p Начало окна
+ * @param delim Разделитель
+ * @return Битовая маска найденных позиций
+ */
+static uint32_t cut_mask_scalar(const char *p, char delim) {
+    uint32_t mask = 0;
+    for (int i = 0; i < CUT_WINDOW; i++) {
+        if (p[i] == delim || p[i] == '\n') {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+#endif
+
+/**
+ * @brief Выбор реализации поиска по возможностям процессора
+ * @return Функция поиска в окне
+ */
+static cut_mask_fn cut_select_mask_fn(void) {
+#ifdef TEXT_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? cut_mask_avx2 : cut_mask_sse2;
+#else
+    return cut_mask_scalar;
+#endif
+}
+
+/**
+ * @brief Маска окна с учётом конца данных
+ * @param sc Состояние перебора
+ * @param p Начало окна
+ * @return Битовая маска найденных позиций
+ */
+static uint32_t cut_scanner_window(const cut_scanner_t *sc, const char *p) {
+    if (sc->end - p >= CUT_WINDOW) {
+        return sc->fn(p, sc->delim);
+    }
+
+    // Хвост короче окна: векторное чтение вышло бы за границу буфера
+    uint32_t mask = 0;
+    for (int i = 0; p + i < sc->end; i++) {
+        if (p[i] == sc->delim || p[i] == '\n') {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief Перенос перебора на произвольную позицию
+ * @param sc Состояние перебора
+ * @param p Новая позиция
+ */
+static void cut_scanner_seek(cut_scanner_t *sc, const char *p) {
+    sc->window = p;
+    sc->mask = cut_scanner_window(sc, p);
+}
+
+/**
+ * @brief Следующий разделитель или перевод строки
+ * @param sc Состояние перебора
+ * @return Указатель на найденный байт или конец данных
+ */
+static inline const char *cut_scanner_next(cut_scanner_t *sc) {
+    while (sc->mask == 0) {
+        sc->window += CUT_WINDOW;
+        if (sc->window >= sc->end) {
+            return sc->end;
+        }
+        sc->mask = cut_scanner_window(sc, sc->window);
+    }
+
+    int bit = __builtin_ctz(sc->mask);
+    sc->mask &= sc->mask - 1;
+    return sc->window + bit;
+}
+
+/**
+ * @brief Запись накопленных фрагментов одним writev
+ * @param out Буфер вывода
+ */
+static void cut_flush(cut_output_t *out) {
+    struct iovec *iov = out->iov;
+    int count = out->count;
+
+    while (count > 0 && !out->error) {
+        ssize_t n = writev(shell_fd(STDOUT_FILENO), iov, count);
+        if (n < 0) {
+            if (errno != EINTR) {
+                out->error = errno;
+            }
+            continue;
+        }
+
+        // Частичная запись: пропуск записанных фрагментов
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+
+    out->count = 0;
+}
+
+/**
+ * @brief Добавление фрагмента в буфер вывода
+ * @param out Буфер вывода
+ * @param p Начало фрагмента
+ * @param len Длина фрагмента
+ */
+static inline void cut_emit(cut_output_t *out, const char *p, size_t len) {
+    if (len == 0) {
+        return;
+    }
+
+    // Соседние в памяти фрагменты сливаются в один
+    if (out->count > 0) {
+        struct iovec *prev = &out->iov[out->count - 1];
+        if ((const char *)prev->iov_base + prev->iov_len == p) {
+            prev->iov_len += len;
+            return;
+        }
+    }
+
+    if (out->count == CUT_IOV_MAX) {
+        cut_flush(out);
+    }
+    out->iov[out->count].iov_base = (void *)p;
+    out->iov[out->count].iov_len = len;
+    out->count++;
+}
+
+/**
+ * @brief Сравнение диапазонов для сортировки
+ * @param a Первый диапазон
+ * @param b Второй диапазон
+ * @return Результат сравнения
+ */
+static int cut_range_compare(const void *a, const void *b) {
+    const cut_range_t *ra = a;
+    const cut_range_t *rb = b;
+    return (ra->lo > rb->lo) - (ra->lo < rb->lo);
+}
+
+/**
+ * @brief Разбор списка диапазонов вида "1,3-5,7-"
+ * @param list Строка списка
+ * @param opt Параметры, куда записываются диапазоны
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+static int cut_parse_list(const char *list, cut_options_t *opt) {
+    int capacity = 1;
+    for (const char *p = list; *p; p++) {
+        if (*p == ',') {
+            capacity++;
+        }
+    }
+
+    cut_range_t *ranges = malloc((size_t)capacity * sizeof(cut_range_t));
+    if (!ranges) {
+        return -1;
+    }
+
+    int count = 0;
+    const char *p = list;
+    while (*p) {
+        char *end = NULL;
+        cut_range_t r = {1, SIZE_MAX};
+        int numbers = 0;
+
+        if (isdigit((unsigned char)*p)) {
+            r.lo = strtoul(p, &end, 10);
+            p = end;
+            r.hi = r.lo;
+            numbers++;
+        }
+        if (*p == '-') {
+            p++;
+            r.hi = SIZE_MAX;
+            if (isdigit((unsigned char)*p)) {
+                r.hi = strtoul(p, &end, 10);
+                p = end;
+                numbers++;
+            }
+        }
+        if (numbers == 0 || (*p != ',' && *p != '\0') || r.lo == 0 || r.hi < r.lo) {
+            break;
+        }
+
+        ranges[count++] = r;
+        if (*p == ',') {
+            p++;
+        }
+    }
+
+    if (*p != '\0' || count == 0) {
+        free(ranges);
+        return -1;
+    }
+
+    // Сортировка и слияние пересекающихся диапазонов
+    qsort(ranges, (size_t)count, sizeof(cut_range_t), cut_range_compare);
+    int merged = 0;
+    for (int i = 1; i < count; i++) {
+        if (ranges[merged].hi == SIZE_MAX || ranges[i].lo <= ranges[merged].hi + 1) {
+            if (ranges[i].hi > ranges[merged].hi) {
+                ranges[merged].hi = ranges[i].hi;
+            }
+        } else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+
+    opt->ranges = ranges;
+    opt->range_count = merged + 1;
+    return 0;
+}
+
+/**
+ * @brief Обработка полных строк в режиме выбора полей
+ * @param out Буфер вывода
+ * @param opt Параметры
+ * @param sc Состояние перебора
+ * @param data Строки; последний байт - перевод строки
+ * @param len Длина данных
+ */
+static void cut_fields(cut_output_t *out, const cut_options_t *opt, cut_scanner_t *sc,
+                       const char *data, size_t len) {
+    const char *end = data + len;
+    size_t last_field = opt->ranges[opt->range_count - 1].hi;
+
+    sc->end = end;
+    cut_scanner_seek(sc, data);
+
+    const char *line = data;
+    while (line < end) {
+        const char *field_start = line;
+        size_t field = 1;
+        int range = 0;
+        int delimited = 0;
+        int emitted = 0;
+
+        const char *p = cut_scanner_next(sc);
+        while (*p != '\n') {
+            delimited = 1;
+
+            // Номера полей растут, поэтому диапазоны проверяются по порядку
+            while (opt->ranges[range].hi < field) {
+                range++;
+            }
+            if (opt->ranges[range].lo <= field) {
+                if (emitted) {
+                    cut_emit(out, opt->out_delim, opt->out_delim_len);
+                }
+                cut_emit(out, field_start, (size_t)(p - field_start));
+                emitted = 1;
+            }
+
+            field++;
+            field_start = p + 1;
+
+            if (field > last_field) {
+                // Остаток строки не нужен: сразу к её концу
+                p = memchr(field_start, '\n', (size_t)(end - field_start));
+                cut_scanner_seek(sc, p + 1);
+                break;
+            }
+            p = cut_scanner_next(sc);
+        }
+
+        if (!delimited) {
+            if (!opt->only_delimited) {
+                cut_emit(out, line, (size_t)(p - line + 1));
+            }
+        } else {
+            if (field <= last_field) {
+                while (opt->ranges[range].hi < field) {
+                    range++;
+                }
+                if (opt->ranges[range].lo <= field) {
+                    if (emitted) {
+                        cut_emit(out, opt->out_delim, opt->out_delim_len);
+                    }
+                    cut_emit(out, field_start, (size_t)(p - field_start));
+                }
+            }
+            cut_emit(out, p, 1);
+        }
+
+        line = p + 1;
+    }
+}
+
+/**
+ * @brief Обработка полных строк в режиме выбора байт
+ * @param out Буфер вывода
+ * @param opt Параметры
+ * @param data Строки; последний байт - перевод строки
+ * @param len Длина данных
+ */
+static void cut_bytes(cut_output_t *out, const cut_options_t *opt,
+                      const char *data, size_t len) {
+    const char *end = data + len;
+    const char *line = data;
+
+    while (line < end) {
+        const char *nl = memchr(line, '\n', (size_t)(end - line));
+        size_t line_len = (size_t)(nl - line);
+
+        for (int i = 0; i < opt->range_count && opt->ranges[i].lo <= line_len; i++) {
+            size_t hi = opt->ranges[i].hi < line_len ? opt->ranges[i].hi : line_len;
+            if (i > 0) {
+                cut_emit(out, opt->out_delim, opt->out_delim_len);
+            }
+            cut_emit(out, line + opt->ranges[i].lo - 1, hi - opt->ranges[i].lo + 1);
+        }
+        cut_emit(out, nl, 1);
+
+        line = nl + 1;
+    }
+}
+
+/**
+ * @brief Обработка одного входного файла
+ * @param fd Дескриптор
+ * @param opt Параметры
+ * @param out Буфер вывода
+ * @param sc Состояние перебора
+ * @return 0 в случае успеха, -1 в случае ошибки чтения
+ */
+static int cut_fd(int fd, const cut_options_t *opt, cut_output_t *out, cut_scanner_t *sc) {
+    size_t capacity = CUT_BLOCK_SIZE;
+    // Лишний байт - для перевода строки после незавершённой последней строки
+    char *buffer = malloc(capacity + 1);
+    if (!buffer) {
+        return -1;
+    }
+
+    size_t len = 0;
+    int result = 0;
+    int eof = 0;
+
+    while (!eof && !out->error) {
+        ssize_t n = read(fd, buffer + len, capacity - len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = -1;
+            break;
+        }
+
+        if (n == 0) {
+            eof = 1;
+            if (len > 0 && buffer[len - 1] != '\n') {
+                buffer[len++] = '\n';
+            }
+        } else {
+            len += (size_t)n;
+        }
+
+        // Обрабатываются только полные строки, хвост переносится в начало
+        const char *last_nl = len > 0 ? memrchr(buffer, '\n', len) : NULL;
+        size_t ready = last_nl ? (size_t)(last_nl - buffer) + 1 : 0;
+
+        if (ready > 0) {
+            if (opt->by_fields) {
+                cut_fields(out, opt, sc, buffer, ready);
+            } else {
+                cut_bytes(out, opt, buffer, ready);
+            }
+            // Фрагменты ссылаются на буфер: запись до его изменения
+            cut_flush(out);
+            memmove(buffer, buffer + ready, len - ready);
+            len -= ready;
+        } else if (len == capacity) {
+            // Строка длиннее блока
+            char *grown = realloc(buffer, capacity * 2 + 1);
+            if (!grown) {
+                result = -1;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+    }
+
+    free(buffer);
+    return result;
+}
+
+/**
+ * @brief Встроенная команда cut (выбор полей и байт из строк)
+ * @param args Аргументы команды
+ * @param argc Количество аргументов
+ * @return 0 в случае успеха, 1 при частичной неудаче, -1 в случае ошибки
+ */
+int builtin_cut(char **args, int argc) {
+    cut_options_t opt = {0};
+    const char *list = NULL;
+    const char *delim = NULL;
+    const char *out_delim = NULL;
+    int i = 1;
+
+    opt.delim = '\t';
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        const char *arg = args[i];
+
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        } else if (strncmp(arg, "--output-delimiter", 18) == 0) {
+            if (arg[18] == '=') {
+                out_delim = arg + 19;
+            } else if (arg[18] == '\0' && i + 1 < argc) {
+                out_delim = args[++i];
+            } else {
+                fprintf(shell_stderr(), "cut: параметру '--output-delimiter' нужно значение\n");
+                return -1;
+            }
+        } else if (strcmp(arg, "-s") == 0) {
+            opt.only_delimited = 1;
+        } else if (strchr("fcbd", arg[1]) && (arg[2] != '\0' || i + 1 < argc)) {
+            // Значение слитно (-f1,3) или отдельным аргументом (-f 1,3)
+            const char *value = arg[2] != '\0' ? arg + 2 : args[++i];
+            if (arg[1] == 'd') {
+                delim = value;
+            } else {
+                if (list) {
+                    fprintf(shell_stderr(), "cut: можно указать только один из -f, -c, -b\n");
+                    return -1;
+                }
+                list = value;
+                opt.by_fields = arg[1] == 'f';
+            }
+        } else {
+            fprintf(shell_stderr(), "cut: неизвестный параметр '%s'\n", arg);
+            fprintf(shell_stderr(), "Использование: cut -f список [-d разделитель] [-s] "
+                            "[--output-delimiter строка] [файл...]\n");
+            fprintf(shell_stderr(), "               cut -c список [файл...]\n");
+            return -1;
+        }
+    }
+
+    if (!list) {
+        fprintf(shell_stderr(), "cut: нужно указать список полей (-f) или байт (-c, -b)\n");
+        return -1;
+    }
+
+    if (delim) {
+        if (!opt.by_fields) {
+            fprintf(shell_stderr(), "cut: разделитель задаётся только вместе с -f\n");
+            return -1;
+        }
+        // Кавычек в оболочке нет, поэтому табуляцию можно записать как \t
+        if (strcmp(delim, "\\t") == 0) {
+            opt.delim = '\t';
+        } else if (strlen(delim) == 1) {
+            opt.delim = delim[0];
+        } else {
+            fprintf(shell_stderr(), "cut: разделитель должен быть одним символом\n");
+            return -1;
+        }
+    }
+
+    if (cut_parse_list(list, &opt) != 0) {
+        fprintf(shell_stderr(), "cut: неверный список '%s'\n", list);
+        return -1;
+    }
+
+    if (out_delim) {
+        opt.out_delim = out_delim;
+    } else if (opt.by_fields) {
+        opt.out_delim = &opt.delim;
+    } else {
+        opt.out_delim = "";
+    }
+    opt.out_delim_len = out_delim ? strlen(out_delim) : (opt.by_fields ? 1 : 0);
+
+    cut_output_t *out = calloc(1, sizeof(cut_output_t));
+    if (!out) {
+        free(opt.ranges);
+        return -1;
+    }
+
+    cut_scanner_t scanner = {0};
+    scanner.delim = opt.delim;
+    scanner.fn = cut_select_mask_fn();
+
+    // Вывод идёт мимо stdio, поэтому его буфер сбрасывается заранее
+    fflush(shell_stdout());
+
+    char *stdin_name = "-";
+    char **paths = (i < argc) ? &args[i] : &stdin_name;
+    int count = (i < argc) ? argc - i : 1;
+    int success_count = 0;
+
+    for (int j = 0; j < count && !out->error; j++) {
+        int fd = open_input(paths[j]);
+        if (fd == -1) {
+            fprintf(shell_stderr(), "cut: не удалось открыть '%s': %s\n", paths[j], strerror(errno));
+            continue;
+        }
+
+        if (cut_fd(fd, &opt, out, &scanner) == 0) {
+            success_count++;
+        } else {
+            fprintf(shell_stderr(), "cut: ошибка чтения '%s': %s\n", paths[j], strerror(errno));
+        }
+        close_input(fd);
+    }
+
+    if (out->error && out->error != EPIPE) {
+        fprintf(shell_stderr(), "cut: ошибка записи: %s\n", strerror(out->error));
+    }
+
+    free(out);
+    free(opt.ranges);
+
+    if (success_count == count) {
+        return 0;
+    } else if (success_count > 0) {
+        return 1; // Частичный успех
+    } else {
+        return -1; // Полная неудача
+    }
+}
@@ -0,0 +1,605 @@
+/**
+ * @file threadpool.c
+ * @brief Реализация общего пула потоков с перехватом работы
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "threadpool.h"
+#include "jobs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/**
+ * @def THREADPOOL_DEQUE_INITIAL
+ * @brief Начальная ёмкость очереди рабочего потока
+ */
+#define THREADPOOL_DEQUE_INITIAL 64
+
+/**
+ * @struct threadpool_task_t
+ * @brief Задание в очереди
+ */
+typedef struct {
+    threadpool_fn fn;              /**< Функция */
+    void *arg;                     /**< Аргумент */
+    threadpool_group_t *group;     /**< Группа */
+} threadpool_task_t;
+
+/**
+ * @struct threadpool_group
+ * @brief Группа заданий
+ */
+struct threadpool_group {
+    atomic_int pending;            /**< Ещё не завершённые задания */
+    atomic_int cancelled;          /**< Явная отмена */
+    unsigned int generation;       /**< Номер прерывания на момент создания */
+    int interruptible;             /**< Отменяется по Ctrl+C */
+    const atomic_int *parent;      /**< Флаг отмены фоновой задачи или NULL */
+};
+
+/**
+ * @struct threadpool_deque_t
+ * @brief Кольцевая очередь рабочего потока
+ */
+typedef struct {
+    pthread_mutex_t lock;          /**< Защита очереди */
+    threadpool_task_t *tasks;      /**< Буфер */
+    size_t capacity;               /**< Ёмкость */
+    size_t head;                   /**< Начало (отсюда забирают другие потоки) */
+    size_t count;                  /**< Количество заданий */
+} threadpool_deque_t;
+
+// Очереди рабочих потоков; очередь 0 существует и до запуска потоков
+static threadpool_deque_t deques[THREADPOOL_MAX_THREADS];
+static pthread_t threads[THREADPOOL_MAX_THREADS];
+
+// Состояние пула: запущенные и спящие потоки, целевой размер
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static atomic_int pool_started = 0;
+static atomic_int pool_queued = 0;
+static atomic_uint submit_cursor = 0;
+static atomic_int pool_target = 1;
+static int pool_idle = 0;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+// Размер по умолчанию читается из разных сеансов и вычисляется один раз
+static pthread_once_t default_size_once = PTHREAD_ONCE_INIT;
+static int default_size = 1;
+
+// Увеличивается при каждом Ctrl+C
+static atomic_uint interrupt_generation = 0;
+
+// Номер рабочего потока (-1 - не поток пула) и группа выполняемого задания
+static __thread int worker_index = -1;
+static __thread threadpool_group_t *current_group = NULL;
+
+/**
+ * @brief Чтение квоты из cpu.max (cgroup v2)
+ * @param dir Каталог группы
+ * @return Количество процессоров по квоте или 0, если квоты нет
+ */
+static int threadpool_read_cpu_max(const char *dir) {
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/cpu.max", dir) >= (int)sizeof(path)) {
+        return 0;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+
+    char quota[32] = "";
+    long period = 0;
+    int cpus = 0;
+    if (fscanf(f, "%31s %ld", quota, &period) == 2 && strcmp(quota, "max") != 0 && period > 0) {
+        long q = atol(quota);
+        cpus = (int)((q + period - 1) / period);
+    }
+    fclose(f);
+    return cpus;
+}
+
+/**
+ * @brief Чтение квоты из cpu.cfs_quota_us (cgroup v1)
+ * @param dir Каталог группы
+ * @return Количество процессоров по квоте или 0, если квоты нет
+ */
+static int threadpool_read_cfs_quota(const char *dir) {
+    char path[PATH_MAX];
+    long quota = -1;
+    long period = 0;
+
+    if (snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir) >= (int)sizeof(path)) {
+        return 0;
+    }
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    if (fscanf(f, "%ld", &quota) != 1) {
+        quota = -1;
+    }
+    fclose(f);
+
+    if (snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir) >= (int)sizeof(path)) {
+        return 0;
+    }
+    f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    if (fscanf(f, "%ld", &period) != 1) {
+        period = 0;
+    }
+    fclose(f);
+
+    return quota > 0 && period > 0 ? (int)((quota + period - 1) / period) : 0;
+}
+
+/**
+ * @brief Квота процессора cgroup текущего процесса
+ * @return Количество процессоров по квоте или 0, если квоты нет
+ *
+ * @details Для cgroup v2 учитываются все родительские группы: действует
+ * наименьшая квота на пути к корню.
+ */
+static int threadpool_cgroup_cpus(void) {
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    if (!f) {
+        return 0;
+    }
+
+    char line[PATH_MAX];
+    char v2_path[PATH_MAX] = "";
+    char v1_path[PATH_MAX] = "";
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *controllers = strchr(line, ':');
+        char *path = controllers ? strchr(controllers + 1, ':') : NULL;
+        if (!path) {
+            continue;
+        }
+        *path++ = '\0';
+        controllers++;
+
+        if (strcmp(line, "0") == 0 && controllers[0] == '\0') {
+            snprintf(v2_path, sizeof(v2_path), "%s", path);
+        } else if (strstr(controllers, "cpu") && !strstr(controllers, "cpuset") &&
+                   strcmp(controllers, "cpuacct") != 0) {
+            snprintf(v1_path, sizeof(v1_path), "%s", path);
+        }
+    }
+    fclose(f);
+
+    int best = 0;
+    char dir[PATH_MAX];
+
+    // cgroup v2: от группы процесса к корню (слишком длинный путь пропускается)
+    int dir_len = snprintf(dir, sizeof(dir), "/sys/fs/cgroup%s", v2_path);
+    while (dir_len < (int)sizeof(dir)) {
+        int cpus = threadpool_read_cpu_max(dir);
+        if (cpus > 0 && (best == 0 || cpus < best)) {
+            best = cpus;
+        }
+        char *slash = strrchr(dir, '/');
+        if (!slash || slash == dir || strcmp(dir, "/sys/fs/cgroup") == 0) {
+            break;
+        }
+        *slash = '\0';
+    }
+
+    // cgroup v1: контроллер cpu смонтирован отдельно
+    if (best == 0) {
+        const char *mounts[] = {"/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct"};
+        for (size_t i = 0; i < sizeof(mounts) / sizeof(mounts[0]) && best == 0; i++) {
+            if (snprintf(dir, sizeof(dir), "%s%s", mounts[i], v1_path) < (int)sizeof(dir)) {
+                best = threadpool_read_cfs_quota(dir);
+            }
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Однократный расчёт размера пула по умолчанию
+ */
+static void threadpool_compute_default_size(void) {
+    cpu_set_t set;
+    int cpus = 1;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        cpus = CPU_COUNT(&set);
+    }
+
+    int quota = threadpool_cgroup_cpus();
+    if (quota > 0 && quota < cpus) {
+        cpus = quota;
+    }
+    if (cpus > THREADPOOL_MAX_THREADS) {
+        cpus = THREADPOOL_MAX_THREADS;
+    }
+
+    default_size = cpus > 0 ? cpus : 1;
+}
+
+/**
+ * @brief Размер пула по умолчанию: квота cgroup, ограниченная доступными CPU
+ * @return Количество потоков
+ */
+static int threadpool_default_size(void) {
+    pthread_once(&default_size_once, threadpool_compute_default_size);
+    return default_size;
+}
+
+/**
+ * @brief Текущий размер пула
+ * @return CUSTOM_SHELL_THREADS, если задана, иначе квота CPU cgroup
+ */
+int threadpool_size(void) {
+    const char *value = get_env_var("CUSTOM_SHELL_THREADS");
+    if (value && *value) {
+        char *end = NULL;
+        long n = strtol(value, &end, 10);
+        if (*end == '\0' && n > 0) {
+            return n > THREADPOOL_MAX_THREADS ? THREADPOOL_MAX_THREADS : (int)n;
+        }
+    }
+    return threadpool_default_size();
+}
+
+/**
+ * @brief Сброс пула в дочернем процессе после fork
+ *
+ * @details Потоки пула не переживают fork; очереди и блокировки
+ * инициализируются заново, потоки снова создадутся по требованию.
+ */
+static void threadpool_atfork_child(void) {
+    pthread_mutex_t lock_init = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond_init = PTHREAD_COND_INITIALIZER;
+
+    pool_lock = lock_init;
+    pool_wake = cond_init;
+    pool_done = cond_init;
+    atomic_store(&pool_started, 0);
+    atomic_store(&pool_queued, 0);
+    pool_idle = 0;
+
+    for (int i = 0; i < THREADPOOL_MAX_THREADS; i++) {
+        deques[i].lock = lock_init;
+        deques[i].head = 0;
+        deques[i].count = 0;
+    }
+}
+
+/**
+ * @brief Однократная инициализация очередей
+ */
+static void threadpool_init(void) {
+    for (int i = 0; i < THREADPOOL_MAX_THREADS; i++) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+    }
+    pthread_atfork(NULL, NULL, threadpool_atfork_child);
+}
+
+/**
+ * @brief Добавление задания в конец очереди
+ * @param dq Очередь
+ * @param task Задание
+ * @return 0 в случае успеха, -1 при нехватке памяти
+ */
+static int deque_push(threadpool_deque_t *dq, const threadpool_task_t *task) {
+    pthread_mutex_lock(&dq->lock);
+
+    if (dq->count == dq->capacity) {
+        size_t capacity = dq->capacity ? dq->capacity * 2 : THREADPOOL_DEQUE_INITIAL;
+        threadpool_task_t *tasks = malloc(capacity * sizeof(threadpool_task_t));
+        if (!tasks) {
+            pthread_mutex_unlock(&dq->lock);
+            return -1;
+        }
+        for (size_t i = 0; i < dq->count; i++) {
+            tasks[i] = dq->tasks[(dq->head + i) % dq->capacity];
+        }
+        free(dq->tasks);
+        dq->tasks = tasks;
+        dq->capacity = capacity;
+        dq->head = 0;
+    }
+
+    dq->tasks[(dq->head + dq->count) % dq->capacity] = *task;
+    dq->count++;
+
+    pthread_mutex_unlock(&dq->lock);
+    return 0;
+}
+
+/**
+ * @brief Извлечение задания из очереди
+ * @param dq Очередь
+ * @param from_back 1 - с конца (владелец), 0 - с начала (перехват)
+ * @param task Куда записать задание
+ * @return 1 если задание извлечено, 0 если очередь пуста
+ */
+static int deque_take(threadpool_deque_t *dq, int from_back, threadpool_task_t *task) {
+    pthread_mutex_lock(&dq->lock);
+
+    int taken = 0;
+    if (dq->count > 0) {
+        if (from_back) {
+            *task = dq->tasks[(dq->head + dq->count - 1) % dq->capacity];
+        } else {
+            *task = dq->tasks[dq->head];
+            dq->head = (dq->head + 1) % dq->capacity;
+        }
+        dq->count--;
+        taken = 1;
+    }
+
+    pthread_mutex_unlock(&dq->lock);
+    return taken;
+}
+
+/**
+ * @brief Поиск задания: сначала своя очередь, затем чужие
+ * @param self Номер рабочего потока или -1
+ * @param task Куда записать задание
+ * @return 1 если задание найдено
+ */
+static int threadpool_take(int self, threadpool_task_t *task) {
+    if (atomic_load(&pool_queued) == 0) {
+        return 0;
+    }
+
+    if (self >= 0 && deque_take(&deques[self], 1, task)) {
+        atomic_fetch_sub(&pool_queued, 1);
+        return 1;
+    }
+
+    int count = atomic_load(&pool_started);
+    if (count < 1) {
+        count = 1;
+    }
+    int start = self >= 0 ? self + 1 : 0;
+    for (int i = 0; i < count; i++) {
+        int victim = (start + i) % count;
+        if (victim != self && deque_take(&deques[victim], 0, task)) {
+            atomic_fetch_sub(&pool_queued, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Проверка отмены группы
+ * @param group Группа
+ * @return Ненулевое значение если группа отменена
+ */
+static int group_cancelled(const threadpool_group_t *group) {
+    return atomic_load(&group->cancelled) ||
+           (group->interruptible && atomic_load(&interrupt_generation) != group->generation) ||
+           (group->parent && atomic_load(group->parent));
+}
+
+/**
+ * @brief Выполнение задания и учёт его завершения в группе
+ * @param task Задание
+ */
+static void threadpool_run(const threadpool_task_t *task) {
+    threadpool_group_t *saved = current_group;
+    current_group = task->group;
+
+    // Задания отменённой группы не начинаются, но учитываются как завершённые
+    if (!group_cancelled(task->group)) {
+        task->fn(task->arg);
+    }
+
+    current_group = saved;
+
+    if (atomic_fetch_sub(&task->group->pending, 1) == 1) {
+        pthread_mutex_lock(&pool_lock);
+        pthread_cond_broadcast(&pool_done);
+        pthread_mutex_unlock(&pool_lock);
+    }
+}
+
+/**
+ * @brief Цикл рабочего потока
+ * @param arg Номер потока
+ * @return NULL
+ */
+static void *threadpool_worker(void *arg) {
+    worker_index = (int)(long)arg;
+
+    for (;;) {
+        threadpool_task_t task;
+        if (worker_index < pool_target && threadpool_take(worker_index, &task)) {
+            threadpool_run(&task);
+            continue;
+        }
+
+        // Потоки сверх уменьшенного размера пула не берут работу
+        pthread_mutex_lock(&pool_lock);
+        while (atomic_load(&pool_queued) == 0 || worker_index >= pool_target) {
+            pool_idle++;
+            pthread_cond_wait(&pool_wake, &pool_lock);
+            pool_idle--;
+        }
+        pthread_mutex_unlock(&pool_lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Запуск ещё одного рабочего потока (вызывается под pool_lock)
+ */
+static void threadpool_spawn(void) {
+    int index = atomic_load(&pool_started);
+    if (index >= THREADPOOL_MAX_THREADS) {
+        return;
+    }
+
+    // Сигналы доставляются основному потоку оболочки
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &saved);
+    if (pthread_create(&threads[index], NULL, threadpool_worker, (void *)(long)index) == 0) {
+        pthread_detach(threads[index]);
+        atomic_store(&pool_started, index + 1);
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+}
+
+/**
+ * @brief Создание группы заданий
+ * @return Группа или NULL в случае ошибки
+ */
+threadpool_group_t *threadpool_group_create(void) {
+    pthread_once(&pool_once, threadpool_init);
+
+    threadpool_group_t *group = calloc(1, sizeof(threadpool_group_t));
+    if (!group) {
+        return NULL;
+    }
+
+    // Работа фоновой задачи отменяется вместе с ней, а не по Ctrl+C
+    group->parent = task_cancel_flag();
+    group->interruptible = group->parent == NULL;
+    group->generation = atomic_load(&interrupt_generation);
+
+    // Размер пула перечитывается, чтобы изменение переменной сразу действовало
+    pthread_mutex_lock(&pool_lock);
+    pool_target = threadpool_size();
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    return group;
+}
+
+/**
+ * @brief Отправка задания в пул
+ * @param group Группа
+ * @param fn Функция задания
+ * @param arg Аргумент
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int threadpool_submit(threadpool_group_t *group, threadpool_fn fn, void *arg) {
+    if (!group || !fn) {
+        return -1;
+    }
+
+    threadpool_task_t task = {fn, arg, group};
+
+    // Поток пула кладёт задание себе, внешний - по кругу в очереди потоков
+    int target = worker_index;
+    if (target < 0) {
+        int started = atomic_load(&pool_started);
+        target = started > 0 ? (int)(atomic_fetch_add(&submit_cursor, 1) % (unsigned)started) : 0;
+    }
+
+    atomic_fetch_add(&group->pending, 1);
+    if (deque_push(&deques[target], &task) != 0) {
+        atomic_fetch_sub(&group->pending, 1);
+        return -1;
+    }
+    atomic_fetch_add(&pool_queued, 1);
+
+    // Новый поток создаётся, только если некому взять задание
+    pthread_mutex_lock(&pool_lock);
+    if (pool_idle > 0) {
+        pthread_cond_signal(&pool_wake);
+    } else if (atomic_load(&pool_started) < pool_target) {
+        threadpool_spawn();
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    return 0;
+}
+
+/**
+ * @brief Ожидание всех заданий группы
+ * @param group Группа
+ * @return 0 если группа выполнена полностью, -1 если она была отменена
+ */
+int threadpool_group_wait(threadpool_group_t *group) {
+    if (!group) {
+        return -1;
+    }
+
+    while (atomic_load(&group->pending) > 0) {
+        threadpool_task_t task;
+        if (threadpool_take(worker_index, &task)) {
+            threadpool_run(&task);
+            continue;
+        }
+
+        // Все задания группы уже выполняются другими потоками
+        pthread_mutex_lock(&pool_lock);
+        if (atomic_load(&group->pending) > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += 50 * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&pool_done, &pool_lock, &deadline);
+        }
+        pthread_mutex_unlock(&pool_lock);
+    }
+
+    return group_cancelled(group) ? -1 : 0;
+}
+
+/**
+ * @brief Отмена группы: ещё не начатые задания пропускаются
+ * @param group Группа
+ */
+void threadpool_group_cancel(threadpool_group_t *group) {
+    if (group) {
+        atomic_store(&group->cancelled, 1);
+    }
+}
+
+/**
+ * @brief Освобождение группы (после threadpool_group_wait)
+ * @param group Группа
+ */
+void threadpool_group_destroy(threadpool_group_t *group) {
+    free(group);
+}
+
+/**
+ * @brief Проверка отмены из выполняемого задания
+ * @return Ненулевое значение если работу текущего задания нужно прекратить
+ */
+int threadpool_cancelled(void) {
+    if (current_group) {
+        return group_cancelled(current_group);
+    }
+    return task_cancelled();
+}
+
+/**
+ * @brief Отмена групп переднего плана (вызывается из обработчика SIGINT)
+ */
+void threadpool_interrupt(void) {
+    // Неблокирующая атомарная операция допустима в обработчике сигнала
+    atomic_fetch_add(&interrupt_generation, 1);
+}
@@ -37,11 +37,12 @@ char **split_string(const char *str, const char *delim, int *count)
         return NULL;
     }
 
-    char *token = strtok(temp_str, delim);
+    char *saveptr = NULL;
+    char *token = strtok_r(temp_str, delim, &saveptr);
     while (token)
     {
         (*count)++;
-        token = strtok(NULL, delim);
+        token = strtok_r(NULL, delim, &saveptr);
     }
 
     free(temp_str);
@@ -66,7 +67,7 @@ char **split_string(const char *str, const char *delim, int *count)
         return NULL;
     }
 
-    token = strtok(temp_str, delim);
+    token = strtok_r(temp_str, delim, &saveptr);
     int i = 0;
     while (token && i < *count)
     {
@@ -83,7 +84,7 @@ char **split_string(const char *str, const char *delim, int *count)
             return NULL;
         }
         i++;
-        token = strtok(NULL, delim);
+        token = strtok_r(NULL, delim, &saveptr);
     }
 
     result[i] = NULL; // Завершающий NULL
@@ -149,6 +150,141 @@ char *trim_string(char *str)
     return str;
 }
 
+/**
+ * @brief Граница слова в кавычках, разбитого парсером по пробелам
+ * @param args Слова команды
+ * @param argc Количество слов
+ * @param start Индекс первого слова
+ * @param offset Смещение возможной открывающей кавычки в первом слове
+ * @return Индекс слова после закрывающей кавычки
+ */
+int quoted_span(char *const *args, int argc, int start, size_t offset)
+{
+    const char *first = args[start] + offset;
+    char quote = first[0];
+    if (quote != '\'' && quote != '"')
+    {
+        return start + 1;
+    }
+
+    for (int i = start; i < argc; i++)
+    {
+        const char *p = i == start ? first + 1 : args[i];
+        while ((p = strchr(p, quote)) != NULL)
+        {
+            // '\'' внутри одинарных кавычек не закрывает их
+            if (quote == '\'' && strncmp(p, "'\\''", 4) == 0)
+            {
+                p += 4;
+                continue;
+            }
+            return i + 1;
+        }
+    }
+
+    return argc;
+}
+
+/**
+ * @brief Сборка тела из слов, разбитых парсером по пробелам
+ * @param args Слова команды
+ * @param start Индекс первого слова
+ * @param end Индекс слова после последнего
+ * @param offset Количество пропускаемых байт первого слова
+ * @param buffer Буфер для тела
+ * @param size Размер буфера
+ * @return buffer
+ */
+char *join_words(char *const *args, int start, int end, size_t offset,
+                 char *buffer, size_t size)
+{
+    buffer[0] = '\0';
+    for (int i = start; i < end; i++)
+    {
+        if (i > start)
+        {
+            strncat(buffer, " ", size - strlen(buffer) - 1);
+        }
+        strncat(buffer, i == start ? args[i] + offset : args[i], size - strlen(buffer) - 1);
+    }
+
+    size_t len = strlen(buffer);
+    char quote = buffer[0];
+    if (len < 2 || (quote != '\'' && quote != '"') || buffer[len - 1] != quote)
+    {
+        return buffer;
+    }
+
+    // Снятие кавычек и '\'' внутри одинарных кавычек
+    size_t out = 0;
+    for (size_t in = 1; in < len - 1; in++)
+    {
+        if (quote == '\'' && strncmp(buffer + in, "'\\''", 4) == 0)
+        {
+            buffer[out++] = '\'';
+            in += 3;
+            continue;
+        }
+        buffer[out++] = buffer[in];
+    }
+    buffer[out] = '\0';
+
+    return buffer;
+}
+
+/**
+ * @brief Поиск переменной среди переменных контекста
+ * @param state Состояние оболочки
+ * @param name Имя переменной
+ * @return Индекс записи или -1 если не найдена
+ */
+static int context_var_index(const shell_state_t *state, const char *name)
+{
+    size_t name_len = strlen(name);
+
+    for (int i = 0; i < state->var_count; i++)
+    {
+        if (strncmp(state->vars[i], name, name_len) == 0 && state->vars[i][name_len] == '=')
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Количество переменных контекста текущего потока
+ * @return Количество переменных, которые нужно добавить в окружение процессов
+ */
+int context_var_count(void)
+{
+    shell_state_t *state = shell_current();
+    if (!state || state->vars_hidden)
+    {
+        return 0;
+    }
+
+    return state->var_count;
+}
+
+/**
+ * @brief Освобождение переменных контекста
+ * @param state Состояние оболочки
+ */
+void free_context_vars(shell_state_t *state)
+{
+    if (!state)
+    {
+        return;
+    }
+
+    free_string_array(state->vars, state->var_count);
+    state->vars = NULL;
+    state->var_count = 0;
+    state->var_capacity = 0;
+}
+
 /**
  * @brief Получение переменной окружения
  * @param name Имя переменной
@@ -161,6 +297,17 @@ char *get_env_var(const char *name)
         return NULL;
     }
 
+    // Переменные встроенного контекста перекрывают окружение процесса
+    shell_state_t *state = shell_current();
+    if (state && !state->vars_hidden)
+    {
+        int index = context_var_index(state, name);
+        if (index != -1)
+        {
+            return state->vars[index] + strlen(name) + 1;
+        }
+    }
+
     return getenv(name);
 }
 
@@ -177,10 +324,190 @@ int set_env_var(const char *name, const char *value)
         return -1;
     }
 
-    if (setenv(name, value ? value : "", 1) != 0)
+    shell_state_t *state = shell_current();
+    if (!state || !state->embedded)
+    {
+        // Переменные интерактивной оболочки - это окружение её процесса
+        if (setenv(name, value ? value : "", 1) != 0)
+        {
+            return -1;
+        }
+
+        return 0;
+    }
+
+    // Встроенный контекст не меняет окружение программы, в которую встроен
+    size_t name_len = strlen(name);
+    size_t value_len = value ? strlen(value) : 0;
+    char *entry = malloc(name_len + value_len + 2);
+    if (!entry)
     {
         return -1;
     }
+    memcpy(entry, name, name_len);
+    entry[name_len] = '=';
+    memcpy(entry + name_len + 1, value ? value : "", value_len + 1);
+
+    int index = context_var_index(state, name);
+    if (index != -1)
+    {
+        free(state->vars[index]);
+        state->vars[index] = entry;
+        return 0;
+    }
+
+    if (state->var_count == state->var_capacity)
+    {
+        int capacity = state->var_capacity ? state->var_capacity * 2 : 16;
+        char **vars = realloc(state->vars, (size_t)capacity * sizeof(char *));
+        if (!vars)
+        {
+            free(entry);
+            return -1;
+        }
+        state->vars = vars;
+        state->var_capacity = capacity;
+    }
+
+    state->vars[state->var_count++] = entry;
+    return 0;
+}
+
+/**
+ * @brief Сравнение имён двух записей окружения вида NAME=value
+ * @param a Первая запись (или просто имя)
+ * @param b Вторая запись (или просто имя)
+ * @return 1 если имена совпадают, 0 если нет
+ */
+static int env_names_equal(const char *a, const char *b)
+{
+    while (*a && *a != '=' && *a == *b)
+    {
+        a++;
+        b++;
+    }
+
+    return (*a == '\0' || *a == '=') && (*b == '\0' || *b == '=');
+}
+
+/**
+ * @brief Проверка, встречается ли имя записи в списке
+ * @param entry Запись окружения
+ * @param list Список записей или имён
+ * @param count Размер списка
+ * @return 1 если встречается, 0 если нет
+ */
+static int env_name_in_list(const char *entry, char *const *list, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (env_names_equal(entry, list[i]))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Построение окружения для одного запуска дочернего процесса
+ * @param assigns Присваивания NAME=value, переопределяющие хранилище
+ * @param assign_count Количество присваиваний
+ * @param clear 1 — начать с пустого окружения (env -i)
+ * @param unsets Имена исключаемых переменных (env -u)
+ * @param unset_count Количество исключаемых переменных
+ * @return Массив указателей для execve (освобождается free())
+ */
+char **build_child_env(char *const *assigns, int assign_count, int clear,
+                       char *const *unsets, int unset_count)
+{
+    extern char **environ;
+
+    int env_count = 0;
+    if (!clear && environ)
+    {
+        while (environ[env_count])
+        {
+            env_count++;
+        }
+    }
+
+    // Переменные встроенного контекста идут поверх окружения процесса
+    int var_count = clear ? 0 : context_var_count();
+    char *const *vars = var_count > 0 ? shell_current()->vars : NULL;
+
+    char **envp = malloc((env_count + var_count + assign_count + 1) * sizeof(char *));
+    if (!envp)
+    {
+        return NULL;
+    }
+
+    // Строки не копируются: массив живёт только до execve или возврата
+    int n = 0;
+    for (int i = 0; i < env_count; i++)
+    {
+        if (env_name_in_list(environ[i], unsets, unset_count) ||
+            env_name_in_list(environ[i], vars, var_count) ||
+            env_name_in_list(environ[i], assigns, assign_count))
+        {
+            continue;
+        }
+        envp[n++] = environ[i];
+    }
+
+    for (int i = 0; i < var_count; i++)
+    {
+        if (!env_name_in_list(vars[i], unsets, unset_count) &&
+            !env_name_in_list(vars[i], assigns, assign_count))
+        {
+            envp[n++] = vars[i];
+        }
+    }
+
+    for (int i = 0; i < assign_count; i++)
+    {
+        // При повторном присваивании одного имени побеждает последнее
+        if (!env_name_in_list(assigns[i], assigns + i + 1, assign_count - i - 1))
+        {
+            envp[n++] = assigns[i];
+        }
+    }
+
+    envp[n] = NULL;
+    return envp;
+}
+
+/**
+ * @brief Применение присваиваний NAME=value к хранилищу переменных
+ * @param assigns Массив присваиваний
+ * @param assign_count Количество присваиваний
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int apply_assignments(char *const *assigns, int assign_count)
+{
+    for (int i = 0; i < assign_count; i++)
+    {
+        const char *eq = strchr(assigns[i], '=');
+        if (!eq)
+        {
+            return -1;
+        }
+
+        char name[256];
+        size_t name_len = (size_t)(eq - assigns[i]);
+        if (name_len >= sizeof(name))
+        {
+            return -1;
+        }
+        memcpy(name, assigns[i], name_len);
+        name[name_len] = '\0';
+
+        if (set_env_var(name, eq + 1) != 0)
+        {
+            return -1;
+        }
+    }
 
     return 0;
 }
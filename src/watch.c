@@ -0,0 +1,663 @@
+/**
+ * @file watch.c
+ * @brief Реализация слежения за файлами (встроенная команда watch)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "watch.h"
+#include "builtins.h"
+#include "executor.h"
+#include "signals.h"
+#include "shell.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+/**
+ * @def WATCH_DIR_MASK
+ * @brief События, на которые подписывается каждый каталог
+ */
+#define WATCH_DIR_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | \
+                        IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+/**
+ * @struct watched_dir_t
+ * @brief Отслеживаемый каталог
+ *
+ * @details Файл из аргументов отслеживается через свой каталог с
+ * фильтром по имени, а не по inode: редактор, сохраняющий файл через
+ * запись во временный и rename поверх, заменяет inode, и слежение за
+ * старым inode перестало бы видеть изменения.
+ */
+typedef struct {
+    int wd;           /**< Дескриптор слежения inotify */
+    char *path;       /**< Путь, под которым каталог добавлен */
+    char **names;     /**< Имена файлов из аргументов или NULL (весь каталог) */
+    int name_count;   /**< Количество имён */
+} watched_dir_t;
+
+/**
+ * @struct watcher_t
+ * @brief Состояние слежения
+ */
+typedef struct {
+    int ifd;                      /**< Дескриптор inotify */
+    watched_dir_t *dirs;          /**< Отслеживаемые объекты */
+    int count;                    /**< Их количество */
+    int capacity;                 /**< Вместимость массива */
+    char **excludes;              /**< Исключаемые имена (-x) */
+    int exclude_count;            /**< Их количество */
+} watcher_t;
+
+/**
+ * @struct watch_child_t
+ * @brief Выполняющийся запуск команды
+ */
+typedef struct {
+    pid_t pid;    /**< Лидер группы процессов или -1 */
+    int pidfd;    /**< Дескриптор процесса для poll или -1 */
+} watch_child_t;
+
+/**
+ * @brief Текущее время по монотонным часам
+ * @return Миллисекунды
+ */
+static long long watch_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Проверка, исключено ли имя параметром -x
+ * @param watcher Состояние слежения
+ * @param name Последний компонент пути
+ * @return 1 если исключено, 0 иначе
+ */
+static int watch_excluded(const watcher_t *watcher, const char *name) {
+    for (int i = 0; i < watcher->exclude_count; i++) {
+        if (strcmp(watcher->excludes[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Поиск записи по дескриптору слежения
+ * @param watcher Состояние слежения
+ * @param wd Дескриптор слежения
+ * @return Индекс записи или -1
+ */
+static int watch_find(const watcher_t *watcher, int wd) {
+    for (int i = 0; i < watcher->count; i++) {
+        if (watcher->dirs[i].wd == wd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Проверка, отслеживается ли имя в каталоге с фильтром
+ * @param dir Отслеживаемый каталог
+ * @param name Имя из события
+ * @return 1 если имя отслеживается (или фильтра нет), 0 иначе
+ */
+static int watch_named(const watched_dir_t *dir, const char *name) {
+    if (!dir->names) {
+        return 1;
+    }
+    for (int i = 0; i < dir->name_count; i++) {
+        if (strcmp(dir->names[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Освобождение записи каталога
+ * @param dir Запись
+ */
+static void watch_entry_free(watched_dir_t *dir) {
+    free(dir->path);
+    for (int i = 0; i < dir->name_count; i++) {
+        free(dir->names[i]);
+    }
+    free(dir->names);
+}
+
+/**
+ * @brief Запоминание пути для дескриптора слежения
+ * @param watcher Состояние слежения
+ * @param wd Дескриптор слежения
+ * @param path Путь
+ * @return 0 при успехе, -1 при нехватке памяти
+ *
+ * @details inotify возвращает тот же wd для уже отслеживаемого объекта,
+ * поэтому повторное добавление только обновляет путь. Каталог, добавленный
+ * целиком, больше не фильтруется по именам файлов.
+ */
+static int watch_remember(watcher_t *watcher, int wd, const char *path) {
+    int index = watch_find(watcher, wd);
+    char *copy = strdup(path);
+    if (!copy) {
+        return -1;
+    }
+
+    if (index != -1) {
+        watch_entry_free(&watcher->dirs[index]);
+        watcher->dirs[index].path = copy;
+        watcher->dirs[index].names = NULL;
+        watcher->dirs[index].name_count = 0;
+        return 0;
+    }
+
+    if (watcher->count == watcher->capacity) {
+        int capacity = watcher->capacity ? watcher->capacity * 2 : 16;
+        watched_dir_t *dirs = realloc(watcher->dirs, (size_t)capacity * sizeof(*dirs));
+        if (!dirs) {
+            free(copy);
+            return -1;
+        }
+        watcher->dirs = dirs;
+        watcher->capacity = capacity;
+    }
+    memset(&watcher->dirs[watcher->count], 0, sizeof(watched_dir_t));
+    watcher->dirs[watcher->count].wd = wd;
+    watcher->dirs[watcher->count].path = copy;
+    watcher->count++;
+    return 0;
+}
+
+/**
+ * @brief Удаление записи после IN_IGNORED
+ * @param watcher Состояние слежения
+ * @param wd Снятый дескриптор слежения
+ */
+static void watch_forget(watcher_t *watcher, int wd) {
+    int index = watch_find(watcher, wd);
+    if (index == -1) {
+        return;
+    }
+    watch_entry_free(&watcher->dirs[index]);
+    watcher->dirs[index] = watcher->dirs[--watcher->count];
+}
+
+/**
+ * @brief Добавление файла из аргументов через его каталог
+ * @param watcher Состояние слежения
+ * @param path Путь к файлу
+ * @param report Сообщать об ошибках
+ * @return 1 при успехе, -1 в случае ошибки
+ */
+static int watch_add_file(watcher_t *watcher, const char *path, int report) {
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+    char parent[PATH_MAX];
+    if (!slash) {
+        snprintf(parent, sizeof(parent), ".");
+    } else {
+        snprintf(parent, sizeof(parent), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+    }
+
+    int wd = inotify_add_watch(watcher->ifd, parent, WATCH_DIR_MASK);
+    if (wd == -1) {
+        if (report || errno == ENOSPC) {
+            fprintf(shell_stderr(), "watch: %s: %s\n", path,
+                    errno == ENOSPC ? "превышен предел fs.inotify.max_user_watches" : strerror(errno));
+        }
+        return -1;
+    }
+
+    int index = watch_find(watcher, wd);
+    if (index == -1) {
+        if (watch_remember(watcher, wd, parent) != 0) {
+            return -1;
+        }
+        index = watcher->count - 1;
+    } else if (watch_named(&watcher->dirs[index], name)) {
+        // Каталог уже отслеживается целиком или ради этого же файла
+        return 1;
+    }
+
+    watched_dir_t *dir = &watcher->dirs[index];
+    char **names = realloc(dir->names, (size_t)(dir->name_count + 1) * sizeof(char *));
+    if (!names) {
+        return -1;
+    }
+    dir->names = names;
+    dir->names[dir->name_count] = strdup(name);
+    if (!dir->names[dir->name_count]) {
+        return -1;
+    }
+    dir->name_count++;
+    return 1;
+}
+
+/**
+ * @brief Рекурсивное добавление каталога (файл добавляется через свой каталог)
+ * @param watcher Состояние слежения
+ * @param path Путь (абсолютный или относительно каталога процесса)
+ * @param report Сообщать об ошибках (для путей из аргументов)
+ * @return Количество добавленных объектов или -1, если path добавить не удалось
+ *
+ * @details Подкаталоги перебираются через дескриптор самого каталога,
+ * поэтому символьные ссылки на каталоги не обходятся и не зацикливают
+ * обход. Если каталог удалён во время обхода, он просто пропускается.
+ */
+static int watch_add_tree(watcher_t *watcher, const char *path, int report) {
+    struct stat st;
+    if (stat(path, &st) == -1) {
+        if (report) {
+            fprintf(shell_stderr(), "watch: %s: %s\n", path, strerror(errno));
+        }
+        return -1;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        return watch_add_file(watcher, path, report);
+    }
+
+    int wd = inotify_add_watch(watcher->ifd, path, WATCH_DIR_MASK);
+    if (wd == -1) {
+        if (report || errno == ENOSPC) {
+            fprintf(shell_stderr(), "watch: %s: %s\n", path,
+                    errno == ENOSPC ? "превышен предел fs.inotify.max_user_watches" : strerror(errno));
+        }
+        return -1;
+    }
+    if (watch_remember(watcher, wd, path) != 0) {
+        return -1;
+    }
+
+    int added = 1;
+    int dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = dfd != -1 ? fdopendir(dfd) : NULL;
+    if (!dir) {
+        if (dfd != -1) {
+            close(dfd);
+        }
+        return added;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 ||
+            watch_excluded(watcher, entry->d_name)) {
+            continue;
+        }
+
+        int is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat child;
+            is_dir = fstatat(dfd, entry->d_name, &child, AT_SYMLINK_NOFOLLOW) == 0 &&
+                     S_ISDIR(child.st_mode);
+        }
+        if (!is_dir) {
+            continue;
+        }
+
+        char child_path[PATH_MAX];
+        int len = snprintf(child_path, sizeof(child_path), "%s/%s", path, entry->d_name);
+        if (len < 0 || (size_t)len >= sizeof(child_path)) {
+            continue;
+        }
+        int n = watch_add_tree(watcher, child_path, 0);
+        if (n > 0) {
+            added += n;
+        }
+    }
+    closedir(dir);
+    return added;
+}
+
+/**
+ * @brief Разбор и применение пачки событий inotify
+ * @param watcher Состояние слежения
+ * @param changed Указатель для имени первого изменения (буфер PATH_MAX)
+ * @return 1 если есть изменения, 0 если нет
+ *
+ * @details Новые каталоги (создание или перенос внутрь) добавляются
+ * сразу, вместе с содержимым: файлы, созданные в них до добавления
+ * слежения, не дали бы событий, но сам IN_CREATE каталога уже считается
+ * изменением. Переполнение очереди (IN_Q_OVERFLOW) тоже считается
+ * изменением - точный список потерян, но перезапуск всё равно нужен.
+ */
+static int watch_drain(watcher_t *watcher, char *changed) {
+    char events[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    int result = 0;
+    ssize_t n;
+
+    while ((n = read(watcher->ifd, events, sizeof(events))) > 0) {
+        for (char *p = events; p < events + n;) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                if (!result) {
+                    snprintf(changed, PATH_MAX, "(переполнение очереди inotify)");
+                }
+                result = 1;
+                continue;
+            }
+
+            int index = watch_find(watcher, ev->wd);
+            if (ev->mask & IN_IGNORED) {
+                watch_forget(watcher, ev->wd);
+                continue;
+            }
+            if (index == -1 || (ev->len > 0 && (watch_excluded(watcher, ev->name) ||
+                                                !watch_named(&watcher->dirs[index], ev->name)))) {
+                continue;
+            }
+
+            char path[PATH_MAX];
+            if (ev->len > 0) {
+                snprintf(path, sizeof(path), "%s/%s", watcher->dirs[index].path, ev->name);
+            } else {
+                snprintf(path, sizeof(path), "%s", watcher->dirs[index].path);
+            }
+
+            if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))) {
+                watch_add_tree(watcher, path, 0);
+            }
+            if (!result) {
+                snprintf(changed, PATH_MAX, "%s", path);
+            }
+            result = 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Запуск команды в отдельной группе процессов
+ * @param child Состояние запуска
+ * @param line Строка команд
+ * @return 0 при успехе, -1 в случае ошибки
+ */
+static int watch_spawn(watch_child_t *child, const char *line) {
+    child->pid = execute_spawn(line, 1);
+    if (child->pid == -1) {
+        return -1;
+    }
+#ifdef SYS_pidfd_open
+    child->pidfd = (int)syscall(SYS_pidfd_open, child->pid, 0);
+#else
+    child->pidfd = -1;
+#endif
+    return 0;
+}
+
+/**
+ * @brief Освобождение состояния завершившегося запуска
+ * @param child Состояние запуска
+ */
+static void watch_release(watch_child_t *child) {
+    if (child->pidfd != -1) {
+        close(child->pidfd);
+    }
+    child->pid = -1;
+    child->pidfd = -1;
+}
+
+/**
+ * @brief Проверка завершения запуска без ожидания
+ * @param child Состояние запуска
+ * @param status Указатель для статуса waitpid
+ * @return 1 если процесс завершён и дождан, 0 иначе
+ */
+static int watch_reap(watch_child_t *child, int *status) {
+    if (child->pid == -1) {
+        return 0;
+    }
+    if (waitpid(child->pid, status, WNOHANG) == child->pid) {
+        watch_release(child);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Прерывание запуска
+ * @param child Состояние запуска
+ *
+ * @details Вся группа получает SIGTERM; если за WATCH_KILL_GRACE_MS
+ * лидер не завершился, группа добивается SIGKILL. Ожидание идёт через
+ * pidfd, без него - опросом с шагом 10 мс.
+ */
+static void watch_cancel(watch_child_t *child) {
+    if (child->pid == -1) {
+        return;
+    }
+
+    int status;
+    kill(-child->pid, SIGTERM);
+    long long deadline = watch_now_ms() + WATCH_KILL_GRACE_MS;
+
+    for (;;) {
+        if (watch_reap(child, &status)) {
+            return;
+        }
+        long long left = deadline - watch_now_ms();
+        if (left <= 0) {
+            break;
+        }
+        if (child->pidfd != -1) {
+            struct pollfd fd = { .fd = child->pidfd, .events = POLLIN };
+            poll(&fd, 1, (int)left);
+        } else {
+            struct timespec step = { 0, 10 * 1000000L };
+            nanosleep(&step, NULL);
+        }
+    }
+
+    kill(-child->pid, SIGKILL);
+    while (waitpid(child->pid, &status, 0) == -1 && errno == EINTR) {
+    }
+    watch_release(child);
+}
+
+/**
+ * @brief Сборка строки команды из аргументов
+ * @param args Аргументы команды
+ * @param count Их количество
+ * @return Строка (освобождается free) или NULL
+ */
+static char *watch_join(char **args, int count) {
+    size_t size = 1;
+    for (int i = 0; i < count; i++) {
+        size += strlen(args[i]) + 1;
+    }
+
+    char *line = malloc(size);
+    if (!line) {
+        return NULL;
+    }
+    line[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            strcat(line, " ");
+        }
+        strcat(line, args[i]);
+    }
+    return line;
+}
+
+/**
+ * @brief Цикл ожидания изменений и перезапусков
+ * @param watcher Состояние слежения
+ * @param line Строка команд
+ * @param debounce Пауза после последнего события (мс)
+ * @return 0 после прерывания, -1 в случае ошибки
+ *
+ * @details Каждое изменение сдвигает срок перезапуска на debounce от
+ * текущего момента, так что серия событий (сохранение в редакторе,
+ * распаковка архива) даёт один перезапуск. Если команда ещё выполняется,
+ * она прерывается при первом же изменении, а не по истечении паузы:
+ * её результат всё равно устарел.
+ */
+static int watch_loop(watcher_t *watcher, const char *line, int debounce) {
+    watch_child_t child = { .pid = -1, .pidfd = -1 };
+    int pending = 1;
+    long long deadline = watch_now_ms();
+    int status;
+
+    for (;;) {
+        if (watch_reap(&child, &status)) {
+            int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            fprintf(shell_stdout(), "[watch] команда завершилась с кодом %d, ожидание изменений\n", code);
+            fflush(shell_stdout());
+        }
+
+        long long now = watch_now_ms();
+        if (pending && child.pid == -1 && now >= deadline) {
+            pending = 0;
+            if (watch_spawn(&child, line) != 0) {
+                return -1;
+            }
+        }
+
+        int timeout = -1;
+        if (pending) {
+            timeout = deadline > now ? (int)(deadline - now) : 0;
+        }
+        // Без pidfd завершение команды замечается опросом
+        if (child.pid != -1 && child.pidfd == -1 && (timeout == -1 || timeout > 100)) {
+            timeout = 100;
+        }
+
+        struct pollfd fds[3] = {
+            { .fd = watcher->ifd, .events = POLLIN },
+            { .fd = g_trap_signal_fd, .events = POLLIN },
+            { .fd = child.pidfd, .events = POLLIN }
+        };
+
+        // Ctrl+C прерывает poll (EINTR), сигнал под ловушкой приходит в signalfd;
+        // fd = -1 в массиве poll пропускает
+        if (poll(fds, 3, timeout) == -1 || fds[1].revents) {
+            break;
+        }
+
+        char changed[PATH_MAX];
+        if (fds[0].revents && watch_drain(watcher, changed)) {
+            if (child.pid != -1) {
+                fprintf(shell_stdout(), "[watch] %s: изменение, прерывание команды\n", changed);
+                fflush(shell_stdout());
+                watch_cancel(&child);
+            } else if (!pending) {
+                fprintf(shell_stdout(), "[watch] %s: изменение, перезапуск\n", changed);
+                fflush(shell_stdout());
+            }
+            pending = 1;
+            deadline = watch_now_ms() + debounce;
+        }
+    }
+
+    watch_cancel(&child);
+    return 0;
+}
+
+/**
+ * @brief Встроенная команда watch
+ * @param args Аргументы
+ * @param argc Количество аргументов
+ * @return 0 после прерывания, -1 в случае ошибки
+ */
+int builtin_watch(char **args, int argc) {
+    int debounce = WATCH_DEFAULT_DEBOUNCE_MS;
+    char *excludes[WATCH_MAX_EXCLUDES];
+    int exclude_count = 0;
+    int i = 1;
+
+    for (; i < argc && args[i][0] == '-' && args[i][1] != '\0' && strcmp(args[i], "--") != 0; i++) {
+        if (strcmp(args[i], "-d") == 0 && i + 1 < argc) {
+            debounce = atoi(args[++i]);
+            if (debounce < 0) {
+                fprintf(shell_stderr(), "watch: пауза должна быть неотрицательной\n");
+                return -1;
+            }
+        } else if (strcmp(args[i], "-x") == 0 && i + 1 < argc) {
+            if (exclude_count == WATCH_MAX_EXCLUDES) {
+                fprintf(shell_stderr(), "watch: слишком много параметров -x (максимум %d)\n", WATCH_MAX_EXCLUDES);
+                return -1;
+            }
+            excludes[exclude_count++] = args[++i];
+        } else {
+            fprintf(shell_stderr(), "watch: неизвестный параметр '%s'\n", args[i]);
+            fprintf(shell_stderr(), "Использование: watch [-d мс] [-x имя]... путь... -- команда [аргументы]\n");
+            return -1;
+        }
+    }
+
+    int first_path = i;
+    while (i < argc && strcmp(args[i], "--") != 0) {
+        i++;
+    }
+    if (i == first_path || i + 1 >= argc) {
+        fprintf(shell_stderr(), "Использование: watch [-d мс] [-x имя]... путь... -- команда [аргументы]\n");
+        return -1;
+    }
+
+    watcher_t watcher;
+    memset(&watcher, 0, sizeof(watcher));
+    watcher.excludes = excludes;
+    watcher.exclude_count = exclude_count;
+    watcher.ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher.ifd == -1) {
+        fprintf(shell_stderr(), "watch: inotify: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int result = 0;
+    for (int p = first_path; p < i; p++) {
+        // inotify принимает только пути: каталог сеанса подставляется через /proc
+        char path[PATH_MAX];
+        if (args[p][0] != '/' && shell_cwd_fd() != AT_FDCWD) {
+            snprintf(path, sizeof(path), "/proc/self/fd/%d/%s", shell_cwd_fd(), args[p]);
+        } else {
+            snprintf(path, sizeof(path), "%s", args[p]);
+        }
+        if (watch_add_tree(&watcher, path, 1) == -1) {
+            result = -1;
+            break;
+        }
+    }
+
+    char *line = result == 0 ? watch_join(&args[i + 1], argc - i - 1) : NULL;
+    if (line) {
+        result = watch_loop(&watcher, line, debounce);
+    } else if (result == 0) {
+        fprintf(shell_stderr(), "watch: ошибка выделения памяти\n");
+        result = -1;
+    }
+
+    free(line);
+    for (int d = 0; d < watcher.count; d++) {
+        watch_entry_free(&watcher.dirs[d]);
+    }
+    free(watcher.dirs);
+    close(watcher.ifd);
+    return result;
+}
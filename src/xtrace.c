@@ -0,0 +1,234 @@
+/**
+ * @file xtrace.c
+ * @brief Реализация трассировки команд (set -x)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#define _GNU_SOURCE
+
+#include "xtrace.h"
+#include "utils.h"
+#include "shellio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @struct xtrace_t
+ * @brief Трассировка состояния оболочки
+ */
+typedef struct xtrace {
+    int fd;                             /**< Дескриптор вывода */
+    int buffered;                       /**< Дескриптор отдельный: вывод буферизуется */
+    char ps4[XTRACE_PS4_MAX];           /**< PS4 на момент set -x */
+    uint64_t last_flush_ns;             /**< Последняя запись буфера (монотонные часы) */
+    size_t used;                        /**< Занято в буфере */
+    char buffer[XTRACE_BUFFER_SIZE];    /**< Буфер строк */
+} xtrace_t;
+
+/**
+ * @brief Монотонное время
+ * @return Наносекунды
+ */
+static uint64_t xtrace_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Запись всех байт с повтором после EINTR
+ * @param fd Дескриптор
+ * @param data Данные
+ * @param size Размер
+ */
+static void xtrace_write(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // Трассировка не должна прерывать выполнение команд
+            return;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+}
+
+/**
+ * @brief Включение трассировки (set -x)
+ * @param state Состояние оболочки
+ * @return 0 в случае успеха, -1 в случае ошибки
+ */
+int xtrace_start(shell_state_t *state) {
+    int fd = state->io_fd != -1 ? state->io_fd : STDERR_FILENO;
+    const char *fd_var = get_env_var("XTRACEFD");
+    if (fd_var && *fd_var) {
+        char *end;
+        long value = strtol(fd_var, &end, 10);
+        if (*end != '\0' || value < 0 || value > 1024 || fcntl((int)value, F_GETFD) == -1) {
+            fprintf(shell_stderr(), "set: XTRACEFD: неверный дескриптор: %s\n", fd_var);
+            return -1;
+        }
+        fd = (int)value;
+    }
+
+    if (!state->xtrace) {
+        state->xtrace = malloc(sizeof(*state->xtrace));
+        if (!state->xtrace) {
+            fprintf(shell_stderr(), "set: недостаточно памяти\n");
+            return -1;
+        }
+        state->xtrace->used = 0;
+    } else {
+        // Повторный set -x мог сменить XTRACEFD: старые строки уходят в старый дескриптор
+        xtrace_flush(state);
+    }
+
+    xtrace_t *trace = state->xtrace;
+    const char *ps4 = get_env_var("PS4");
+    snprintf(trace->ps4, sizeof(trace->ps4), "%s", ps4 ? ps4 : "+ ");
+    trace->fd = fd;
+    trace->buffered = fd != STDOUT_FILENO && fd != STDERR_FILENO && fd != state->io_fd;
+    trace->last_flush_ns = xtrace_clock();
+    return 0;
+}
+
+/**
+ * @brief Запись буфера трассировки
+ * @param state Состояние оболочки (может быть NULL)
+ */
+void xtrace_flush(shell_state_t *state) {
+    xtrace_t *trace = state ? state->xtrace : NULL;
+    if (!trace || trace->used == 0) {
+        return;
+    }
+    xtrace_write(trace->fd, trace->buffer, trace->used);
+    trace->used = 0;
+}
+
+/**
+ * @brief Выключение трассировки с записью буфера (set +x, выход)
+ * @param state Состояние оболочки
+ */
+void xtrace_stop(shell_state_t *state) {
+    if (state && state->xtrace) {
+        xtrace_flush(state);
+        free(state->xtrace);
+        state->xtrace = NULL;
+    }
+}
+
+/**
+ * @brief Добавление строки к строке трассировки с отсечением
+ * @param line Строка трассировки
+ * @param used Занято байт
+ * @param text Добавляемый текст
+ * @return Новая длина
+ */
+static size_t xtrace_append(char *line, size_t used, const char *text) {
+    size_t len = strlen(text);
+    if (len > XTRACE_BUFFER_SIZE - 1 - used) {
+        len = XTRACE_BUFFER_SIZE - 1 - used;
+    }
+    memcpy(line + used, text, len);
+    return used + len;
+}
+
+/**
+ * @brief Вывод команды перед выполнением
+ * @param state Состояние оболочки
+ * @param commands Звенья конвейера
+ * @param count Количество звеньев
+ */
+void xtrace_command(shell_state_t *state, const command_t *commands, int count) {
+    xtrace_t *trace = state->xtrace;
+    if (!trace) {
+        return;
+    }
+
+    char line[XTRACE_BUFFER_SIZE];
+    size_t used = 0;
+
+    // Первый символ PS4 повторяется по глубине вложенности, как в bash
+    const char *ps4 = trace->ps4;
+    if (*ps4) {
+        for (int i = 0; i <= state->source_depth && used < 32; i++) {
+            line[used++] = *ps4;
+        }
+        ps4++;
+    }
+    for (; *ps4; ps4++) {
+        if (ps4[0] == '\\' && ps4[1] == 't') {
+            struct timespec now;
+            char stamp[32];
+            clock_gettime(CLOCK_REALTIME, &now);
+            snprintf(stamp, sizeof(stamp), "%lld.%06ld", (long long)now.tv_sec, now.tv_nsec / 1000);
+            used = xtrace_append(line, used, stamp);
+            ps4++;
+        } else if (used < XTRACE_BUFFER_SIZE - 1) {
+            line[used++] = *ps4;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const command_t *cmd = &commands[i];
+        if (i > 0) {
+            used = xtrace_append(line, used, " | ");
+        }
+        for (int j = 0; j < cmd->assign_count; j++) {
+            if (j > 0) {
+                used = xtrace_append(line, used, " ");
+            }
+            used = xtrace_append(line, used, cmd->assigns[j]);
+        }
+        for (int j = 0; j < cmd->argc; j++) {
+            if (j > 0 || cmd->assign_count > 0) {
+                used = xtrace_append(line, used, " ");
+            }
+            used = xtrace_append(line, used, cmd->args[j]);
+        }
+        if (cmd->input_file) {
+            char redirect[16];
+            snprintf(redirect, sizeof(redirect), cmd->input_fd != 0 ? " %d<" : " <", cmd->input_fd);
+            used = xtrace_append(line, used, redirect);
+            used = xtrace_append(line, used, cmd->input_file);
+        }
+        if (cmd->output_file) {
+            char redirect[16];
+            snprintf(redirect, sizeof(redirect), cmd->output_fd != 1 ? " %d>" : " >", cmd->output_fd);
+            used = xtrace_append(line, used, redirect);
+            used = xtrace_append(line, used, cmd->output_file);
+        }
+        if (cmd->background) {
+            used = xtrace_append(line, used, " &");
+        }
+    }
+    line[used++] = '\n';
+
+    if (!trace->buffered) {
+        // Общий с командами поток: строка должна выйти раньше их вывода
+        xtrace_write(trace->fd, line, used);
+        return;
+    }
+
+    if (trace->used + used > sizeof(trace->buffer)) {
+        xtrace_flush(state);
+    }
+    memcpy(trace->buffer + trace->used, line, used);
+    trace->used += used;
+
+    uint64_t now = xtrace_clock();
+    if (now - trace->last_flush_ns >= (uint64_t)XTRACE_FLUSH_MS * 1000000) {
+        xtrace_flush(state);
+        trace->last_flush_ns = now;
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ * @file plugin_hello.c
+ * @brief Загружаемая команда hello для теста enable -f
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include <shellplugin.h>
+#include <string.h>
+
+/**
+ * @brief Команда hello: выводит аргумент и отмечает вызов переменной
+ * @param call Параметры вызова
+ * @return 0 в случае успеха, 1 в случае ошибки записи
+ */
+static int hello_run(const shell_builtin_call_t *call) {
+    const char *who = call->argc > 1 ? call->argv[1] : "world";
+    call->set_var("HELLO_RAN", who);
+    if (call->out.write(call->out.handle, who, strlen(who)) != 0) {
+        return 1;
+    }
+    return call->out.write(call->out.handle, "\n", 1) == 0 ? 0 : 1;
+}
+
+const shell_builtin_def_t hello_builtin = {
+    SHELL_BUILTIN_ABI_VERSION, "hello", "hello [имя]", hello_run
+};
+
+// Описание другой версии ABI не должно загружаться
+const shell_builtin_def_t stale_builtin = {
+    SHELL_BUILTIN_ABI_VERSION + 1, "stale", NULL, hello_run
+};
@@ -0,0 +1,109 @@
+/**
+ * @file test.h
+ * @brief Минимальные средства для тестов оболочки
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ *
+ * @details
+ * Каждый тест - отдельная программа: CHECK отмечает неудачу и продолжает
+ * выполнение, test_finish() возвращает код выхода для ctest. Вывод
+ * контекста перехватывается во временный файл (test_capture_*).
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int test_failures = 0;
+
+/**
+ * @def CHECK
+ * @brief Проверка условия с выводом места неудачи
+ */
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: не выполнено: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @def CHECK_STR
+ * @brief Сравнение строк с выводом обоих значений
+ */
+#define CHECK_STR(actual, expected)                                         \
+    do {                                                                    \
+        const char *test_a = (actual);                                      \
+        const char *test_e = (expected);                                    \
+        if (!test_a || strcmp(test_a, test_e) != 0) {                       \
+            fprintf(stderr, "%s:%d: %s = \"%s\", ожидалось \"%s\"\n",       \
+                    __FILE__, __LINE__, #actual,                            \
+                    test_a ? test_a : "(null)", test_e);                    \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief Итог теста
+ * @return Код выхода программы теста
+ */
+static inline int test_finish(void) {
+    if (test_failures > 0) {
+        fprintf(stderr, "Неудачных проверок: %d\n", test_failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Временный файл для перехвата вывода
+ * @return Дескриптор или -1 в случае ошибки
+ */
+static inline int test_capture_open(void) {
+    FILE *file = tmpfile();
+    if (!file) {
+        return -1;
+    }
+    // Дескриптор остаётся открытым после fclose копии
+    int fd = dup(fileno(file));
+    fclose(file);
+    return fd;
+}
+
+/**
+ * @brief Чтение перехваченного вывода с начала файла
+ * @param fd Дескриптор из test_capture_open
+ * @return Строка (освобождается free) или NULL
+ */
+static inline char *test_capture_read(int fd) {
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < 0) {
+        return NULL;
+    }
+    char *text = malloc((size_t)size + 1);
+    if (!text) {
+        return NULL;
+    }
+    ssize_t n = pread(fd, text, (size_t)size, 0);
+    text[n > 0 ? n : 0] = '\0';
+    return text;
+}
+
+/**
+ * @brief Очистка перехваченного вывода
+ * @param fd Дескриптор из test_capture_open
+ */
+static inline void test_capture_reset(int fd) {
+    if (ftruncate(fd, 0) == 0) {
+        lseek(fd, 0, SEEK_SET);
+    }
+}
+
+#endif /* TEST_H */
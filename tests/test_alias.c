@@ -0,0 +1,158 @@
+/**
+ * @file test_alias.c
+ * @brief Тесты псевдонимов: раскрытие, контексты и образ сессии
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "test.h"
+#include "customshell.h"
+#include "alias.h"
+#include "image.h"
+
+/**
+ * @def TEST_CHAIN
+ * @brief Длина цепочки псевдонимов c0 -> c1 -> ... -> echo
+ */
+#define TEST_CHAIN 200
+
+/**
+ * @brief Выполнение строки в контексте с перехватом вывода
+ * @param ctx Контекст
+ * @param out Перехватывающий дескриптор контекста
+ * @param line Строка
+ * @return Вывод (освобождается free) или NULL
+ */
+static char *eval_captured(shell_context_t *ctx, int out, const char *line) {
+    test_capture_reset(out);
+    shell_context_eval_string(ctx, line);
+    return test_capture_read(out);
+}
+
+/**
+ * @brief Одна строка в разных контекстах раскрывается их псевдонимами
+ */
+static void test_alias_contexts(void) {
+    shell_context_t *first = shell_context_create();
+    shell_context_t *second = shell_context_create();
+    shell_context_t *plain = shell_context_create();
+    int first_out = test_capture_open();
+    int second_out = test_capture_open();
+    int plain_out = test_capture_open();
+    CHECK(first && second && plain && first_out != -1 && second_out != -1 && plain_out != -1);
+    shell_context_set_output(first, first_out);
+    shell_context_set_output(second, second_out);
+    shell_context_set_output(plain, plain_out);
+
+    CHECK(shell_context_eval_string(first, "alias greet='echo one'") == 0);
+    CHECK(shell_context_eval_string(second, "alias greet='echo two'") == 0);
+
+    char *text = eval_captured(first, first_out, "greet");
+    CHECK_STR(text, "one\n");
+    free(text);
+    text = eval_captured(second, second_out, "greet");
+    CHECK_STR(text, "two\n");
+    free(text);
+    CHECK(shell_context_eval_string(plain, "greet") != 0);
+
+    // Изменение набора не оставляет в кэше строку, разобранную со старым
+    CHECK(shell_context_eval_string(first, "alias greet='echo three'") == 0);
+    text = eval_captured(first, first_out, "greet");
+    CHECK_STR(text, "three\n");
+    free(text);
+    CHECK(shell_context_eval_string(first, "unalias greet") == 0);
+    CHECK(shell_context_eval_string(first, "greet") != 0);
+    text = eval_captured(second, second_out, "greet");
+    CHECK_STR(text, "two\n");
+    free(text);
+
+    shell_context_destroy(first);
+    shell_context_destroy(second);
+    shell_context_destroy(plain);
+    close(first_out);
+    close(second_out);
+    close(plain_out);
+}
+
+/**
+ * @brief Количество псевдонимов и глубина раскрытия не ограничены
+ */
+static void test_alias_chain(void) {
+    shell_context_t *ctx = shell_context_create();
+    int out = test_capture_open();
+    CHECK(ctx && out != -1);
+    shell_context_set_output(ctx, out);
+
+    char line[128];
+    for (int i = 0; i < TEST_CHAIN; i++) {
+        if (i + 1 < TEST_CHAIN) {
+            snprintf(line, sizeof(line), "alias c%d=c%d", i, i + 1);
+        } else {
+            snprintf(line, sizeof(line), "alias c%d='echo end'", i);
+        }
+        CHECK(shell_context_eval_string(ctx, line) == 0);
+    }
+    char *text = eval_captured(ctx, out, "c0 of chain");
+    CHECK_STR(text, "end of chain\n");
+    free(text);
+
+    // Цикл раскрывается по одному разу и останавливается на имени команды
+    CHECK(shell_context_eval_string(ctx, "alias x=y y=x") == 0);
+    CHECK(shell_context_eval_string(ctx, "x") != 0);
+
+    // Тело с пробелом в конце раскрывает и следующее слово
+    CHECK(shell_context_eval_string(ctx, "alias say='echo ' word=expanded") == 0);
+    text = eval_captured(ctx, out, "say word");
+    CHECK_STR(text, "expanded\n");
+    free(text);
+
+    // Вывод alias читается обратно
+    CHECK(shell_context_eval_string(ctx, "alias q='echo it'\\''s'") == 0);
+    text = eval_captured(ctx, out, "alias q");
+    CHECK_STR(text, "alias q='echo it'\\''s'\n");
+    free(text);
+    text = eval_captured(ctx, out, "q");
+    CHECK_STR(text, "it's\n");
+    free(text);
+
+    CHECK(shell_context_eval_string(ctx, "unalias -a") == 0);
+    text = eval_captured(ctx, out, "alias");
+    CHECK_STR(text, "");
+    free(text);
+
+    shell_context_destroy(ctx);
+    close(out);
+}
+
+/**
+ * @brief Псевдонимы переживают сохранение и загрузку образа
+ */
+static void test_alias_image(void) {
+    shell_state_t state;
+    CHECK(shell_init(&state) == 0);
+
+    char path[] = "/tmp/custom_shell_alias_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd != -1);
+    close(fd);
+
+    image_begin();
+    CHECK(shell_execute_line(&state, "alias ok='true'") == 0);
+    CHECK(image_dump(path) == 0);
+    alias_clear_all(&state);
+    CHECK(shell_execute_line(&state, "ok") != 0);
+
+    CHECK(image_load(path) == 0);
+    CHECK(shell_execute_line(&state, "ok") == 0);
+
+    unlink(path);
+    shell_cleanup(&state);
+}
+
+int main(void) {
+    test_alias_contexts();
+    test_alias_chain();
+    test_alias_image();
+    return test_finish();
+}
@@ -0,0 +1,71 @@
+/**
+ * @file test_env.c
+ * @brief Тесты префиксных присваиваний и команд env и exec
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "test.h"
+#include "customshell.h"
+#include "parser.h"
+
+/**
+ * @brief Разбор префиксных присваиваний
+ */
+static void test_parse_assignments(void) {
+    command_t cmd;
+    CHECK(parse_command("A=1 B=x=y env -i", &cmd) == 0);
+    CHECK(cmd.assign_count == 2);
+    CHECK_STR(cmd.assigns[0], "A=1");
+    CHECK_STR(cmd.assigns[1], "B=x=y");
+    CHECK_STR(cmd.name, "env");
+    CHECK(cmd.argc == 2);
+    free_command(&cmd);
+
+    // Слово с '=' после имени команды - обычный аргумент
+    CHECK(parse_command("echo A=1", &cmd) == 0);
+    CHECK(cmd.assign_count == 0);
+    CHECK(cmd.argc == 2);
+    free_command(&cmd);
+}
+
+/**
+ * @brief Присваивания без команды и для одной команды
+ */
+static void test_context_assignments(void) {
+    shell_context_t *ctx = shell_context_create();
+    int out = test_capture_open();
+    CHECK(ctx && out != -1);
+    shell_context_set_output(ctx, out);
+
+    CHECK(shell_context_eval_string(ctx, "COLOR=blue") == 0);
+    CHECK_STR(shell_context_get_var(ctx, "COLOR"), "blue");
+
+    // Префиксное присваивание действует только на свою команду
+    shell_context_eval_string(ctx, "ONCE=1 env");
+    char *text = test_capture_read(out);
+    CHECK(text && strstr(text, "ONCE=1\n"));
+    CHECK(text && strstr(text, "COLOR=blue\n"));
+    free(text);
+    CHECK(shell_context_get_var(ctx, "ONCE") == NULL);
+
+    // env -i: только явно переданные переменные
+    test_capture_reset(out);
+    shell_context_eval_string(ctx, "env -i ONLY=1");
+    text = test_capture_read(out);
+    CHECK_STR(text, "ONLY=1\n");
+    free(text);
+
+    // exec во встроенном контексте недоступен
+    CHECK(shell_context_eval_string(ctx, "exec true") != 0);
+
+    shell_context_destroy(ctx);
+    close(out);
+}
+
+int main(void) {
+    test_parse_assignments();
+    test_context_assignments();
+    return test_finish();
+}
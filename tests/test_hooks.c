@@ -0,0 +1,153 @@
+/**
+ * @file test_hooks.c
+ * @brief Тесты хуков preexec и precmd и их сохранения в образе сессии вместе
+ * с ловушками и удалёнными переменными
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "test.h"
+#include "customshell.h"
+#include "hooks.h"
+#include "image.h"
+#include "signals.h"
+
+/**
+ * @brief Выполнение хуков с перехватом вывода процесса
+ * @param state Состояние оболочки
+ * @param point Точка
+ * @param line Строка ввода или NULL
+ * @return Вывод (освобождается free) или NULL
+ */
+static char *run_captured(shell_state_t *state, hook_point_t point, const char *line) {
+    fflush(stdout);
+    int out = test_capture_open();
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(out, STDOUT_FILENO);
+
+    hook_run(state, point, line);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    char *text = test_capture_read(out);
+    close(out);
+    return text;
+}
+
+/**
+ * @brief Подсчёт хуков (функция обхода)
+ * @param point Точка
+ * @param body Тело
+ * @param arg Счётчик
+ * @return 0
+ */
+static int count_hook(hook_point_t point, const char *body, void *arg) {
+    (void)point;
+    (void)body;
+    (*(int *)arg)++;
+    return 0;
+}
+
+/**
+ * @brief HOOK_COMMAND видна только командам хука
+ */
+static void test_hook_command(shell_state_t *state) {
+    CHECK(shell_execute_line(state, "hook preexec printenv HOOK_COMMAND") == 0);
+    CHECK(hook_installed(state, HOOK_PREEXEC));
+    CHECK(!hook_installed(state, HOOK_PRECMD));
+
+    char *text = run_captured(state, HOOK_PREEXEC, "echo hello");
+    CHECK_STR(text, "echo hello\n");
+    free(text);
+    CHECK(getenv("HOOK_COMMAND") == NULL);
+
+    // Прежнее значение переменной возвращается после хука
+    setenv("HOOK_COMMAND", "outer", 1);
+    text = run_captured(state, HOOK_PREEXEC, "ls");
+    CHECK_STR(text, "ls\n");
+    free(text);
+    CHECK_STR(getenv("HOOK_COMMAND"), "outer");
+    unsetenv("HOOK_COMMAND");
+
+    CHECK(shell_execute_line(state, "hook -r preexec") == 0);
+    CHECK(!hook_installed(state, HOOK_PREEXEC));
+}
+
+/**
+ * @brief Хуки переживают сохранение и загрузку образа
+ */
+static void test_hook_image(shell_state_t *state) {
+    char path[] = "/tmp/custom_shell_hooks_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd != -1);
+    close(fd);
+
+    image_begin();
+    CHECK(shell_execute_line(state, "hook precmd 'echo it'\\''s ready'") == 0);
+    CHECK(image_dump(path) == 0);
+    hook_clear_all(state);
+    CHECK(!hook_installed(state, HOOK_PRECMD));
+
+    CHECK(image_load(path) == 0);
+    int count = 0;
+    hook_foreach(state, count_hook, &count);
+    CHECK(count == 1);
+    char *text = run_captured(state, HOOK_PRECMD, NULL);
+    CHECK_STR(text, "it's ready\n");
+    free(text);
+
+    hook_clear_all(state);
+    unlink(path);
+}
+
+/**
+ * @brief Ловушки и удалённые файлом настроек переменные переживают образ
+ */
+static void test_trap_image(shell_state_t *state) {
+    char path[] = "/tmp/custom_shell_traps_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd != -1);
+    close(fd);
+
+    setenv("IMAGE_GONE", "before", 1);
+    image_begin();
+    CHECK(shell_execute_line(state, "trap 'echo failed' ERR") == 0);
+    unsetenv("IMAGE_GONE");
+    CHECK(image_dump(path) == 0);
+    trap_set(TRAP_ERR, NULL);
+    setenv("IMAGE_GONE", "before", 1);
+    CHECK(!trap_pseudo_installed(TRAP_ERR));
+
+    CHECK(image_load(path) == 0);
+    CHECK(trap_pseudo_installed(TRAP_ERR));
+    CHECK(getenv("IMAGE_GONE") == NULL);
+
+    trap_set(TRAP_ERR, NULL);
+    unlink(path);
+}
+
+/**
+ * @brief Во встроенном контексте хуки не устанавливаются
+ */
+static void test_hook_embedded(void) {
+    shell_context_t *ctx = shell_context_create();
+    int out = test_capture_open();
+    CHECK(ctx && out != -1);
+    shell_context_set_output(ctx, out);
+    CHECK(shell_context_eval_string(ctx, "hook precmd echo x") != 0);
+    shell_context_destroy(ctx);
+    close(out);
+}
+
+int main(void) {
+    shell_state_t state;
+    CHECK(shell_init(&state) == 0);
+    test_hook_command(&state);
+    test_hook_image(&state);
+    test_trap_image(&state);
+    test_hook_embedded();
+    shell_cleanup(&state);
+    return test_finish();
+}
@@ -0,0 +1,350 @@
+/**
+ * @file test_io.c
+ * @brief Тесты ввода-вывода встроенных контекстов в параллельных потоках
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "test.h"
+#include "customshell.h"
+#include <pthread.h>
+#include <fcntl.h>
+#include <time.h>
+
+/**
+ * @def TEST_THREADS
+ * @brief Количество параллельных контекстов
+ */
+#define TEST_THREADS 4
+
+/**
+ * @def TEST_ROUNDS
+ * @brief Количество команд каждого контекста
+ */
+#define TEST_ROUNDS 50
+
+// Каталог с файлами теста
+static char test_dir[] = "/tmp/custom_shell_io_XXXXXX";
+
+// Ожидаемый вывод checksum input.txt
+static char expected_sum[128];
+
+/**
+ * @brief Чтение файла каталога теста
+ * @param name Имя файла
+ * @return Содержимое (освобождается free) или NULL
+ */
+static char *read_test_file(const char *name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", test_dir, name);
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    char *text = test_capture_read(fd);
+    close(fd);
+    return text;
+}
+
+/**
+ * @brief Поток с контекстом без своего вывода: только перенаправления в файлы
+ * @param arg Номер потока
+ * @return Количество неверных файлов
+ */
+static void *redirect_worker(void *arg) {
+    long id = (long)arg;
+    long failures = 0;
+    shell_context_t *ctx = shell_context_create();
+    if (!ctx) {
+        return (void *)1L;
+    }
+
+    char line[512];
+    snprintf(line, sizeof(line), "cd %s", test_dir);
+    shell_context_eval_string(ctx, line);
+
+    for (int round = 0; round < TEST_ROUNDS; round++) {
+        snprintf(line, sizeof(line), "checksum input.txt > sum_%ld\necho thread %ld > echo_%ld",
+                 id, id, id);
+        shell_context_eval_string(ctx, line);
+
+        char name[32];
+        snprintf(name, sizeof(name), "sum_%ld", id);
+        char *sum = read_test_file(name);
+        snprintf(name, sizeof(name), "echo_%ld", id);
+        char *echo = read_test_file(name);
+        char echo_expected[32];
+        snprintf(echo_expected, sizeof(echo_expected), "thread %ld\n", id);
+        if (!sum || strcmp(sum, expected_sum) != 0 || !echo || strcmp(echo, echo_expected) != 0) {
+            failures++;
+        }
+        free(sum);
+        free(echo);
+    }
+
+    shell_context_destroy(ctx);
+    return (void *)failures;
+}
+
+/**
+ * @brief Перенаправления параллельных контекстов не задевают друг друга и процесс
+ */
+static void test_parallel_redirections(void) {
+    CHECK(mkdtemp(test_dir) != NULL);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/input.txt", test_dir);
+    FILE *input = fopen(path, "w");
+    CHECK(input != NULL);
+    if (!input) {
+        return;
+    }
+    fputs("parallel contexts\n", input);
+    fclose(input);
+
+    // Эталон - вывод того же контекста в перехваченный дескриптор
+    shell_context_t *ctx = shell_context_create();
+    int out = test_capture_open();
+    CHECK(ctx && out != -1);
+    shell_context_set_output(ctx, out);
+    snprintf(path, sizeof(path), "checksum %s/input.txt", test_dir);
+    shell_context_eval_string(ctx, path);
+    char *text = test_capture_read(out);
+    CHECK(text && strstr(text, "  "));
+    if (text) {
+        // В эталоне путь полный, в потоках - относительный
+        snprintf(expected_sum, sizeof(expected_sum), "%.*s  input.txt\n",
+                 (int)strcspn(text, " "), text);
+    }
+    free(text);
+    shell_context_destroy(ctx);
+    close(out);
+
+    // Вывод процесса перехватывается: туда не должно попасть ничего
+    fflush(stdout);
+    int host = test_capture_open();
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(host, STDOUT_FILENO);
+
+    pthread_t threads[TEST_THREADS];
+    for (long i = 0; i < TEST_THREADS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, redirect_worker, (void *)i) == 0);
+    }
+    for (int i = 0; i < TEST_THREADS; i++) {
+        void *failures = NULL;
+        pthread_join(threads[i], &failures);
+        CHECK(failures == NULL);
+    }
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    text = test_capture_read(host);
+    CHECK_STR(text, "");
+    free(text);
+    close(host);
+}
+
+/**
+ * @brief Ввод встроенной команды в конце конвейера - канал своего контекста
+ */
+static void test_pipeline_input(void) {
+    shell_context_t *ctx = shell_context_create();
+    int out = test_capture_open();
+    CHECK(ctx && out != -1);
+    shell_context_set_output(ctx, out);
+
+    shell_context_eval_string(ctx, "printf 'a\\nb\\nc\\n' | head -n 2");
+    char *text = test_capture_read(out);
+    CHECK(text && strstr(text, "b\n") && !strstr(text, "c\n"));
+    free(text);
+
+    // exec без команды изменил бы дескрипторы встраивающей программы
+    CHECK(shell_context_eval_string(ctx, "exec 3> /dev/null") != 0);
+
+    shell_context_destroy(ctx);
+    close(out);
+}
+
+/**
+ * @struct slow_session_t
+ * @brief Сессия с долгой встроенной командой
+ */
+typedef struct {
+    shell_context_t *ctx;   /**< Контекст */
+    int done;               /**< Команда завершена */
+} slow_session_t;
+
+/**
+ * @brief Поток долгой сессии
+ * @param arg Сессия
+ * @return NULL
+ */
+static void *slow_worker(void *arg) {
+    slow_session_t *session = arg;
+    char line[256];
+    // 4 КиБ со скоростью 2 КиБ/с - около двух секунд внутри pv
+    snprintf(line, sizeof(line), "pv -q -L 2k %s/input.bin", test_dir);
+    shell_context_eval_string(session->ctx, line);
+    __atomic_store_n(&session->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * @brief Долгая встроенная команда одной сессии не задерживает другие
+ *
+ * @details Так работает сервер сессий: у каждого соединения свой контекст
+ * с выводом в сокет (shell_context_set_output).
+ */
+static void test_sessions_in_parallel(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/input.bin", test_dir);
+    FILE *input = fopen(path, "w");
+    CHECK(input != NULL);
+    if (!input) {
+        return;
+    }
+    for (int i = 0; i < 4096; i++) {
+        fputc('a' + i % 26, input);
+    }
+    fclose(input);
+
+    slow_session_t slow = {shell_context_create(), 0};
+    int slow_out = test_capture_open();
+    shell_context_t *fast = shell_context_create();
+    int fast_out = test_capture_open();
+    CHECK(slow.ctx && fast && slow_out != -1 && fast_out != -1);
+    shell_context_set_output(slow.ctx, slow_out);
+    shell_context_set_output(fast, fast_out);
+
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, slow_worker, &slow) == 0);
+    struct timespec pause = {0, 200 * 1000 * 1000};
+    nanosleep(&pause, NULL);
+
+    // Встроенные команды второй сессии выполняются, пока первая ещё в pv
+    for (int i = 0; i < 10; i++) {
+        shell_context_eval_string(fast, "echo fast");
+    }
+    CHECK(__atomic_load_n(&slow.done, __ATOMIC_ACQUIRE) == 0);
+
+    pthread_join(thread, NULL);
+    char *text = test_capture_read(fast_out);
+    CHECK(text && strlen(text) == 10 * strlen("fast\n") && strncmp(text, "fast\n", 5) == 0);
+    free(text);
+    text = test_capture_read(slow_out);
+    CHECK(text && strlen(text) == 4096 && strncmp(text, "abcdef", 6) == 0);
+    free(text);
+
+    shell_context_destroy(slow.ctx);
+    shell_context_destroy(fast);
+    close(slow_out);
+    close(fast_out);
+    unlink(path);
+}
+
+/**
+ * @struct early_exit_t
+ * @brief Конвейер, читатель которого завершается раньше писателя
+ */
+typedef struct {
+    const char *line;   /**< Строка конвейера */
+    char *output;       /**< Вывод контекста */
+    int done;           /**< Конвейер завершён */
+} early_exit_t;
+
+/**
+ * @brief Поток с конвейером
+ * @param arg Конвейер
+ * @return NULL
+ */
+static void *early_exit_worker(void *arg) {
+    early_exit_t *run = arg;
+    shell_context_t *ctx = shell_context_create();
+    int out = test_capture_open();
+    if (ctx && out != -1) {
+        shell_context_set_output(ctx, out);
+        shell_context_eval_string(ctx, run->line);
+        run->output = test_capture_read(out);
+    }
+    shell_context_destroy(ctx);
+    if (out != -1) {
+        close(out);
+    }
+    __atomic_store_n(&run->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * @brief Встроенная команда в начале конвейера завершается, когда читатель вышел
+ *
+ * @details Звено без exec не должно держать копию чтения своего канала:
+ * иначе писатель не получает EPIPE и оболочка зависает.
+ */
+static void test_pipeline_early_exit(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/big.txt", test_dir);
+    FILE *big = fopen(path, "w");
+    CHECK(big != NULL);
+    if (!big) {
+        return;
+    }
+    // Намного больше буфера канала
+    for (int i = 1; i <= 300000; i++) {
+        fprintf(big, "%d\n", i);
+    }
+    fclose(big);
+
+    const char *formats[] = {
+        "cut -c1-3 %s | head -n 1",
+        "pv -q %s | head -n 1",
+        "head -n 300000 %s | /usr/bin/head -n 1",
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        char line[512];
+        snprintf(line, sizeof(line), formats[i], path);
+        early_exit_t run = {line, NULL, 0};
+        pthread_t thread;
+        CHECK(pthread_create(&thread, NULL, early_exit_worker, &run) == 0);
+
+        // Зависший конвейер не дождаться: проверка по сроку
+        for (int waited = 0; waited < 200 && !__atomic_load_n(&run.done, __ATOMIC_ACQUIRE); waited++) {
+            struct timespec pause = {0, 50 * 1000 * 1000};
+            nanosleep(&pause, NULL);
+        }
+        if (!__atomic_load_n(&run.done, __ATOMIC_ACQUIRE)) {
+            fprintf(stderr, "%s:%d: конвейер завис: %s\n", __FILE__, __LINE__, line);
+            exit(1);
+        }
+        pthread_join(thread, NULL);
+        CHECK_STR(run.output, "1\n");
+        free(run.output);
+    }
+    unlink(path);
+}
+
+/**
+ * @brief Удаление каталога теста
+ */
+static void remove_test_dir(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/input.txt", test_dir);
+    unlink(path);
+    for (int i = 0; i < TEST_THREADS; i++) {
+        snprintf(path, sizeof(path), "%s/sum_%d", test_dir, i);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/echo_%d", test_dir, i);
+        unlink(path);
+    }
+    rmdir(test_dir);
+}
+
+int main(void) {
+    test_parallel_redirections();
+    test_pipeline_input();
+    test_sessions_in_parallel();
+    test_pipeline_early_exit();
+    remove_test_dir();
+    return test_finish();
+}
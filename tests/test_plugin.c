@@ -0,0 +1,75 @@
+/**
+ * @file test_plugin.c
+ * @brief Тесты загрузки встроенных команд из библиотек (enable -f, -d)
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "test.h"
+#include "customshell.h"
+#include "shell.h"
+
+/**
+ * @brief Загрузка и удаление команды в самой оболочке
+ */
+static void test_enable(shell_state_t *state) {
+    CHECK(shell_execute_line(state, "enable -f " TEST_PLUGIN_PATH " hello") == 0);
+    CHECK(shell_execute_line(state, "hello shell") == 0);
+    CHECK_STR(getenv("HELLO_RAN"), "shell");
+
+    // Описание другой версии ABI и отсутствующее имя не загружаются
+    CHECK(shell_execute_line(state, "enable -f " TEST_PLUGIN_PATH " stale") != 0);
+    CHECK(shell_execute_line(state, "enable -f " TEST_PLUGIN_PATH " missing") != 0);
+    CHECK(shell_execute_line(state, "enable -f /nonexistent/plugin.so hello") != 0);
+}
+
+/**
+ * @brief Встроенный контекст вызывает загруженную команду, но не меняет таблицу
+ */
+static void test_embedded(void) {
+    shell_context_t *ctx = shell_context_create();
+    int out = test_capture_open();
+    CHECK(ctx && out != -1);
+    shell_context_set_output(ctx, out);
+
+    // Вывод команды идёт в дескриптор контекста, переменная - в контекст
+    CHECK(shell_context_eval_string(ctx, "hello context") == 0);
+    char *text = test_capture_read(out);
+    CHECK_STR(text, "context\n");
+    free(text);
+    CHECK_STR(shell_context_get_var(ctx, "HELLO_RAN"), "context");
+    CHECK_STR(getenv("HELLO_RAN"), "shell");
+
+    test_capture_reset(out);
+    CHECK(shell_context_eval_string(ctx, "enable -d hello") != 0);
+    CHECK(shell_context_eval_string(ctx, "enable -f " TEST_PLUGIN_PATH " hello") != 0);
+    text = test_capture_read(out);
+    CHECK(text && strstr(text, "недоступно во встроенном контексте"));
+    free(text);
+
+    // Список команд по-прежнему доступен
+    test_capture_reset(out);
+    CHECK(shell_context_eval_string(ctx, "enable") == 0);
+    text = test_capture_read(out);
+    CHECK(text && strstr(text, "enable -f " TEST_PLUGIN_PATH " hello"));
+    free(text);
+
+    shell_context_destroy(ctx);
+    close(out);
+}
+
+int main(void) {
+    shell_state_t state;
+    CHECK(shell_init(&state) == 0);
+    test_enable(&state);
+    test_embedded();
+
+    // После enable -d имя снова неизвестно
+    CHECK(shell_execute_line(&state, "enable -d hello") == 0);
+    CHECK(shell_execute_line(&state, "hello again") != 0);
+    CHECK_STR(getenv("HELLO_RAN"), "shell");
+
+    shell_cleanup(&state);
+    return test_finish();
+}
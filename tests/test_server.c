@@ -0,0 +1,184 @@
+/**
+ * @file test_server.c
+ * @brief Тесты сервера сессий: вывод и псевдонимы каждой сессии отдельно
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "test.h"
+#include "server.h"
+#include <pthread.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Каталог с сокетом и файлами теста
+static char test_dir[] = "/tmp/custom_shell_server_XXXXXX";
+static char socket_path[64];
+
+/**
+ * @brief Поток сервера
+ * @param arg Указатель на код возврата server_run
+ * @return NULL
+ */
+static void *server_thread(void *arg) {
+    *(int *)arg = server_run(socket_path, 4);
+    return NULL;
+}
+
+/**
+ * @brief Миллисекунды монотонных часов
+ * @return Время
+ */
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/**
+ * @brief Подключение к серверу (ждёт появления сокета)
+ * @return Сокет или -1
+ */
+static int connect_session(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+
+    for (long deadline = now_ms() + 5000; now_ms() < deadline;) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd != -1 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+        struct timespec pause = {0, 10 * 1000 * 1000};
+        nanosleep(&pause, NULL);
+    }
+    return -1;
+}
+
+/**
+ * @brief Отправка строки в сессию
+ * @param fd Сокет
+ * @param text Строка
+ */
+static void send_text(int fd, const char *text) {
+    CHECK(write(fd, text, strlen(text)) == (ssize_t)strlen(text));
+}
+
+/**
+ * @brief Чтение вывода сессии до появления подстроки, конца потока или срока
+ * @param fd Сокет
+ * @param until Ожидаемая подстрока или NULL (читать до конца потока)
+ * @param timeout_ms Срок в миллисекундах
+ * @return Прочитанное (освобождается free)
+ */
+static char *read_session(int fd, const char *until, long timeout_ms) {
+    size_t length = 0;
+    size_t capacity = 8192;
+    char *text = calloc(capacity, 1);
+    long deadline = now_ms() + timeout_ms;
+
+    while (text && now_ms() < deadline && !(until && strstr(text, until))) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        if (capacity - length < 1024) {
+            capacity *= 2;
+            char *grown = realloc(text, capacity);
+            if (!grown) {
+                break;
+            }
+            text = grown;
+        }
+        ssize_t n = read(fd, text + length, capacity - length - 1);
+        if (n <= 0) {
+            break;
+        }
+        length += (size_t)n;
+        text[length] = '\0';
+    }
+    return text;
+}
+
+/**
+ * @brief Долгая встроенная команда сессии не задерживает другую сессию
+ */
+static void test_sessions(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/input.bin", test_dir);
+    FILE *input = fopen(path, "w");
+    CHECK(input != NULL);
+    if (!input) {
+        return;
+    }
+    for (int i = 0; i < 4096; i++) {
+        fputc('a' + i % 26, input);
+    }
+    fclose(input);
+
+    int slow = connect_session();
+    int fast = connect_session();
+    CHECK(slow != -1 && fast != -1);
+
+    // 4 КиБ со скоростью 2 КиБ/с - около двух секунд внутри pv
+    char line[512];
+    snprintf(line, sizeof(line), "alias greet='echo slow'\npv -q -L 2k %s\ngreet\n", path);
+    send_text(slow, line);
+    struct timespec pause = {0, 200 * 1000 * 1000};
+    nanosleep(&pause, NULL);
+
+    // Вторая сессия отвечает, пока первая ещё в pv, и не видит её псевдонимов
+    long started = now_ms();
+    send_text(fast, "greet\necho fast done\n");
+    char *text = read_session(fast, "fast done\n", 1500);
+    CHECK(text && strstr(text, "fast done\n"));
+    CHECK(now_ms() - started < 1500);
+    CHECK(text && !strstr(text, "slow"));
+    free(text);
+
+    shutdown(slow, SHUT_WR);
+    text = read_session(slow, NULL, 10000);
+    CHECK(text && strlen(text) == 4096 + strlen("slow\n"));
+    CHECK(text && strncmp(text, "abcdef", 6) == 0);
+    CHECK(text && strstr(text, "slow\n"));
+    free(text);
+
+    close(slow);
+    close(fast);
+    unlink(path);
+}
+
+int main(void) {
+    CHECK(mkdtemp(test_dir) != NULL);
+    snprintf(socket_path, sizeof(socket_path), "%s/shell.sock", test_dir);
+
+    // Сигнал остановки должен дойти до sigwait сервера, а не до другого потока
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigaddset(&stop_signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    int result = -1;
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, server_thread, &result) == 0);
+
+    test_sessions();
+
+    kill(getpid(), SIGTERM);
+    pthread_join(thread, NULL);
+    CHECK(result == 0);
+
+    unlink(socket_path);
+    rmdir(test_dir);
+    return test_finish();
+}
@@ -0,0 +1,84 @@
+/**
+ * @file test_utils.c
+ * @brief Тесты разбора аргументов и сборки тел trap, alias и hook из слов команды
+ * @author Custom Shell Team
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "test.h"
+#include "parser.h"
+#include "utils.h"
+
+/**
+ * @brief Тело в кавычках заканчивается на слове с закрывающей кавычкой
+ */
+static void test_quoted_span(void) {
+    char *trap[] = {"trap", "'echo", "1", "2'", "EXIT", NULL};
+    CHECK(quoted_span(trap, 5, 1, 0) == 4);
+
+    char *word[] = {"trap", "echo", "INT", NULL};
+    CHECK(quoted_span(word, 3, 1, 0) == 2);
+
+    // '\'' не закрывает одинарные кавычки
+    char *escaped[] = {"trap", "'a'\\''", "b'", "INT", NULL};
+    CHECK(quoted_span(escaped, 4, 1, 0) == 3);
+
+    char *open[] = {"trap", "'echo", "1", NULL};
+    CHECK(quoted_span(open, 3, 1, 0) == 3);
+
+    char *alias[] = {"alias", "ll='ls", "-l'", "x=y", NULL};
+    CHECK(quoted_span(alias, 4, 1, 3) == 3);
+}
+
+/**
+ * @brief Сборка тела и снятие кавычек
+ */
+static void test_join_words(void) {
+    char buffer[MAX_INPUT_SIZE];
+
+    char *trap[] = {"trap", "'echo", "1", "2'", "EXIT", NULL};
+    CHECK_STR(join_words(trap, 1, 4, 0, buffer, sizeof(buffer)), "echo 1 2");
+
+    char *escaped[] = {"trap", "'echo", "it'\\''s'", NULL};
+    CHECK_STR(join_words(escaped, 1, 3, 0, buffer, sizeof(buffer)), "echo it's");
+
+    char *empty[] = {"trap", "''", NULL};
+    CHECK_STR(join_words(empty, 1, 2, 0, buffer, sizeof(buffer)), "");
+
+    char *alias[] = {"alias", "ll=\"ls", "-l\"", NULL};
+    CHECK_STR(join_words(alias, 1, 3, 3, buffer, sizeof(buffer)), "ls -l");
+
+    char *plain[] = {"hook", "preexec", "echo", "x", NULL};
+    CHECK_STR(join_words(plain, 2, 4, 0, buffer, sizeof(buffer)), "echo x");
+
+    // Длинное тело обрезается по размеру буфера
+    char small[4];
+    CHECK_STR(join_words(plain, 2, 4, 0, small, sizeof(small)), "ech");
+}
+
+/**
+ * @brief Количество аргументов команды не ограничено MAX_ARGS
+ */
+static void test_parse_arguments(void) {
+    char line[MAX_ARGS * 3 * 8];
+    char *end = line;
+    end += sprintf(end, "touch");
+    for (int i = 0; i < MAX_ARGS * 3; i++) {
+        end += sprintf(end, " f%d", i);
+    }
+
+    command_t cmd;
+    CHECK(parse_command(line, &cmd) == 0);
+    CHECK(cmd.argc == MAX_ARGS * 3 + 1);
+    CHECK_STR(cmd.args[cmd.argc - 1], "f191");
+    CHECK(cmd.args[cmd.argc] == NULL);
+    free_command(&cmd);
+}
+
+int main(void) {
+    test_parse_arguments();
+    test_quoted_span();
+    test_join_words();
+    return test_finish();
+}